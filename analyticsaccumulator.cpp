@@ -0,0 +1,137 @@
+/**
+ * @file analyticsaccumulator.cpp
+ * @brief Implementation of the AnalyticsAccumulator class.
+ */
+
+#include "analyticsaccumulator.h"
+#include <QDateTime>
+#include <algorithm>
+
+namespace {
+/** @brief Julian day number of 1970-01-01. */
+constexpr qint64 UNIX_EPOCH_JULIAN_DAY = 2440588;
+
+/** @brief Integer division rounding towards negative infinity. */
+qint64 floorDiv(qint64 value, qint64 divisor) {
+  qint64 quotient = value / divisor;
+  if ((value % divisor != 0) && ((value < 0) != (divisor < 0)))
+    --quotient;
+  return quotient;
+}
+
+/**
+ * @brief Adds the counters of @p source to @p target.
+ * @param keyMap If not empty, maps source keys to target keys.
+ */
+void mergeCounts(QVector<int> &target, const QVector<int> &source,
+                 const QVector<quint32> &keyMap) {
+  if (keyMap.isEmpty() && target.size() < source.size())
+    target.resize(source.size());
+  for (int key = 0; key < source.size(); ++key) {
+    const int count = source[key];
+    if (count == 0)
+      continue;
+    const quint32 mapped = keyMap.isEmpty() ? quint32(key) : keyMap[key];
+    if (mapped == AnalyticsAccumulator::INVALID_KEY)
+      continue;
+    if (mapped >= quint32(target.size()))
+      target.resize(mapped + 1);
+    target[mapped] += count;
+  }
+}
+} // namespace
+
+AnalyticsAccumulator::AnalyticsAccumulator(qint64 firstUts, qint64 lastUts)
+    : m_hourly(24, 0), m_weekly(7, 0) {
+  std::fill(std::begin(m_windowStart), std::end(m_windowStart), 0);
+  if (lastUts <= 0)
+    return;
+  // Same bounds as the QDateTime arithmetic of the per-method path:
+  // [last + 1s - N days, last + 1s).
+  m_windowEnd = lastUts + 1;
+  m_windowStart[Last7Days] = m_windowEnd - 7 * SECONDS_PER_DAY;
+  m_windowStart[Last30Days] = m_windowEnd - 30 * SECONDS_PER_DAY;
+  m_windowStart[Last90Days] = m_windowEnd - 90 * SECONDS_PER_DAY;
+  // An empty window when there is no first scrobble.
+  m_windowStart[AllTime] = firstUts > 0 ? firstUts : m_windowEnd;
+}
+
+void AnalyticsAccumulator::add(qint64 uts, quint32 artistKey,
+                               quint32 trackKey) {
+  ++m_rowCount;
+  if (artistKey != INVALID_KEY) {
+    if (artistKey >= quint32(m_artistCounts.size()))
+      m_artistCounts.resize(artistKey + 1);
+    m_artistCounts[artistKey]++;
+  }
+  if (trackKey != INVALID_KEY) {
+    if (trackKey >= quint32(m_trackCounts.size()))
+      m_trackCounts.resize(trackKey + 1);
+    m_trackCounts[trackKey]++;
+  }
+  if (uts <= 0)
+    return;
+
+  if (m_firstUts == 0)
+    m_firstUts = uts;
+  m_lastUts = uts;
+  if (uts < m_windowEnd) {
+    for (int w = 0; w < WindowCount; ++w) {
+      if (uts >= m_windowStart[w])
+        m_windowCounts[w]++;
+    }
+  }
+
+  const qint64 local = uts + localOffset(uts);
+  const qint64 day = floorDiv(local, SECONDS_PER_DAY);
+  const qint64 secondOfDay = local - day * SECONDS_PER_DAY;
+  m_hourly[int(secondOfDay / 3600)]++;
+  // 1970-01-01 was a Thursday (index 3 with Monday = 0).
+  m_weekly[int((day % 7 + 7 + 3) % 7)]++;
+  if (m_localDays.empty() || m_localDays.back() != day)
+    m_localDays.push_back(day);
+}
+
+void AnalyticsAccumulator::merge(const AnalyticsAccumulator &later,
+                                 const QVector<quint32> &trackKeyMap,
+                                 const QVector<quint32> &artistKeyMap) {
+  m_rowCount += later.m_rowCount;
+  if (m_firstUts == 0)
+    m_firstUts = later.m_firstUts;
+  if (later.m_lastUts != 0)
+    m_lastUts = later.m_lastUts;
+  for (int w = 0; w < WindowCount; ++w)
+    m_windowCounts[w] += later.m_windowCounts[w];
+  for (int i = 0; i < 24; ++i)
+    m_hourly[i] += later.m_hourly[i];
+  for (int i = 0; i < 7; ++i)
+    m_weekly[i] += later.m_weekly[i];
+
+  mergeCounts(m_artistCounts, later.m_artistCounts, artistKeyMap);
+  mergeCounts(m_trackCounts, later.m_trackCounts, trackKeyMap);
+
+  m_localDays.insert(m_localDays.end(), later.m_localDays.begin(),
+                     later.m_localDays.end());
+}
+
+QList<QDate> AnalyticsAccumulator::listenedDates() const {
+  std::vector<qint64> days = m_localDays;
+  std::sort(days.begin(), days.end());
+  days.erase(std::unique(days.begin(), days.end()), days.end());
+  QList<QDate> dates;
+  dates.reserve(days.size());
+  for (qint64 day : days)
+    dates.append(QDate::fromJulianDay(UNIX_EPOCH_JULIAN_DAY + day));
+  return dates;
+}
+
+int AnalyticsAccumulator::localOffset(qint64 uts) {
+  const qint64 bucket = floorDiv(uts, OFFSET_BUCKET_SECONDS);
+  if (bucket != m_cachedBucket) {
+    m_cachedBucket = bucket;
+    m_cachedOffset =
+        QDateTime::fromSecsSinceEpoch(bucket * OFFSET_BUCKET_SECONDS)
+            .offsetFromUtc();
+  }
+  return m_cachedOffset;
+}
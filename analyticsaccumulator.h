@@ -0,0 +1,133 @@
+#ifndef ANALYTICSACCUMULATOR_H
+#define ANALYTICSACCUMULATOR_H
+
+#include <QDate>
+#include <QList>
+#include <QVector>
+#include <array>
+#include <limits>
+#include <vector>
+
+/**
+ * @class AnalyticsAccumulator
+ * @brief Collects every statistic of AnalyticsEngine::analyzeAll() in one
+ * sequential sweep over the scrobbles.
+ * @details Each row is visited once: its identity counters are bumped and its
+ * local time is derived a single time, from which the hour, day of week and
+ * listening day all follow. The local UTC offset is cached per 15 minute
+ * bucket (every real-world time zone transition falls on a quarter hour), so
+ * the time zone database is consulted once per bucket rather than once per
+ * row. The rolling mean windows are anchored on the first and last scrobble,
+ * which the caller looks up before the sweep, so window membership is a pair
+ * of integer comparisons.
+ *
+ * Artist and track keys are opaque dense IDs; the caller resolves them to
+ * names when the results are built (see AnalyticsEngine::analyzeAll()).
+ */
+class AnalyticsAccumulator {
+  friend class IncrementalAnalytics;
+
+public:
+  /** @brief Key value meaning "no identity"; such rows are not counted. */
+  static constexpr quint32 INVALID_KEY = std::numeric_limits<quint32>::max();
+
+  /** @brief Indices of the rolling windows returned by windowCount(). */
+  enum Window { Last7Days, Last30Days, Last90Days, AllTime, WindowCount };
+  /** @brief Row counts of all rolling windows, indexed by Window. */
+  using WindowCounts = std::array<int, WindowCount>;
+
+  /**
+   * @brief Constructs an accumulator anchored on the given timestamps.
+   * @param firstUts UTC seconds of the first valid scrobble, or 0 if none.
+   * @param lastUts UTC seconds of the last valid scrobble, or 0 if none.
+   */
+  explicit AnalyticsAccumulator(qint64 firstUts = 0, qint64 lastUts = 0);
+
+  /**
+   * @brief Adds one scrobble.
+   * @details Rows with uts <= 0 are only counted for artists and tracks, as
+   * the per-method list analytics do. Rows are expected in timestamp order;
+   * out-of-order rows are still counted correctly.
+   * @param uts UTC timestamp in seconds since epoch.
+   * @param artistKey Dense artist ID, or INVALID_KEY.
+   * @param trackKey Dense (artist, track) ID, or INVALID_KEY.
+   */
+  void add(qint64 uts, quint32 artistKey, quint32 trackKey);
+
+  /**
+   * @brief Folds the partial result of a later range of rows into this one.
+   * @details Counters are summed and the first/last timestamps keep add
+   * order, so merging the partials of consecutive chunks in chunk order gives
+   * exactly the result of adding all rows to one accumulator, whatever the
+   * number of threads that produced them. Both accumulators must have been
+   * constructed with the same anchors.
+   * @param later Accumulator holding rows that follow the rows of this one.
+   * @param trackKeyMap If not empty, maps the track keys of @p later to the
+   * track keys of this accumulator (for callers whose partials number tracks
+   * independently).
+   * @param artistKeyMap If not empty, maps the artist keys of @p later to the
+   * artist keys of this accumulator.
+   */
+  void merge(const AnalyticsAccumulator &later,
+             const QVector<quint32> &trackKeyMap = QVector<quint32>(),
+             const QVector<quint32> &artistKeyMap = QVector<quint32>());
+
+  /** @brief Returns the number of rows added so far. */
+  qint64 rowCount() const { return m_rowCount; }
+  /** @brief Returns the first valid timestamp seen in add order, or 0. */
+  qint64 firstUts() const { return m_firstUts; }
+  /** @brief Returns the last valid timestamp seen in add order, or 0. */
+  qint64 lastUts() const { return m_lastUts; }
+
+  /** @brief Returns the play counts indexed by artist key. */
+  const QVector<int> &artistCounts() const { return m_artistCounts; }
+  /** @brief Returns the play counts indexed by track key. */
+  const QVector<int> &trackCounts() const { return m_trackCounts; }
+  /** @brief Returns the 24 local hour-of-day counters. */
+  const QVector<int> &hourlyCounts() const { return m_hourly; }
+  /** @brief Returns the 7 local day-of-week counters (Monday first). */
+  const QVector<int> &weeklyCounts() const { return m_weekly; }
+
+  /**
+   * @brief Returns the number of valid rows inside a rolling window.
+   * @details The windows end one second after the anchored last scrobble;
+   * AllTime starts at the anchored first scrobble.
+   */
+  int windowCount(Window window) const { return m_windowCounts[window]; }
+  /** @brief Returns the row counts of all rolling windows. */
+  const WindowCounts &windowCounts() const { return m_windowCounts; }
+
+  /** @brief Returns every local date with at least one scrobble, ascending. */
+  QList<QDate> listenedDates() const;
+
+private:
+  /**
+   * @brief Returns the local UTC offset in seconds at @p uts.
+   * @details Cached for the 15 minute bucket containing @p uts.
+   */
+  int localOffset(qint64 uts);
+
+  /** @brief Bucket size of the UTC offset cache (15 minutes). */
+  static constexpr qint64 OFFSET_BUCKET_SECONDS = 15 * 60;
+  static constexpr qint64 SECONDS_PER_DAY = 24 * 60 * 60;
+
+  qint64 m_rowCount = 0; /**< @brief Rows added so far. */
+  qint64 m_firstUts = 0; /**< @brief First valid timestamp seen. */
+  qint64 m_lastUts = 0;  /**< @brief Last valid timestamp seen. */
+  qint64 m_windowStart[WindowCount]; /**< @brief Inclusive window starts. */
+  qint64 m_windowEnd = 0; /**< @brief Exclusive end shared by all windows. */
+  WindowCounts m_windowCounts = {}; /**< @brief Rows per window. */
+  QVector<int> m_artistCounts; /**< @brief Counters by artist key. */
+  QVector<int> m_trackCounts;  /**< @brief Counters by track key. */
+  QVector<int> m_hourly;       /**< @brief Counters by local hour. */
+  QVector<int> m_weekly;       /**< @brief Counters by local weekday. */
+  std::vector<qint64>
+      m_localDays; /**< @brief Local day numbers (days since 1970-01-01),
+                      appended whenever the day changes between rows. */
+  qint64 m_cachedBucket =
+      std::numeric_limits<qint64>::min(); /**< @brief Bucket of the cached
+                                             offset. */
+  int m_cachedOffset = 0; /**< @brief Cached local UTC offset in seconds. */
+};
+
+#endif // ANALYTICSACCUMULATOR_H
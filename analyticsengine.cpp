@@ -1,9 +1,188 @@
 #include "analyticsengine.h"
+#include "analyticsaccumulator.h"
+#include "incrementalanalytics.h"
+#include "stringinterner.h"
+#include <QAnyStringView>
 #include <QDebug>
+#include <QHash>
 #include <QMetaType>
 #include <QSet>
+#include <QThreadPool>
+#include <QtConcurrent>
 #include <algorithm>
+#include <functional>
 #include <limits>
+#include <vector>
+
+namespace {
+/**
+ * @brief Orders (key, count) entries by count (descending), then display name
+ * (ascending), and keeps the first @p limit.
+ * @details Names are resolved only for entries that can still make the cut:
+ * those counted above the limit-th count plus the ties at that count.
+ * @param entries Entries with a positive count; reordered in place.
+ * @param limit Maximum number of results; -1 or 0 keeps all.
+ * @param nameOf Callable returning the display name of a key.
+ */
+template <typename Key, typename NameFn>
+SortedCounts selectTop(std::vector<std::pair<Key, int>> &entries, int limit,
+                       NameFn nameOf) {
+  const size_t keep = (limit > 0 && size_t(limit) < entries.size())
+                          ? size_t(limit)
+                          : entries.size();
+  SortedCounts result;
+  if (keep == 0) {
+    return result;
+  }
+  if (keep < entries.size()) {
+    std::nth_element(entries.begin(), entries.begin() + (keep - 1),
+                     entries.end(),
+                     [](const std::pair<Key, int> &a,
+                        const std::pair<Key, int> &b) {
+                       return a.second > b.second;
+                     });
+    const int threshold = entries[keep - 1].second;
+    entries.erase(std::partition(entries.begin(), entries.end(),
+                                 [threshold](const std::pair<Key, int> &e) {
+                                   return e.second >= threshold;
+                                 }),
+                  entries.end());
+  }
+
+  result.reserve(entries.size());
+  for (const auto &entry : entries) {
+    result.append(qMakePair(nameOf(entry.first), entry.second));
+  }
+  std::sort(result.begin(), result.end(),
+            [](const CountPair &a, const CountPair &b) {
+              if (a.second != b.second)
+                return a.second > b.second;
+              return a.first < b.first;
+            });
+  if (result.size() > qsizetype(keep)) {
+    result.erase(result.begin() + keep, result.end());
+  }
+  return result;
+}
+
+/**
+ * @brief Collects the non-zero slots of a dense counter array.
+ * @param counts Counters indexed by ID.
+ */
+std::vector<std::pair<quint32, int>>
+nonZeroEntries(const QVector<int> &counts) {
+  std::vector<std::pair<quint32, int>> entries;
+  for (int id = 0; id < counts.size(); ++id) {
+    if (counts[id] > 0)
+      entries.emplace_back(quint32(id), counts[id]);
+  }
+  return entries;
+}
+
+/**
+ * @brief Counts scrobbles per interned ID.
+ * @param scrobbles The scrobbles to count.
+ * @param idCount Number of IDs currently known to the interner.
+ * @param idOf Member pointer selecting the ID to count by.
+ * @return Counters indexed by the selected ID.
+ */
+QVector<int> countIds(const QList<ScrobbleData> &scrobbles, int idCount,
+                      quint32 ScrobbleData::*idOf) {
+  QVector<int> counts(idCount, 0);
+  for (const ScrobbleData &s : scrobbles) {
+    const quint32 id = s.*idOf;
+    if (id == StringInterner::INVALID_ID)
+      continue;
+    if (id >= quint32(counts.size()))
+      counts.resize(id + 1);
+    counts[id]++;
+  }
+  return counts;
+}
+
+/**
+ * @brief Counts scrobbles per interned artist ID.
+ * @param scrobbles The scrobbles to count.
+ * @return Counters indexed by StringInterner ID.
+ */
+QVector<int> countArtistIds(const QList<ScrobbleData> &scrobbles) {
+  return countIds(scrobbles, StringInterner::instance().size(),
+                  &ScrobbleData::artistId);
+}
+
+/**
+ * @brief Counts scrobbles per interned (artist, track) pair ID.
+ * @param scrobbles The scrobbles to count.
+ * @return Counters indexed by StringInterner pair ID.
+ */
+QVector<int> countTrackKeyIds(const QList<ScrobbleData> &scrobbles) {
+  return countIds(scrobbles, StringInterner::instance().pairCount(),
+                  &ScrobbleData::trackKeyId);
+}
+
+/**
+ * @brief Caches, per interned ID, whether its string equals a query ignoring
+ * case.
+ */
+class IdMatcher {
+public:
+  /** @param value The string to match. */
+  explicit IdMatcher(const QString &value) : m_value(value) {}
+
+  /** @brief Returns true if the string of @p id equals the query. */
+  bool matches(quint32 id) {
+    if (id == StringInterner::INVALID_ID)
+      return false;
+    if (id >= m_state.size())
+      m_state.resize(id + 1, Unknown);
+    if (m_state[id] == Unknown) {
+      bool equal = StringInterner::instance().string(id).compare(
+                       m_value, Qt::CaseInsensitive) == 0;
+      m_state[id] = equal ? Match : NoMatch;
+    }
+    return m_state[id] == Match;
+  }
+
+private:
+  enum State : char { Unknown, Match, NoMatch };
+  QString m_value;
+  std::vector<State> m_state;
+};
+
+/** @brief Half-open range [first, second) of row indices. */
+using RowRange = QPair<qsizetype, qsizetype>;
+
+/**
+ * @brief Rows per analyzeAll() chunk.
+ * @details Fixed rather than derived from the thread count, so the partials
+ * (and therefore the merged results) are the same on every machine.
+ */
+constexpr qsizetype ANALYSIS_CHUNK_ROWS = 64 * 1024;
+
+/**
+ * @brief Splits [0, rowCount) into consecutive ANALYSIS_CHUNK_ROWS ranges.
+ * @param rowCount The number of rows to split.
+ */
+QList<RowRange> chunkRanges(qsizetype rowCount) {
+  QList<RowRange> ranges;
+  for (qsizetype begin = 0; begin < rowCount; begin += ANALYSIS_CHUNK_ROWS) {
+    ranges.append(
+        qMakePair(begin, qMin(begin + ANALYSIS_CHUNK_ROWS, rowCount)));
+  }
+  return ranges;
+}
+
+/**
+ * @struct StorePartial
+ * @brief Partial analyzeAll() result of one ScrobbleStore chunk.
+ */
+struct StorePartial {
+  AnalyticsAccumulator acc; /**< @brief Counters of the chunk. */
+  std::vector<quint64>
+      trackPairs; /**< @brief Packed (artist, track) dictionary IDs indexed
+                     by the chunk-local track key. */
+};
+} // namespace
 
 AnalyticsEngine::AnalyticsEngine(QObject *parent) : QObject(parent) {}
 
@@ -16,50 +195,51 @@ AnalyticsEngine::sortMapByValue(const QMap<QString, T> &map) {
     list.append(qMakePair(it.key(), it.value()));
   }
 
-  std::sort(list.begin(), list.end(),
-            [](const QPair<QString, T> &a, const QPair<QString, T> &b) {
-              return a.second > b.second;
-            });
+  // Stable, so equal values keep the map's ascending key order.
+  std::stable_sort(list.begin(), list.end(),
+                   [](const QPair<QString, T> &a, const QPair<QString, T> &b) {
+                     return a.second > b.second;
+                   });
 
   return list;
 }
 
+template QList<QPair<QString, int>>
+AnalyticsEngine::sortMapByValue<int>(const QMap<QString, int> &map);
+
 SortedCounts
 AnalyticsEngine::getTopArtists(const QList<ScrobbleData> &scrobbles,
                                int count) {
-  QMap<QString, int> artistCounts;
-  for (const ScrobbleData &s : scrobbles) {
-    artistCounts[s.artist]++;
-  }
-  SortedCounts sortedList = sortMapByValue(artistCounts);
-  if (count > 0 && sortedList.size() > count) {
-    return sortedList.mid(0, count);
-  }
-  return sortedList;
+  std::vector<std::pair<quint32, int>> entries =
+      nonZeroEntries(countArtistIds(scrobbles));
+  StringInterner &interner = StringInterner::instance();
+  return selectTop(entries, count,
+                   [&interner](quint32 id) { return interner.string(id); });
 }
 
 SortedCounts AnalyticsEngine::getTopTracks(const QList<ScrobbleData> &scrobbles,
                                            int count) {
-  QMap<QString, int> trackCounts;
-  for (const ScrobbleData &s : scrobbles) {
-    trackCounts[QString("%1 - %2").arg(s.artist, s.track)]++;
-  }
-  SortedCounts sortedList = sortMapByValue(trackCounts);
-  if (count > 0 && sortedList.size() > count) {
-    return sortedList.mid(0, count);
-  }
-  return sortedList;
+  std::vector<std::pair<quint32, int>> entries =
+      nonZeroEntries(countTrackKeyIds(scrobbles));
+  StringInterner &interner = StringInterner::instance();
+  return selectTop(entries, count, [&interner](quint32 pairId) {
+    QPair<quint32, quint32> ids = interner.pair(pairId);
+    return QString("%1 - %2").arg(interner.string(ids.first),
+                                  interner.string(ids.second));
+  });
 }
 
 QDateTime AnalyticsEngine::findLastPlayed(const QList<ScrobbleData> &scrobbles,
                                           const QString &artist,
                                           const QString &track) {
+  // Each distinct ID is compared as a string at most once.
+  IdMatcher artistMatcher(artist);
+  IdMatcher trackMatcher(track);
   QDateTime lastPlayed;
   for (int i = scrobbles.size() - 1; i >= 0; --i) {
     const ScrobbleData &s = scrobbles[i];
-    if (s.artist.compare(artist, Qt::CaseInsensitive) == 0 &&
-        s.track.compare(track, Qt::CaseInsensitive) == 0) {
-      lastPlayed = s.timestamp;
+    if (artistMatcher.matches(s.artistId) && trackMatcher.matches(s.trackId)) {
+      lastPlayed = s.timestamp();
       break;
     }
   }
@@ -68,9 +248,12 @@ QDateTime AnalyticsEngine::findLastPlayed(const QList<ScrobbleData> &scrobbles,
 
 QMap<QString, int>
 AnalyticsEngine::getArtistPlayCounts(const QList<ScrobbleData> &scrobbles) {
+  const QVector<int> idCounts = countArtistIds(scrobbles);
+  StringInterner &interner = StringInterner::instance();
   QMap<QString, int> artistCounts;
-  for (const ScrobbleData &s : scrobbles) {
-    artistCounts[s.artist]++;
+  for (int id = 0; id < idCounts.size(); ++id) {
+    if (idCounts[id] > 0)
+      artistCounts.insert(interner.string(id), idCounts[id]);
   }
   return artistCounts;
 }
@@ -83,13 +266,19 @@ AnalyticsEngine::getMeanScrobblesPerDay(const QList<ScrobbleData> &scrobbles,
       fromUTC >= toUTC) {
     return 0.0;
   }
+  const qint64 fromUts = fromUTC.toSecsSinceEpoch();
+  const qint64 toUts = toUTC.toSecsSinceEpoch();
   int countInRange = 0;
   for (const auto &s : scrobbles) {
-    if (s.timestamp.isValid() && s.timestamp >= fromUTC &&
-        s.timestamp < toUTC) {
+    if (s.isValid() && s.uts >= fromUts && s.uts < toUts) {
       countInRange++;
     }
   }
+  return meanPerDay(countInRange, fromUTC, toUTC);
+}
+
+double AnalyticsEngine::meanPerDay(int countInRange, const QDateTime &fromUTC,
+                                   const QDateTime &toUTC) {
   if (countInRange == 0)
     return 0.0;
   qint64 secondsInRange = fromUTC.secsTo(toUTC);
@@ -108,13 +297,13 @@ AnalyticsEngine::getFirstScrobbleDate(const QList<ScrobbleData> &scrobbles) {
   if (scrobbles.isEmpty()) {
     return QDateTime();
   }
-  if (scrobbles.first().timestamp.isValid()) {
-    return scrobbles.first().timestamp;
+  if (scrobbles.first().isValid()) {
+    return scrobbles.first().timestamp();
   } else {
 
     for (const auto &s : scrobbles) {
-      if (s.timestamp.isValid())
-        return s.timestamp;
+      if (s.isValid())
+        return s.timestamp();
     }
     return QDateTime();
   }
@@ -125,13 +314,13 @@ AnalyticsEngine::getLastScrobbleDate(const QList<ScrobbleData> &scrobbles) {
   if (scrobbles.isEmpty()) {
     return QDateTime();
   }
-  if (scrobbles.last().timestamp.isValid()) {
-    return scrobbles.last().timestamp;
+  if (scrobbles.last().isValid()) {
+    return scrobbles.last().timestamp();
   } else {
 
     for (int i = scrobbles.size() - 1; i >= 0; --i) {
-      if (scrobbles[i].timestamp.isValid())
-        return scrobbles[i].timestamp;
+      if (scrobbles[i].isValid())
+        return scrobbles[i].timestamp();
     }
     return QDateTime();
   }
@@ -141,8 +330,8 @@ QVector<int> AnalyticsEngine::getScrobblesPerHourOfDay(
     const QList<ScrobbleData> &scrobbles) {
   QVector<int> counts(24, 0);
   for (const auto &s : scrobbles) {
-    if (s.timestamp.isValid()) {
-      QDateTime localTime = s.timestamp.toLocalTime();
+    if (s.isValid()) {
+      QDateTime localTime = QDateTime::fromSecsSinceEpoch(s.uts);
       int hour = localTime.time().hour();
       if (hour >= 0 && hour < 24) {
         counts[hour]++;
@@ -158,8 +347,8 @@ QVector<int> AnalyticsEngine::getScrobblesPerDayOfWeek(
     const QList<ScrobbleData> &scrobbles) {
   QVector<int> counts(7, 0);
   for (const auto &s : scrobbles) {
-    if (s.timestamp.isValid()) {
-      QDateTime localTime = s.timestamp.toLocalTime();
+    if (s.isValid()) {
+      QDateTime localTime = QDateTime::fromSecsSinceEpoch(s.uts);
       int dayOfWeek = localTime.date().dayOfWeek();
       if (dayOfWeek >= 1 && dayOfWeek <= 7) {
 
@@ -182,17 +371,27 @@ ListeningStreak AnalyticsEngine::calculateListeningStreaks(
 
   QSet<QDate> listenedDatesLocal;
   for (const auto &s : scrobbles) {
-    if (s.timestamp.isValid()) {
-      listenedDatesLocal.insert(s.timestamp.toLocalTime().date());
+    if (s.isValid()) {
+      listenedDatesLocal.insert(QDateTime::fromSecsSinceEpoch(s.uts).date());
     }
   }
 
-  if (listenedDatesLocal.isEmpty()) {
-    return result;
-  }
+  return streaksFromDates(listenedDatesLocal);
+}
 
+ListeningStreak
+AnalyticsEngine::streaksFromDates(const QSet<QDate> &listenedDatesLocal) {
   QList<QDate> sortedDates = listenedDatesLocal.values();
   std::sort(sortedDates.begin(), sortedDates.end());
+  return streaksFromSortedDates(sortedDates);
+}
+
+ListeningStreak
+AnalyticsEngine::streaksFromSortedDates(const QList<QDate> &sortedDates) {
+  ListeningStreak result;
+  if (sortedDates.isEmpty()) {
+    return result;
+  }
 
   int currentStreakLength = 0;
   QDate previousDateLocal;
@@ -249,34 +448,45 @@ ListeningStreak AnalyticsEngine::calculateListeningStreaks(
   return result;
 }
 
-QVariantMap AnalyticsEngine::analyzeAll(const QList<ScrobbleData> &scrobbles,
-                                        int topN) {
+template <typename ArtistNameFn, typename TrackNameFn>
+QVariantMap AnalyticsEngine::buildResults(
+    const AnalyticsAccumulator &acc, qint64 firstUts, qint64 lastUts,
+    const AnalyticsAccumulator::WindowCounts &windows, int topN,
+    ArtistNameFn artistName, TrackNameFn trackName) {
   QVariantMap results;
-  if (scrobbles.isEmpty()) {
-    return results;
-  }
+  const QDateTime firstDate =
+      firstUts > 0 ? QDateTime::fromSecsSinceEpoch(firstUts, Qt::UTC)
+                   : QDateTime();
+  const QDateTime lastDate =
+      lastUts > 0 ? QDateTime::fromSecsSinceEpoch(lastUts, Qt::UTC)
+                  : QDateTime();
+  std::vector<std::pair<quint32, int>> artists =
+      nonZeroEntries(acc.artistCounts());
+  std::vector<std::pair<quint32, int>> tracks =
+      nonZeroEntries(acc.trackCounts());
+
+  results["firstDate"] = QVariant::fromValue(firstDate);
+  results["lastDate"] = QVariant::fromValue(lastDate);
+  results["streak"] =
+      QVariant::fromValue(streaksFromSortedDates(acc.listenedDates()));
+  results["topArtists"] =
+      QVariant::fromValue(selectTop(artists, topN, artistName));
+  results["topTracks"] =
+      QVariant::fromValue(selectTop(tracks, topN, trackName));
+  results["hourlyData"] = QVariant::fromValue(acc.hourlyCounts());
+  results["weeklyData"] = QVariant::fromValue(acc.weeklyCounts());
 
-  results["firstDate"] = QVariant::fromValue(getFirstScrobbleDate(scrobbles));
-  results["lastDate"] = QVariant::fromValue(getLastScrobbleDate(scrobbles));
-  results["streak"] = QVariant::fromValue(calculateListeningStreaks(scrobbles));
-  results["topArtists"] = QVariant::fromValue(getTopArtists(scrobbles, topN));
-  results["topTracks"] = QVariant::fromValue(getTopTracks(scrobbles, topN));
-  results["hourlyData"] =
-      QVariant::fromValue(getScrobblesPerHourOfDay(scrobbles));
-  results["weeklyData"] =
-      QVariant::fromValue(getScrobblesPerDayOfWeek(scrobbles));
-
-  QDateTime lastDate = results["lastDate"].toDateTime();
-  QDateTime firstDate = results["firstDate"].toDateTime();
   if (lastDate.isValid()) {
     QDateTime toDateUTC = lastDate.addSecs(1);
-    QDateTime from7 = toDateUTC.addDays(-7);
-    QDateTime from30 = toDateUTC.addDays(-30);
-    QDateTime from90 = toDateUTC.addDays(-90);
-
-    results["mean7"] = getMeanScrobblesPerDay(scrobbles, from7, toDateUTC);
-    results["mean30"] = getMeanScrobblesPerDay(scrobbles, from30, toDateUTC);
-    results["mean90"] = getMeanScrobblesPerDay(scrobbles, from90, toDateUTC);
+    results["mean7"] =
+        meanPerDay(windows[AnalyticsAccumulator::Last7Days],
+                   toDateUTC.addDays(-7), toDateUTC);
+    results["mean30"] =
+        meanPerDay(windows[AnalyticsAccumulator::Last30Days],
+                   toDateUTC.addDays(-30), toDateUTC);
+    results["mean90"] =
+        meanPerDay(windows[AnalyticsAccumulator::Last90Days],
+                   toDateUTC.addDays(-90), toDateUTC);
   } else {
     results["mean7"] = 0.0;
     results["mean30"] = 0.0;
@@ -284,10 +494,320 @@ QVariantMap AnalyticsEngine::analyzeAll(const QList<ScrobbleData> &scrobbles,
   }
   if (firstDate.isValid() && lastDate.isValid()) {
     results["meanAllTime"] =
-        getMeanScrobblesPerDay(scrobbles, firstDate, lastDate.addSecs(1));
+        meanPerDay(windows[AnalyticsAccumulator::AllTime], firstDate,
+                   lastDate.addSecs(1));
   } else {
     results["meanAllTime"] = 0.0;
   }
 
   return results;
 }
+
+QVariantMap AnalyticsEngine::analyzeAll(const QList<ScrobbleData> &scrobbles,
+                                        int topN, QThreadPool *pool) {
+  if (scrobbles.isEmpty()) {
+    return QVariantMap();
+  }
+  // The window anchors are found from both ends (usually O(1)), so the
+  // rolling means can be counted during the sweep below.
+  const QDateTime first = getFirstScrobbleDate(scrobbles);
+  const QDateTime last = getLastScrobbleDate(scrobbles);
+  const qint64 firstUts = first.isValid() ? first.toSecsSinceEpoch() : 0;
+  const qint64 lastUts = last.isValid() ? last.toSecsSinceEpoch() : 0;
+
+  // Interned IDs are global, so the partials share one key space.
+  std::function<AnalyticsAccumulator(const RowRange &)> sweep =
+      [&scrobbles, firstUts, lastUts](const RowRange &range) {
+        AnalyticsAccumulator partial(firstUts, lastUts);
+        for (qsizetype i = range.first; i < range.second; ++i) {
+          const ScrobbleData &s = scrobbles[i];
+          partial.add(s.uts, s.artistId, s.trackKeyId);
+        }
+        return partial;
+      };
+  const QList<AnalyticsAccumulator> partials =
+      QtConcurrent::blockingMapped<QList<AnalyticsAccumulator>>(
+          pool ? pool : QThreadPool::globalInstance(),
+          chunkRanges(scrobbles.size()), sweep);
+  AnalyticsAccumulator acc(firstUts, lastUts);
+  for (const AnalyticsAccumulator &partial : partials) {
+    acc.merge(partial);
+  }
+
+  return buildInternedResults(acc, acc.firstUts(), acc.lastUts(),
+                              acc.windowCounts(), topN);
+}
+
+QVariantMap AnalyticsEngine::buildInternedResults(
+    const AnalyticsAccumulator &acc, qint64 firstUts, qint64 lastUts,
+    const AnalyticsAccumulator::WindowCounts &windows, int topN) {
+  StringInterner &interner = StringInterner::instance();
+  return buildResults(
+      acc, firstUts, lastUts, windows, topN,
+      [&interner](quint32 id) { return interner.string(id); },
+      [&interner](quint32 pairId) {
+        QPair<quint32, quint32> ids = interner.pair(pairId);
+        return QString("%1 - %2").arg(interner.string(ids.first),
+                                      interner.string(ids.second));
+      });
+}
+
+QVariantMap AnalyticsEngine::analyzeAll(const IncrementalAnalytics &state,
+                                        int topN) {
+  if (state.isEmpty()) {
+    return QVariantMap();
+  }
+  return buildInternedResults(state.counts(), state.firstUts(),
+                              state.lastUts(), state.windowCounts(), topN);
+}
+
+namespace {
+/**
+ * @brief Returns the index of the first store row whose uts is >= value.
+ * @param store The store, sorted by timestamp.
+ * @param value The timestamp to search for.
+ */
+qsizetype lowerBoundUts(const ScrobbleStore &store, qint64 value) {
+  qsizetype low = 0;
+  qsizetype high = store.size();
+  while (low < high) {
+    qsizetype mid = low + (high - low) / 2;
+    if (store.utsAt(mid) < value)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return low;
+}
+
+/**
+ * @brief Marks every dictionary ID whose string equals @p value, ignoring
+ * case.
+ * @param store The store whose dictionary is searched.
+ * @param value The string to match.
+ * @return One flag per dictionary ID.
+ */
+std::vector<char> matchingStringIds(const ScrobbleStore &store,
+                                    const QString &value) {
+  std::vector<char> matches(store.stringCount(), 0);
+  for (int id = 0; id < store.stringCount(); ++id) {
+    matches[id] = QAnyStringView::compare(store.string(id), value,
+                                          Qt::CaseInsensitive) == 0;
+  }
+  return matches;
+}
+
+/**
+ * @brief Counts store rows per dictionary artist ID.
+ * @param store The store to count.
+ * @return Counters indexed by the store's dictionary IDs.
+ */
+QVector<int> countStoreArtistIds(const ScrobbleStore &store) {
+  QVector<int> counts(store.stringCount(), 0);
+  const quint32 knownIds = counts.size();
+  store.forEach([&counts, knownIds](const ScrobbleRecordView &r) {
+    if (r.uts > 0 && r.artistId < knownIds)
+      counts[r.artistId]++;
+  });
+  return counts;
+}
+} // namespace
+
+SortedCounts AnalyticsEngine::getTopArtists(const ScrobbleStore &store,
+                                            int count) {
+  std::vector<std::pair<quint32, int>> entries =
+      nonZeroEntries(countStoreArtistIds(store));
+  return selectTop(entries, count, [&store](quint32 id) {
+    return store.string(id).toString();
+  });
+}
+
+SortedCounts AnalyticsEngine::getTopTracks(const ScrobbleStore &store,
+                                           int count) {
+  // Count by packed (artist ID, track ID) so no string is touched per row.
+  QHash<quint64, int> pairCounts;
+  store.forEach([&pairCounts](const ScrobbleRecordView &r) {
+    if (r.uts > 0)
+      pairCounts[(quint64(r.artistId) << 32) | r.trackId]++;
+  });
+  std::vector<std::pair<quint64, int>> entries;
+  entries.reserve(pairCounts.size());
+  for (auto it = pairCounts.constBegin(); it != pairCounts.constEnd(); ++it)
+    entries.emplace_back(it.key(), it.value());
+  return selectTop(entries, count, [&store](quint64 key) {
+    return QString("%1 - %2").arg(store.string(quint32(key >> 32)).toString(),
+                                  store.string(quint32(key)).toString());
+  });
+}
+
+QDateTime AnalyticsEngine::findLastPlayed(const ScrobbleStore &store,
+                                          const QString &artist,
+                                          const QString &track) {
+  const std::vector<char> artistMatches = matchingStringIds(store, artist);
+  const std::vector<char> trackMatches = matchingStringIds(store, track);
+  const quint32 knownIds = store.stringCount();
+  QDateTime lastPlayed;
+  store.forEachReverse([&](const ScrobbleRecordView &r) {
+    if (r.uts > 0 && r.artistId < knownIds && r.trackId < knownIds &&
+        artistMatches[r.artistId] && trackMatches[r.trackId]) {
+      lastPlayed = r.timestamp();
+      return false;
+    }
+    return true;
+  });
+  return lastPlayed;
+}
+
+QMap<QString, int>
+AnalyticsEngine::getArtistPlayCounts(const ScrobbleStore &store) {
+  const QVector<int> idCounts = countStoreArtistIds(store);
+  QMap<QString, int> artistCounts;
+  for (int id = 0; id < idCounts.size(); ++id) {
+    if (idCounts[id] > 0)
+      artistCounts.insert(store.string(id).toString(), idCounts[id]);
+  }
+  return artistCounts;
+}
+
+double AnalyticsEngine::getMeanScrobblesPerDay(const ScrobbleStore &store,
+                                               const QDateTime &fromUTC,
+                                               const QDateTime &toUTC) {
+  if (store.isEmpty() || !fromUTC.isValid() || !toUTC.isValid() ||
+      fromUTC >= toUTC) {
+    return 0.0;
+  }
+  qint64 fromUts = qMax<qint64>(fromUTC.toSecsSinceEpoch(), 1);
+  qint64 toUts = toUTC.toSecsSinceEpoch();
+  int countInRange = 0;
+  if (toUts > fromUts) {
+    countInRange =
+        static_cast<int>(lowerBoundUts(store, toUts) -
+                         lowerBoundUts(store, fromUts));
+  }
+  return meanPerDay(countInRange, fromUTC, toUTC);
+}
+
+QDateTime AnalyticsEngine::getFirstScrobbleDate(const ScrobbleStore &store) {
+  qsizetype first = lowerBoundUts(store, 1);
+  if (first >= store.size()) {
+    return QDateTime();
+  }
+  return store.at(first).timestamp();
+}
+
+QDateTime AnalyticsEngine::getLastScrobbleDate(const ScrobbleStore &store) {
+  if (store.isEmpty() || store.utsAt(store.size() - 1) <= 0) {
+    return QDateTime();
+  }
+  return store.at(store.size() - 1).timestamp();
+}
+
+QVector<int>
+AnalyticsEngine::getScrobblesPerHourOfDay(const ScrobbleStore &store) {
+  QVector<int> counts(24, 0);
+  store.forEach([&counts](const ScrobbleRecordView &r) {
+    if (r.uts > 0)
+      counts[QDateTime::fromSecsSinceEpoch(r.uts).time().hour()]++;
+  });
+  return counts;
+}
+
+QVector<int>
+AnalyticsEngine::getScrobblesPerDayOfWeek(const ScrobbleStore &store) {
+  QVector<int> counts(7, 0);
+  store.forEach([&counts](const ScrobbleRecordView &r) {
+    if (r.uts > 0)
+      counts[QDateTime::fromSecsSinceEpoch(r.uts).date().dayOfWeek() - 1]++;
+  });
+  return counts;
+}
+
+ListeningStreak
+AnalyticsEngine::calculateListeningStreaks(const ScrobbleStore &store) {
+  QSet<QDate> listenedDatesLocal;
+  store.forEach([&listenedDatesLocal](const ScrobbleRecordView &r) {
+    if (r.uts > 0)
+      listenedDatesLocal.insert(QDateTime::fromSecsSinceEpoch(r.uts).date());
+  });
+  return streaksFromDates(listenedDatesLocal);
+}
+
+AnalyticsAccumulator
+AnalyticsEngine::accumulate(const ScrobbleStore &store, qint64 firstUts,
+                            qint64 lastUts, QThreadPool *pool,
+                            std::vector<quint64> &trackPairs) {
+  std::function<StorePartial(const RowRange &)> sweep =
+      [&store, firstUts, lastUts](const RowRange &range) {
+        StorePartial partial;
+        partial.acc = AnalyticsAccumulator(firstUts, lastUts);
+        // Dictionary IDs are dense per store, but (artist, track) pairs are
+        // not: give each distinct pair a dense key on first sight.
+        QHash<quint64, quint32> trackKeys;
+        const quint32 knownIds = store.stringCount();
+        store.forEachInRange(
+            range.first, range.second, [&](const ScrobbleRecordView &r) {
+              if (r.uts <= 0)
+                return;
+              const quint64 pair = (quint64(r.artistId) << 32) | r.trackId;
+              auto it = trackKeys.constFind(pair);
+              if (it == trackKeys.constEnd()) {
+                it = trackKeys.insert(pair, quint32(partial.trackPairs.size()));
+                partial.trackPairs.push_back(pair);
+              }
+              partial.acc.add(r.uts,
+                              r.artistId < knownIds
+                                  ? r.artistId
+                                  : AnalyticsAccumulator::INVALID_KEY,
+                              it.value());
+            });
+        return partial;
+      };
+  const QList<StorePartial> partials =
+      QtConcurrent::blockingMapped<QList<StorePartial>>(
+          pool ? pool : QThreadPool::globalInstance(),
+          chunkRanges(store.size()), sweep);
+
+  // Renumber each partial's track keys into one key space, in chunk order so
+  // the keys do not depend on the thread count.
+  AnalyticsAccumulator acc(firstUts, lastUts);
+  QHash<quint64, quint32> trackKeys;
+  trackPairs.clear();
+  for (const StorePartial &partial : partials) {
+    QVector<quint32> keyMap(partial.trackPairs.size());
+    for (size_t key = 0; key < partial.trackPairs.size(); ++key) {
+      const quint64 pair = partial.trackPairs[key];
+      auto it = trackKeys.constFind(pair);
+      if (it == trackKeys.constEnd()) {
+        it = trackKeys.insert(pair, quint32(trackPairs.size()));
+        trackPairs.push_back(pair);
+      }
+      keyMap[key] = it.value();
+    }
+    acc.merge(partial.acc, keyMap);
+  }
+  return acc;
+}
+
+QVariantMap AnalyticsEngine::analyzeAll(const ScrobbleStore &store, int topN,
+                                        QThreadPool *pool) {
+  if (store.isEmpty()) {
+    return QVariantMap();
+  }
+  const QDateTime first = getFirstScrobbleDate(store);
+  const QDateTime last = getLastScrobbleDate(store);
+  std::vector<quint64> trackPairs;
+  const AnalyticsAccumulator acc =
+      accumulate(store, first.isValid() ? first.toSecsSinceEpoch() : 0,
+                 last.isValid() ? last.toSecsSinceEpoch() : 0, pool,
+                 trackPairs);
+
+  return buildResults(
+      acc, acc.firstUts(), acc.lastUts(), acc.windowCounts(), topN,
+      [&store](quint32 id) { return store.string(id).toString(); },
+      [&store, &trackPairs](quint32 key) {
+        const quint64 pair = trackPairs[key];
+        return QString("%1 - %2").arg(
+            store.string(quint32(pair >> 32)).toString(),
+            store.string(quint32(pair)).toString());
+      });
+}
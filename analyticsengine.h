@@ -1,15 +1,22 @@
 #ifndef ANALYTICSENGINE_H
 #define ANALYTICSENGINE_H
 
+#include "analyticsaccumulator.h"
 #include "scrobbledata.h"
+#include "scrobblestore.h"
 #include <QDate>
 #include <QDateTime>
 #include <QList>
 #include <QMap>
 #include <QObject>
 #include <QPair>
+#include <QSet>
 #include <QVariantMap>
 #include <QVector>
+#include <vector>
+
+class IncrementalAnalytics;
+class QThreadPool;
 
 using CountPair = QPair<QString, int>;
 using SortedCounts = QList<CountPair>;
@@ -37,7 +44,11 @@ struct ListeningStreak {
  * times, calculate listening streaks, determine mean scrobbles per day, and
  * analyze listening patterns by time of day or day of week. Assumes input
  * scrobble lists are sorted by timestamp (important for some calculations like
- * first/last date).
+ * first/last date). Every method also has an overload taking a memory-mapped
+ * ScrobbleStore, which iterates the mapped rows directly instead of a
+ * materialized QList<ScrobbleData>; both overloads return identical results.
+ * Counting runs over dense integer arrays indexed by interned string IDs (see
+ * StringInterner); names are resolved only for the returned entries.
  * @inherits QObject
  */
 class AnalyticsEngine : public QObject {
@@ -55,7 +66,7 @@ public:
    * @param count The maximum number of top artists to return. If -1 or 0,
    * returns all artists.
    * @return A SortedCounts list containing pairs of artist names and their play
-   * counts, sorted descending by count.
+   * counts, sorted descending by count; equal counts are ordered by name.
    */
   SortedCounts getTopArtists(const QList<ScrobbleData> &scrobbles,
                              int count = 50);
@@ -65,7 +76,8 @@ public:
    * @param count The maximum number of top tracks to return. If -1 or 0,
    * returns all tracks.
    * @return A SortedCounts list containing pairs of track identifiers ("Artist
-   * - Track") and their play counts, sorted descending by count.
+   * - Track") and their play counts, sorted descending by count; equal counts
+   * are ordered by name.
    */
   SortedCounts getTopTracks(const QList<ScrobbleData> &scrobbles,
                             int count = 50);
@@ -143,14 +155,19 @@ public:
   calculateListeningStreaks(const QList<ScrobbleData> &scrobbles);
   /**
    * @brief Calculates a comprehensive set of statistics.
-   * @details This method calls other analysis methods of this class to compute
-   * various statistics and aggregates them into a single map. It's suitable for
-   * running in a background thread to avoid blocking the UI. Requires necessary
-   * custom types (like ListeningStreak, SortedCounts) to be registered with
-   * QMetaType if used across threads or stored in QVariant.
+   * @details Computes the same statistics as the individual methods of this
+   * class in a single pass over the scrobbles (see AnalyticsAccumulator) and
+   * aggregates them into a single map. The rows are split into fixed-size
+   * chunks that are swept in parallel; the partial accumulators are merged in
+   * chunk order, so the results are identical for any thread count. It's
+   * suitable for running in a background thread to avoid blocking the UI.
+   * Requires necessary custom types (like ListeningStreak, SortedCounts) to be
+   * registered with QMetaType if used across threads or stored in QVariant.
    * @param scrobbles The list of scrobble data to analyze.
    * @param topN The number of top artists/tracks to compute and include in the
    * results.
+   * @param pool Thread pool for the chunk sweeps; nullptr uses the global
+   * instance.
    * @return A QVariantMap containing various calculated statistics.
    *         Keys include: "firstDate" (QDateTime), "lastDate" (QDateTime),
    *         "streak" (QVariant containing ListeningStreak),
@@ -160,10 +177,69 @@ public:
    *         "mean7" (double, avg scrobbles/day for last 7 days), etc.
    *         Returns an empty map if the input scrobbles list is empty.
    */
-  QVariantMap analyzeAll(const QList<ScrobbleData> &scrobbles, int topN = 100);
+  QVariantMap analyzeAll(const QList<ScrobbleData> &scrobbles, int topN = 100,
+                         QThreadPool *pool = nullptr);
+
+  /** @brief ScrobbleStore overload of getTopArtists(). */
+  SortedCounts getTopArtists(const ScrobbleStore &store, int count = 50);
+  /** @brief ScrobbleStore overload of getTopTracks(). */
+  SortedCounts getTopTracks(const ScrobbleStore &store, int count = 50);
+  /**
+   * @brief ScrobbleStore overload of findLastPlayed().
+   * @details Matching dictionary IDs are resolved once, then the mapped rows
+   * are scanned newest first using integer comparisons only.
+   */
+  QDateTime findLastPlayed(const ScrobbleStore &store, const QString &artist,
+                           const QString &track);
+  /** @brief ScrobbleStore overload of getArtistPlayCounts(). */
+  QMap<QString, int> getArtistPlayCounts(const ScrobbleStore &store);
+  /**
+   * @brief ScrobbleStore overload of getMeanScrobblesPerDay().
+   * @details The range bounds are binary searched in the sorted store.
+   */
+  double getMeanScrobblesPerDay(const ScrobbleStore &store,
+                                const QDateTime &from, const QDateTime &to);
+  /** @brief ScrobbleStore overload of getFirstScrobbleDate(). */
+  QDateTime getFirstScrobbleDate(const ScrobbleStore &store);
+  /** @brief ScrobbleStore overload of getLastScrobbleDate(). */
+  QDateTime getLastScrobbleDate(const ScrobbleStore &store);
+  /** @brief ScrobbleStore overload of getScrobblesPerHourOfDay(). */
+  QVector<int> getScrobblesPerHourOfDay(const ScrobbleStore &store);
+  /** @brief ScrobbleStore overload of getScrobblesPerDayOfWeek(). */
+  QVector<int> getScrobblesPerDayOfWeek(const ScrobbleStore &store);
+  /** @brief ScrobbleStore overload of calculateListeningStreaks(). */
+  ListeningStreak calculateListeningStreaks(const ScrobbleStore &store);
+  /** @brief ScrobbleStore overload of analyzeAll(). */
+  QVariantMap analyzeAll(const ScrobbleStore &store, int topN = 100,
+                         QThreadPool *pool = nullptr);
+  /**
+   * @brief IncrementalAnalytics overload of analyzeAll().
+   * @details Only builds the result map from the retained counters, so its
+   * cost does not depend on the size of the history.
+   */
+  QVariantMap analyzeAll(const IncrementalAnalytics &state, int topN = 100);
+
+  /**
+   * @brief Sweeps a store into a single accumulator, in parallel chunks.
+   * @details Artist keys are the store's dictionary IDs; track keys are dense
+   * indices into @p trackPairs. Rows with uts <= 0 are skipped.
+   * @param store The store to sweep.
+   * @param firstUts Window anchor: the first valid timestamp, or 0.
+   * @param lastUts Window anchor: the last valid timestamp, or 0.
+   * @param pool Thread pool for the chunk sweeps; nullptr uses the global
+   * instance.
+   * @param[out] trackPairs Receives the packed (artist << 32 | track)
+   * dictionary IDs indexed by track key.
+   * @return The merged accumulator.
+   */
+  static AnalyticsAccumulator accumulate(const ScrobbleStore &store,
+                                         qint64 firstUts, qint64 lastUts,
+                                         QThreadPool *pool,
+                                         std::vector<quint64> &trackPairs);
 
   /**
    * @brief Helper template function to sort a QMap by its values (descending).
+   * @details The sort is stable, so equal values keep ascending key order.
    * @tparam T The value type in the map (must be comparable with '>').
    * @param map The QMap to sort.
    * @return A QList of QPair<QString, T> sorted by the T value in descending
@@ -171,6 +247,53 @@ public:
    */
   template <typename T>
   static QList<QPair<QString, T>> sortMapByValue(const QMap<QString, T> &map);
+
+private:
+  /**
+   * @brief Turns a filled accumulator into the analyzeAll() result map.
+   * @param acc The accumulator holding the counters of the scrobbles.
+   * @param firstUts The first valid timestamp, or 0.
+   * @param lastUts The last valid timestamp, or 0.
+   * @param windows Row counts of the rolling windows ending at @p lastUts.
+   * @param topN The number of top artists/tracks to include.
+   * @param artistName Callable resolving an artist key to its name.
+   * @param trackName Callable resolving a track key to "Artist - Track".
+   */
+  template <typename ArtistNameFn, typename TrackNameFn>
+  static QVariantMap
+  buildResults(const AnalyticsAccumulator &acc, qint64 firstUts,
+               qint64 lastUts,
+               const AnalyticsAccumulator::WindowCounts &windows, int topN,
+               ArtistNameFn artistName, TrackNameFn trackName);
+  /**
+   * @brief buildResults() for accumulators keyed by StringInterner IDs.
+   */
+  static QVariantMap
+  buildInternedResults(const AnalyticsAccumulator &acc, qint64 firstUts,
+                       qint64 lastUts,
+                       const AnalyticsAccumulator::WindowCounts &windows,
+                       int topN);
+
+  /**
+   * @brief Computes streaks from the set of local dates with scrobbles.
+   * @param listenedDatesLocal Every local date with at least one scrobble.
+   */
+  static ListeningStreak
+  streaksFromDates(const QSet<QDate> &listenedDatesLocal);
+  /**
+   * @brief Computes streaks from the distinct local dates with scrobbles.
+   * @param sortedDates Every local date with at least one scrobble, ascending
+   * and without duplicates.
+   */
+  static ListeningStreak
+  streaksFromSortedDates(const QList<QDate> &sortedDates);
+
+  /**
+   * @brief Converts a scrobble count inside a range into a per-day mean.
+   * @param countInRange Number of scrobbles inside [fromUTC, toUTC).
+   */
+  static double meanPerDay(int countInRange, const QDateTime &fromUTC,
+                           const QDateTime &toUTC);
 };
 
 #endif
@@ -0,0 +1,62 @@
+/**
+ * @file benchanalyticsengine.cpp
+ * @brief Benchmarks AnalyticsEngine::analyzeAll() at different thread counts.
+ * @details Run with e.g. `bench_analyticsengine -median 5` to compare the
+ * chunked analysis on 1, 2, 4 and 8 worker threads over a synthetic history.
+ */
+
+#include <QDateTime>
+#include <QThreadPool>
+#include <QtTest>
+
+#include "analyticsengine.h"
+#include "scrobbledata.h"
+
+class BenchAnalyticsEngine : public QObject {
+  Q_OBJECT
+
+private:
+  AnalyticsEngine engine;
+  QList<ScrobbleData> m_scrobbles;
+
+private slots:
+  void initTestCase();
+  void benchAnalyzeAll_data();
+  void benchAnalyzeAll();
+};
+
+void BenchAnalyticsEngine::initTestCase() {
+  // About ten years of history at ~270 scrobbles a day.
+  const int rowCount = 1000000;
+  const qint64 start =
+      QDateTime(QDate(2015, 1, 1), QTime(0, 0), Qt::UTC).toSecsSinceEpoch();
+  m_scrobbles.reserve(rowCount);
+  for (int i = 0; i < rowCount; ++i) {
+    const int artist = (i * 7919) % 5000;
+    m_scrobbles << ScrobbleData(QString("Artist %1").arg(artist),
+                                QString("Track %1").arg((i * 104729) % 40000),
+                                QString("Album %1").arg(artist % 900),
+                                start + qint64(i) * 320);
+  }
+}
+
+void BenchAnalyticsEngine::benchAnalyzeAll_data() {
+  QTest::addColumn<int>("threads");
+  QTest::newRow("1 thread") << 1;
+  QTest::newRow("2 threads") << 2;
+  QTest::newRow("4 threads") << 4;
+  QTest::newRow("8 threads") << 8;
+}
+
+void BenchAnalyticsEngine::benchAnalyzeAll() {
+  QFETCH(int, threads);
+  QThreadPool pool;
+  pool.setMaxThreadCount(threads);
+  QVariantMap results;
+  QBENCHMARK { results = engine.analyzeAll(m_scrobbles, 100, &pool); }
+  QVERIFY(!results.isEmpty());
+}
+
+QTEST_MAIN(BenchAnalyticsEngine)
+
+#include "benchanalyticsengine.moc"
@@ -0,0 +1,158 @@
+/**
+ * @file benchjsonparser.cpp
+ * @brief Benchmarks ScrobbleJsonParser against the QJsonDocument decoding it
+ * replaced.
+ * @details Run with e.g. `bench_jsonparser -median 5`. Inputs are a legacy
+ * JSON week file with 5000 entries and a `user.getrecenttracks` page with 200
+ * tracks shaped like a real response (images, MBIDs, URLs, a now playing
+ * track).
+ */
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtTest>
+
+#include "scrobbledata.h"
+#include "scrobblejsonparser.h"
+
+class BenchJsonParser : public QObject {
+  Q_OBJECT
+
+private:
+  QByteArray m_weekFile;
+  QByteArray m_apiPage;
+
+private slots:
+  void initTestCase();
+  void benchWeekFile_document();
+  void benchWeekFile_streaming();
+  void benchApiPage_document();
+  void benchApiPage_streaming();
+};
+
+void BenchJsonParser::initTestCase() {
+  const qint64 start = 1709510400;
+  QJsonArray week;
+  for (int i = 0; i < 5000; ++i) {
+    QJsonObject obj;
+    obj["artist"] = QString("Artist %1").arg((i * 7919) % 800);
+    obj["track"] = QString("Track \"%1\" – live").arg((i * 104729) % 3000);
+    obj["album"] = QString("Album %1").arg((i * 7919) % 300);
+    obj["uts"] = start + qint64(i) * 120;
+    week.append(obj);
+  }
+  m_weekFile = QJsonDocument(week).toJson(QJsonDocument::Compact);
+
+  QJsonArray tracks;
+  for (int i = 0; i < 201; ++i) {
+    auto text = [](const QString &value) {
+      return QJsonObject{{"mbid", ""}, {"#text", value}};
+    };
+    QJsonArray images;
+    for (const char *size : {"small", "medium", "large", "extralarge"}) {
+      images.append(QJsonObject{
+          {"size", size},
+          {"#text", "https://lastfm.freetls.fastly.net/i/u/34s/"
+                    "2a96cbd8b46e442fc41c2b86b821562f.png"}});
+    }
+    QJsonObject track{{"artist", text(QString("Artist %1").arg(i % 40))},
+                      {"streamable", "0"},
+                      {"image", images},
+                      {"mbid", "4b5e1a7c-0c7d-4e38-9d5b-2f9b7e5a1c3d"},
+                      {"album", text(QString("Album %1").arg(i % 25))},
+                      {"name", QString("Track %1").arg(i)},
+                      {"url", "https://www.last.fm/music/Artist/_/Track"}};
+    if (i == 0) {
+      track["@attr"] = QJsonObject{{"nowplaying", "true"}};
+    } else {
+      const qint64 uts = start - qint64(i) * 200;
+      track["date"] = QJsonObject{{"uts", QString::number(uts)},
+                                  {"#text", "04 Mar 2024, 00:00"}};
+    }
+    tracks.append(track);
+  }
+  QJsonObject recentTracks{
+      {"track", tracks},
+      {"@attr", QJsonObject{{"user", "someone"},
+                            {"totalPages", "312"},
+                            {"page", "1"},
+                            {"perPage", "200"},
+                            {"total", "62400"}}}};
+  m_apiPage = QJsonDocument(QJsonObject{{"recenttracks", recentTracks}})
+                  .toJson(QJsonDocument::Compact);
+}
+
+void BenchJsonParser::benchWeekFile_document() {
+  QList<ScrobbleData> rows;
+  QBENCHMARK {
+    rows.clear();
+    const QJsonArray array = QJsonDocument::fromJson(m_weekFile).array();
+    for (const QJsonValue &val : array) {
+      QJsonObject obj = val.toObject();
+      if (obj.contains("uts") && obj.contains("artist") &&
+          obj.contains("track")) {
+        qint64 uts = obj["uts"].toInteger();
+        if (uts > 0) {
+          rows.append(ScrobbleData(obj["artist"].toString(),
+                                   obj["track"].toString(),
+                                   obj["album"].toString(), uts));
+        }
+      }
+    }
+  }
+  QCOMPARE(rows.size(), qsizetype(5000));
+}
+
+void BenchJsonParser::benchWeekFile_streaming() {
+  QList<ScrobbleData> rows;
+  QString errorMsg;
+  QBENCHMARK {
+    rows.clear();
+    QVERIFY(ScrobbleJsonParser::parseWeekArray(m_weekFile, rows, errorMsg));
+  }
+  QCOMPARE(rows.size(), qsizetype(5000));
+}
+
+void BenchJsonParser::benchApiPage_document() {
+  QList<ScrobbleData> rows;
+  int totalPages = 0;
+  QBENCHMARK {
+    rows.clear();
+    QJsonObject rootObj = QJsonDocument::fromJson(m_apiPage).object();
+    QJsonObject recentTracksObj = rootObj["recenttracks"].toObject();
+    totalPages =
+        recentTracksObj["@attr"].toObject()["totalPages"].toString().toInt();
+    const QJsonArray tracksArray = recentTracksObj["track"].toArray();
+    for (const QJsonValue &value : tracksArray) {
+      QJsonObject trackObj = value.toObject();
+      if (trackObj.contains("@attr") &&
+          trackObj["@attr"].toObject()["nowplaying"].toString() == "true")
+        continue;
+      qint64 uts = trackObj["date"].toObject()["uts"].toString().toLongLong();
+      if (uts > 0) {
+        rows.append(
+            ScrobbleData(trackObj["artist"].toObject()["#text"].toString(),
+                         trackObj["name"].toString(),
+                         trackObj["album"].toObject()["#text"].toString(),
+                         uts));
+      }
+    }
+  }
+  QCOMPARE(rows.size(), qsizetype(200));
+  QCOMPARE(totalPages, 312);
+}
+
+void BenchJsonParser::benchApiPage_streaming() {
+  ScrobbleJsonParser::RecentTracksPage page;
+  QString errorMsg;
+  QBENCHMARK {
+    QVERIFY(ScrobbleJsonParser::parseRecentTracks(m_apiPage, page, errorMsg));
+  }
+  QCOMPARE(page.scrobbles.size(), qsizetype(200));
+  QCOMPARE(page.totalPages, 312);
+}
+
+QTEST_MAIN(BenchJsonParser)
+
+#include "benchjsonparser.moc"
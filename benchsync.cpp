@@ -0,0 +1,217 @@
+/**
+ * @file benchsync.cpp
+ * @brief End-to-end sync benchmark: LastFmManager fetching from a local
+ * MockLastFmServer into a DatabaseManager on a temporary directory.
+ * @details Run with `bench_sync`. Each row syncs a synthetic history once and
+ * reports the wall time as the benchmark result, plus throughput in scrobbles
+ * per second (first request until every page is journaled and folded into the
+ * week files) and the per-page latency from the last request of a page until
+ * its save completed (median, p95, p99, max). Rows at Last.fm's real request
+ * budget show the throughput the rate limit allows; rows with a lifted
+ * budget show what the pipeline itself sustains. Every row also reports the
+ * connections the server accepted and the response body bytes on the wire
+ * (checked against the bytes the server sent) against their decoded size;
+ * the two 2000-page rows compare a compressed import with an uncompressed
+ * one, and the compressed row must move fewer bytes than it decodes.
+ * Windowed rows import the same history with
+ * LastFmManager::startWindowedImport(), saving one four-week window at a
+ * time, and report the window count instead of page latencies. The synthetic
+ * history has one scrobble every 30 minutes, so 40000 tracks span about two
+ * and a half years. Every row also reports how long the network thread and
+ * the parser pool were busy; the 1000-track rows (beyond Last.fm's limit of
+ * 200, which the mock server does not enforce) compare one parser with four.
+ */
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QTemporaryDir>
+#include <QtTest>
+#include <algorithm>
+
+#include "databasemanager.h"
+#include "lastfmmanager.h"
+#include "mocklastfmserver.h"
+
+class BenchSync : public QObject {
+  Q_OBJECT
+
+private slots:
+  void benchSync_data();
+  void benchSync();
+};
+
+void BenchSync::benchSync_data() {
+  QTest::addColumn<int>("tracks");
+  QTest::addColumn<int>("latencyMs");
+  QTest::addColumn<double>("errorRate");
+  QTest::addColumn<double>("requestsPerSecond");
+  QTest::addColumn<int>("pagesInFlight");
+  QTest::addColumn<bool>("compressed");
+  QTest::addColumn<bool>("windowed");
+  QTest::addColumn<int>("pageLimit");
+  QTest::addColumn<int>("parsers");
+
+  QTest::newRow("lastfm budget, 50 ms")
+      << 20000 << 50 << 0.0 << 5.0 << 4 << true << false << 200 << 4;
+  QTest::newRow("unlimited, 0 ms, serial")
+      << 40000 << 0 << 0.0 << 1000.0 << 1 << true << false << 200 << 4;
+  QTest::newRow("unlimited, 0 ms")
+      << 40000 << 0 << 0.0 << 1000.0 << 4 << true << false << 200 << 4;
+  QTest::newRow("unlimited, 100 ms")
+      << 40000 << 100 << 0.0 << 1000.0 << 4 << true << false << 200 << 4;
+  QTest::newRow("unlimited, 100 ms, 5% errors")
+      << 40000 << 100 << 0.05 << 1000.0 << 4 << true << false << 200 << 4;
+  QTest::newRow("2000 pages, identity")
+      << 400000 << 10 << 0.0 << 1000.0 << 4 << false << false << 200 << 4;
+  QTest::newRow("2000 pages, deflate")
+      << 400000 << 10 << 0.0 << 1000.0 << 4 << true << false << 200 << 4;
+  QTest::newRow("unlimited, 100 ms, windowed")
+      << 40000 << 100 << 0.0 << 1000.0 << 4 << true << true << 200 << 4;
+  QTest::newRow("unlimited, 100 ms, windowed, 16 in flight")
+      << 40000 << 100 << 0.0 << 1000.0 << 16 << true << true << 200 << 4;
+  QTest::newRow("1000-track pages, 1 parser")
+      << 100000 << 10 << 0.0 << 1000.0 << 4 << true << false << 1000 << 1;
+  QTest::newRow("1000-track pages, 4 parsers")
+      << 100000 << 10 << 0.0 << 1000.0 << 4 << true << false << 1000 << 4;
+}
+
+void BenchSync::benchSync() {
+  QFETCH(int, tracks);
+  QFETCH(int, latencyMs);
+  QFETCH(double, errorRate);
+  QFETCH(double, requestsPerSecond);
+  QFETCH(int, pagesInFlight);
+  QFETCH(bool, compressed);
+  QFETCH(bool, windowed);
+  QFETCH(int, pageLimit);
+  QFETCH(int, parsers);
+  const QString username = "benchuser";
+
+  MockLastFmServer server;
+  server.setTrackCount(tracks);
+  server.setTrackSpacingSecs(30 * 60);
+  server.setLatencyMs(latencyMs);
+  server.setErrorRate(errorRate);
+  server.setCompression(compressed ? MockLastFmServer::Compression::Gzip
+                                   : MockLastFmServer::Compression::None);
+  QVERIFY(server.listen());
+
+  QTemporaryDir tempDir;
+  QVERIFY(tempDir.isValid());
+  DatabaseManager database(tempDir.path());
+  LastFmManager lastFm;
+  lastFm.setup("benchkey", username);
+  lastFm.setApiBaseUrl(server.baseUrl());
+  lastFm.setRequestsPerSecond(requestsPerSecond);
+  lastFm.setMaxPagesInFlight(pagesInFlight);
+  lastFm.setPageLimit(pageLimit);
+  lastFm.setParserThreads(parsers);
+
+  QElapsedTimer clock;
+  QHash<int, qint64> lastRequestMs;
+  QList<qint64> pageLatencyMs;
+  qint64 savedScrobbles = 0;
+  bool fetchDone = false;
+  bool saveIdle = false;
+  QString error;
+
+  connect(&server, &MockLastFmServer::requestReceived, this,
+          [&](int page) { lastRequestMs[page] = clock.elapsed(); });
+  // Wired like MainWindow: pages go from the parser threads straight into
+  // the save queue.
+  connect(&lastFm, &LastFmManager::pageReadyForSaving, &database,
+          &DatabaseManager::saveScrobblesAsync, Qt::DirectConnection);
+  connect(&lastFm, &LastFmManager::importWindowReady, &database,
+          &DatabaseManager::saveScrobblesAsync, Qt::DirectConnection);
+  connect(&database, &DatabaseManager::scrobblesSaved, this,
+          [&](const QString &, const QList<ScrobbleData> &scrobbles) {
+            savedScrobbles += scrobbles.size();
+          });
+  connect(&database, &DatabaseManager::saveQueueDepthChanged, &lastFm,
+          &LastFmManager::setDownstreamDepth);
+  int windows = 0;
+  connect(&database, &DatabaseManager::pageSaveCompleted, this, [&](int page) {
+    ++windows;
+    pageLatencyMs.append(clock.elapsed() - lastRequestMs.value(page));
+  });
+  connect(&database, &DatabaseManager::pageSaveFailed, this,
+          [&](int, const QString &message) { error = message; });
+  connect(&database, &DatabaseManager::saveQueueIdle, this,
+          [&]() { saveIdle = !database.isSaveInProgress(); });
+  connect(&lastFm, &LastFmManager::fetchError, this,
+          [&](const QString &message) { error = message; });
+  connect(&lastFm, &LastFmManager::fetchFinished, this, [&]() {
+    fetchDone = true;
+    saveIdle = !database.isSaveInProgress();
+  });
+
+  clock.start();
+  if (windowed)
+    lastFm.startWindowedImport(0, 0, {});
+  else
+    lastFm.startInitialOrResumeFetch(1, 0);
+  QTRY_VERIFY_WITH_TIMEOUT((fetchDone && saveIdle) || !error.isEmpty(),
+                           10 * 60 * 1000);
+  const qint64 elapsedMs = qMax<qint64>(1, clock.elapsed());
+  QVERIFY2(error.isEmpty(), qPrintable(error));
+
+  const int pages = (tracks + pageLimit - 1) / pageLimit;
+  QCOMPARE(savedScrobbles, qint64(tracks));
+  QCOMPARE(database.getLastSyncTimestamp(username), server.newestTimestamp());
+  // Bodies are counted as received, before the worker inflates them.
+  const LastFmManager::TransferStats transfer = lastFm.transferStats();
+  QCOMPARE(transfer.wireBytes, server.bodyBytesSent());
+  if (compressed)
+    QVERIFY(transfer.wireBytes < transfer.decodedBytes);
+  else
+    QCOMPARE(transfer.wireBytes, transfer.decodedBytes);
+  if (windowed) {
+    qInfo().noquote() << QString("%1 scrobbles in %2 ms: %3 scrobbles/s, %4 "
+                                 "requests for %5 windows")
+                             .arg(tracks)
+                             .arg(elapsedMs)
+                             .arg(tracks * 1000.0 / elapsedMs, 0, 'f', 0)
+                             .arg(server.requestCount())
+                             .arg(windows);
+    QTest::setBenchmarkResult(elapsedMs, QTest::WalltimeMilliseconds);
+    return;
+  }
+  QCOMPARE(pageLatencyMs.size(), qsizetype(pages));
+
+  std::sort(pageLatencyMs.begin(), pageLatencyMs.end());
+  auto percentile = [&](double p) {
+    return pageLatencyMs[qMin(pageLatencyMs.size() - 1,
+                              qsizetype(p * pageLatencyMs.size()))];
+  };
+  qInfo().noquote() << QString("%1 scrobbles in %2 ms: %3 scrobbles/s, %4 "
+                               "requests for %5 pages")
+                           .arg(tracks)
+                           .arg(elapsedMs)
+                           .arg(tracks * 1000.0 / elapsedMs, 0, 'f', 0)
+                           .arg(server.requestCount())
+                           .arg(pages);
+  qInfo().noquote() << QString("page latency ms: p50 %1, p95 %2, p99 %3, "
+                               "max %4")
+                           .arg(percentile(0.50))
+                           .arg(percentile(0.95))
+                           .arg(percentile(0.99))
+                           .arg(pageLatencyMs.last());
+  qInfo().noquote() << QString("%1 connections, %2 bytes on the wire for %3 "
+                               "decoded (%4%)")
+                           .arg(server.connectionCount())
+                           .arg(transfer.wireBytes)
+                           .arg(transfer.decodedBytes)
+                           .arg(100.0 * transfer.wireBytes /
+                                    qMax<qint64>(1, transfer.decodedBytes),
+                                0, 'f', 1);
+  qInfo().noquote() << QString("network thread busy %1 ms, %2 parsers busy "
+                               "%3 ms")
+                           .arg(transfer.networkBusyNs / 1000000)
+                           .arg(lastFm.parserThreads())
+                           .arg(transfer.parseBusyNs / 1000000);
+  QTest::setBenchmarkResult(elapsedMs, QTest::WalltimeMilliseconds);
+}
+
+QTEST_MAIN(BenchSync)
+
+#include "benchsync.moc"
@@ -0,0 +1,104 @@
+/**
+ * @file benchweekmerge.cpp
+ * @brief Benchmarks merging a fetched page into an existing week file.
+ * @details Run with e.g. `bench_weekmerge -median 5`. A 1000-row page, newest
+ * first and half of it already stored, is merged into a 5000-row week. The
+ * timestamp-map-and-sort merge the save path used before is timed alongside
+ * for comparison.
+ */
+
+#include <QDateTime>
+#include <QMap>
+#include <QTemporaryDir>
+#include <QtTest>
+#include <algorithm>
+#include <limits>
+
+#include "scrobbledata.h"
+#include "stringdictionary.h"
+#include "weekfile.h"
+
+class BenchWeekMerge : public QObject {
+  Q_OBJECT
+
+private:
+  QTemporaryDir m_tempDir;
+  qint64 m_weekStart = 0;
+  QList<ScrobbleData> m_existing;
+  QList<ScrobbleData> m_page;
+
+private slots:
+  void initTestCase();
+  void benchMergeRows();
+  void benchMapAndSort();
+  void benchDecodeMergeEncode();
+};
+
+void BenchWeekMerge::initTestCase() {
+  QVERIFY(m_tempDir.isValid());
+  m_weekStart =
+      QDateTime(QDate(2024, 3, 4), QTime(0, 0), Qt::UTC).toSecsSinceEpoch();
+  const int existingRows = 5000;
+  const int pageRows = 1000;
+  // Rows two minutes apart fill 10000 minutes; the page covers the last 500
+  // stored rows and 500 new ones after them.
+  auto row = [this](int i) {
+    return ScrobbleData(QString("Artist %1").arg((i * 7919) % 800),
+                        QString("Track %1").arg((i * 104729) % 3000),
+                        QString("Album %1").arg((i * 7919) % 300),
+                        m_weekStart + qint64(i) * 120);
+  };
+  for (int i = 0; i < existingRows; ++i)
+    m_existing << row(i);
+  for (int i = existingRows + pageRows / 2 - 1;
+       i >= existingRows - pageRows / 2; --i)
+    m_page << row(i);
+}
+
+void BenchWeekMerge::benchMergeRows() {
+  QList<ScrobbleData> merged;
+  qsizetype added = 0;
+  QBENCHMARK { added = WeekFile::mergeRows(m_existing, m_page, merged); }
+  QCOMPARE(added, qsizetype(500));
+  QCOMPARE(merged.size(), qsizetype(5500));
+}
+
+void BenchWeekMerge::benchMapAndSort() {
+  QList<ScrobbleData> merged;
+  QBENCHMARK {
+    merged = m_existing;
+    QMap<qint64, bool> timestamps;
+    for (const ScrobbleData &s : std::as_const(merged))
+      timestamps[s.uts] = true;
+    for (const ScrobbleData &s : std::as_const(m_page)) {
+      if (s.isValid() && !timestamps.contains(s.uts)) {
+        merged.append(s);
+        timestamps[s.uts] = true;
+      }
+    }
+    std::sort(merged.begin(), merged.end());
+  }
+  QCOMPARE(merged.size(), qsizetype(5500));
+}
+
+void BenchWeekMerge::benchDecodeMergeEncode() {
+  StringDictionary dictionary(m_tempDir.filePath("strings.dict"));
+  const QByteArray file = WeekFile::encode(m_weekStart, m_existing, dictionary);
+  QByteArray encoded;
+  QBENCHMARK {
+    QList<ScrobbleData> existing;
+    QVERIFY(WeekFile::decode(file, dictionary,
+                             std::numeric_limits<qint64>::min(),
+                             std::numeric_limits<qint64>::max(),
+                             existing) == WeekFile::DecodeResult::Ok);
+    QList<ScrobbleData> merged;
+    WeekFile::mergeRows(existing, m_page, merged);
+    encoded = WeekFile::encode(m_weekStart, merged, dictionary);
+  }
+  QCOMPARE(encoded.size(),
+           qsizetype(WeekFile::HEADER_SIZE + 5500 * WeekFile::ROW_SIZE));
+}
+
+QTEST_MAIN(BenchWeekMerge)
+
+#include "benchweekmerge.moc"
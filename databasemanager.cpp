@@ -4,24 +4,104 @@
  */
 
 #include "databasemanager.h"
+#include "scrobblejournal.h"
+#include "scrobblejsonparser.h"
+#include "stringdictionary.h"
+#include "weekfile.h"
+#include "weekgrid.h"
+#include "weekmanifest.h"
 #include <QCoreApplication>
+#include <QDataStream>
 #include <QDebug>
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QMap>
 #include <QMetaObject>
 #include <QSaveFile>
+#include <QSet>
 #include <QStandardPaths>
 #include <QThread>
+#include <QThreadPool>
+#include <QTimeZone>
 #include <QtConcurrent>
 #include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace {
+/**
+ * @brief Serializes every operation that writes to a user's directory (week
+ * files, string dictionary, journal, migration). Readers only take it to
+ * migrate the directory and fold a leftover journal before reading.
+ */
+QMutex s_storageMutex;
+/** @brief Marker file recording that a user directory uses binary storage. */
+const char STORAGE_VERSION_FILE[] = "storage.version";
+/** @brief Name of the week manifest in a user directory. */
+const char MANIFEST_FILE[] = "weeks.manifest";
+/** @brief Name of the scrobble journal in a user directory. */
+const char JOURNAL_FILE[] = "journal.log";
+/**
+ * @brief Journaled rows of one user after which the save task folds the
+ * journal into the week files without waiting for the queue to drain.
+ */
+constexpr qsizetype JOURNAL_COMPACT_ROWS = 50000;
+/** @brief Most queued pages the save task takes in one batch. */
+constexpr int SAVE_BATCH_MAX_PAGES = 50;
+/** @brief Name of the persisted analytics snapshot in a user directory. */
+const char SNAPSHOT_FILE[] = "analytics.snapshot";
+/** @brief Leading magic number of the snapshot file ("LFAS"). */
+constexpr quint32 SNAPSHOT_MAGIC = 0x4C464153;
+/** @brief Snapshot format version; bump whenever the layout changes. */
+constexpr quint32 SNAPSHOT_VERSION = 1;
+
+/**
+ * @struct SnapshotFileEntry
+ * @brief Identity of one week file covered by an analytics snapshot.
+ */
+struct SnapshotFileEntry {
+  qint64 weekStartUts = 0;   /**< @brief Week start of the file. */
+  qint64 byteSize = 0;       /**< @brief File size when the state was built. */
+  qint64 lastModifiedMs = 0; /**< @brief Modification time (ms since epoch). */
+  quint32 coveredRows = 0;   /**< @brief Rows at or before the watermark. */
+};
+
+/**
+ * @struct WeekLoad
+ * @brief Outcome of reading and decoding one week file on a loader thread.
+ */
+struct WeekLoad {
+  QString fileName;         /**< @brief Name of the week file. */
+  bool readFailed = false;  /**< @brief The file could not be opened. */
+  QByteArray data;          /**< @brief File content, kept for a retry. */
+  QList<ScrobbleData> rows; /**< @brief Decoded rows inside the range. */
+  WeekFile::DecodeResult result =
+      WeekFile::DecodeResult::Ok; /**< @brief Result of the decode. */
+};
+
+/**
+ * @brief Returns the pool that reads and decodes week files in parallel.
+ * @details Separate from the global pool, which runs the load task itself
+ * and the analysis, and bounded by the number of cores.
+ */
+QThreadPool *weekLoadPool() {
+  static QThreadPool *pool = [] {
+    auto *p = new QThreadPool;
+    p->setMaxThreadCount(QThread::idealThreadCount());
+    return p;
+  }();
+  return pool;
+}
+} // namespace
 
 DatabaseManager::DatabaseManager(const QString &basePath, QObject *parent)
     : QObject(parent), m_saveTaskRunning(false) {
+  m_savePool.setMaxThreadCount(1);
 
   QString absoluteBasePath =
       QDir::isAbsolutePath(basePath)
@@ -38,6 +118,10 @@ DatabaseManager::DatabaseManager(const QString &basePath, QObject *parent)
 
   connect(&m_loadWatcher, &QFutureWatcherBase::finished, this,
           &DatabaseManager::handleLoadFinished);
+  connect(&m_storeWatcher, &QFutureWatcherBase::finished, this,
+          &DatabaseManager::handleStoreOpenFinished);
+  connect(&m_snapshotWatcher, &QFutureWatcherBase::finished, this,
+          &DatabaseManager::handleSnapshotLoadFinished);
 }
 
 void DatabaseManager::saveScrobblesAsync(int pageNumber,
@@ -49,12 +133,6 @@ void DatabaseManager::saveScrobblesAsync(int pageNumber,
                << pageNumber;
     return;
   }
-  if (scrobbles.isEmpty()) {
-    qDebug()
-        << "[DB Manager] Skipping save request for empty scrobble list (page"
-        << pageNumber << ")";
-    return;
-  }
 
   SaveWorkItem item;
   item.pageNumber = pageNumber;
@@ -62,13 +140,57 @@ void DatabaseManager::saveScrobblesAsync(int pageNumber,
   item.data = scrobbles;
 
   qDebug() << "[DB Manager] Adding save request for page" << pageNumber
-           << "to queue.";
+           << "(" << scrobbles.size() << "scrobbles) to queue.";
+  int depth = 0;
   {
     QMutexLocker locker(&m_saveQueueMutex);
+    // A full queue means the save task is running and will make room.
+    while (m_saveQueue.size() >= m_maxSaveQueuePages && !m_shuttingDown) {
+      qDebug() << "[DB Manager] Save queue full, waiting to add page"
+               << pageNumber;
+      m_saveQueueNotFull.wait(&m_saveQueueMutex);
+    }
+    if (m_shuttingDown) {
+      locker.unlock();
+      qWarning() << "[DB Manager] Shutting down, page" << pageNumber
+                 << "not saved.";
+      emit pageSaveFailed(pageNumber, "Database is shutting down.");
+      return;
+    }
     m_saveQueue.enqueue(item);
+    depth = int(m_saveQueue.size()) + m_saveBatchPages;
+    // Started under the lock, so shutdown() either sees the task or keeps
+    // the page out of the queue.
+    startSaveTaskIfNotRunning();
+  }
+  emit saveQueueDepthChanged(depth);
+}
+
+DatabaseManager::~DatabaseManager() { shutdown(); }
+
+void DatabaseManager::shutdown() {
+  {
+    QMutexLocker locker(&m_saveQueueMutex);
+    if (m_shuttingDown)
+      return;
+    m_shuttingDown = true;
+    m_saveQueueNotFull.wakeAll();
   }
+  disconnect();
+  qInfo() << "[DB Manager] Shutting down, waiting for queued saves...";
+  m_savePool.waitForDone();
+  qInfo() << "[DB Manager] Save queue closed.";
+}
 
-  startSaveTaskIfNotRunning();
+void DatabaseManager::setMaxSaveQueuePages(int pages) {
+  QMutexLocker locker(&m_saveQueueMutex);
+  m_maxSaveQueuePages = qMax(1, pages);
+  m_saveQueueNotFull.wakeAll();
+}
+
+int DatabaseManager::maxSaveQueuePages() const {
+  QMutexLocker locker(&m_saveQueueMutex);
+  return m_maxSaveQueuePages;
 }
 
 void DatabaseManager::startSaveTaskIfNotRunning() {
@@ -76,7 +198,7 @@ void DatabaseManager::startSaveTaskIfNotRunning() {
     qInfo()
         << "[DB Manager] Starting background save task loop (QtConcurrent)...";
 
-    QtConcurrent::run([this]() { this->saveTaskLoop(); });
+    QtConcurrent::run(&m_savePool, [this]() { this->saveTaskLoop(); });
   } else {
     qDebug() << "[DB Manager] Save task already running.";
   }
@@ -85,63 +207,117 @@ void DatabaseManager::startSaveTaskIfNotRunning() {
 void DatabaseManager::saveTaskLoop() {
   qInfo() << "[DB Save Task] Started processing queue in thread"
           << QThread::currentThreadId();
-  bool processedItemThisLoop = false;
+  // Rows journaled per user since that user's journal was last folded.
+  QHash<QString, qsizetype> journaledRows;
+
+  auto compact = [this](const QString &username) {
+    QString errorMsg;
+    emit statusMessage("Writing journaled pages to week files...");
+    if (!compactJournalSync(m_basePath, username, errorMsg)) {
+      // The pages stay in the journal and are folded on the next read.
+      qWarning() << "[DB Save Task] Journal compaction failed for" << username
+                 << ":" << errorMsg;
+      emit statusMessage("Error compacting journal: " + errorMsg);
+    }
+  };
 
   forever {
-    SaveWorkItem item;
-    bool itemDequeued = false;
+    QList<SaveWorkItem> batch;
+    int finishedBatchDepth = -1;
+    bool queueDrained = false;
 
     {
       QMutexLocker locker(&m_saveQueueMutex);
-      if (!m_saveQueue.isEmpty()) {
-        item = m_saveQueue.dequeue();
-        itemDequeued = true;
-        qInfo() << "[DB Save Task] Dequeued save request for page"
-                << item.pageNumber << ". Items left:" << m_saveQueue.size();
-      } else {
+      if (m_saveBatchPages > 0) {
+        m_saveBatchPages = 0;
+        finishedBatchDepth = int(m_saveQueue.size());
+      }
+      while (!m_saveQueue.isEmpty() && batch.size() < SAVE_BATCH_MAX_PAGES)
+        batch.append(m_saveQueue.dequeue());
+      m_saveBatchPages = int(batch.size());
+      if (!batch.isEmpty()) {
+        m_saveQueueNotFull.wakeAll();
+        qInfo() << "[DB Save Task] Dequeued" << batch.size()
+                << "save requests. Items left:" << m_saveQueue.size();
+      } else if (journaledRows.isEmpty()) {
         qInfo() << "[DB Save Task] Queue is empty. Finishing task loop.";
         m_saveTaskRunning.storeRelease(false);
-        break;
+        queueDrained = true;
       }
+    }
+    if (finishedBatchDepth >= 0)
+      emit saveQueueDepthChanged(finishedBatchDepth);
+    if (queueDrained)
+      break;
 
-      if (itemDequeued) {
-        processedItemThisLoop = true;
-        emit statusMessage(QString("Saving page %1...").arg(item.pageNumber));
-        QString errorMsg;
-        qDebug() << "[DB Save Task] >>> Calling saveChunkSync for page"
-                 << item.pageNumber << "...";
-        bool success =
-            saveChunkSync(m_basePath, item.username, item.data, errorMsg);
-        qDebug() << "[DB Save Task] <<< saveChunkSync returned:" << success
-                 << "for page" << item.pageNumber << "Error:" << errorMsg;
-
-        if (success) {
-          emit pageSaveCompleted(item.pageNumber);
-        } else {
-          emit pageSaveFailed(item.pageNumber, errorMsg);
-        }
-
-        emit statusMessage(QString("Idle. (Last save: Page %1 %2)")
-                               .arg(item.pageNumber)
-                               .arg(success ? "OK" : "Failed"));
-      }
+    if (batch.isEmpty()) {
+      // The queue drained: fold the journals in one batch per user, then
+      // look at the queue again in case pages arrived meanwhile.
+      const QStringList usernames = journaledRows.keys();
+      journaledRows.clear();
+      for (const QString &username : usernames)
+        compact(username);
+      continue;
     }
 
-    qInfo() << "[DB Save Task] Exiting save task loop function in thread"
-            << QThread::currentThreadId();
+    // Pages of the same user share one journal record, and thus one write
+    // and one fsync; their week files are merged together at the next fold.
+    QMap<QString, QList<int>> batchByUser;
+    for (int i = 0; i < batch.size(); ++i)
+      batchByUser[batch[i].username].append(i);
 
-    {
-      QMutexLocker locker(&m_saveQueueMutex);
-      if (!m_saveQueue.isEmpty()) {
-        qWarning() << "[DB Save Task] Queue is not empty after loop exit! "
-                      "Restarting task...";
+    for (auto it = batchByUser.constBegin(); it != batchByUser.constEnd();
+         ++it) {
+      const QString &username = it.key();
+      const QList<int> &indexes = it.value();
+      QList<ScrobbleData> rows;
+      for (int index : indexes)
+        rows.append(batch[index].data);
 
-        startSaveTaskIfNotRunning();
-      } else {
-        qDebug() << "[DB Save Task] Confirmed queue empty on loop exit.";
+      const int firstPage = batch[indexes.first()].pageNumber;
+      const int lastPage = batch[indexes.last()].pageNumber;
+      emit statusMessage(indexes.size() == 1
+                             ? QString("Saving page %1...").arg(firstPage)
+                             : QString("Saving %1 pages...")
+                                   .arg(indexes.size()));
+      QString errorMsg;
+      bool success = journalChunkSync(m_basePath, username, rows, errorMsg);
+      qDebug() << "[DB Save Task] journalChunkSync returned:" << success
+               << "for" << indexes.size() << "pages of" << username
+               << "Error:" << errorMsg;
+
+      // Signals go out per page, in queue order, so the resume state only
+      // advances over pages that are durable.
+      for (int index : indexes) {
+        if (success)
+          emit pageSaveCompleted(batch[index].pageNumber);
+        else
+          emit pageSaveFailed(batch[index].pageNumber, errorMsg);
       }
+      if (success && !rows.isEmpty()) {
+        emit scrobblesSaved(username, rows);
+        qsizetype &pending = journaledRows[username];
+        pending += rows.size();
+        if (pending >= JOURNAL_COMPACT_ROWS) {
+          journaledRows.remove(username);
+          compact(username);
+        }
+      }
+
+      emit statusMessage(QString("Idle. (Last save: Page %1 %2)")
+                             .arg(lastPage)
+                             .arg(success ? "OK" : "Failed"));
     }
   }
+
+  qInfo() << "[DB Save Task] Exiting save task loop function in thread"
+          << QThread::currentThreadId();
+  emit saveQueueIdle();
+}
+
+int DatabaseManager::saveQueueDepth() const {
+  QMutexLocker locker(&m_saveQueueMutex);
+  return int(m_saveQueue.size()) + m_saveBatchPages;
 }
 
 bool DatabaseManager::isSaveInProgress() const {
@@ -193,6 +369,61 @@ void DatabaseManager::loadAllScrobblesAsync(const QString &username) {
   m_loadWatcher.setFuture(future);
 }
 
+void DatabaseManager::openStoreAsync(const QString &username) {
+  if (m_storeWatcher.isRunning()) {
+    emit loadError("Load operation (store) already in progress.");
+    return;
+  }
+  if (username.isEmpty()) {
+    emit loadError("Cannot load data for empty username.");
+    return;
+  }
+  emit statusMessage("Opening scrobble store...");
+  m_lastStoreError.clear();
+  QString basePath = m_basePath;
+  QFuture<QSharedPointer<ScrobbleStore>> future =
+      QtConcurrent::run([=]() mutable {
+        return openStoreSync(basePath, username, m_lastStoreError);
+      });
+  m_storeWatcher.setFuture(future);
+}
+
+void DatabaseManager::loadSnapshotAsync(const QString &username) {
+  if (m_snapshotWatcher.isRunning()) {
+    emit loadError("Load operation (snapshot) already in progress.");
+    return;
+  }
+  if (username.isEmpty()) {
+    emit loadError("Cannot load data for empty username.");
+    return;
+  }
+  emit statusMessage("Loading analytics snapshot...");
+  m_lastSnapshotError.clear();
+  QString basePath = m_basePath;
+  QFuture<QSharedPointer<IncrementalAnalytics>> future =
+      QtConcurrent::run([=]() mutable {
+        return loadSnapshotSync(basePath, username, m_lastSnapshotError);
+      });
+  m_snapshotWatcher.setFuture(future);
+}
+
+void DatabaseManager::saveSnapshotAsync(
+    const QString &username, QSharedPointer<const IncrementalAnalytics> state,
+    QSharedPointer<const ScrobbleStore> store) {
+  if (username.isEmpty() || !state || !store) {
+    qWarning() << "[DB Snapshot] Save requested without user, state or store.";
+    return;
+  }
+  QString basePath = m_basePath;
+  QtConcurrent::run([basePath, username, state, store]() {
+    QString errorMsg;
+    if (!saveSnapshotSync(basePath, username, *state, *store, errorMsg)) {
+      qWarning() << "[DB Snapshot] Could not save analytics snapshot:"
+                 << errorMsg;
+    }
+  });
+}
+
 qint64 DatabaseManager::getLastSyncTimestamp(const QString &username) {
   if (username.isEmpty()) {
     qWarning() << "Cannot get last sync timestamp for empty username.";
@@ -203,6 +434,31 @@ qint64 DatabaseManager::getLastSyncTimestamp(const QString &username) {
   return timestamp;
 }
 
+QMap<qint64, int> DatabaseManager::getWeekCounts(const QString &username) {
+  if (username.isEmpty()) {
+    qWarning() << "Cannot get week counts for empty username.";
+    return {};
+  }
+  return weekCountsSync(m_basePath, username);
+}
+
+void DatabaseManager::exportToJsonAsync(const QString &username,
+                                        const QString &targetDir) {
+  if (username.isEmpty()) {
+    emit exportFinished(false, "Cannot export data for empty username.");
+    return;
+  }
+  emit statusMessage("Exporting scrobbles to JSON...");
+  QString basePath = m_basePath;
+  QtConcurrent::run([this, basePath, username, targetDir]() {
+    QString errorMsg;
+    bool success = exportJsonSync(basePath, username, targetDir, errorMsg);
+    emit exportFinished(success, success ? "Exported to " + targetDir
+                                         : errorMsg);
+    emit statusMessage("Idle.");
+  });
+}
+
 void DatabaseManager::handleLoadFinished() {
   QList<ScrobbleData> results = m_loadWatcher.result();
   emit statusMessage("Idle.");
@@ -218,6 +474,29 @@ void DatabaseManager::handleLoadFinished() {
   m_lastLoadError.clear();
 }
 
+void DatabaseManager::handleStoreOpenFinished() {
+  QSharedPointer<ScrobbleStore> store = m_storeWatcher.result();
+  emit statusMessage("Idle.");
+  if (m_lastStoreError.isEmpty()) {
+    emit storeOpened(store);
+    qInfo() << "Scrobble store opened successfully. Rows:" << store->size();
+  } else {
+    emit loadError(m_lastStoreError);
+    qWarning() << "Scrobble store opened with errors:" << m_lastStoreError;
+  }
+  m_lastStoreError.clear();
+}
+
+void DatabaseManager::handleSnapshotLoadFinished() {
+  QSharedPointer<IncrementalAnalytics> state = m_snapshotWatcher.result();
+  emit statusMessage("Idle.");
+  if (!m_lastSnapshotError.isEmpty()) {
+    qWarning() << "[DB Snapshot] Snapshot not used:" << m_lastSnapshotError;
+  }
+  emit snapshotLoaded(state);
+  m_lastSnapshotError.clear();
+}
+
 bool DatabaseManager::saveChunkSync(const QString &basePath,
                                     const QString &username,
                                     const QList<ScrobbleData> &scrobbles,
@@ -251,9 +530,33 @@ bool DatabaseManager::saveChunkSync(const QString &basePath,
     qDebug() << "[DB Sync Save] Successfully created user path.";
   }
 
+  QMutexLocker storageLocker(&s_storageMutex);
+
+  if (!migrateLegacyJsonSync(userPath, errorMsg)) {
+    qCritical() << "[DB Sync Save] Legacy JSON migration failed:" << errorMsg;
+    return false;
+  }
+  return mergeIntoWeekFilesSync(userPath, scrobbles, errorMsg);
+}
+
+bool DatabaseManager::mergeIntoWeekFilesSync(
+    const QString &userPath, const QList<ScrobbleData> &scrobbles,
+    QString &errorMsg) {
+  StringDictionary dictionary(getDictionaryPath(userPath));
+  if (!dictionary.load(errorMsg)) {
+    qCritical() << "[DB Sync Save] " << errorMsg;
+    return false;
+  }
+  WeekManifest manifest(getManifestPath(userPath));
+  QString manifestError;
+  if (!loadManifestSync(userPath, manifest, manifestError)) {
+    qWarning() << "[DB Sync Save] " << manifestError;
+  }
+  bool manifestChanged = false;
+
   QMap<QString, QList<ScrobbleData>> scrobblesByFile;
   for (const ScrobbleData &scrobble : scrobbles) {
-    QString filePath = getWeekFilePath(userPath, scrobble.timestamp);
+    QString filePath = getWeekFilePath(userPath, scrobble.uts);
     scrobblesByFile[filePath].append(scrobble);
   }
   qDebug() << "[DB Sync Save] Grouped scrobbles into" << scrobblesByFile.count()
@@ -272,40 +575,29 @@ bool DatabaseManager::saveChunkSync(const QString &basePath,
              << newScrobblesForFile.count() << "new entries.";
 
     QList<ScrobbleData> existingScrobbles;
-    QMap<qint64, bool> existingTimestamps;
     QFile readFile(filePath);
     if (readFile.exists()) {
-      if (readFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+      if (readFile.open(QIODevice::ReadOnly)) {
         QByteArray data = readFile.readAll();
         readFile.close();
-        QJsonParseError parseError;
-        QJsonDocument doc = QJsonDocument::fromJson(data, &parseError);
-        if (parseError.error == QJsonParseError::NoError && doc.isArray()) {
-          QJsonArray array = doc.array();
-          for (const QJsonValue &val : array) {
-            QJsonObject obj = val.toObject();
-            if (obj.contains("uts") && obj.contains("artist") &&
-                obj.contains("track")) {
-              ScrobbleData s;
-              s.timestamp = QDateTime::fromSecsSinceEpoch(
-                  obj["uts"].toInteger(), Qt::UTC);
-              if (s.timestamp.isValid() && obj["uts"].toInteger() > 0) {
-                s.artist = obj["artist"].toString();
-                s.track = obj["track"].toString();
-                s.album = obj["album"].toString();
-                existingScrobbles.append(s);
-                existingTimestamps[s.timestamp.toSecsSinceEpoch()] = true;
-              }
-            }
-          }
+        WeekFile::DecodeResult result = WeekFile::decode(
+            data, dictionary, std::numeric_limits<qint64>::min(),
+            std::numeric_limits<qint64>::max(), existingScrobbles);
+        if (result == WeekFile::DecodeResult::Ok) {
           qDebug() << "[DB Sync Save] Read" << existingScrobbles.count()
                    << "valid existing entries from"
                    << QFileInfo(filePath).fileName();
-        } else {
-          qWarning() << "[DB Sync Save] File exists but is corrupt/not array:"
+        } else if (result == WeekFile::DecodeResult::Corrupt) {
+          qWarning() << "[DB Sync Save] File exists but is corrupt:"
                      << QFileInfo(filePath).fileName() << ". Overwriting.";
           existingScrobbles.clear();
-          existingTimestamps.clear();
+        } else {
+          currentFileError = "File references unknown dictionary entries: " +
+                             QFileInfo(filePath).fileName();
+          qWarning() << "[DB Sync Save] " << currentFileError;
+          all_ok = false;
+          cumulativeErrors += currentFileError + "; ";
+          continue;
         }
       } else {
         currentFileError = "Could not open existing file for reading: " +
@@ -318,17 +610,9 @@ bool DatabaseManager::saveChunkSync(const QString &basePath,
       }
     }
 
-    int addedCount = 0;
-    for (const ScrobbleData &newScrobble : newScrobblesForFile) {
-      if (newScrobble.timestamp.isValid() &&
-          newScrobble.timestamp.toSecsSinceEpoch() > 0) {
-        if (!existingTimestamps.contains(
-                newScrobble.timestamp.toSecsSinceEpoch())) {
-          existingScrobbles.append(newScrobble);
-          addedCount++;
-        }
-      }
-    }
+    QList<ScrobbleData> mergedScrobbles;
+    const qsizetype addedCount = WeekFile::mergeRows(
+        existingScrobbles, newScrobblesForFile, mergedScrobbles);
     if (addedCount == 0) {
       qDebug() << "[DB Sync Save] No unique entries to add for"
                << QFileInfo(filePath).fileName() << ". Skipping write.";
@@ -336,65 +620,403 @@ bool DatabaseManager::saveChunkSync(const QString &basePath,
     }
     qDebug() << "[DB Sync Save] Added" << addedCount
              << "unique entries. Total for file now:"
-             << existingScrobbles.count();
-
-    std::sort(existingScrobbles.begin(), existingScrobbles.end(),
-              [](const ScrobbleData &a, const ScrobbleData &b) {
-                return a.timestamp < b.timestamp;
-              });
-
-    QJsonArray outputArray;
-    for (const ScrobbleData &s : existingScrobbles) {
-      QJsonObject obj;
-      obj["artist"] = s.artist;
-      obj["track"] = s.track;
-      obj["album"] = s.album;
-      obj["uts"] = s.timestamp.toSecsSinceEpoch();
-      outputArray.append(obj);
-    }
-    QJsonDocument outputDoc(outputArray);
-    QSaveFile saveFile(filePath);
-    if (saveFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-      saveFile.write(outputDoc.toJson(QJsonDocument::Compact));
-      if (!saveFile.commit()) {
-        currentFileError = "Failed to commit changes to file: " +
-                           QFileInfo(filePath).fileName() +
-                           " Error: " + saveFile.errorString();
-        qCritical() << "[DB Sync Save] COMMIT FAILED:" << currentFileError;
-        all_ok = false;
-        cumulativeErrors += currentFileError + "; ";
-      } else {
-        qDebug() << "[DB Sync Save] Successfully committed"
-                 << QFileInfo(filePath).fileName();
-      }
-    } else {
-      currentFileError = "Could not open QSaveFile for writing: " +
-                         QFileInfo(filePath).fileName() +
-                         " Error: " + saveFile.errorString();
-      qWarning() << "[DB Sync Save] QSaveFile open failed:" << currentFileError;
+             << mergedScrobbles.count();
+
+    if (!writeWeekFileSync(filePath, mergedScrobbles, dictionary, manifest,
+                           currentFileError)) {
+      qCritical() << "[DB Sync Save] Write failed:" << currentFileError;
       all_ok = false;
       cumulativeErrors += currentFileError + "; ";
+    } else {
+      manifestChanged = true;
+      qDebug() << "[DB Sync Save] Successfully committed"
+               << QFileInfo(filePath).fileName();
     }
   }
 
+  if (manifestChanged && !manifest.save(manifestError)) {
+    // The week files are saved; dropping the stale manifest makes the next
+    // reader rebuild it from them.
+    qWarning() << "[DB Sync Save] " << manifestError;
+    QFile::remove(manifest.filePath());
+  }
+
   if (!all_ok) {
     errorMsg = cumulativeErrors;
   }
   return all_ok;
 }
 
+bool DatabaseManager::journalChunkSync(const QString &basePath,
+                                       const QString &username,
+                                       const QList<ScrobbleData> &scrobbles,
+                                       QString &errorMsg) {
+  errorMsg.clear();
+  if (username.isEmpty()) {
+    errorMsg = "Username cannot be empty.";
+    qWarning() << "[DB Journal] " << errorMsg;
+    return false;
+  }
+  if (scrobbles.isEmpty())
+    return true;
+
+  QString userPath = basePath + "/" + username;
+  if (!QDir().mkpath(userPath)) {
+    errorMsg = "Could not create user directory: " + userPath;
+    qCritical() << "[DB Journal] " << errorMsg;
+    return false;
+  }
+
+  QMutexLocker storageLocker(&s_storageMutex);
+  // Legacy files must be converted before any journal is folded on top.
+  if (!migrateLegacyJsonSync(userPath, errorMsg)) {
+    qCritical() << "[DB Journal] Legacy JSON migration failed:" << errorMsg;
+    return false;
+  }
+  ScrobbleJournal journal(getJournalPath(userPath));
+  if (!journal.append(scrobbles, errorMsg)) {
+    qCritical() << "[DB Journal] " << errorMsg;
+    return false;
+  }
+  return true;
+}
+
+bool DatabaseManager::compactJournalSync(const QString &basePath,
+                                         const QString &username,
+                                         QString &errorMsg) {
+  QMutexLocker storageLocker(&s_storageMutex);
+  return foldJournalSync(basePath + "/" + username, errorMsg);
+}
+
+bool DatabaseManager::foldJournalSync(const QString &userPath,
+                                      QString &errorMsg) {
+  ScrobbleJournal journal(getJournalPath(userPath));
+  if (!journal.exists())
+    return true;
+
+  QList<ScrobbleData> rows;
+  QString warnings;
+  if (!journal.replay(rows, warnings, errorMsg))
+    return false;
+  if (!warnings.isEmpty())
+    qWarning() << "[DB Journal]" << warnings;
+  if (!rows.isEmpty() && !mergeIntoWeekFilesSync(userPath, rows, errorMsg))
+    return false;
+  if (!journal.remove(errorMsg))
+    return false;
+  qInfo() << "[DB Journal] Folded" << rows.size()
+          << "journaled scrobbles into the week files of" << userPath;
+  return true;
+}
+
+bool DatabaseManager::prepareUserDirSync(const QString &userPath,
+                                         QString &errorMsg) {
+  QString stepError;
+  if (!migrateLegacyJsonSync(userPath, stepError)) {
+    errorMsg = "Migration failed: " + stepError;
+    return false;
+  }
+  if (!foldJournalSync(userPath, stepError)) {
+    errorMsg = "Journal replay failed: " + stepError;
+    return false;
+  }
+  return true;
+}
+
+bool DatabaseManager::writeWeekFileSync(const QString &filePath,
+                                        const QList<ScrobbleData> &sorted,
+                                        StringDictionary &dictionary,
+                                        WeekManifest &manifest,
+                                        QString &errorMsg) {
+  qint64 weekStart = getWeekStart(sorted.first().uts);
+  QByteArray encoded = WeekFile::encode(weekStart, sorted, dictionary);
+
+  // The dictionary must be on disk before any week file referencing its new
+  // entries is committed.
+  if (dictionary.hasPendingEntries() && !dictionary.flush(errorMsg)) {
+    return false;
+  }
+
+  QSaveFile saveFile(filePath);
+  if (!saveFile.open(QIODevice::WriteOnly)) {
+    errorMsg = "Could not open QSaveFile for writing: " +
+               QFileInfo(filePath).fileName() +
+               " Error: " + saveFile.errorString();
+    return false;
+  }
+  saveFile.write(encoded);
+  if (!saveFile.commit()) {
+    errorMsg = "Failed to commit changes to file: " +
+               QFileInfo(filePath).fileName() +
+               " Error: " + saveFile.errorString();
+    return false;
+  }
+  WeekManifest::Entry entry;
+  WeekManifest::describe(encoded, entry);
+  manifest.insert(entry);
+  return true;
+}
+
 QDateTime DatabaseManager::getWeekStart(const QDateTime timestamp) {
-  QDateTime utcTimestamp = timestamp.toUTC();
-  int daysToSubtract = utcTimestamp.date().dayOfWeek() - 1;
-  if (daysToSubtract < 0)
-    daysToSubtract = 6;
-  return utcTimestamp.date().addDays(-daysToSubtract).startOfDay(Qt::UTC);
+  return QDateTime::fromSecsSinceEpoch(
+      getWeekStart(timestamp.toSecsSinceEpoch()), Qt::UTC);
+}
+
+qint64 DatabaseManager::getWeekStart(qint64 uts) {
+  return WeekGrid::weekStart(uts);
 }
 
 QString DatabaseManager::getWeekFilePath(const QString &userPath,
                                          const QDateTime timestamp) {
-  QDateTime weekStart = getWeekStart(timestamp);
-  return QString("%1/%2.json").arg(userPath).arg(weekStart.toSecsSinceEpoch());
+  return getWeekFilePath(userPath, timestamp.toSecsSinceEpoch());
+}
+
+QString DatabaseManager::getWeekFilePath(const QString &userPath, qint64 uts) {
+  return QString("%1/%2%3")
+      .arg(userPath)
+      .arg(getWeekStart(uts))
+      .arg(WeekFile::fileSuffix());
+}
+
+QString DatabaseManager::getDictionaryPath(const QString &userPath) {
+  return userPath + "/strings.dict";
+}
+
+QString DatabaseManager::getManifestPath(const QString &userPath) {
+  return userPath + "/" + MANIFEST_FILE;
+}
+
+bool DatabaseManager::loadManifestSync(const QString &userPath,
+                                       WeekManifest &manifest,
+                                       QString &errorMsg) {
+  QString loadError;
+  if (manifest.load(loadError))
+    return true;
+  if (QFile::exists(manifest.filePath())) {
+    qWarning() << "[DB Manifest] Rebuilding unreadable manifest:" << loadError;
+  }
+  return rebuildManifestSync(userPath, manifest, errorMsg);
+}
+
+bool DatabaseManager::rebuildManifestSync(const QString &userPath,
+                                          WeekManifest &manifest,
+                                          QString &errorMsg) {
+  manifest.clear();
+  const QList<QPair<qint64, QString>> weekFiles =
+      listWeekFiles(userPath, WeekFile::fileSuffix());
+  for (const auto &weekFile : weekFiles) {
+    QFile file(weekFile.second);
+    QByteArray data;
+    if (file.open(QIODevice::ReadOnly)) {
+      data = file.readAll();
+      file.close();
+    }
+    WeekManifest::Entry entry;
+    if (!WeekManifest::describe(data, entry)) {
+      // Keep unreadable files visible to range loads, which report them.
+      entry.minUts = weekFile.first;
+      entry.maxUts = weekFile.first + 7 * 24 * 60 * 60 - 1;
+      entry.byteSize = data.size();
+      entry.checksum = WeekManifest::crc32(data.constData(), data.size());
+    }
+    // The file name decides which week a file serves.
+    entry.weekStartUts = weekFile.first;
+    manifest.insert(entry);
+  }
+  qInfo() << "[DB Manifest] Rebuilt manifest of" << weekFiles.size()
+          << "week files in" << userPath;
+  return manifest.save(errorMsg);
+}
+
+bool DatabaseManager::checkManifestSync(const QString &userPath,
+                                        const WeekManifest &manifest,
+                                        bool verifyChecksums,
+                                        QStringList &problems) {
+  const qsizetype problemsBefore = problems.size();
+  QSet<qint64> onDisk;
+  for (const auto &weekFile : listWeekFiles(userPath, WeekFile::fileSuffix()))
+    onDisk.insert(weekFile.first);
+
+  for (const WeekManifest::Entry &entry : manifest.entries()) {
+    const QString filePath = getWeekFilePath(userPath, entry.weekStartUts);
+    const QString fileName = QFileInfo(filePath).fileName();
+    if (!onDisk.remove(entry.weekStartUts)) {
+      problems << "Week file listed in manifest is missing: " + fileName;
+      continue;
+    }
+    if (QFileInfo(filePath).size() != entry.byteSize) {
+      problems << "Week file size differs from manifest: " + fileName;
+      continue;
+    }
+    if (verifyChecksums) {
+      QFile file(filePath);
+      if (!file.open(QIODevice::ReadOnly)) {
+        problems << "Cannot read week file: " + fileName;
+        continue;
+      }
+      const QByteArray data = file.readAll();
+      if (WeekManifest::crc32(data.constData(), data.size()) !=
+          entry.checksum) {
+        problems << "Week file checksum differs from manifest: " + fileName;
+      }
+    }
+  }
+  for (qint64 weekStart : std::as_const(onDisk)) {
+    problems << "Week file not listed in manifest: " +
+                    QFileInfo(getWeekFilePath(userPath, weekStart)).fileName();
+  }
+  return problems.size() == problemsBefore;
+}
+
+QString DatabaseManager::getJournalPath(const QString &userPath) {
+  return userPath + "/" + JOURNAL_FILE;
+}
+
+QString DatabaseManager::getSnapshotPath(const QString &userPath) {
+  return userPath + "/" + SNAPSHOT_FILE;
+}
+
+QList<QPair<qint64, QString>>
+DatabaseManager::listWeekFiles(const QString &userPath,
+                               const QString &suffix) {
+  QList<QPair<qint64, QString>> weekFiles;
+  QDir userDir(userPath);
+  if (!userDir.exists())
+    return weekFiles;
+  userDir.setFilter(QDir::Files | QDir::NoDotAndDotDot);
+  userDir.setNameFilters({"*" + suffix});
+  const QStringList fileList = userDir.entryList();
+  for (const QString &fileName : fileList) {
+    bool ok = false;
+    qint64 weekStart = fileName.chopped(suffix.size()).toLongLong(&ok);
+    if (!ok)
+      continue;
+    weekFiles.append(qMakePair(weekStart, userDir.filePath(fileName)));
+  }
+  std::sort(weekFiles.begin(), weekFiles.end(),
+            [](const QPair<qint64, QString> &a,
+               const QPair<qint64, QString> &b) { return a.first < b.first; });
+  return weekFiles;
+}
+
+bool DatabaseManager::migrateLegacyJsonSync(const QString &userPath,
+                                            QString &errorMsg) {
+  const QString markerPath = userPath + "/" + STORAGE_VERSION_FILE;
+  if (QFile::exists(markerPath))
+    return true;
+  if (!QDir(userPath).exists())
+    return true;
+
+  const QList<QPair<qint64, QString>> jsonFiles =
+      listWeekFiles(userPath, ".json");
+  if (!jsonFiles.isEmpty()) {
+    qInfo() << "[DB Migration] Converting" << jsonFiles.size()
+            << "legacy JSON week files in" << userPath;
+  }
+
+  StringDictionary dictionary(getDictionaryPath(userPath));
+  if (!dictionary.load(errorMsg))
+    return false;
+  WeekManifest manifest(getManifestPath(userPath));
+  if (!loadManifestSync(userPath, manifest, errorMsg))
+    return false;
+
+  const QString backupPath = userPath + "/json-backup";
+  QStringList skippedFiles;
+  for (const auto &jsonFile : jsonFiles) {
+    const QString fileName = QFileInfo(jsonFile.second).fileName();
+    QFile file(jsonFile.second);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+      errorMsg = "Cannot read legacy file: " + fileName;
+      return false;
+    }
+    QByteArray data = file.readAll();
+    file.close();
+
+    QList<ScrobbleData> rows;
+    if (!parseLegacyJson(data, rows)) {
+      // Leave unreadable files in place; they are no longer picked up by the
+      // loader but remain available for manual recovery.
+      qWarning() << "[DB Migration] Skipping corrupt legacy file" << fileName;
+      skippedFiles << fileName;
+      continue;
+    }
+
+    QMap<QString, QList<ScrobbleData>> rowsByFile;
+    for (const ScrobbleData &s : rows)
+      rowsByFile[getWeekFilePath(userPath, s.uts)].append(s);
+
+    bool migrated = true;
+    for (auto it = rowsByFile.begin(); it != rowsByFile.end(); ++it) {
+      QList<ScrobbleData> existingRows;
+      QFile existing(it.key());
+      if (existing.exists()) {
+        if (!existing.open(QIODevice::ReadOnly)) {
+          errorMsg = "Cannot read week file: " +
+                     QFileInfo(it.key()).fileName() + " " +
+                     existing.errorString();
+          return false;
+        }
+        const QByteArray existingData = existing.readAll();
+        existing.close();
+        const WeekFile::DecodeResult result = WeekFile::decode(
+            existingData, dictionary, std::numeric_limits<qint64>::min(),
+            std::numeric_limits<qint64>::max(), existingRows);
+        if (result != WeekFile::DecodeResult::Ok) {
+          // Writing the legacy rows alone would replace the stored week with
+          // a partial one; keep both files untouched instead.
+          qWarning() << "[DB Migration] Week file"
+                     << QFileInfo(it.key()).fileName()
+                     << "cannot be decoded; not migrating" << fileName;
+          migrated = false;
+          continue;
+        }
+      }
+      QList<ScrobbleData> merged;
+      if (WeekFile::mergeRows(existingRows, it.value(), merged) == 0 &&
+          existing.exists())
+        continue;
+      if (!writeWeekFileSync(it.key(), merged, dictionary, manifest,
+                             errorMsg) ||
+          !manifest.save(errorMsg))
+        return false;
+    }
+    if (!migrated) {
+      skippedFiles << fileName;
+      continue;
+    }
+
+    if (!QDir().mkpath(backupPath) ||
+        !QFile::rename(jsonFile.second, backupPath + "/" + fileName)) {
+      errorMsg = "Could not move migrated legacy file: " + fileName;
+      return false;
+    }
+  }
+
+  if (!dictionary.flush(errorMsg))
+    return false;
+
+  if (!skippedFiles.isEmpty()) {
+    // Without the marker the skipped files are retried on the next access,
+    // e.g. after they were repaired by hand.
+    qWarning() << "[DB Migration]" << skippedFiles.size()
+               << "legacy files were not migrated and remain in" << userPath
+               << ":" << skippedFiles.join(", ");
+    return true;
+  }
+
+  QSaveFile marker(markerPath);
+  if (!marker.open(QIODevice::WriteOnly) ||
+      marker.write(QByteArray::number(WeekFile::FORMAT_VERSION)) < 0 ||
+      !marker.commit()) {
+    errorMsg = "Could not write storage version marker: " +
+               marker.errorString();
+    return false;
+  }
+  if (!jsonFiles.isEmpty()) {
+    qInfo() << "[DB Migration] Migration to binary week files complete.";
+  }
+  return true;
 }
 
 QList<ScrobbleData> DatabaseManager::loadScrobblesSync(const QString &basePath,
@@ -410,54 +1032,89 @@ QList<ScrobbleData> DatabaseManager::loadScrobblesSync(const QString &basePath,
   if (!userDir.exists()) {
     return loadedScrobbles;
   }
-  userDir.setFilter(QDir::Files | QDir::NoDotAndDotDot);
-  userDir.setNameFilters({"*.json"});
-  userDir.setSorting(QDir::Name);
-  QStringList fileList = userDir.entryList();
-  for (const QString &fileName : fileList) {
-    qint64 fileTimestamp = fileName.chopped(5).toLongLong();
-    if (fileTimestamp == 0 && fileName != "0.json")
-      continue;
-    QDateTime fileWeekStart =
-        QDateTime::fromSecsSinceEpoch(fileTimestamp, Qt::UTC);
-    QDateTime fileWeekEnd = fileWeekStart.addDays(7);
-    if (fileWeekEnd <= from || fileWeekStart >= to)
-      continue;
-    QFile file(userDir.filePath(fileName));
-    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-      QByteArray data = file.readAll();
-      file.close();
-      QJsonParseError parseError;
-      QJsonDocument doc = QJsonDocument::fromJson(data, &parseError);
-      if (parseError.error == QJsonParseError::NoError && doc.isArray()) {
-        QJsonArray array = doc.array();
-        for (const QJsonValue &val : array) {
-          QJsonObject obj = val.toObject();
-          if (obj.contains("uts") && obj.contains("artist") &&
-              obj.contains("track")) {
-            ScrobbleData s;
-            qint64 uts = obj["uts"].toInteger();
-            s.timestamp = QDateTime::fromSecsSinceEpoch(uts, Qt::UTC);
-            if (s.timestamp.isValid() && uts > 0 && s.timestamp >= from &&
-                s.timestamp < to) {
-              s.artist = obj["artist"].toString();
-              s.track = obj["track"].toString();
-              s.album = obj["album"].toString();
-              loadedScrobbles.append(s);
-            }
-          }
+
+  WeekManifest manifest(getManifestPath(userPath));
+  {
+    QMutexLocker storageLocker(&s_storageMutex);
+    QString prepareError;
+    if (!prepareUserDirSync(userPath, prepareError)) {
+      errorMsg += prepareError + "; ";
+    }
+    QString manifestError;
+    if (!loadManifestSync(userPath, manifest, manifestError)) {
+      qWarning() << "[Load Worker]" << manifestError;
+    }
+  }
+
+  StringDictionary dictionary(getDictionaryPath(userPath));
+  QString dictionaryError;
+  if (!dictionary.load(dictionaryError)) {
+    errorMsg += dictionaryError + "; ";
+    return loadedScrobbles;
+  }
+
+  const qint64 fromUts = from.toSecsSinceEpoch();
+  const qint64 toUts = to.toSecsSinceEpoch();
+  // Only files whose rows overlap the range are opened. Each one is read and
+  // decoded on its own loader thread; the dictionary is only read there.
+  const QList<WeekManifest::Entry> entries =
+      manifest.entriesInRange(fromUts, toUts);
+  std::function<WeekLoad(const WeekManifest::Entry &)> loadWeek =
+      [&](const WeekManifest::Entry &entry) {
+        WeekLoad load;
+        load.fileName =
+            QFileInfo(getWeekFilePath(userPath, entry.weekStartUts)).fileName();
+        QFile file(userPath + "/" + load.fileName);
+        if (!file.open(QIODevice::ReadOnly)) {
+          load.readFailed = true;
+          return load;
         }
-      } else {
-        errorMsg += "Corrupt file: " + fileName + "; ";
+        load.data = file.readAll();
+        file.close();
+        load.result = WeekFile::decode(load.data, dictionary, fromUts, toUts,
+                                       load.rows);
+        if (load.result != WeekFile::DecodeResult::UnknownStringId)
+          load.data.clear();
+        return load;
+      };
+  QList<WeekLoad> loads = QtConcurrent::blockingMapped<QList<WeekLoad>>(
+      weekLoadPool(), entries, loadWeek);
+
+  qsizetype rowCount = 0;
+  bool refreshed = false;
+  for (WeekLoad &load : loads) {
+    if (load.readFailed) {
+      errorMsg += "Cannot read file: " + load.fileName + "; ";
+      continue;
+    }
+    if (load.result == WeekFile::DecodeResult::UnknownStringId) {
+      // The save task may have appended to the dictionary after we loaded it.
+      if (!refreshed)
+        refreshed = dictionary.refresh(dictionaryError);
+      if (refreshed) {
+        load.result = WeekFile::decode(load.data, dictionary, fromUts, toUts,
+                                       load.rows);
       }
-    } else {
-      errorMsg += "Cannot read file: " + fileName + "; ";
+      load.data.clear();
     }
+    if (load.result != WeekFile::DecodeResult::Ok) {
+      errorMsg += "Corrupt file: " + load.fileName + "; ";
+      continue;
+    }
+    rowCount += load.rows.size();
+  }
+
+  // Week files are sorted and hold disjoint weeks, so concatenating them in
+  // week order yields sorted output.
+  loadedScrobbles.reserve(rowCount);
+  for (const WeekLoad &load : std::as_const(loads)) {
+    if (load.result == WeekFile::DecodeResult::Ok)
+      loadedScrobbles.append(load.rows);
+  }
+  if (!std::is_sorted(loadedScrobbles.cbegin(), loadedScrobbles.cend())) {
+    qWarning() << "[Load Worker] Week files out of order, sorting.";
+    std::sort(loadedScrobbles.begin(), loadedScrobbles.end());
   }
-  std::sort(loadedScrobbles.begin(), loadedScrobbles.end(),
-            [](const ScrobbleData &a, const ScrobbleData &b) {
-              return a.timestamp < b.timestamp;
-            });
   return loadedScrobbles;
 }
 QList<ScrobbleData> DatabaseManager::loadAllScrobblesSync(
@@ -467,35 +1124,359 @@ QList<ScrobbleData> DatabaseManager::loadAllScrobblesSync(
   return loadScrobblesSync(basePath, username, distantPast, distantFuture,
                            errorMsg);
 }
+QSharedPointer<ScrobbleStore>
+DatabaseManager::openStoreSync(const QString &basePath,
+                               const QString &username, QString &errorMsg) {
+  QSharedPointer<ScrobbleStore> store(new ScrobbleStore);
+  QString userPath = basePath + "/" + username;
+  if (!QDir(userPath).exists()) {
+    return store;
+  }
+
+  WeekManifest manifest(getManifestPath(userPath));
+  {
+    QMutexLocker storageLocker(&s_storageMutex);
+    QString prepareError;
+    if (!prepareUserDirSync(userPath, prepareError)) {
+      errorMsg += prepareError + "; ";
+    }
+    QString manifestError;
+    QStringList problems;
+    if (!loadManifestSync(userPath, manifest, manifestError)) {
+      qWarning() << "[DB Manifest]" << manifestError;
+    } else if (!checkManifestSync(userPath, manifest, false, problems)) {
+      qWarning() << "[DB Manifest] Manifest out of date, rebuilding:"
+                 << problems.join("; ");
+      if (!rebuildManifestSync(userPath, manifest, manifestError))
+        qWarning() << "[DB Manifest]" << manifestError;
+    }
+  }
+
+  QStringList weekFilePaths;
+  for (const WeekManifest::Entry &entry : manifest.entries())
+    weekFilePaths.append(getWeekFilePath(userPath, entry.weekStartUts));
+  store->open(getDictionaryPath(userPath), weekFilePaths, errorMsg);
+  return store;
+}
+
+bool DatabaseManager::saveSnapshotSync(const QString &basePath,
+                                       const QString &username,
+                                       const IncrementalAnalytics &state,
+                                       const ScrobbleStore &store,
+                                       QString &errorMsg) {
+  const QString userPath = basePath + "/" + username;
+  if (state.isEmpty()) {
+    errorMsg = "Analytics state is empty.";
+    return false;
+  }
+  if (!QDir(userPath).exists()) {
+    errorMsg = "User directory does not exist: " + userPath;
+    return false;
+  }
+
+  const qint64 watermark = state.lastUts();
+  const qint64 watermarkWeek = getWeekStart(watermark);
+  QList<SnapshotFileEntry> entries;
+  qint64 coveredTotal = 0;
+  for (const ScrobbleStore::WeekFileInfo &info : store.weekFiles()) {
+    if (info.weekStartUts > watermarkWeek)
+      break;
+    SnapshotFileEntry entry;
+    entry.weekStartUts = info.weekStartUts;
+    entry.byteSize = info.byteSize;
+    entry.lastModifiedMs = info.lastModifiedMs;
+    entry.coveredRows = info.rowCount;
+    if (info.weekStartUts == watermarkWeek) {
+      // Rows are sorted inside a week file.
+      qsizetype low = info.firstRow;
+      qsizetype high = info.firstRow + info.rowCount;
+      while (low < high) {
+        const qsizetype mid = low + (high - low) / 2;
+        if (store.utsAt(mid) <= watermark)
+          low = mid + 1;
+        else
+          high = mid;
+      }
+      entry.coveredRows = quint32(low - info.firstRow);
+    }
+    coveredTotal += entry.coveredRows;
+    entries.append(entry);
+  }
+  if (coveredTotal != state.scrobbleCount()) {
+    errorMsg = QString("Analytics state (%1 scrobbles) does not match the "
+                       "stored week files (%2 scrobbles).")
+                   .arg(state.scrobbleCount())
+                   .arg(coveredTotal);
+    return false;
+  }
+
+  QSaveFile file(getSnapshotPath(userPath));
+  if (!file.open(QIODevice::WriteOnly)) {
+    errorMsg = "Cannot write analytics snapshot: " + file.errorString();
+    return false;
+  }
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_6_0);
+  out << SNAPSHOT_MAGIC << SNAPSHOT_VERSION << QTimeZone::systemTimeZoneId()
+      << watermark << quint32(entries.size());
+  for (const SnapshotFileEntry &entry : entries) {
+    out << entry.weekStartUts << entry.byteSize << entry.lastModifiedMs
+        << entry.coveredRows;
+  }
+  state.serialize(out);
+  if (out.status() != QDataStream::Ok || !file.commit()) {
+    errorMsg = "Cannot write analytics snapshot: " + file.errorString();
+    return false;
+  }
+  qDebug() << "[DB Snapshot] Saved analytics snapshot for" << username
+           << "at watermark" << watermark;
+  return true;
+}
+
+QSharedPointer<IncrementalAnalytics>
+DatabaseManager::loadSnapshotSync(const QString &basePath,
+                                  const QString &username, QString &errorMsg) {
+  const QString userPath = basePath + "/" + username;
+  if (QDir(userPath).exists()) {
+    QMutexLocker storageLocker(&s_storageMutex);
+    QString prepareError;
+    if (!prepareUserDirSync(userPath, prepareError)) {
+      errorMsg = prepareError;
+      return {};
+    }
+  }
+  QFile file(getSnapshotPath(userPath));
+  if (!file.exists())
+    return {};
+  if (!file.open(QIODevice::ReadOnly)) {
+    errorMsg = "Cannot read analytics snapshot: " + file.errorString();
+    return {};
+  }
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_6_0);
+  quint32 magic = 0;
+  quint32 version = 0;
+  in >> magic >> version;
+  if (magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION) {
+    errorMsg = "Unsupported analytics snapshot format.";
+    return {};
+  }
+  QByteArray timeZoneId;
+  qint64 watermark = 0;
+  quint32 fileCount = 0;
+  in >> timeZoneId >> watermark >> fileCount;
+  // The hour, weekday and day counters are in local time.
+  if (timeZoneId != QTimeZone::systemTimeZoneId()) {
+    errorMsg = "Time zone changed since the analytics snapshot was written.";
+    return {};
+  }
+  QList<SnapshotFileEntry> entries;
+  for (quint32 i = 0; i < fileCount && in.status() == QDataStream::Ok; ++i) {
+    SnapshotFileEntry entry;
+    in >> entry.weekStartUts >> entry.byteSize >> entry.lastModifiedMs >>
+        entry.coveredRows;
+    entries.append(entry);
+  }
+  auto state = QSharedPointer<IncrementalAnalytics>::create();
+  if (in.status() != QDataStream::Ok || !state->deserialize(in) ||
+      state->watermark() != watermark || entries.isEmpty()) {
+    errorMsg = "Corrupt analytics snapshot.";
+    return {};
+  }
+  file.close();
+
+  // Every week file up to the watermark week must be the one the snapshot
+  // was built from. Only the watermark week itself may have grown since.
+  const qint64 watermarkWeek = getWeekStart(watermark);
+  QList<QPair<qint64, QString>> pending;
+  qsizetype entryIndex = 0;
+  for (const auto &weekFile : listWeekFiles(userPath, WeekFile::fileSuffix())) {
+    if (weekFile.first > watermarkWeek) {
+      pending.append(weekFile);
+      continue;
+    }
+    const QFileInfo info(weekFile.second);
+    if (entryIndex >= entries.size() ||
+        entries[entryIndex].weekStartUts != weekFile.first) {
+      errorMsg = "Week file " + info.fileName() +
+                 " is not covered by the analytics snapshot.";
+      return {};
+    }
+    const SnapshotFileEntry &entry = entries[entryIndex++];
+    if (info.size() == entry.byteSize &&
+        info.lastModified().toMSecsSinceEpoch() == entry.lastModifiedMs)
+      continue;
+    if (weekFile.first < watermarkWeek) {
+      errorMsg = "Week file " + info.fileName() +
+                 " changed since the analytics snapshot was written.";
+      return {};
+    }
+    pending.append(weekFile);
+  }
+  if (entryIndex != entries.size()) {
+    errorMsg = "A week file covered by the analytics snapshot was removed.";
+    return {};
+  }
+
+  qint64 folded = 0;
+  if (!pending.isEmpty()) {
+    StringDictionary dictionary(getDictionaryPath(userPath));
+    QString dictionaryError;
+    if (!dictionary.load(dictionaryError)) {
+      errorMsg = dictionaryError;
+      return {};
+    }
+    for (const auto &weekFile : pending) {
+      const QString fileName = QFileInfo(weekFile.second).fileName();
+      QFile weekData(weekFile.second);
+      if (!weekData.open(QIODevice::ReadOnly)) {
+        errorMsg = "Cannot read file: " + fileName;
+        return {};
+      }
+      const QByteArray data = weekData.readAll();
+      weekData.close();
+
+      QList<ScrobbleData> rows;
+      WeekFile::DecodeResult result =
+          WeekFile::decode(data, dictionary, 0,
+                           std::numeric_limits<qint64>::max(), rows);
+      if (result == WeekFile::DecodeResult::UnknownStringId &&
+          dictionary.refresh(dictionaryError)) {
+        result = WeekFile::decode(data, dictionary, 0,
+                                  std::numeric_limits<qint64>::max(), rows);
+      }
+      if (result != WeekFile::DecodeResult::Ok) {
+        errorMsg = "Corrupt file: " + fileName;
+        return {};
+      }
+      const qint64 expectedCovered = weekFile.first == watermarkWeek
+                                         ? entries.last().coveredRows
+                                         : 0;
+      const qint64 covered =
+          std::count_if(rows.cbegin(), rows.cend(),
+                        [watermark](const ScrobbleData &s) {
+                          return s.uts <= watermark;
+                        });
+      if (covered != expectedCovered) {
+        errorMsg = "Week file " + fileName +
+                   " changed since the analytics snapshot was written.";
+        return {};
+      }
+      folded += state->apply(rows);
+    }
+  }
+  qInfo() << "[DB Snapshot] Restored analytics of" << state->scrobbleCount()
+          << "scrobbles," << folded << "of them stored after the snapshot.";
+  return state;
+}
+
 qint64 DatabaseManager::findLastTimestampSync(const QString &basePath,
                                               const QString &username) {
   QString userPath = basePath + "/" + username;
   QDir userDir(userPath);
   if (!userDir.exists())
     return 0;
-  userDir.setFilter(QDir::Files | QDir::NoDotAndDotDot);
-  userDir.setNameFilters({"*.json"});
-  userDir.setSorting(QDir::Name | QDir::Reversed);
-  QStringList fileList = userDir.entryList();
-  for (const QString &fileName : fileList) {
-    QFile file(userDir.filePath(fileName));
-    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-      QByteArray data = file.readAll();
-      file.close();
-      QJsonParseError parseError;
-      QJsonDocument doc = QJsonDocument::fromJson(data, &parseError);
-      if (parseError.error == QJsonParseError::NoError && doc.isArray()) {
-        QJsonArray array = doc.array();
-        if (!array.isEmpty()) {
-          QJsonObject lastObj = array.last().toObject();
-          if (lastObj.contains("uts")) {
-            qint64 lastTimestampInFile = lastObj["uts"].toInteger();
-            if (lastTimestampInFile > 0)
-              return lastTimestampInFile;
-          }
-        }
-      }
+  WeekManifest manifest(getManifestPath(userPath));
+  {
+    QMutexLocker storageLocker(&s_storageMutex);
+    QString prepareError;
+    if (!prepareUserDirSync(userPath, prepareError)) {
+      qWarning() << "[DB]" << prepareError;
+    }
+    QString manifestError;
+    if (!loadManifestSync(userPath, manifest, manifestError)) {
+      qWarning() << "[DB Manifest]" << manifestError;
+    }
+  }
+  return manifest.lastTimestamp();
+}
+
+QMap<qint64, int> DatabaseManager::weekCountsSync(const QString &basePath,
+                                                 const QString &username) {
+  QString userPath = basePath + "/" + username;
+  QMap<qint64, int> counts;
+  if (!QDir(userPath).exists())
+    return counts;
+  WeekManifest manifest(getManifestPath(userPath));
+  {
+    QMutexLocker storageLocker(&s_storageMutex);
+    QString prepareError;
+    if (!prepareUserDirSync(userPath, prepareError)) {
+      qWarning() << "[DB]" << prepareError;
+    }
+    QString manifestError;
+    if (!loadManifestSync(userPath, manifest, manifestError)) {
+      qWarning() << "[DB Manifest]" << manifestError;
+    }
+  }
+  for (const WeekManifest::Entry &entry : manifest.entries()) {
+    counts.insert(entry.weekStartUts, int(entry.rowCount));
+  }
+  return counts;
+}
+
+bool DatabaseManager::parseLegacyJson(const QByteArray &data,
+                                      QList<ScrobbleData> &rows) {
+  QString parseError;
+  if (!ScrobbleJsonParser::parseWeekArray(data, rows, parseError)) {
+    qWarning() << "[DB Migration]" << parseError;
+    return false;
+  }
+  return true;
+}
+
+QByteArray DatabaseManager::toLegacyJson(const QList<ScrobbleData> &rows) {
+  QJsonArray outputArray;
+  for (const ScrobbleData &s : rows) {
+    QJsonObject obj;
+    obj["artist"] = s.artist();
+    obj["track"] = s.track();
+    obj["album"] = s.album();
+    obj["uts"] = s.uts;
+    outputArray.append(obj);
+  }
+  return QJsonDocument(outputArray).toJson(QJsonDocument::Compact);
+}
+
+bool DatabaseManager::exportJsonSync(const QString &basePath,
+                                     const QString &username,
+                                     const QString &targetDir,
+                                     QString &errorMsg) {
+  if (username.isEmpty() || targetDir.isEmpty()) {
+    errorMsg = "Username and export directory must not be empty.";
+    return false;
+  }
+  if (!QDir().mkpath(targetDir)) {
+    errorMsg = "Could not create export directory: " + targetDir;
+    return false;
+  }
+
+  QString loadError;
+  QList<ScrobbleData> all = loadAllScrobblesSync(basePath, username, loadError);
+  if (!loadError.isEmpty()) {
+    errorMsg = loadError;
+    return false;
+  }
+
+  QMap<qint64, QList<ScrobbleData>> rowsByWeek;
+  for (const ScrobbleData &s : all)
+    rowsByWeek[getWeekStart(s.uts)].append(s);
+
+  for (auto it = rowsByWeek.constBegin(); it != rowsByWeek.constEnd(); ++it) {
+    QString filePath = QString("%1/%2.json").arg(targetDir).arg(it.key());
+    QSaveFile saveFile(filePath);
+    if (!saveFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+      errorMsg = "Could not open export file: " + filePath;
+      return false;
+    }
+    saveFile.write(toLegacyJson(it.value()));
+    if (!saveFile.commit()) {
+      errorMsg = "Failed to write export file: " + filePath +
+                 " Error: " + saveFile.errorString();
+      return false;
     }
   }
-  return 0;
+  qInfo() << "[DB Export] Exported" << all.size() << "scrobbles in"
+          << rowsByWeek.size() << "week files to" << targetDir;
+  return true;
 }
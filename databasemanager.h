@@ -1,16 +1,26 @@
 #ifndef DATABASEMANAGER_H
 #define DATABASEMANAGER_H
 
+#include "incrementalanalytics.h"
 #include "scrobbledata.h"
+#include "scrobblestore.h"
 #include <QAtomicInteger>
 #include <QDateTime>
 #include <QFuture>
 #include <QFutureWatcher>
 #include <QList>
+#include <QMap>
 #include <QMutex>
 #include <QObject>
+#include <QPair>
 #include <QQueue>
+#include <QSharedPointer>
 #include <QString>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+class StringDictionary;
+class WeekManifest;
 
 /**
  * @struct SaveWorkItem
@@ -28,8 +38,14 @@ class TestDatabaseManager;
  * @class DatabaseManager
  * @brief Manages the persistence of scrobble data to the local disk.
  * @details Provides asynchronous methods for saving fetched scrobble pages and
- * loading stored scrobbles. Data is organized into weekly JSON files per user.
- * Uses QtConcurrent for background tasks.
+ * loading stored scrobbles. Data is organized into weekly binary columnar files
+ * (see WeekFile) per user, whose strings live in a per-user StringDictionary.
+ * A per-user WeekManifest indexes the week files, so range loads and the last
+ * sync timestamp do not need to list or open them. Fetched pages are first
+ * appended to a per-user ScrobbleJournal and folded into the week files in
+ * batches. Legacy weekly JSON files
+ * are migrated on first access, and JSON remains available as an export
+ * format. Uses QtConcurrent for background tasks.
  * @inherits QObject
  */
 class DatabaseManager : public QObject {
@@ -49,15 +65,24 @@ public:
                            QObject *parent = nullptr);
 
   /**
-   * @brief Default destructor.
+   * @brief Destructor.
+   * @details Waits for the save task (see shutdown()).
    */
-  ~DatabaseManager() override = default;
+  ~DatabaseManager() override;
+
+  /** @brief Default of maxSaveQueuePages(). */
+  static const int DEFAULT_MAX_SAVE_QUEUE_PAGES = 64;
 
   /**
    * @brief Asynchronously queues a list of scrobbles for saving to the
    * database.
-   * @details The save operation is performed in a background thread. Empty
-   * usernames or scrobble lists are handled gracefully.
+   * @details The save operation is performed in a background thread. An
+   * empty list is queued as well and reported with pageSaveCompleted in
+   * turn, so the completions of a fetch arrive in the order it queued its
+   * pages. Blocks while maxSaveQueuePages() pages are queued, until the save
+   * task takes the next batch; meant to be called from the fetch pipeline
+   * (see LastFmManager::pageReadyForSaving), not the GUI thread.
+   * @note Thread-safe.
    * @param pageNumber The page number corresponding to this batch of scrobbles
    * (used for signalling).
    * @param username The Last.fm username the scrobbles belong to. Cannot be
@@ -67,6 +92,27 @@ public:
   void saveScrobblesAsync(int pageNumber, const QString &username,
                           const QList<ScrobbleData> &scrobbles);
 
+  /**
+   * @brief Sets how many pages may wait in the save queue before
+   * saveScrobblesAsync() blocks.
+   * @param pages The limit; values below 1 are raised to 1.
+   */
+  void setMaxSaveQueuePages(int pages);
+  /** @brief Returns the queue length at which saves block. */
+  int maxSaveQueuePages() const;
+
+  /**
+   * @brief Stops accepting pages and waits until the queued ones are saved.
+   * @details Callers blocked in saveScrobblesAsync() are woken and their
+   * pages rejected with pageSaveFailed, as is every later page; a rejected
+   * page is fetched again by the next sync. The manager's signals are
+   * disconnected first, so the saves still finishing do not reach receivers
+   * that are being torn down. Call this before destroying the fetch pipeline
+   * feeding the queue; the manager cannot save afterwards.
+   * @note Must not be called from the fetch pipeline.
+   */
+  void shutdown();
+
   /**
    * @brief Asynchronously loads scrobbles for a specific user within a given
    * UTC date range using QtConcurrent.
@@ -90,15 +136,71 @@ public:
    */
   void loadAllScrobblesAsync(const QString &username);
 
+  /**
+   * @brief Asynchronously opens a memory-mapped ScrobbleStore over all stored
+   * week files of a user.
+   * @details Unlike loadAllScrobblesAsync, nothing is copied into a
+   * QList<ScrobbleData>; rows are read from the mapped files on demand.
+   * Connect to storeOpened or loadError for the outcome.
+   * @param username The Last.fm username to open. Cannot be empty.
+   */
+  void openStoreAsync(const QString &username);
+
+  /**
+   * @brief Asynchronously loads the persisted analytics snapshot of a user and
+   * folds in the scrobbles stored after it was written.
+   * @details The snapshot is only used if every week file it covers is
+   * unchanged; otherwise, or if there is none, a null state is delivered and
+   * the caller should analyze the store from scratch. Connect to
+   * snapshotLoaded for the outcome.
+   * @param username The Last.fm username to load. Cannot be empty.
+   */
+  void loadSnapshotAsync(const QString &username);
+
+  /**
+   * @brief Asynchronously writes an analytics state as the user's snapshot.
+   * @details Failures are only logged; a missing snapshot costs one full
+   * analysis at the next start.
+   * @param username The Last.fm username the state belongs to.
+   * @param state The state to persist. It must not be modified afterwards
+   * (pass a copy of a live state).
+   * @param store The store the state was built from; the identity of its week
+   * files is recorded so later changes invalidate the snapshot.
+   */
+  void saveSnapshotAsync(const QString &username,
+                         QSharedPointer<const IncrementalAnalytics> state,
+                         QSharedPointer<const ScrobbleStore> store);
+
   /**
    * @brief Synchronously retrieves the timestamp of the latest scrobble stored
    * in the database for a given user.
+   * @details Answered from the week manifest without opening any week file.
    * @param username The Last.fm username to check. Cannot be empty.
    * @return The UTC timestamp (seconds since epoch) of the last known scrobble,
    * or 0 if no data exists or the user is empty.
    */
   qint64 getLastSyncTimestamp(const QString &username);
 
+  /**
+   * @brief Synchronously retrieves the number of stored scrobbles per week.
+   * @details Answered from the week manifest without opening any week file;
+   * journaled pages are folded in first. A corrupt week file counts as
+   * empty.
+   * @param username The Last.fm username to check. Cannot be empty.
+   * @return Row counts keyed by UTC week start (seconds since epoch); empty
+   * if no data exists or the user is empty.
+   */
+  QMap<qint64, int> getWeekCounts(const QString &username);
+
+  /**
+   * @brief Asynchronously exports all stored scrobbles of a user as weekly
+   * JSON files (the legacy storage layout) into a target directory.
+   * @details Connect to exportFinished for the outcome.
+   * @param username The Last.fm username whose data is exported.
+   * @param targetDir The directory the `<weekStart>.json` files are written to.
+   */
+  void exportToJsonAsync(const QString &username, const QString &targetDir);
+
   /**
    * @brief Checks if there are pending save operations either running or
    * queued.
@@ -107,6 +209,13 @@ public:
    */
   bool isSaveInProgress() const;
 
+  /**
+   * @brief Returns the persist stage backlog: pages queued for saving plus
+   * the pages of the batch being written.
+   * @note Thread-safe.
+   */
+  int saveQueueDepth() const;
+
   /**
    * @brief Provides access to the base path used by the manager.
    * @return The absolute path string of the database root directory.
@@ -120,6 +229,28 @@ signals:
    * @param pageNumber The page number that was completed.
    */
   void pageSaveCompleted(int pageNumber);
+  /**
+   * @brief Emitted whenever saveQueueDepth() changes: when a page is queued
+   * and when the save task takes or finishes a batch.
+   * @details Emitted from the save task thread as well; connect with a queued
+   * (or automatic) connection.
+   * @param depth The new backlog in pages.
+   */
+  void saveQueueDepthChanged(int depth);
+  /**
+   * @brief Emitted by the save task when the queue has drained and all
+   * journaled pages have been folded into the week files.
+   */
+  void saveQueueIdle();
+  /**
+   * @brief Emitted by the save task after a batch of pages of one user has
+   * been journaled.
+   * @details Lets views fold fetched scrobbles in once they are durable.
+   * @param username The user the scrobbles belong to.
+   * @param scrobbles The scrobbles of the batch, in queue order.
+   */
+  void scrobblesSaved(const QString &username,
+                      const QList<ScrobbleData> &scrobbles);
   /**
    * @brief Emitted when saving a specific page of scrobbles failed.
    * @param pageNumber The page number that failed.
@@ -140,6 +271,27 @@ signals:
    */
   void loadError(const QString &error);
 
+  /**
+   * @brief Emitted when an asynchronous openStoreAsync operation succeeds.
+   * @param store The opened store. It is read-only and may be shared with
+   * worker threads.
+   */
+  void storeOpened(QSharedPointer<const ScrobbleStore> store);
+
+  /**
+   * @brief Emitted when an asynchronous loadSnapshotAsync operation finishes.
+   * @param state The restored, up-to-date analytics state, or null if no
+   * usable snapshot exists.
+   */
+  void snapshotLoaded(QSharedPointer<IncrementalAnalytics> state);
+
+  /**
+   * @brief Emitted when an asynchronous JSON export finishes.
+   * @param success True if every week file was written.
+   * @param message The target directory on success, or an error description.
+   */
+  void exportFinished(bool success, const QString &message);
+
   /**
    * @brief Emitted to provide status updates about database operations (saving,
    * loading, errors).
@@ -154,25 +306,40 @@ private slots:
    */
   void handleLoadFinished();
 
+  /**
+   * @brief Slot connected to the store watcher's finished signal.
+   */
+  void handleStoreOpenFinished();
+
+  /**
+   * @brief Slot connected to the snapshot watcher's finished signal.
+   */
+  void handleSnapshotLoadFinished();
+
 private:
   /**
    * @brief Starts the background save task via QtConcurrent if it's not already
    * running.
+   * @note Called with m_saveQueueMutex held.
    */
   void startSaveTaskIfNotRunning();
 
   /**
    * @brief The main loop executed by the background save task thread.
-   * @details Dequeues SaveWorkItem instances and calls saveChunkSync until the
-   * queue is empty.
+   * @details Drains the queue in batches of up to SAVE_BATCH_MAX_PAGES
+   * SaveWorkItem instances and appends the pages of each user as one journal
+   * record via journalChunkSync, then emits pageSaveCompleted (or
+   * pageSaveFailed) for every page. A journal is folded into the week files,
+   * one merge-write per week file, once it holds JOURNAL_COMPACT_ROWS rows and
+   * whenever the queue drains.
    */
   void saveTaskLoop();
 
   /**
    * @brief Synchronously saves or merges a list of scrobbles into the
-   * appropriate weekly JSON file(s).
-   * @details Reads existing data, merges new unique scrobbles, sorts, and
-   * writes back using QSaveFile.
+   * appropriate weekly binary file(s).
+   * @details Validates the input, takes the storage write lock, migrates
+   * legacy JSON files and calls mergeIntoWeekFilesSync.
    * @param basePath The root database directory path.
    * @param username The username subdirectory.
    * @param scrobbles The list of new scrobbles to process.
@@ -183,6 +350,66 @@ private:
                             const QList<ScrobbleData> &scrobbles,
                             QString &errorMsg);
 
+  /**
+   * @brief Merges scrobbles into the weekly binary files of a user directory.
+   * @details Reads existing data, merges new unique scrobbles with
+   * WeekFile::mergeRows(), and writes back using QSaveFile. The caller must
+   * hold the storage write lock.
+   * @param userPath The path to the specific user's data directory.
+   * @param scrobbles The list of new scrobbles to process.
+   * @param[out] errorMsg A string to store any error messages encountered.
+   * @return True if all operations were successful, false otherwise.
+   */
+  static bool mergeIntoWeekFilesSync(const QString &userPath,
+                                     const QList<ScrobbleData> &scrobbles,
+                                     QString &errorMsg);
+
+  /**
+   * @brief Synchronously appends a list of scrobbles to the user's journal.
+   * @details One sequential, fsynced write; no week file is read or written.
+   * @param basePath The root database directory path.
+   * @param username The username subdirectory.
+   * @param scrobbles The list of new scrobbles to journal.
+   * @param[out] errorMsg A string to store any error messages encountered.
+   * @return True once the scrobbles are durable.
+   */
+  static bool journalChunkSync(const QString &basePath,
+                               const QString &username,
+                               const QList<ScrobbleData> &scrobbles,
+                               QString &errorMsg);
+
+  /**
+   * @brief Folds the user's journal into the week files and deletes it.
+   * @details Locking wrapper around foldJournalSync().
+   * @param basePath The root database directory path.
+   * @param username The username subdirectory.
+   * @param[out] errorMsg A string to store any error messages encountered.
+   * @return True if no journal is left behind.
+   */
+  static bool compactJournalSync(const QString &basePath,
+                                 const QString &username, QString &errorMsg);
+
+  /**
+   * @brief Replays the journal of a user directory into the week files in one
+   * merge and deletes it.
+   * @details Does nothing if there is no journal. The journal is kept if the
+   * merge fails. The caller must hold the storage write lock.
+   * @param userPath The path to the specific user's data directory.
+   * @param[out] errorMsg A string to store any error messages encountered.
+   * @return True if no journal is left behind.
+   */
+  static bool foldJournalSync(const QString &userPath, QString &errorMsg);
+
+  /**
+   * @brief Brings a user directory up to date before it is read: migrates
+   * legacy JSON files and folds a journal left behind by an earlier run.
+   * @details The caller must hold the storage write lock.
+   * @param userPath The path to the specific user's data directory.
+   * @param[out] errorMsg A string to store any error messages encountered.
+   * @return True if the week files are complete.
+   */
+  static bool prepareUserDirSync(const QString &userPath, QString &errorMsg);
+
   /**
    * @brief Calculates the start of the week (Monday, 00:00:00 UTC) containing
    * the given timestamp.
@@ -190,21 +417,172 @@ private:
    * @return A QDateTime representing the start of the week in UTC.
    */
   static QDateTime getWeekStart(const QDateTime timestamp);
+  /**
+   * @brief Integer overload of getWeekStart().
+   * @param uts A UTC timestamp in seconds since epoch.
+   * @return The UTC week start (Monday 00:00:00) in seconds since epoch.
+   */
+  static qint64 getWeekStart(qint64 uts);
   /**
    * @brief Constructs the full file path for the weekly data file corresponding
    * to the given timestamp.
    * @details The filename is based on the Unix timestamp of the week start.
    * @param userPath The path to the specific user's data directory.
    * @param timestamp The timestamp within the desired week.
-   * @return A QString containing the full path to the JSON file (e.g.,
-   * ".../username/1677456000.json").
+   * @return A QString containing the full path to the week file (e.g.,
+   * ".../username/1677456000.week").
    */
   static QString getWeekFilePath(const QString &userPath,
                                  const QDateTime timestamp);
+  /**
+   * @brief Integer overload of getWeekFilePath().
+   * @param userPath The path to the specific user's data directory.
+   * @param uts A UTC timestamp (seconds since epoch) within the desired week.
+   */
+  static QString getWeekFilePath(const QString &userPath, qint64 uts);
+
+  /**
+   * @brief Returns the path of the string dictionary inside a user directory.
+   * @param userPath The path to the specific user's data directory.
+   * @return The dictionary file path.
+   */
+  static QString getDictionaryPath(const QString &userPath);
+
+  /**
+   * @brief Returns the path of the scrobble journal inside a user directory.
+   * @param userPath The path to the specific user's data directory.
+   * @return The journal file path.
+   */
+  static QString getJournalPath(const QString &userPath);
+
+  /**
+   * @brief Returns the path of the analytics snapshot inside a user directory.
+   * @param userPath The path to the specific user's data directory.
+   * @return The snapshot file path.
+   */
+  static QString getSnapshotPath(const QString &userPath);
+
+  /**
+   * @brief Lists the week files with the given suffix in a user directory.
+   * @param userPath The path to the specific user's data directory.
+   * @param suffix The filename suffix to match (e.g. ".week").
+   * @return Pairs of (week start UTC seconds, file path), sorted numerically
+   * by week start. Files whose name is not a number are skipped.
+   */
+  static QList<QPair<qint64, QString>> listWeekFiles(const QString &userPath,
+                                                     const QString &suffix);
+
+  /**
+   * @brief Encodes and atomically writes one week file.
+   * @details Flushes new dictionary entries before committing the file and
+   * updates the file's entry in @p manifest (in memory; the caller saves it).
+   * @param filePath Target week file path.
+   * @param sorted The week's scrobbles, sorted by timestamp. Must not be empty.
+   * @param dictionary The user's string dictionary.
+   * @param manifest The user's week manifest.
+   * @param[out] errorMsg A string to store any error message encountered.
+   * @return True on success.
+   */
+  static bool writeWeekFileSync(const QString &filePath,
+                                const QList<ScrobbleData> &sorted,
+                                StringDictionary &dictionary,
+                                WeekManifest &manifest, QString &errorMsg);
+
+  /**
+   * @brief Returns the path of the week manifest inside a user directory.
+   * @param userPath The path to the specific user's data directory.
+   * @return The manifest file path.
+   */
+  static QString getManifestPath(const QString &userPath);
+
+  /**
+   * @brief Loads the week manifest of a user directory, rebuilding it from the
+   * week files if it is missing or unreadable.
+   * @details The caller must hold the storage write lock.
+   * @param userPath The path to the specific user's data directory.
+   * @param[out] manifest Receives the entries.
+   * @param[out] errorMsg A string to store any error message encountered.
+   * @return False if a rebuilt manifest could not be saved; @p manifest is
+   * still filled in that case.
+   */
+  static bool loadManifestSync(const QString &userPath, WeekManifest &manifest,
+                               QString &errorMsg);
+
+  /**
+   * @brief Recreates the week manifest from the week files on disk.
+   * @details Reads every week file once. The caller must hold the storage
+   * write lock.
+   * @param userPath The path to the specific user's data directory.
+   * @param[out] manifest Receives the entries.
+   * @param[out] errorMsg A string to store any error message encountered.
+   * @return False if the manifest could not be saved.
+   */
+  static bool rebuildManifestSync(const QString &userPath,
+                                  WeekManifest &manifest, QString &errorMsg);
+
+  /**
+   * @brief Compares a week manifest against the week files on disk.
+   * @details Reports files missing from either side and size mismatches;
+   * with @p verifyChecksums, every file is also read and its CRC-32 compared.
+   * @param userPath The path to the specific user's data directory.
+   * @param manifest The manifest to check.
+   * @param verifyChecksums True to compare file contents as well.
+   * @param[out] problems One description per inconsistency.
+   * @return True if the manifest matches the directory.
+   */
+  static bool checkManifestSync(const QString &userPath,
+                                const WeekManifest &manifest,
+                                bool verifyChecksums, QStringList &problems);
+
+  /**
+   * @brief One-time conversion of legacy `<weekStart>.json` files in a user
+   * directory into binary week files.
+   * @details Does nothing once the storage version marker exists. Rows are
+   * merged into existing week files by (uts, artist, track); converted JSON
+   * files are moved to a `json-backup` subdirectory. A JSON file that cannot
+   * be parsed, or whose week file cannot be decoded, is left in place and
+   * logged, and the marker is then not written so the file is retried on the
+   * next call. The caller must hold the storage write lock.
+   * @param userPath The path to the specific user's data directory.
+   * @param[out] errorMsg A string to store any error message encountered.
+   * @return False on an I/O error; skipped files do not fail the call.
+   */
+  static bool migrateLegacyJsonSync(const QString &userPath,
+                                    QString &errorMsg);
+
+  /**
+   * @brief Parses a legacy JSON week file (array of {artist, track, album,
+   * uts} objects).
+   * @param data The raw JSON content.
+   * @param[out] rows Valid scrobbles are appended here.
+   * @return False if the data is not a JSON array.
+   */
+  static bool parseLegacyJson(const QByteArray &data,
+                              QList<ScrobbleData> &rows);
+
+  /**
+   * @brief Serializes scrobbles into the legacy JSON week-file layout.
+   * @param rows The scrobbles to serialize.
+   * @return Compact JSON bytes.
+   */
+  static QByteArray toLegacyJson(const QList<ScrobbleData> &rows);
+
+  /**
+   * @brief Synchronously writes all scrobbles of a user as weekly JSON files.
+   * @param basePath The root database directory path.
+   * @param username The username subdirectory.
+   * @param targetDir Directory receiving the `<weekStart>.json` files.
+   * @param[out] errorMsg A string to store any error message encountered.
+   * @return True on success.
+   */
+  static bool exportJsonSync(const QString &basePath, const QString &username,
+                             const QString &targetDir, QString &errorMsg);
 
   /**
    * @brief Synchronously loads scrobbles from weekly files within a specified
    * UTC date range.
+   * @details The files are selected by their timestamp range in the week
+   * manifest; the directory is not listed.
    * @param basePath The root database directory path.
    * @param username The username subdirectory.
    * @param from The start UTC timestamp (inclusive).
@@ -231,11 +609,60 @@ private:
                                                   const QString &username,
                                                   QString &errorMsg);
 
+  /**
+   * @brief Synchronously maps all week files of a user into a ScrobbleStore.
+   * @details Legacy JSON files are migrated first. The week manifest is
+   * checked against the directory (without checksums) and rebuilt if it has
+   * drifted, e.g. after a crash between a week file and a manifest write.
+   * @param basePath The root database directory path.
+   * @param username The username subdirectory.
+   * @param[out] errorMsg A string to store any error messages encountered
+   * (e.g., corrupt files).
+   * @return The opened store; empty if the user has no data yet.
+   */
+  static QSharedPointer<ScrobbleStore> openStoreSync(const QString &basePath,
+                                                     const QString &username,
+                                                     QString &errorMsg);
+
+  /**
+   * @brief Synchronously writes an analytics snapshot.
+   * @details Records, next to the state, the size, modification time and
+   * number of covered rows of every week file up to the week of the state's
+   * last scrobble. The file is replaced atomically.
+   * @param basePath The root database directory path.
+   * @param username The username subdirectory.
+   * @param state The state to persist.
+   * @param store The store the state was built from.
+   * @param[out] errorMsg A string to store any error message encountered.
+   * @return False if the state does not match the store or the file could not
+   * be written.
+   */
+  static bool saveSnapshotSync(const QString &basePath,
+                               const QString &username,
+                               const IncrementalAnalytics &state,
+                               const ScrobbleStore &store, QString &errorMsg);
+
+  /**
+   * @brief Synchronously restores an analytics snapshot and brings it up to
+   * date.
+   * @details Week files before the snapshot's last week must be unchanged, and
+   * the last week must still hold the same rows up to the watermark. Rows
+   * after the watermark (in that week or in newer week files) are decoded and
+   * applied to the restored state.
+   * @param basePath The root database directory path.
+   * @param username The username subdirectory.
+   * @param[out] errorMsg Why an existing snapshot could not be used.
+   * @return The state, or null if there is no usable snapshot.
+   */
+  static QSharedPointer<IncrementalAnalytics>
+  loadSnapshotSync(const QString &basePath, const QString &username,
+                   QString &errorMsg);
+
   /**
    * @brief Synchronously finds the timestamp of the very last scrobble stored
    * across all weekly files for a user.
-   * @details Iterates through files in reverse order to find the latest entry
-   * efficiently.
+   * @details Reads the maximum timestamp of the newest week from the week
+   * manifest.
    * @param basePath The root database directory path.
    * @param username The username subdirectory.
    * @return The UTC timestamp (seconds since epoch) of the latest scrobble, or
@@ -244,14 +671,43 @@ private:
   static qint64 findLastTimestampSync(const QString &basePath,
                                       const QString &username);
 
+  /**
+   * @brief Synchronously reads the row count of every week file of a user
+   * from the week manifest.
+   * @param basePath The root database directory path.
+   * @param username The username subdirectory.
+   * @return Row counts keyed by week start, empty if the user has no data.
+   */
+  static QMap<qint64, int> weekCountsSync(const QString &basePath,
+                                          const QString &username);
+
   QString m_basePath;
 
   QFutureWatcher<QList<ScrobbleData>> m_loadWatcher;
   QString m_lastLoadError;
 
+  QFutureWatcher<QSharedPointer<ScrobbleStore>> m_storeWatcher;
+  QString m_lastStoreError;
+
+  QFutureWatcher<QSharedPointer<IncrementalAnalytics>> m_snapshotWatcher;
+  QString m_lastSnapshotError;
+
   mutable QMutex m_saveQueueMutex;
   QQueue<SaveWorkItem> m_saveQueue;
+  int m_saveBatchPages = 0; /**< @brief Pages of the batch being written;
+                               guarded by m_saveQueueMutex. */
+  int m_maxSaveQueuePages =
+      DEFAULT_MAX_SAVE_QUEUE_PAGES; /**< @brief Queue length at which saves
+                                       block; guarded by m_saveQueueMutex. */
+  QWaitCondition m_saveQueueNotFull; /**< @brief Signalled when the save task
+                                        takes pages off the queue, and on
+                                        shutdown. */
+  bool m_shuttingDown = false; /**< @brief Set by shutdown(); guarded by
+                                  m_saveQueueMutex. */
   QAtomicInteger<bool> m_saveTaskRunning;
+  QThreadPool m_savePool; /**< @brief Runs the save task. Declared last, so
+                             it is destroyed (and waited for) before the
+                             queue the task works on. */
 };
 
 #endif // DATABASEMANAGER_H
@@ -0,0 +1,95 @@
+/**
+ * @file historyverifier.cpp
+ * @brief Implementation of the HistoryVerifier class.
+ */
+
+#include "historyverifier.h"
+#include <QDebug>
+
+HistoryVerifier::HistoryVerifier(const QMap<qint64, int> &localWeekCounts,
+                                 qint64 endUts, int pageLimit)
+    : m_weekCounts(localWeekCounts), m_pageLimit(qMax(1, pageLimit)) {
+  if (endUts > 0) {
+    Request root;
+    root.fromUts = 0;
+    root.toUts = endUts;
+    m_queue.append(root);
+  }
+}
+
+HistoryVerifier::Request HistoryVerifier::takeRequest() {
+  const Request request = m_queue.takeFirst();
+  if (request.kind == Kind::Count)
+    m_summary.countRequests++;
+  return request;
+}
+
+void HistoryVerifier::handleCount(const Request &request, int remoteTotal) {
+  checkWindow(request.fromUts, request.toUts, remoteTotal);
+  if (request.parentTotal >= 0) {
+    checkWindow(request.toUts, request.siblingToUts,
+                qMax(0, request.parentTotal - remoteTotal));
+  }
+}
+
+void HistoryVerifier::handlePage(const Request &request, int totalPages) {
+  m_summary.pagesFetched++;
+  if (request.page != 1)
+    return;
+  for (int page = 2; page <= totalPages; ++page) {
+    Request next = request;
+    next.page = page;
+    m_queue.append(next);
+  }
+}
+
+qint64 HistoryVerifier::localCount(qint64 fromUts, qint64 toUts) const {
+  qint64 count = 0;
+  for (auto it = m_weekCounts.lowerBound(fromUts);
+       it != m_weekCounts.cend() && it.key() < toUts; ++it) {
+    count += it.value();
+  }
+  return count;
+}
+
+qint64 HistoryVerifier::splitPoint(qint64 fromUts, qint64 toUts) const {
+  qint64 boundary = WeekGrid::weekStart(fromUts + (toUts - fromUts) / 2);
+  if (boundary <= fromUts)
+    boundary += WEEK_SECS;
+  return boundary < toUts ? boundary : 0;
+}
+
+void HistoryVerifier::checkWindow(qint64 fromUts, qint64 toUts,
+                                  qint64 remoteTotal) {
+  const qint64 local = localCount(fromUts, toUts);
+  if (remoteTotal == local)
+    return;
+  if (remoteTotal < local) {
+    // Scrobbles deleted on Last.fm since they were stored; nothing to fetch.
+    qDebug() << "[Verifier] Window" << fromUts << "-" << toUts << "stores"
+             << local << "scrobbles, Last.fm has" << remoteTotal;
+    m_summary.extraScrobbles += local - remoteTotal;
+    return;
+  }
+
+  const qint64 boundary = splitPoint(fromUts, toUts);
+  if (local == 0 || remoteTotal <= m_pageLimit || boundary == 0) {
+    qDebug() << "[Verifier] Window" << fromUts << "-" << toUts << "misses"
+             << remoteTotal - local << "of" << remoteTotal << "scrobbles";
+    m_summary.gapWindows++;
+    m_summary.missingScrobbles += remoteTotal - local;
+    Request fetch;
+    fetch.kind = Kind::Fetch;
+    fetch.fromUts = fromUts;
+    fetch.toUts = toUts;
+    m_queue.append(fetch);
+    return;
+  }
+
+  Request left;
+  left.fromUts = fromUts;
+  left.toUts = boundary;
+  left.parentTotal = int(remoteTotal);
+  left.siblingToUts = toUts;
+  m_queue.append(left);
+}
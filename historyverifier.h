@@ -0,0 +1,127 @@
+#ifndef HISTORYVERIFIER_H
+#define HISTORYVERIFIER_H
+
+#include "weekgrid.h"
+#include <QList>
+#include <QMap>
+#include <QtGlobal>
+
+/**
+ * @class HistoryVerifier
+ * @brief Plans the requests that find and refill holes in a stored history.
+ * @details Compares stored scrobble counts with the totals Last.fm reports
+ * for time windows (`user.getrecenttracks` with `from`/`to` and one track per
+ * page, so the page count is the track count). Verification starts with one
+ * window over the whole history up to an end time. A window whose counts
+ * agree is done. A window missing scrobbles is split in two at a week
+ * boundary and the left half is counted; the right half's total follows from
+ * the parent's, so each split costs one request. Splitting stops at a single
+ * week, at a window that fits one page, or at a window with nothing stored.
+ * Such a window is fetched page by page.
+ *
+ * The class only plans: the caller sends takeRequest() results and reports
+ * the answers with handleCount() and handlePage(). Windows are half-open,
+ * [fromUts, toUts).
+ */
+class HistoryVerifier {
+public:
+  /** @brief Length of a week in seconds. */
+  static constexpr qint64 WEEK_SECS = WeekGrid::WEEK_SECS;
+  /** @brief Default tracks per page of a fetched window. */
+  static constexpr int DEFAULT_PAGE_LIMIT = 200;
+
+  /** @brief What a request asks for. */
+  enum class Kind {
+    Count, /**< @brief The number of scrobbles in the window. */
+    Fetch  /**< @brief One page of the scrobbles in the window. */
+  };
+
+  /**
+   * @struct Request
+   * @brief One planned API request.
+   */
+  struct Request {
+    Kind kind = Kind::Count; /**< @brief Count or fetch. */
+    qint64 fromUts = 0;      /**< @brief Window start (inclusive). */
+    qint64 toUts = 0;        /**< @brief Window end (exclusive). */
+    int page = 1;            /**< @brief Page of a fetch. */
+    int parentTotal = -1;    /**< @brief Remote total of the split window,
+                                or -1 if this is not a left half. */
+    qint64 siblingToUts = 0; /**< @brief End of the right half. */
+  };
+
+  /**
+   * @struct Summary
+   * @brief Outcome of a verification so far.
+   */
+  struct Summary {
+    int countRequests = 0;       /**< @brief Windows counted remotely. */
+    int gapWindows = 0;          /**< @brief Windows scheduled for fetch. */
+    int pagesFetched = 0;        /**< @brief Pages of those windows. */
+    qint64 missingScrobbles = 0; /**< @brief Remote minus stored, summed over
+                                    the fetched windows. */
+    qint64 extraScrobbles = 0;   /**< @brief Stored minus remote, summed over
+                                    windows holding more than Last.fm. */
+  };
+
+  /** @brief Constructs a verifier with nothing to do. */
+  HistoryVerifier() = default;
+
+  /**
+   * @brief Plans the verification of the history before @p endUts.
+   * @param localWeekCounts Stored scrobbles per week start (UTC, Monday).
+   * @param endUts End of the verified range (exclusive), normally one second
+   * after the last stored scrobble.
+   * @param pageLimit Tracks per page of a fetched window.
+   */
+  HistoryVerifier(const QMap<qint64, int> &localWeekCounts, qint64 endUts,
+                  int pageLimit = DEFAULT_PAGE_LIMIT);
+
+  /** @brief Returns true while requests are waiting to be taken. */
+  bool hasRequest() const { return !m_queue.isEmpty(); }
+  /** @brief Removes and returns the next request; requires hasRequest(). */
+  Request takeRequest();
+
+  /**
+   * @brief Reports the answer to a Count request.
+   * @param request The request as returned by takeRequest().
+   * @param remoteTotal Scrobbles Last.fm holds in the window.
+   */
+  void handleCount(const Request &request, int remoteTotal);
+  /**
+   * @brief Reports the answer to a Fetch request.
+   * @details The answer to page 1 schedules the remaining pages.
+   * @param request The request as returned by takeRequest().
+   * @param totalPages Pages of the window reported by Last.fm.
+   */
+  void handlePage(const Request &request, int totalPages);
+
+  /**
+   * @brief Returns the stored scrobbles of the weeks starting in
+   * [fromUts, toUts).
+   */
+  qint64 localCount(qint64 fromUts, qint64 toUts) const;
+  /** @brief Returns the tracks per page of a fetched window. */
+  int pageLimit() const { return m_pageLimit; }
+  /** @brief Returns the outcome so far. */
+  Summary summary() const { return m_summary; }
+
+private:
+  /**
+   * @brief Compares a window and plans what follows: nothing, a split or a
+   * fetch.
+   */
+  void checkWindow(qint64 fromUts, qint64 toUts, qint64 remoteTotal);
+  /**
+   * @brief Returns the week boundary closest to the middle of a window, or 0
+   * if the window spans no boundary.
+   */
+  qint64 splitPoint(qint64 fromUts, qint64 toUts) const;
+
+  QMap<qint64, int> m_weekCounts; /**< @brief Stored scrobbles per week. */
+  int m_pageLimit = DEFAULT_PAGE_LIMIT; /**< @brief Tracks per fetched page. */
+  QList<Request> m_queue;               /**< @brief Requests not yet taken. */
+  Summary m_summary;                    /**< @brief Outcome so far. */
+};
+
+#endif // HISTORYVERIFIER_H
@@ -0,0 +1,234 @@
+/**
+ * @file incrementalanalytics.cpp
+ * @brief Implementation of the IncrementalAnalytics class.
+ */
+
+#include "incrementalanalytics.h"
+#include "analyticsengine.h"
+#include "scrobblestore.h"
+#include "stringinterner.h"
+#include <QDataStream>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+/** @brief Writes a length-prefixed list of timestamps or day numbers. */
+void writeValues(QDataStream &out, const std::vector<qint64> &values) {
+  out << quint32(values.size());
+  for (qint64 value : values)
+    out << value;
+}
+
+/**
+ * @brief Reads a list written by writeValues().
+ * @return False if the stream ended early.
+ */
+bool readValues(QDataStream &in, std::vector<qint64> &values) {
+  quint32 count = 0;
+  in >> count;
+  values.clear();
+  for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+    qint64 value = 0;
+    in >> value;
+    values.push_back(value);
+  }
+  return in.status() == QDataStream::Ok;
+}
+} // namespace
+
+void IncrementalAnalytics::clear() {
+  m_counts = AnalyticsAccumulator();
+  m_firstUts = 0;
+  m_lastUts = 0;
+  m_validCount = 0;
+  m_watermark = 0;
+  m_recentUts.clear();
+  m_appliedKeys = ScrobbleKeySet();
+}
+
+void IncrementalAnalytics::rebuild(const ScrobbleStore &store,
+                                   QThreadPool *pool) {
+  clear();
+  if (store.isEmpty()) {
+    return;
+  }
+
+  // No window anchors: the windows are derived from m_recentUts instead.
+  std::vector<quint64> trackPairs;
+  const AnalyticsAccumulator storeCounts =
+      AnalyticsEngine::accumulate(store, 0, 0, pool, trackPairs);
+
+  // Move the dictionary keys into the interner key space, resolving each
+  // distinct string once.
+  StringInterner &interner = StringInterner::instance();
+  QVector<quint32> globalIds(store.stringCount(),
+                             StringInterner::INVALID_ID);
+  auto globalId = [&](quint32 id) {
+    if (id >= quint32(globalIds.size()))
+      return interner.intern(QString());
+    if (globalIds[id] == StringInterner::INVALID_ID)
+      globalIds[id] = interner.intern(store.string(id).toString());
+    return globalIds[id];
+  };
+  const QVector<int> &artistCounts = storeCounts.artistCounts();
+  QVector<quint32> artistMap(artistCounts.size(),
+                             AnalyticsAccumulator::INVALID_KEY);
+  for (int id = 0; id < artistCounts.size(); ++id) {
+    if (artistCounts[id] > 0)
+      artistMap[id] = globalId(id);
+  }
+  QVector<quint32> trackMap(qsizetype(trackPairs.size()));
+  for (size_t key = 0; key < trackPairs.size(); ++key) {
+    const quint64 pair = trackPairs[key];
+    trackMap[key] = interner.internPair(globalId(quint32(pair >> 32)),
+                                        globalId(quint32(pair)));
+  }
+  m_counts.merge(storeCounts, trackMap, artistMap);
+
+  m_firstUts = storeCounts.firstUts();
+  m_lastUts = storeCounts.lastUts();
+  m_validCount = storeCounts.rowCount();
+  m_watermark = m_lastUts;
+  const qint64 recentStart = m_lastUts + 1 - RECENT_SECONDS;
+  for (qsizetype i = store.size() - 1; i >= 0; --i) {
+    const qint64 uts = store.utsAt(i);
+    if (uts <= 0 || uts < recentStart)
+      break;
+    m_recentUts.push_back(uts);
+  }
+  std::reverse(m_recentUts.begin(), m_recentUts.end());
+
+  qDebug() << "[Incremental Analytics] Rebuilt from" << m_validCount
+           << "scrobbles, watermark" << m_watermark;
+}
+
+int IncrementalAnalytics::apply(const QList<ScrobbleData> &batch) {
+  int counted = 0;
+  for (const ScrobbleData &s : batch) {
+    if (!s.isValid() || s.uts <= m_watermark || !m_appliedKeys.insert(s))
+      continue;
+    m_counts.add(s.uts, s.artistId, s.trackKeyId);
+    if (m_firstUts == 0 || s.uts < m_firstUts)
+      m_firstUts = s.uts;
+    m_lastUts = qMax(m_lastUts, s.uts);
+    ++m_validCount;
+    ++counted;
+    // Pages usually arrive near the end of the sorted range, so this
+    // insertion only moves a few elements.
+    m_recentUts.insert(
+        std::upper_bound(m_recentUts.begin(), m_recentUts.end(), s.uts),
+        s.uts);
+  }
+  pruneRecent();
+  return counted;
+}
+
+AnalyticsAccumulator::WindowCounts IncrementalAnalytics::windowCounts() const {
+  AnalyticsAccumulator::WindowCounts counts = {};
+  if (m_lastUts <= 0) {
+    return counts;
+  }
+  // Same bounds as the fused pass: [last + 1s - N days, last + 1s).
+  const qint64 end = m_lastUts + 1;
+  const int days[] = {7, 30, 90};
+  for (int w = AnalyticsAccumulator::Last7Days;
+       w <= AnalyticsAccumulator::Last90Days; ++w) {
+    const qint64 start = end - qint64(days[w]) * 24 * 60 * 60;
+    counts[w] = int(m_recentUts.end() - std::lower_bound(m_recentUts.begin(),
+                                                         m_recentUts.end(),
+                                                         start));
+  }
+  counts[AnalyticsAccumulator::AllTime] = int(m_validCount);
+  return counts;
+}
+
+void IncrementalAnalytics::pruneRecent() {
+  const qint64 recentStart = m_lastUts + 1 - RECENT_SECONDS;
+  m_recentUts.erase(m_recentUts.begin(),
+                    std::lower_bound(m_recentUts.begin(), m_recentUts.end(),
+                                     recentStart));
+}
+
+void IncrementalAnalytics::serialize(QDataStream &out) const {
+  const StringInterner &interner = StringInterner::instance();
+  out << m_firstUts << m_lastUts << m_validCount;
+  out << m_counts.m_hourly << m_counts.m_weekly;
+
+  std::vector<qint64> days = m_counts.m_localDays;
+  std::sort(days.begin(), days.end());
+  days.erase(std::unique(days.begin(), days.end()), days.end());
+  writeValues(out, days);
+  writeValues(out, m_recentUts);
+
+  const QVector<int> &artists = m_counts.m_artistCounts;
+  out << quint32(std::count_if(artists.cbegin(), artists.cend(),
+                               [](int count) { return count > 0; }));
+  for (int id = 0; id < artists.size(); ++id) {
+    if (artists[id] > 0)
+      out << interner.string(quint32(id)) << qint32(artists[id]);
+  }
+  const QVector<int> &tracks = m_counts.m_trackCounts;
+  out << quint32(std::count_if(tracks.cbegin(), tracks.cend(),
+                               [](int count) { return count > 0; }));
+  for (int id = 0; id < tracks.size(); ++id) {
+    if (tracks[id] <= 0)
+      continue;
+    const QPair<quint32, quint32> pair = interner.pair(quint32(id));
+    out << interner.string(pair.first) << interner.string(pair.second)
+        << qint32(tracks[id]);
+  }
+}
+
+bool IncrementalAnalytics::deserialize(QDataStream &in) {
+  clear();
+  QVector<int> hourly;
+  QVector<int> weekly;
+  in >> m_firstUts >> m_lastUts >> m_validCount >> hourly >> weekly;
+  if (in.status() != QDataStream::Ok || hourly.size() != 24 ||
+      weekly.size() != 7) {
+    clear();
+    return false;
+  }
+  m_counts.m_hourly = hourly;
+  m_counts.m_weekly = weekly;
+  if (!readValues(in, m_counts.m_localDays) || !readValues(in, m_recentUts) ||
+      !std::is_sorted(m_recentUts.begin(), m_recentUts.end())) {
+    clear();
+    return false;
+  }
+
+  StringInterner &interner = StringInterner::instance();
+  quint32 count = 0;
+  in >> count;
+  for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+    QString artist;
+    qint32 plays = 0;
+    in >> artist >> plays;
+    const quint32 id = interner.intern(artist);
+    if (id >= quint32(m_counts.m_artistCounts.size()))
+      m_counts.m_artistCounts.resize(id + 1);
+    m_counts.m_artistCounts[id] += plays;
+  }
+  in >> count;
+  for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+    QString artist;
+    QString track;
+    qint32 plays = 0;
+    in >> artist >> track >> plays;
+    const quint32 id =
+        interner.internPair(interner.intern(artist), interner.intern(track));
+    if (id >= quint32(m_counts.m_trackCounts.size()))
+      m_counts.m_trackCounts.resize(id + 1);
+    m_counts.m_trackCounts[id] += plays;
+  }
+  if (in.status() != QDataStream::Ok) {
+    clear();
+    return false;
+  }
+
+  m_counts.m_rowCount = m_validCount;
+  m_counts.m_firstUts = m_firstUts;
+  m_counts.m_lastUts = m_lastUts;
+  m_watermark = m_lastUts;
+  return true;
+}
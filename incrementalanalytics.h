@@ -0,0 +1,121 @@
+#ifndef INCREMENTALANALYTICS_H
+#define INCREMENTALANALYTICS_H
+
+#include "analyticsaccumulator.h"
+#include "scrobbledata.h"
+#include "scrobblekeyset.h"
+#include <QList>
+#include <vector>
+
+class QDataStream;
+class QThreadPool;
+class ScrobbleStore;
+
+/**
+ * @class IncrementalAnalytics
+ * @brief Retained analyzeAll() state that absorbs newly fetched scrobbles
+ * without a full recompute.
+ * @details Built once from the stored history with rebuild(), it keeps the
+ * artist/track counters, hour and weekday histograms and listening days
+ * between runs, keyed by StringInterner IDs so that fetched pages (see
+ * DatabaseManager::scrobblesSaved) can be applied as they are saved. Applying
+ * a batch costs time proportional to the batch: the rolling mean windows
+ * only need the timestamps of the trailing 90 days, which are kept sorted.
+ * AnalyticsEngine::analyzeAll() turns the state into the usual result map.
+ *
+ * Rows at or before the watermark (the last scrobble of the history the
+ * state was built from) are already counted and are skipped, mirroring the
+ * update fetch, which only asks the API for newer scrobbles. Rows above it
+ * are remembered by identity, so a row delivered twice (a page repeated on
+ * resume, or a row shifted across page boundaries) is counted once, just as
+ * the week files store it once. Not thread-safe;
+ * a state being applied to must not be read concurrently.
+ */
+class IncrementalAnalytics {
+public:
+  /** @brief Constructs an empty state. */
+  IncrementalAnalytics() = default;
+
+  /** @brief Forgets all counters. */
+  void clear();
+
+  /** @brief Returns true if no scrobble has been counted. */
+  bool isEmpty() const { return m_validCount == 0; }
+
+  /**
+   * @brief Recomputes the state from a whole stored history.
+   * @details Sweeps the store in parallel chunks (see
+   * AnalyticsEngine::accumulate()) and moves the counters into the
+   * StringInterner key space. Sets the watermark to the last stored scrobble.
+   * @param store The user's scrobble store.
+   * @param pool Thread pool for the sweep; nullptr uses the global instance.
+   */
+  void rebuild(const ScrobbleStore &store, QThreadPool *pool = nullptr);
+
+  /**
+   * @brief Adds a batch of new scrobbles (e.g. one API page).
+   * @details Rows without a valid timestamp, at/before the watermark or
+   * already applied (same uts, artist and track) are skipped. The batch may
+   * be in any order.
+   * @param batch The scrobbles to add.
+   * @return The number of scrobbles counted.
+   */
+  int apply(const QList<ScrobbleData> &batch);
+
+  /** @brief Returns the earliest counted timestamp, or 0. */
+  qint64 firstUts() const { return m_firstUts; }
+  /** @brief Returns the latest counted timestamp, or 0. */
+  qint64 lastUts() const { return m_lastUts; }
+  /** @brief Returns the number of counted scrobbles. */
+  qint64 scrobbleCount() const { return m_validCount; }
+  /** @brief Returns the timestamp at or before which rows are skipped. */
+  qint64 watermark() const { return m_watermark; }
+
+  /**
+   * @brief Returns the counters, keyed by StringInterner artist and pair IDs.
+   * @details The window counts of the accumulator itself are unused; see
+   * windowCounts().
+   */
+  const AnalyticsAccumulator &counts() const { return m_counts; }
+
+  /** @brief Returns the rolling window counts ending at lastUts() + 1s. */
+  AnalyticsAccumulator::WindowCounts windowCounts() const;
+
+  /**
+   * @brief Writes the state to a stream (see DatabaseManager's analytics
+   * snapshot).
+   * @details Interner IDs only live for one process, so artists and tracks
+   * are written by name. Listening days are written once each.
+   * @param out The target stream.
+   */
+  void serialize(QDataStream &out) const;
+
+  /**
+   * @brief Replaces the state with one written by serialize().
+   * @details Names are interned again and the watermark is set to the last
+   * restored scrobble, so only newer rows can be applied afterwards.
+   * @param in The source stream.
+   * @return False (leaving the state empty) if the data is truncated or
+   * inconsistent.
+   */
+  bool deserialize(QDataStream &in);
+
+private:
+  /** @brief Drops recent timestamps that left the widest window. */
+  void pruneRecent();
+
+  /** @brief Length of the widest rolling window (90 days). */
+  static constexpr qint64 RECENT_SECONDS = 90 * 24 * 60 * 60;
+
+  AnalyticsAccumulator m_counts; /**< @brief Counters in interner keys. */
+  qint64 m_firstUts = 0;         /**< @brief Earliest counted timestamp. */
+  qint64 m_lastUts = 0;          /**< @brief Latest counted timestamp. */
+  qint64 m_validCount = 0;       /**< @brief Counted scrobbles. */
+  qint64 m_watermark = 0; /**< @brief Last timestamp of the rebuilt history. */
+  std::vector<qint64>
+      m_recentUts; /**< @brief Sorted timestamps of the trailing 90 days. */
+  ScrobbleKeySet
+      m_appliedKeys; /**< @brief Identities of rows above the watermark. */
+};
+
+#endif // INCREMENTALANALYTICS_H
@@ -4,58 +4,151 @@
  */
 
 #include "lastfmmanager.h"
+#include "scrobblejsonparser.h"
+#include <QDateTime>
 #include <QDebug>
 #include <QNetworkReply>
 #include <QNetworkRequest>
+#include <QScopeGuard>
 #include <QTimer>
 #include <QUrl>
 #include <QUrlQuery>
+#include <algorithm>
+#include <zlib.h>
+
+namespace {
+/**
+ * @brief Inflates a `gzip` or `deflate` response body.
+ * @details gzip and zlib streams are told apart by their header; a stream
+ * that is neither is read as raw deflate data, which some servers send as
+ * `deflate` instead of the zlib stream HTTP asks for.
+ * @param ok Set to whether the body was a complete stream.
+ * @return The decoded body.
+ */
+QByteArray inflateBody(const QByteArray &body, bool &ok) {
+  // 15 + 32 detects a gzip or zlib header; -15 reads headerless data.
+  for (const int windowBits : {15 + 32, -15}) {
+    z_stream stream = {};
+    if (inflateInit2(&stream, windowBits) != Z_OK)
+      break;
+    stream.next_in =
+        reinterpret_cast<Bytef *>(const_cast<char *>(body.constData()));
+    stream.avail_in = uInt(body.size());
+    QByteArray decoded;
+    char chunk[16384];
+    int result = Z_OK;
+    while (result == Z_OK) {
+      stream.next_out = reinterpret_cast<Bytef *>(chunk);
+      stream.avail_out = uInt(sizeof(chunk));
+      result = inflate(&stream, Z_NO_FLUSH);
+      decoded.append(chunk, qsizetype(sizeof(chunk) - stream.avail_out));
+    }
+    inflateEnd(&stream);
+    if (result == Z_STREAM_END) {
+      ok = true;
+      return decoded;
+    }
+  }
+  ok = false;
+  return QByteArray();
+}
+} // namespace
 
 LastFmManager::LastFmManager(QObject *parent)
     : QObject(parent), m_apiKey(""), m_username(""), m_fetchFromTimestamp(0),
-      m_currentPageFetching(0), m_expectedTotalPages(0),
-      m_isPerformingUpdate(false), m_retryCount(0),
-      m_lastFailed_fromTimestamp(0), m_lastFailed_page(0),
-      m_isRetryPending(false) {
-  m_retryTimer = new QTimer(this);
-  m_retryTimer->setInterval(RETRY_DELAY_MS);
-  m_retryTimer->setSingleShot(true);
-  connect(m_retryTimer, &QTimer::timeout, this, &LastFmManager::retryLastFetch);
+      m_expectedTotalPages(0), m_isPerformingUpdate(false) {
+  qRegisterMetaType<RecentTracksRequest>("RecentTracksRequest");
+  m_clock.start();
+  m_dispatchTimer = new QTimer(this);
+  m_dispatchTimer->setSingleShot(true);
+  connect(m_dispatchTimer, &QTimer::timeout, this,
+          &LastFmManager::fillRequestWindow);
 
   m_workerThread = new QThread(this);
   m_workerThread->setObjectName("LastFmWorkerThread");
   m_worker = new LastFmWorker();
   m_worker->moveToThread(m_workerThread);
 
+  const int parserCount =
+      qBound(1, QThread::idealThreadCount(), MAX_PARSER_THREADS);
+  for (int i = 0; i < parserCount; ++i) {
+    QThread *thread = new QThread(this);
+    thread->setObjectName(QString("LastFmParserThread%1").arg(i));
+    LastFmParser *parser = new LastFmParser();
+    parser->moveToThread(thread);
+    connect(thread, &QThread::finished, parser, &QObject::deleteLater);
+    // Runs on the parser thread, which routes the scrobbles itself.
+    connect(parser, &LastFmParser::resultReady, parser,
+            [this](const QList<ScrobbleData> &scrobbles, int totalPages,
+                   int currentPage, int requestedPage, int generation) {
+              routeResult(scrobbles, totalPages, currentPage, requestedPage,
+                          generation);
+            },
+            Qt::DirectConnection);
+    connect(parser, &LastFmParser::errorOccurred, this,
+            &LastFmManager::handleFetchErrorWorker, Qt::QueuedConnection);
+    m_parserThreads.append(thread);
+    m_parsers.append(parser);
+  }
+  m_activeParsers.storeRelaxed(parserCount);
+
   connect(m_workerThread, &QThread::finished, m_worker, &QObject::deleteLater);
   connect(this, &LastFmManager::startFetching, m_worker, &LastFmWorker::doFetch,
           Qt::QueuedConnection);
-  connect(m_worker, &LastFmWorker::resultReady, this,
-          &LastFmManager::handlePageResultReady, Qt::QueuedConnection);
+  // Runs on the network thread, which only queues the body for a parser.
+  connect(m_worker, &LastFmWorker::replyReceived, m_worker,
+          [this](const QByteArray &body, int httpStatusCode,
+                 const QString &networkError, int requestedPage,
+                 int generation, const QString &cacheKey) {
+            dispatchReply(body, httpStatusCode, networkError, requestedPage,
+                          generation, cacheKey);
+          },
+          Qt::DirectConnection);
 
   connect(m_worker, &LastFmWorker::errorOccurred, this,
           &LastFmManager::handleFetchErrorWorker, Qt::QueuedConnection);
   connect(m_worker, &LastFmWorker::finished, this,
           &LastFmManager::handleWorkerFinished, Qt::QueuedConnection);
+  connect(m_worker, &LastFmWorker::pageTransferred, this,
+          &LastFmManager::handlePageTransferred, Qt::QueuedConnection);
+  connect(m_worker, &LastFmWorker::connectionEncrypted, this,
+          &LastFmManager::handleConnectionEncrypted, Qt::QueuedConnection);
+  connect(m_worker, &LastFmWorker::pageServedFromCache, this,
+          &LastFmManager::handlePageServedFromCache, Qt::QueuedConnection);
 
   m_workerThread->start();
-  qInfo() << "LastFmManager worker thread started.";
+  for (QThread *thread : std::as_const(m_parserThreads))
+    thread->start();
+  qInfo() << "LastFmManager worker and" << parserCount
+          << "parser threads started.";
 }
 
 LastFmManager::~LastFmManager() {
-  qDebug() << "LastFmManager Destructor: Stopping worker thread...";
-  if (m_workerThread && m_workerThread->isRunning()) {
-    m_workerThread->quit();
-    if (!m_workerThread->wait(3000)) {
-      qWarning()
-          << "Last.fm worker thread did not stop gracefully, terminating.";
-      m_workerThread->terminate();
-      m_workerThread->wait();
-    } else {
-      qDebug() << "Last.fm worker thread stopped gracefully.";
+  shutdown();
+  qInfo() << "LastFmManager destroyed.";
+}
+
+void LastFmManager::shutdown() {
+  if (m_fetchActive) {
+    qInfo() << "[LFM Manager] Shutting down during a fetch; stopping it.";
+    endFetch();
+  }
+  qDebug() << "[LFM Manager] Stopping worker threads...";
+  QList<QThread *> threads = m_parserThreads;
+  threads.prepend(m_workerThread);
+  for (QThread *thread : std::as_const(threads)) {
+    if (thread && thread->isRunning()) {
+      thread->quit();
+      if (!thread->wait(3000)) {
+        qWarning() << thread->objectName()
+                   << "did not stop gracefully, terminating.";
+        thread->terminate();
+        thread->wait();
+      } else {
+        qDebug() << thread->objectName() << "stopped gracefully.";
+      }
     }
   }
-  qInfo() << "LastFmManager destroyed.";
 }
 
 void LastFmManager::setup(const QString &apiKey, const QString &username) {
@@ -65,13 +158,227 @@ void LastFmManager::setup(const QString &apiKey, const QString &username) {
   m_username = username;
 }
 
+void LastFmManager::setMaxPagesInFlight(int count) {
+  m_maxPagesInFlight = qMax(1, count);
+  qDebug() << "[LFM Manager] Max pages in flight:" << m_maxPagesInFlight;
+}
+
+void LastFmManager::setApiBaseUrl(const QString &url) {
+  const QString baseUrl =
+      url.isEmpty() ? QString::fromLatin1(DEFAULT_API_BASE_URL) : url;
+  qDebug() << "[LFM Manager] API base URL:" << baseUrl;
+  QMetaObject::invokeMethod(
+      m_worker,
+      [worker = m_worker, baseUrl]() { worker->setApiBaseUrl(baseUrl); },
+      Qt::QueuedConnection);
+}
+
+void LastFmManager::setRequestsPerSecond(double requestsPerSecond) {
+  m_rateLimiter = RateLimiter(requestsPerSecond);
+  qDebug() << "[LFM Manager] Request budget:" << m_rateLimiter.currentRate()
+           << "per second";
+}
+
+void LastFmManager::setResponseCache(const QString &directory,
+                                     qint64 maxBytes) {
+  m_responseCache.reset(
+      directory.isEmpty() ? nullptr : new ResponseCache(directory, maxBytes));
+  qDebug() << "[LFM Manager] Response cache:"
+           << (directory.isEmpty() ? "disabled" : directory);
+  QMetaObject::invokeMethod(
+      m_worker,
+      [worker = m_worker, cache = m_responseCache]() {
+        worker->setResponseCache(cache);
+      },
+      Qt::QueuedConnection);
+  for (LastFmParser *parser : std::as_const(m_parsers)) {
+    QMetaObject::invokeMethod(
+        parser,
+        [parser, cache = m_responseCache]() {
+          parser->setResponseCache(cache);
+        },
+        Qt::QueuedConnection);
+  }
+}
+
+void LastFmManager::setPageLimit(int limit) {
+  m_pageLimit = qMax(1, limit);
+  qDebug() << "[LFM Manager] Tracks per page:" << m_pageLimit;
+}
+
+void LastFmManager::setParserThreads(int count) {
+  m_activeParsers.storeRelaxed(qBound(1, count, int(m_parsers.size())));
+  qDebug() << "[LFM Manager] Parser threads:"
+           << m_activeParsers.loadRelaxed();
+}
+
+void LastFmManager::dispatchReply(const QByteArray &body, int httpStatusCode,
+                                  const QString &networkError,
+                                  int requestedPage, int generation,
+                                  const QString &cacheKey) {
+  // Shortest queue first: pages differ in size, so round robin would let a
+  // large page hold up the pages queued behind it.
+  const int active = m_activeParsers.loadRelaxed();
+  LastFmParser *parser = m_parsers.first();
+  for (int i = 1; i < active; ++i) {
+    if (m_parsers[i]->pendingReplies() < parser->pendingReplies())
+      parser = m_parsers[i];
+  }
+  parser->noteReplyQueued();
+  QMetaObject::invokeMethod(
+      parser,
+      [=]() {
+        parser->parseReply(body, httpStatusCode, networkError, requestedPage,
+                           generation, cacheKey);
+      },
+      Qt::QueuedConnection);
+}
+
+void LastFmManager::addRoute(int id, const Route &route) {
+  QMutexLocker locker(&m_routeMutex);
+  m_routes.insert(id, route);
+}
+
+void LastFmManager::resetRoutes() {
+  QMutexLocker locker(&m_routeMutex);
+  m_routeGeneration = m_fetchGeneration;
+  m_routeUsername = m_username;
+  m_routes.clear();
+  m_completedPages.clear();
+  m_windowPagesLeft.clear();
+  m_windowScrobbles.clear();
+}
+
+void LastFmManager::routeResult(const QList<ScrobbleData> &scrobbles,
+                                int totalPages, int currentPage,
+                                int requestedPage, int generation) {
+  QMutexLocker emitLocker(&m_emitMutex);
+  Route route;
+  QString username;
+  QList<ParsedPage> ready;
+  bool windowComplete = false;
+  {
+    QMutexLocker locker(&m_routeMutex);
+    if (generation != m_routeGeneration || !m_routes.contains(requestedPage)) {
+      qDebug() << "[LFM Manager] Dropping unrouted result for request"
+               << requestedPage;
+      return;
+    }
+    route = m_routes.take(requestedPage);
+    username = m_routeUsername;
+    ParsedPage parsed;
+    parsed.id = requestedPage;
+    parsed.scrobbles = scrobbles;
+    parsed.totalPages = totalPages;
+    parsed.currentPage = currentPage;
+    switch (route.kind) {
+    case Route::Kind::Page:
+      m_completedPages.insert(requestedPage, parsed);
+      while (!m_completedPages.isEmpty() &&
+             m_completedPages.firstKey() == m_nextPageToEmit) {
+        ready.append(m_completedPages.take(m_nextPageToEmit));
+        m_nextPageToEmit++;
+      }
+      break;
+    case Route::Kind::Window: {
+      int &pagesLeft = m_windowPagesLeft[route.window];
+      if (route.page == 1)
+        pagesLeft += qMax(1, totalPages) - 1;
+      m_windowScrobbles[route.window] += scrobbles;
+      if (--pagesLeft <= 0) {
+        m_windowPagesLeft.remove(route.window);
+        parsed.scrobbles = m_windowScrobbles.take(route.window);
+        windowComplete = true;
+      }
+      ready.append(parsed);
+      break;
+    }
+    case Route::Kind::Control:
+    case Route::Kind::Backfill:
+      ready.append(parsed);
+      break;
+    }
+  }
+
+  // A page is only reported to the manager once it has been handed on, so
+  // the fetch cannot finish while a page is still on its way to the disk.
+  for (const ParsedPage &page : std::as_const(ready)) {
+    switch (route.kind) {
+    case Route::Kind::Page:
+      qDebug() << "[LFM Manager] Emitting pageReadyForSaving for page"
+               << page.id;
+      emit pageReadyForSaving(page.id, username, page.scrobbles);
+      break;
+    case Route::Kind::Window:
+      if (windowComplete) {
+        qInfo() << "[LFM Manager] Import window" << route.window
+                << "complete with" << page.scrobbles.size() << "scrobbles.";
+        emit importWindowReady(route.window, username, page.scrobbles);
+      }
+      break;
+    case Route::Kind::Backfill:
+      if (!page.scrobbles.isEmpty())
+        emit backfillPageReady(0, username, page.scrobbles);
+      break;
+    case Route::Kind::Control:
+      break;
+    }
+    const QList<ScrobbleData> forwarded =
+        route.kind == Route::Kind::Control ? page.scrobbles
+                                           : QList<ScrobbleData>();
+    const int scrobbleCount = route.kind == Route::Kind::Page
+                                  ? int(page.scrobbles.size())
+                                  : int(scrobbles.size());
+    QMetaObject::invokeMethod(
+        this,
+        [=]() {
+          handlePageResultReady(forwarded, scrobbleCount, page.totalPages,
+                                page.currentPage, page.id, generation);
+        },
+        Qt::QueuedConnection);
+  }
+}
+
+int LastFmManager::pagesAwaitingOrder() const {
+  QMutexLocker locker(&m_routeMutex);
+  return int(m_completedPages.size());
+}
+
+void LastFmManager::setDownstreamCapacity(int pages) {
+  m_downstreamCapacity = qMax(1, pages);
+}
+
+int LastFmManager::pagesAwaitingParse() const {
+  int pending = 0;
+  for (const LastFmParser *parser : m_parsers)
+    pending += parser->pendingReplies();
+  return pending;
+}
+
+LastFmManager::TransferStats LastFmManager::transferStats() const {
+  TransferStats stats = m_transferStats;
+  stats.networkBusyNs = m_worker->busyNsecs() - m_networkBusyAtStart;
+  qint64 parseBusyNs = 0;
+  for (const LastFmParser *parser : m_parsers)
+    parseBusyNs += parser->busyNsecs();
+  stats.parseBusyNs = parseBusyNs - m_parseBusyAtStart;
+  return stats;
+}
+
+void LastFmManager::setDownstreamDepth(int pages) {
+  const bool wasFull = m_downstreamDepth >= m_downstreamCapacity;
+  m_downstreamDepth = pages;
+  if (wasFull && m_downstreamDepth < m_downstreamCapacity) {
+    qDebug() << "[LFM Manager] Persist backlog down to" << pages
+             << "pages, resuming requests.";
+    fillRequestWindow();
+  }
+}
+
 void LastFmManager::resetRetryState() {
   qDebug() << "[LFM Manager] Resetting retry state.";
-  m_retryTimer->stop();
-  m_retryCount = 0;
-  m_lastFailed_fromTimestamp = 0;
-  m_lastFailed_page = 0;
-  m_isRetryPending = false;
+  m_retryPages.clear();
+  m_retryCounts.clear();
 }
 
 void LastFmManager::fetchScrobblesSince(qint64 lastSyncTimestamp) {
@@ -84,13 +391,7 @@ void LastFmManager::fetchScrobblesSince(qint64 lastSyncTimestamp) {
   }
 
   qInfo() << "Starting UPDATE fetch since timestamp" << lastSyncTimestamp;
-  resetRetryState();
-  m_fetchFromTimestamp = lastSyncTimestamp;
-  m_currentPageFetching = 1;
-  m_expectedTotalPages = 0;
-  m_isPerformingUpdate = true;
-  emit startFetching(m_apiKey, m_username, m_fetchFromTimestamp,
-                     m_currentPageFetching);
+  beginFetch(lastSyncTimestamp, 1, 0, true);
 }
 
 void LastFmManager::startInitialOrResumeFetch(int startPage,
@@ -105,66 +406,438 @@ void LastFmManager::startInitialOrResumeFetch(int startPage,
 
   qInfo() << "Starting INITIAL/RESUME fetch from page" << startPage
           << "(Known total:" << knownTotalPages << ")";
+  beginFetch(0, startPage, knownTotalPages, false);
+}
+
+void LastFmManager::verifyHistory(const QMap<qint64, int> &localWeekCounts,
+                                  qint64 endUts) {
+  if (m_apiKey.isEmpty() || m_username.isEmpty()) {
+    emit fetchError("API Key or Username not set.");
+    return;
+  }
+
+  qInfo() << "Starting VERIFY of" << localWeekCounts.size()
+          << "stored weeks before" << endUts;
+  resetFetchState();
+  m_isVerifying = true;
+  m_verifier = HistoryVerifier(localWeekCounts, endUts, m_pageLimit);
+  fillRequestWindow();
+  finishPlannedFetchIfDone();
+}
+
+void LastFmManager::startWindowedImport(qint64 startUts, qint64 endUts,
+                                        const QSet<int> &completedWindows) {
+  if (m_apiKey.isEmpty() || m_username.isEmpty()) {
+    emit fetchError("API Key or Username not set.");
+    return;
+  }
+
+  resetFetchState();
+  m_isImporting = true;
+  if (startUts > 0 && endUts > startUts) {
+    qInfo() << "Resuming WINDOWED import of" << startUts << "-" << endUts
+            << "with" << completedWindows.size() << "windows already saved";
+    m_importStartUts = startUts;
+    m_importEndUts = endUts;
+    emit importRangeDetermined(m_importStartUts, m_importEndUts);
+    planImportWindows(completedWindows);
+  } else {
+    // Fixing the end now keeps the probes and every window consistent while
+    // new scrobbles arrive; those are left to the next update fetch.
+    m_importEndUts = QDateTime::currentSecsSinceEpoch() + 1;
+    qInfo() << "Starting WINDOWED import before" << m_importEndUts;
+    ImportRequest probe;
+    probe.step = ImportRequest::Step::ProbeNewest;
+    m_importQueue.append(probe);
+  }
+  fillRequestWindow();
+  finishPlannedFetchIfDone();
+}
+
+int LastFmManager::importWindowIndex(qint64 uts) {
+  return int(WeekGrid::cellIndex(uts, IMPORT_WINDOW_SECS));
+}
+
+qint64 LastFmManager::importWindowStart(int index) {
+  return WeekGrid::cellStart(index, IMPORT_WINDOW_SECS);
+}
+
+int LastFmManager::importWindowCount(qint64 startUts, qint64 endUts) {
+  if (endUts <= startUts)
+    return 0;
+  return importWindowIndex(endUts - 1) - importWindowIndex(startUts) + 1;
+}
+
+void LastFmManager::resetFetchState() {
   resetRetryState();
-  m_fetchFromTimestamp = 0;
-  m_currentPageFetching = qMax(1, startPage);
-  m_expectedTotalPages = knownTotalPages;
-  m_isPerformingUpdate = false;
+  m_dispatchTimer->stop();
+  m_fetchGeneration++;
+  m_fetchActive = true;
+  m_isVerifying = false;
+  m_verifyRequests.clear();
+  m_isImporting = false;
+  m_importStartUts = 0;
+  m_importEndUts = 0;
+  m_importQueue.clear();
+  m_importRequests.clear();
+  m_sentRequests.clear();
+  m_nextRequestId = 1;
+  m_pagesInFlight.clear();
+  resetRoutes();
+  m_transferStats = TransferStats();
+  const TransferStats busy = transferStats();
+  m_networkBusyAtStart += busy.networkBusyNs;
+  m_parseBusyAtStart += busy.parseBusyNs;
+}
+
+void LastFmManager::beginFetch(qint64 fromTimestamp, int startPage,
+                               int knownTotalPages, bool isUpdate) {
+  resetFetchState();
+  m_fetchFromTimestamp = fromTimestamp;
+  // Like the import end: scrobbles arriving during the fetch would shift
+  // every later page by their number, so they are left to the next update.
+  m_fetchEndTimestamp = QDateTime::currentSecsSinceEpoch() + 1;
+  m_isPerformingUpdate = isUpdate;
+  m_nextPageToRequest = qMax(1, startPage);
+  {
+    QMutexLocker locker(&m_routeMutex);
+    m_nextPageToEmit = m_nextPageToRequest;
+  }
+  m_expectedTotalPages = isUpdate ? 0 : knownTotalPages;
+  // The stored total may be outdated, so the window only opens once the
+  // first response has confirmed it.
+  m_totalPagesKnown = false;
   if (m_expectedTotalPages > 0) {
     emit totalPagesDetermined(m_expectedTotalPages);
   }
-  emit startFetching(m_apiKey, m_username, m_fetchFromTimestamp,
-                     m_currentPageFetching);
+  fillRequestWindow();
+}
+
+void LastFmManager::endFetch() {
+  qInfo() << "[LFM Manager] Transferred" << m_transferStats.responses
+          << "responses (" << m_transferStats.http2Responses << "over HTTP/2,"
+          << m_transferStats.tlsHandshakes
+          << "TLS handshakes):" << m_transferStats.wireBytes
+          << "bytes on the wire," << m_transferStats.decodedBytes
+          << "decoded," << m_transferStats.cachedResponses << "from cache.";
+  const TransferStats busy = transferStats();
+  qInfo() << "[LFM Manager] Network thread busy" << busy.networkBusyNs / 1000000
+          << "ms, parsers busy" << busy.parseBusyNs / 1000000 << "ms.";
+  if (m_isVerifying) {
+    const HistoryVerifier::Summary summary = m_verifier.summary();
+    qInfo() << "[LFM Manager] Verification counted" << summary.countRequests
+            << "windows; fetched" << summary.pagesFetched << "pages of"
+            << summary.gapWindows << "windows missing"
+            << summary.missingScrobbles << "scrobbles;"
+            << summary.extraScrobbles << "stored scrobbles not on Last.fm.";
+  }
+  if (m_isImporting) {
+    QMutexLocker locker(&m_routeMutex);
+    if (!m_windowPagesLeft.isEmpty()) {
+      qInfo() << "[LFM Manager] Import stopped with"
+              << m_windowPagesLeft.size() << "windows incomplete.";
+    }
+  }
+  m_fetchActive = false;
+  m_isVerifying = false;
+  m_isImporting = false;
+  m_fetchGeneration++;
+  m_dispatchTimer->stop();
+  m_pagesInFlight.clear();
+  m_verifyRequests.clear();
+  m_importQueue.clear();
+  m_importRequests.clear();
+  m_sentRequests.clear();
+  resetRoutes();
+  resetRetryState();
 }
 
-void LastFmManager::scheduleNextPageFetch() {
-  if (m_isRetryPending) {
-    qDebug() << "[LFM Manager] Skipping next page schedule, retry pending.";
+void LastFmManager::fillRequestWindow() {
+  if (!m_fetchActive) {
+    return;
+  }
+  if (m_isVerifying || m_isImporting) {
+    fillPlannedWindow();
     return;
   }
 
-  if (m_expectedTotalPages > 0 &&
-      m_currentPageFetching < m_expectedTotalPages) {
-    m_currentPageFetching++;
-    qDebug() << "[LFM Manager] Scheduling fetch for page"
-             << m_currentPageFetching << "in 500ms...";
-    QTimer::singleShot(500, this, [=]() {
-      if (!m_isRetryPending) {
-        qDebug() << "[LFM Manager] Timer fired, emitting startFetching for page"
-                 << m_currentPageFetching;
-        qDebug() << "[LFM Manager] scheduleNextPageFetch (timer): Checking "
-                    "Key/User before emit. Key:"
-                 << (m_apiKey.isEmpty() ? "EMPTY" : "SET")
-                 << "User:" << m_username;
-        emit startFetching(m_apiKey, m_username, m_fetchFromTimestamp,
-                           m_currentPageFetching);
-      } else {
-        qDebug() << "[LFM Manager] Timer fired, but retry is now pending. "
-                    "Aborting scheduled fetch.";
+  int nextPageToEmit = 0;
+  {
+    QMutexLocker locker(&m_routeMutex);
+    nextPageToEmit = m_nextPageToEmit;
+  }
+  const int windowEnd = nextPageToEmit + m_maxPagesInFlight;
+  while (m_pagesInFlight.size() < m_maxPagesInFlight) {
+    int page = 0;
+    if (!m_retryPages.isEmpty()) {
+      page = m_retryPages.first();
+    } else if (!m_totalPagesKnown) {
+      // Until a response reports the page count only the first page is
+      // requested.
+      if (!m_pagesInFlight.isEmpty() || m_nextPageToRequest != nextPageToEmit)
+        break;
+      page = m_nextPageToRequest;
+    } else if (m_nextPageToRequest <= m_expectedTotalPages &&
+               m_nextPageToRequest < windowEnd) {
+      if (m_downstreamDepth >= m_downstreamCapacity) {
+        // Backpressure: resumed by setDownstreamDepth().
+        qDebug() << "[LFM Manager] Persist backlog at" << m_downstreamDepth
+                 << "pages, holding back page" << m_nextPageToRequest;
+        break;
       }
-    });
+      page = m_nextPageToRequest;
+    } else {
+      break;
+    }
+
+    const qint64 waitMs = m_rateLimiter.tryAcquire(m_clock.elapsed());
+    if (waitMs > 0) {
+      if (!m_dispatchTimer->isActive()) {
+        m_dispatchTimer->start(int(waitMs));
+      }
+      return;
+    }
+
+    if (!m_retryPages.isEmpty()) {
+      m_retryPages.removeFirst();
+    } else {
+      m_nextPageToRequest++;
+    }
+    m_pagesInFlight.insert(page);
+    qDebug() << "[LFM Manager] Requesting page" << page << "("
+             << m_pagesInFlight.size() << "in flight)";
+    Route route;
+    route.kind = Route::Kind::Page;
+    addRoute(page, route);
+    RecentTracksRequest request;
+    request.id = page;
+    request.page = page;
+    request.limit = m_pageLimit;
+    request.fromUts = m_fetchFromTimestamp > 0 ? m_fetchFromTimestamp + 1 : 0;
+    request.toUts = m_fetchEndTimestamp - 1;
+    emit startFetching(m_apiKey, m_username, request, m_fetchGeneration);
+  }
+}
+
+void LastFmManager::fillPlannedWindow() {
+  while (m_pagesInFlight.size() < m_maxPagesInFlight &&
+         (!m_retryPages.isEmpty() || hasPlannedRequest())) {
+    if (m_downstreamDepth >= m_downstreamCapacity) {
+      qDebug() << "[LFM Manager] Persist backlog at" << m_downstreamDepth
+               << "pages, holding back planned requests.";
+      break;
+    }
+    const qint64 waitMs = m_rateLimiter.tryAcquire(m_clock.elapsed());
+    if (waitMs > 0) {
+      if (!m_dispatchTimer->isActive()) {
+        m_dispatchTimer->start(int(waitMs));
+      }
+      return;
+    }
+
+    RecentTracksRequest request;
+    if (!m_retryPages.isEmpty()) {
+      request = m_sentRequests.value(m_retryPages.takeFirst());
+    } else {
+      request = takePlannedRequest(m_nextRequestId++);
+      m_sentRequests.insert(request.id, request);
+    }
+    m_pagesInFlight.insert(request.id);
+    emit startFetching(m_apiKey, m_username, request, m_fetchGeneration);
+  }
+}
+
+bool LastFmManager::hasPlannedRequest() const {
+  return m_isVerifying ? m_verifier.hasRequest() : !m_importQueue.isEmpty();
+}
+
+RecentTracksRequest LastFmManager::takePlannedRequest(int id) {
+  RecentTracksRequest request;
+  request.id = id;
+  if (m_isVerifying) {
+    const HistoryVerifier::Request window = m_verifier.takeRequest();
+    m_verifyRequests.insert(id, window);
+    const bool isCount = window.kind == HistoryVerifier::Kind::Count;
+    Route route;
+    route.kind = isCount ? Route::Kind::Control : Route::Kind::Backfill;
+    addRoute(id, route);
+    request.page = window.page;
+    // With one track per page the page count of a response is the number
+    // of scrobbles in the window.
+    request.limit = isCount ? 1 : m_verifier.pageLimit();
+    request.fromUts = window.fromUts;
+    request.toUts = window.toUts - 1;
+    qDebug() << "[LFM Manager]" << (isCount ? "Counting" : "Fetching page")
+             << window.page << "of window" << window.fromUts << "-"
+             << window.toUts;
+    return request;
+  }
+
+  const ImportRequest step = m_importQueue.takeFirst();
+  m_importRequests.insert(id, step);
+  Route route;
+  if (step.step == ImportRequest::Step::Window) {
+    route.kind = Route::Kind::Window;
+    route.window = step.window;
+    route.page = step.page;
+  }
+  addRoute(id, route);
+  request.toUts = m_importEndUts - 1;
+  switch (step.step) {
+  case ImportRequest::Step::ProbeNewest:
+  case ImportRequest::Step::ProbeOldest:
+    // One track per page: the page count is the scrobble count, and its
+    // last page holds the oldest scrobble.
+    request.page = step.page;
+    request.limit = 1;
+    qDebug() << "[LFM Manager] Probing page" << step.page << "before"
+             << m_importEndUts;
+    break;
+  case ImportRequest::Step::Window:
+    request.page = step.page;
+    request.limit = m_pageLimit;
+    request.fromUts = qMax(m_importStartUts, importWindowStart(step.window));
+    request.toUts =
+        qMin(m_importEndUts, importWindowStart(step.window + 1)) - 1;
+    // A window never changes once its end has passed, so its pages can be
+    // read back from any earlier attempt, even one from days ago.
+    request.preferCache = true;
+    qDebug() << "[LFM Manager] Fetching page" << step.page << "of import window"
+             << step.window << "(" << m_pagesInFlight.size() << "in flight)";
+    break;
+  }
+  return request;
+}
+
+bool LastFmManager::finishPlannedFetchIfDone() {
+  if (!m_pagesInFlight.isEmpty() || !m_retryPages.isEmpty() ||
+      hasPlannedRequest()) {
+    return false;
+  }
+  endFetch();
+  emit fetchFinished();
+  return true;
+}
+
+void LastFmManager::handleVerificationResult(int requestId, int totalPages) {
+  const HistoryVerifier::Request window = m_verifyRequests.take(requestId);
+  if (window.kind == HistoryVerifier::Kind::Count) {
+    m_verifier.handleCount(window, totalPages);
   } else {
-    qInfo() << "[LFM Manager] Finished fetching all expected pages from API "
-               "(last req page"
-            << m_currentPageFetching << " of " << m_expectedTotalPages << ").";
-    emit fetchFinished();
+    m_verifier.handlePage(window, totalPages);
+  }
+
+  if (!finishPlannedFetchIfDone())
+    fillRequestWindow();
+}
+
+void LastFmManager::planImportWindows(const QSet<int> &completedWindows) {
+  if (m_importEndUts <= m_importStartUts)
+    return;
+  const int first = importWindowIndex(m_importStartUts);
+  const int last = importWindowIndex(m_importEndUts - 1);
+  // Newest first, like the page-numbered import, so recent statistics fill
+  // in early.
+  QMutexLocker locker(&m_routeMutex);
+  for (int window = last; window >= first; --window) {
+    if (completedWindows.contains(window))
+      continue;
+    ImportRequest request;
+    request.window = window;
+    m_importQueue.append(request);
+    m_windowPagesLeft.insert(window, 1);
   }
+  qInfo() << "[LFM Manager] Import of" << m_importStartUts << "-"
+          << m_importEndUts << "planned:" << m_importQueue.size() << "of"
+          << (last - first + 1) << "windows left.";
+}
+
+void LastFmManager::handleImportResult(int requestId,
+                                       const QList<ScrobbleData> &scrobbles,
+                                       int totalPages) {
+  const ImportRequest step = m_importRequests.take(requestId);
+  switch (step.step) {
+  case ImportRequest::Step::ProbeNewest:
+    qInfo() << "[LFM Manager] Import probe found" << totalPages
+            << "scrobbles.";
+    if (totalPages > 0) {
+      ImportRequest oldest;
+      oldest.step = ImportRequest::Step::ProbeOldest;
+      oldest.page = totalPages;
+      m_importQueue.append(oldest);
+    } else {
+      m_importStartUts = m_importEndUts;
+      emit importRangeDetermined(m_importStartUts, m_importEndUts);
+    }
+    break;
+  case ImportRequest::Step::ProbeOldest: {
+    qint64 oldestUts = 0;
+    for (const ScrobbleData &scrobble : scrobbles) {
+      if (scrobble.uts > 0 && (oldestUts == 0 || scrobble.uts < oldestUts))
+        oldestUts = scrobble.uts;
+    }
+    if (oldestUts == 0) {
+      qWarning() << "[LFM Manager] Import probe returned no oldest scrobble, "
+                    "importing from the start of the grid.";
+      oldestUts = IMPORT_GRID_ORIGIN_UTS;
+    }
+    m_importStartUts = oldestUts;
+    emit importRangeDetermined(m_importStartUts, m_importEndUts);
+    planImportWindows({});
+    break;
+  }
+  case ImportRequest::Step::Window:
+    // routeResult() has counted the window's pages and collects them.
+    if (step.page == 1) {
+      // Follow-up pages go first, so few windows are buffered at a time.
+      for (int page = totalPages; page >= 2; --page) {
+        ImportRequest next = step;
+        next.page = page;
+        m_importQueue.prepend(next);
+      }
+    }
+    break;
+  }
+
+  if (!finishPlannedFetchIfDone())
+    fillRequestWindow();
 }
 
 void LastFmManager::handlePageResultReady(
-    const QList<ScrobbleData> &pageScrobbles, int totalPages, int currentPage) {
-  qInfo() << "[LFM Manager] Fetched page" << currentPage << "/" << totalPages
-          << "with" << pageScrobbles.count() << "scrobbles.";
+    const QList<ScrobbleData> &pageScrobbles, int scrobbleCount,
+    int totalPages, int currentPage, int requestedPage, int generation) {
+  if (generation != m_fetchGeneration ||
+      !m_pagesInFlight.remove(requestedPage)) {
+    qDebug() << "[LFM Manager] Ignoring stale result for page"
+             << requestedPage;
+    return;
+  }
+  m_rateLimiter.recordSuccess();
+  const int retries = m_retryCounts.take(requestedPage);
+  if (retries > 0) {
+    qInfo() << "[LFM Manager] Request" << requestedPage << "answered after"
+            << retries << "retry attempt(s).";
+  }
+  if (m_isVerifying || m_isImporting) {
+    m_sentRequests.remove(requestedPage);
+  }
+  if (m_isVerifying) {
+    handleVerificationResult(requestedPage, totalPages);
+    return;
+  }
+  if (m_isImporting) {
+    handleImportResult(requestedPage, pageScrobbles, totalPages);
+    return;
+  }
 
-  if (m_retryCount > 0) {
-    qInfo() << "[LFM Manager] Successful fetch after" << m_retryCount
-            << "retry attempt(s). Resetting retry state.";
-    resetRetryState();
-  } else {
-    m_isRetryPending = false;
+  qInfo() << "[LFM Manager] Fetched page" << currentPage << "/" << totalPages
+          << "with" << scrobbleCount << "scrobbles.";
+  if (currentPage != requestedPage) {
+    qWarning() << "[LFM Manager] Page mismatch Req:" << requestedPage
+               << "Rcv:" << currentPage;
   }
 
-  if ((m_expectedTotalPages <= 0 && totalPages > 0) || currentPage == 1 ||
+  if ((m_expectedTotalPages <= 0 && totalPages > 0) || requestedPage == 1 ||
       (!m_isPerformingUpdate && totalPages != m_expectedTotalPages)) {
     if (!m_isPerformingUpdate && m_expectedTotalPages > 0 &&
         m_expectedTotalPages != totalPages) {
@@ -179,121 +852,182 @@ void LastFmManager::handlePageResultReady(
               << m_expectedTotalPages;
     }
   }
+  m_totalPagesKnown = true;
 
-  if (m_isPerformingUpdate && pageScrobbles.isEmpty() &&
-      m_fetchFromTimestamp > 0 && currentPage == 1) {
+  if (m_isPerformingUpdate && scrobbleCount == 0 &&
+      m_fetchFromTimestamp > 0 && requestedPage == 1) {
     qInfo() << "[LFM Manager] Update fetch received empty first page, assuming "
                "caught up.";
+    endFetch();
     emit fetchFinished();
     return;
   }
 
-  qDebug() << "[LFM Manager] Emitting pageReadyForSaving for page"
-           << currentPage;
-  emit pageReadyForSaving(pageScrobbles, currentPage);
+  // The page itself has already gone to the persist stage.
+  if (m_pagesInFlight.isEmpty() && m_retryPages.isEmpty() &&
+      m_nextPageToRequest > m_expectedTotalPages) {
+    qInfo() << "[LFM Manager] Finished fetching all expected pages from API "
+               "(last requested page"
+            << (m_nextPageToRequest - 1) << " of " << m_expectedTotalPages
+            << ").";
+    endFetch();
+    emit fetchFinished();
+    return;
+  }
 
-  scheduleNextPageFetch();
+  fillRequestWindow();
 }
 
 void LastFmManager::handleFetchErrorWorker(const QString &errorString,
-                                           int httpStatusCode) {
+                                           int httpStatusCode, int apiErrorCode,
+                                           int requestedPage, int generation) {
+  if (generation != m_fetchGeneration ||
+      !m_pagesInFlight.remove(requestedPage)) {
+    qDebug() << "[LFM Manager] Ignoring stale error for page" << requestedPage;
+    return;
+  }
   qWarning() << "[LFM Manager] Fetch error received from Worker:" << errorString
-             << "| HTTP Status:" << httpStatusCode;
+             << "| HTTP Status:" << httpStatusCode
+             << "| API Error:" << apiErrorCode;
 
-  if (httpStatusCode == 500 && m_retryCount < MAX_500_RETRIES) {
-    m_retryCount++;
-    m_lastFailed_fromTimestamp = m_fetchFromTimestamp;
-    m_lastFailed_page = m_currentPageFetching;
-    m_isRetryPending = true;
+  const bool throttled =
+      RateLimiter::isThrottleResponse(httpStatusCode, apiErrorCode);
+  int &retries = m_retryCounts[requestedPage];
+  if (throttled && retries < MAX_THROTTLE_RETRIES) {
+    retries++;
+    const qint64 backoffMs = m_rateLimiter.recordThrottle(m_clock.elapsed());
+    auto pos = std::lower_bound(m_retryPages.begin(), m_retryPages.end(),
+                                requestedPage);
+    m_retryPages.insert(pos, requestedPage);
 
-    qWarning() << "[LFM Manager] Received HTTP 500 error for page"
-               << m_lastFailed_page << ". Attempting retry" << m_retryCount
-               << "/" << MAX_500_RETRIES << "in" << (RETRY_DELAY_MS / 1000)
-               << "seconds...";
-
-    m_retryTimer->start();
+    qWarning() << "[LFM Manager] Throttled on page" << requestedPage
+               << ". Attempting retry" << retries << "/"
+               << MAX_THROTTLE_RETRIES << "in" << backoffMs
+               << "ms; request rate now" << m_rateLimiter.currentRate()
+               << "per second.";
+    fillRequestWindow();
   } else {
     QString finalErrorString = errorString;
-    if (httpStatusCode == 500) {
-      qCritical() << "[LFM Manager] HTTP 500 error persisted after"
-                  << m_retryCount << "retries for page" << m_currentPageFetching
-                  << ". Giving up.";
+    if (throttled) {
+      qCritical() << "[LFM Manager] Throttling persisted after" << retries
+                  << "retries for page" << requestedPage << ". Giving up.";
       finalErrorString =
-          "API Internal Server Error (500) persisted after retries.";
+          httpStatusCode == 500
+              ? "API Internal Server Error (500) persisted after retries."
+              : "Last.fm rate limit still exceeded after retries.";
     } else {
-      qWarning() << "[LFM Manager] Non-500 error or non-HTTP error occurred. "
-                    "No retry.";
+      qWarning() << "[LFM Manager] Non-throttling error occurred. No retry.";
     }
-    resetRetryState();
+    endFetch();
     emit fetchError(finalErrorString);
     emit fetchFinished();
   }
 }
 
-void LastFmManager::retryLastFetch() {
-  qInfo() << "[LFM Manager] Retry timer expired. Retrying fetch for page"
-          << m_lastFailed_page;
-  m_isRetryPending = false;
+void LastFmManager::handleWorkerFinished() {
+  qDebug() << "[LFM Manager] Worker task finished processing in its thread.";
+}
 
-  qDebug()
-      << "[LFM Manager] retryLastFetch: Checking Key/User before emit. Key:"
-      << (m_apiKey.isEmpty() ? "EMPTY" : "SET") << "User:" << m_username;
+void LastFmManager::handlePageTransferred(int page, qint64 wireBytes,
+                                          qint64 decodedBytes, bool http2) {
+  m_transferStats.responses++;
+  if (http2)
+    m_transferStats.http2Responses++;
+  m_transferStats.wireBytes += wireBytes;
+  m_transferStats.decodedBytes += decodedBytes;
+  qDebug() << "[LFM Manager] Page" << page << "transferred" << wireBytes
+           << "bytes for" << decodedBytes << "decoded"
+           << (http2 ? "(HTTP/2)" : "(HTTP/1.1)");
+}
 
-  emit startFetching(m_apiKey, m_username, m_lastFailed_fromTimestamp,
-                     m_lastFailed_page);
+void LastFmManager::handleConnectionEncrypted() {
+  m_transferStats.tlsHandshakes++;
 }
 
-void LastFmManager::handleWorkerFinished() {
-  qDebug() << "[LFM Manager] Worker task finished processing in its thread.";
+void LastFmManager::handlePageServedFromCache(int page, qint64 bytes) {
+  m_transferStats.cachedResponses++;
+  qDebug() << "[LFM Manager] Page" << page << "served from cache (" << bytes
+           << "bytes)";
 }
 
 LastFmWorker::LastFmWorker(QObject *parent)
-    : QObject(parent), m_requestedPage(0), m_requestedFromTimestamp(0) {}
+    : QObject(parent), m_networkManager(this) {
+  // A child of the worker, so it moves to the worker thread along with it.
+  connect(&m_networkManager, &QNetworkAccessManager::encrypted, this,
+          [this](QNetworkReply *) { emit connectionEncrypted(); });
+}
 
 void LastFmWorker::doFetch(const QString &apiKey, const QString &username,
-                           qint64 fromTimestamp, int page) {
+                           const RecentTracksRequest &request,
+                           int generation) {
+  QElapsedTimer busy;
+  busy.start();
+  // Also counts a cache hit, whose body is handed on from here.
+  auto recordBusy = qScopeGuard([&]() { m_busyNs += busy.nsecsElapsed(); });
   qCritical() << "[Worker Thread] doFetch received: API Key is"
               << (apiKey.isEmpty() ? "EMPTY" : "SET") << "Username:" << username
-              << "Page:" << page;
-
-  m_requestedPage = page;
-  m_requestedFromTimestamp = fromTimestamp;
+              << "Page:" << request.page << "Request:" << request.id;
 
   if (apiKey.isEmpty() || username.isEmpty()) {
     qCritical() << "[Worker Thread] ABORTING fetch: API Key or Username is "
                    "empty on arrival!";
-    emit errorOccurred("Internal Error: API Key/User empty in worker", 0);
+    emit errorOccurred("Internal Error: API Key/User empty in worker", 0, 0,
+                       request.id, generation);
     emit finished();
     return;
   }
 
-  QUrl url(API_BASE_URL);
+  QString cacheKey;
+  if (m_responseCache) {
+    cacheKey = ResponseCache::keyFor(username, request.fromUts, request.toUts,
+                                     request.page, request.limit);
+    QByteArray body;
+    if (request.preferCache && m_responseCache->lookup(cacheKey, body, -1)) {
+      qInfo() << "[Worker Thread] Request" << request.id << "served from cache";
+      emit pageServedFromCache(request.id, body.size());
+      emit replyReceived(body, 200, QString(), request.id, generation,
+                         QString());
+      emit finished();
+      return;
+    }
+  }
+
+  QUrl url(m_apiBaseUrl);
   QUrlQuery query;
 
   query.addQueryItem("method", "user.getrecenttracks");
   query.addQueryItem("user", username);
   query.addQueryItem("api_key", apiKey);
   query.addQueryItem("format", "json");
-  query.addQueryItem("page", QString::number(page));
-  query.addQueryItem("limit", QString::number(FETCH_LIMIT));
-  if (fromTimestamp > 0) {
-    query.addQueryItem("from", QString::number(fromTimestamp + 1));
+  query.addQueryItem("page", QString::number(request.page));
+  query.addQueryItem("limit", QString::number(request.limit));
+  if (request.fromUts > 0) {
+    query.addQueryItem("from", QString::number(request.fromUts));
+  }
+  if (request.toUts > 0) {
+    query.addQueryItem("to", QString::number(request.toUts));
   }
   url.setQuery(query);
 
-  QNetworkRequest request(url);
-  request.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
-                       QNetworkRequest::NoLessSafeRedirectPolicy);
+  QNetworkRequest networkRequest(url);
+  networkRequest.setAttribute(QNetworkRequest::RedirectPolicyAttribute,
+                              QNetworkRequest::NoLessSafeRedirectPolicy);
+  networkRequest.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+  networkRequest.setRawHeader("Connection", "keep-alive");
+  // Set by hand, so the manager hands the body on as received and its size
+  // on the wire is known; onReplyFinished() inflates it.
+  networkRequest.setRawHeader("Accept-Encoding", "gzip, deflate");
 
   if (m_networkManager.thread() != QThread::currentThread()) {
     qWarning() << "[Worker Thread] NAM needs creation/recreation.";
   }
 
-  qInfo() << "[Worker Thread] Requesting URL:" << request.url().toString();
-  QNetworkReply *reply = m_networkManager.get(request);
+  qInfo() << "[Worker Thread] Requesting URL:"
+          << networkRequest.url().toString();
+  QNetworkReply *reply = m_networkManager.get(networkRequest);
 
   connect(reply, &QNetworkReply::finished, this,
-          [=]() { onReplyFinished(reply); });
+          [=]() { onReplyFinished(reply, request.id, generation, cacheKey); });
   connect(reply, &QNetworkReply::errorOccurred, this,
           [=](QNetworkReply::NetworkError code) {
             qWarning() << "[Worker Thread] Network Error Signal ("
@@ -302,97 +1036,121 @@ void LastFmWorker::doFetch(const QString &apiKey, const QString &username,
           });
 }
 
-void LastFmWorker::onReplyFinished(QNetworkReply *reply) {
+void LastFmWorker::onReplyFinished(QNetworkReply *reply, int page,
+                                   int generation, const QString &cacheKey) {
+  QElapsedTimer busy;
+  busy.start();
+  auto recordBusy = qScopeGuard([&]() { m_busyNs += busy.nsecsElapsed(); });
   if (!reply) {
     qWarning() << "[Worker] Null reply";
-    emit errorOccurred("Network reply null", 0);
+    emit errorOccurred("Network reply null", 0, 0, page, generation);
     emit finished();
     return;
   }
 
-  QUrl url = reply->url();
   int httpStatusCode =
       reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
-  QByteArray responseData = reply->readAll();
+  QString networkError = reply->error() != QNetworkReply::NoError
+                             ? reply->errorString()
+                             : QString();
 
-  qInfo() << "[Worker Thread] Reply finished for page" << m_requestedPage
-          << url.query() << "| Status:" << httpStatusCode
+  qInfo() << "[Worker Thread] Reply finished for page" << page
+          << reply->url().query() << "| Status:" << httpStatusCode
           << "| Error:" << reply->errorString();
 
-  QList<ScrobbleData> fetchedScrobbles;
-  int totalPages = 0;
-  int currentPage = m_requestedPage;
+  const QByteArray wireBody = reply->readAll();
+  QByteArray body = wireBody;
+  const QByteArray encoding =
+      reply->rawHeader("Content-Encoding").trimmed().toLower();
+  const bool compressed =
+      encoding == "gzip" || encoding == "x-gzip" || encoding == "deflate";
+  if (compressed && !wireBody.isEmpty()) {
+    bool inflated = false;
+    body = inflateBody(wireBody, inflated);
+    if (!inflated && networkError.isEmpty()) {
+      networkError = "Corrupt " + QString::fromLatin1(encoding) +
+                     "-encoded response body";
+    }
+  } else if (!compressed && !encoding.isEmpty() && encoding != "identity" &&
+             networkError.isEmpty()) {
+    networkError =
+        "Unsupported Content-Encoding: " + QString::fromLatin1(encoding);
+  }
+  emit pageTransferred(
+      page, wireBody.size(), body.size(),
+      reply->attribute(QNetworkRequest::Http2WasUsedAttribute).toBool());
+  emit replyReceived(body, httpStatusCode, networkError, page, generation,
+                     cacheKey);
+  reply->deleteLater();
+  emit finished();
+}
+
+void LastFmWorker::setApiBaseUrl(const QString &url) { m_apiBaseUrl = url; }
+
+void LastFmWorker::setResponseCache(QSharedPointer<ResponseCache> cache) {
+  m_responseCache = cache;
+}
+
+LastFmParser::LastFmParser(QObject *parent) : QObject(parent) {}
+
+void LastFmParser::setResponseCache(QSharedPointer<ResponseCache> cache) {
+  m_responseCache = cache;
+}
+
+void LastFmParser::parseReply(const QByteArray &body, int httpStatusCode,
+                              const QString &networkError, int requestedPage,
+                              int generation, const QString &cacheKey) {
+  m_pendingReplies.deref();
+  QElapsedTimer busy;
+  busy.start();
+  auto recordBusy = qScopeGuard([&]() { m_busyNs += busy.nsecsElapsed(); });
+  ScrobbleJsonParser::RecentTracksPage parsed;
+  QString parseError;
 
-  if (reply->error() != QNetworkReply::NoError || httpStatusCode >= 400) {
-    qWarning() << "[Worker Thread] ------ ERROR RESPONSE Page"
-               << m_requestedPage << "------";
-    qWarning() << "[Worker Thread] Response Body:" << responseData;
-    qWarning() << "[Worker Thread] -----------------------------";
+  if (!networkError.isEmpty() || httpStatusCode >= 400) {
+    qWarning() << "[Parser Thread] ------ ERROR RESPONSE Page" << requestedPage
+               << "------";
+    qWarning() << "[Parser Thread] Response Body:" << body;
+    qWarning() << "[Parser Thread] -----------------------------";
 
+    // Error responses usually carry a Last.fm error code in the body.
+    ScrobbleJsonParser::parseRecentTracks(body, parsed, parseError);
     emit errorOccurred(QString("Network/API Error (Status %1): %2")
                            .arg(httpStatusCode)
-                           .arg(reply->errorString()),
-                       httpStatusCode);
-  } else {
-    QJsonParseError parseError;
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(responseData, &parseError);
-    if (parseError.error == QJsonParseError::NoError && jsonDoc.isObject()) {
-      QJsonObject rootObj = jsonDoc.object();
-      if (rootObj.contains("error")) {
-        qWarning() << "[Worker Thread] API Error in JSON (Page"
-                   << m_requestedPage << "):" << rootObj["message"].toString();
-        emit errorOccurred(
-            "Last.fm API Error: " + rootObj["message"].toString(), 0);
-      } else if (rootObj.contains("recenttracks")) {
-        QJsonObject recentTracksObj = rootObj["recenttracks"].toObject();
-        QJsonObject attr = recentTracksObj["@attr"].toObject();
-        totalPages = attr["totalPages"].toString().toInt();
-        currentPage = attr["page"].toString().toInt();
-        if (currentPage != m_requestedPage && m_requestedPage > 0) {
-          qWarning() << "[Worker] Page mismatch Req:" << m_requestedPage
-                     << "Rcv:" << currentPage;
-        }
-
-        QJsonArray tracksArray = recentTracksObj["track"].toArray();
-        int tracksParsedOnPage = 0;
-        for (const QJsonValue &value : tracksArray) {
-          QJsonObject trackObj = value.toObject();
-          if (trackObj.contains("@attr") &&
-              trackObj["@attr"].toObject()["nowplaying"].toString() == "true")
-            continue;
-          if (trackObj.contains("date")) {
-            qint64 uts =
-                trackObj["date"].toObject()["uts"].toString().toLongLong();
-            if (uts > 0) {
-              ScrobbleData scrobble;
-              scrobble.artist =
-                  trackObj["artist"].toObject()["#text"].toString();
-              scrobble.track = trackObj["name"].toString();
-              scrobble.album = trackObj["album"].toObject()["#text"].toString();
-              scrobble.timestamp = QDateTime::fromSecsSinceEpoch(uts, Qt::UTC);
-              fetchedScrobbles.append(scrobble);
-              tracksParsedOnPage++;
-            } else {
-              qWarning() << "[Worker] Invalid UTS <= 0";
-            }
-          } else {
-            qWarning() << "[Worker] Track missing date object";
-          }
-        }
-        qInfo() << "[Worker Thread] Successful Response: Page" << currentPage
-                << "/" << totalPages << "| Parsed:" << tracksParsedOnPage;
-        emit resultReady(fetchedScrobbles, totalPages, currentPage);
-      } else {
-        emit errorOccurred("Invalid JSON structure (page " +
-                               QString::number(m_requestedPage) + ")",
-                           httpStatusCode);
-      }
-    } else {
-      emit errorOccurred("Failed to parse JSON (page " +
-                             QString::number(m_requestedPage) + ")",
-                         httpStatusCode);
+                           .arg(networkError),
+                       httpStatusCode, parsed.apiErrorCode, requestedPage,
+                       generation);
+  } else if (!ScrobbleJsonParser::parseRecentTracks(body, parsed,
+                                                    parseError)) {
+    qWarning() << "[Parser Thread]" << parseError;
+    emit errorOccurred("Failed to parse JSON (page " +
+                           QString::number(requestedPage) + ")",
+                       httpStatusCode, 0, requestedPage, generation);
+  } else if (parsed.isApiError) {
+    qWarning() << "[Parser Thread] API Error in JSON (Page" << requestedPage
+               << "):" << parsed.apiErrorMessage;
+    emit errorOccurred("Last.fm API Error: " + parsed.apiErrorMessage, 0,
+                       parsed.apiErrorCode, requestedPage, generation);
+  } else if (parsed.hasRecentTracks) {
+    if (parsed.skippedTracks > 0) {
+      qWarning() << "[Parser] Skipped" << parsed.skippedTracks
+                 << "tracks without a valid date";
+    }
+    qInfo() << "[Parser Thread] Successful Response: Page" << parsed.page
+            << "/" << parsed.totalPages
+            << "| Parsed:" << parsed.scrobbles.size();
+    // Only bodies that parsed into a page are cached, so a resume never
+    // replays an error.
+    QString cacheError;
+    if (m_responseCache && !cacheKey.isEmpty() &&
+        !m_responseCache->store(cacheKey, body, cacheError)) {
+      qWarning() << "[Parser Thread]" << cacheError;
     }
+    emit resultReady(parsed.scrobbles, parsed.totalPages, parsed.page,
+                     requestedPage, generation);
+  } else {
+    emit errorOccurred("Invalid JSON structure (page " +
+                           QString::number(requestedPage) + ")",
+                       httpStatusCode, 0, requestedPage, generation);
   }
-  reply->deleteLater();
-  emit finished();
 }
@@ -1,37 +1,178 @@
 #ifndef LASTFMMANAGER_H
 #define LASTFMMANAGER_H
 
+#include "historyverifier.h"
+#include "ratelimiter.h"
+#include "responsecache.h"
 #include "scrobbledata.h"
+#include "weekgrid.h"
+#include <QAtomicInt>
+#include <QByteArray>
 #include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QList>
+#include <QMap>
+#include <QMutex>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QObject>
+#include <QSet>
+#include <QSharedPointer>
 #include <QString>
 #include <QThread>
 #include <QTimer>
+
+/**
+ * @struct RecentTracksRequest
+ * @brief One `user.getrecenttracks` request sent by LastFmWorker.
+ */
+struct RecentTracksRequest {
+  int id = 0;         /**< @brief Echoed back with the outcome; the page number
+                         for page fetches. */
+  int page = 1;       /**< @brief 1-based page. */
+  int limit = 200;    /**< @brief Tracks per page. */
+  qint64 fromUts = 0; /**< @brief `from` (inclusive), or 0 to omit it. */
+  qint64 toUts = 0;   /**< @brief `to` (inclusive), or 0 to omit it. */
+  bool preferCache = false; /**< @brief Answer from the response cache if it
+                               holds the request, however old the entry; only
+                               for ranges that can no longer change. */
+};
+Q_DECLARE_METATYPE(RecentTracksRequest)
+
 /**
  * @class LastFmManager
  * @brief Manages interaction with the Last.fm API for fetching scrobble data.
  * @details Handles asynchronous fetching of recent tracks, pagination, rate
- * limiting (via delays), and error handling including retries for specific
- * errors. Uses a LastFmWorker object running in a separate thread for network
- * requests.
+ * limiting, and error handling including retries for specific errors.
+ *
+ * A fetch runs as a pipeline of bounded stages. A LastFmWorker on its own
+ * thread performs the network requests and hands the raw response bodies to a
+ * pool of LastFmParser objects, one thread each; every body goes to the
+ * parser with the shortest queue. The parser thread then routes the parsed
+ * scrobbles itself (see routeResult()): pages are put in page order and
+ * emitted with pageReadyForSaving, import windows are assembled, and
+ * backfilled pages are passed on, all without a detour through the GUI
+ * thread. Connect these signals directly to DatabaseManager::saveScrobblesAsync
+ * (Qt::DirectConnection), whose bounded queue then blocks the parsers when
+ * the disk falls behind. Only the outcome of each request (page count,
+ * scrobble count) is queued to the manager's thread, which decides what to
+ * request next. The number of requests in flight bounds the parse queues and
+ * the reorder buffer. New pages are only requested while the persist stage
+ * reports fewer than downstreamCapacity() pages waiting (see
+ * setDownstreamDepth()), so a slow disk throttles fetching long before the
+ * save queue fills.
+ *
+ * Once a response has reported the total page count, up to
+ * maxPagesInFlight() pages are requested concurrently, with request starts
+ * paced by a RateLimiter. The window slides over page numbers:
+ * only pages below the oldest page not yet emitted plus the window size are
+ * requested. Completed pages wait in a reorder buffer so that
+ * pageReadyForSaving is always emitted in ascending page order. Every page
+ * request carries the same `to`, fixed when the fetch starts (see
+ * fetchEndTimestamp()), so the page boundaries do not move while scrobbles
+ * are added and no scrobble is skipped or fetched twice.
+ *
+ * Throttling responses (see RateLimiter::isThrottleResponse()) put the page
+ * back in line and make the limiter back off; the fetch fails once a single
+ * page has been throttled more than MAX_THROTTLE_RETRIES times.
+ *
+ * verifyHistory() runs the same machinery over the requests planned by a
+ * HistoryVerifier instead of page numbers: it counts time windows and
+ * fetches the windows missing scrobbles, emitting their pages with
+ * backfillPageReady. startWindowedImport() does the same for the fixed
+ * time windows of an initial import, emitting each with importWindowReady.
  * @inherits QObject
  */
 class LastFmWorker;
+class LastFmParser;
 
 class LastFmManager : public QObject {
   Q_OBJECT
-  /** @brief Maximum number of retries for HTTP 500 errors. */
-  static const int MAX_500_RETRIES = 3;
-  /** @brief Delay between retry attempts in milliseconds (e.g., 60 seconds). */
-  static const int RETRY_DELAY_MS = 60 * 1000;
+  /** @brief Maximum number of retries of a page after throttling errors. */
+  static const int MAX_THROTTLE_RETRIES = 6;
+  /** @brief Default number of page requests kept in flight. */
+  static const int DEFAULT_PAGES_IN_FLIGHT = 4;
+  /** @brief Default persist stage backlog at which fetching pauses. */
+  static const int DEFAULT_DOWNSTREAM_CAPACITY = 16;
+  /** @brief Tracks requested per page (the maximum the API allows). */
+  static const int PAGE_LIMIT = 200;
+  /** @brief Upper bound of the parser pool size. */
+  static constexpr int MAX_PARSER_THREADS = 4;
+
+  /**
+   * @struct Route
+   * @brief Where the scrobbles of a request go once it is parsed.
+   */
+  struct Route {
+    /** @brief The destination. */
+    enum class Kind {
+      Control, /**< @brief Back to the manager (probes and counts). */
+      Page,    /**< @brief Reorder buffer, then pageReadyForSaving. */
+      Window,  /**< @brief Import window, then importWindowReady. */
+      Backfill /**< @brief Straight on with backfillPageReady. */
+    };
+    Kind kind = Kind::Control; /**< @brief The destination. */
+    int window = 0;            /**< @brief Grid index of an import window. */
+    int page = 1;              /**< @brief Page within the window. */
+  };
+
+  /**
+   * @struct ParsedPage
+   * @brief A parsed response waiting to be routed on.
+   */
+  struct ParsedPage {
+    int id = 0;                    /**< @brief Id of the request. */
+    QList<ScrobbleData> scrobbles; /**< @brief Scrobbles of the response, or
+                                      of the completed window. */
+    int totalPages = 0;            /**< @brief Page count of the response. */
+    int currentPage = 0;           /**< @brief Page reported by the response. */
+  };
+
+  /**
+   * @struct ImportRequest
+   * @brief What a request of a windowed import asks for.
+   */
+  struct ImportRequest {
+    /** @brief The step of the import. */
+    enum class Step {
+      ProbeNewest, /**< @brief Newest scrobble and total count. */
+      ProbeOldest, /**< @brief Oldest scrobble. */
+      Window       /**< @brief One page of an import window. */
+    };
+    Step step = Step::Window; /**< @brief The step. */
+    int window = 0;           /**< @brief Grid index of the window. */
+    int page = 1;             /**< @brief Page within the window. */
+  };
 
 public:
+  /**
+   * @brief Endpoint of the Last.fm API v2.
+   * @details HTTPS, since Last.fm negotiates HTTP/2 only through TLS ALPN.
+   */
+  static constexpr const char *DEFAULT_API_BASE_URL =
+      "https://ws.audioscrobbler.com/2.0/";
+
+  /**
+   * @struct TransferStats
+   * @brief Network volume of the current (or last) fetch.
+   */
+  struct TransferStats {
+    int responses = 0;       /**< @brief Responses received. */
+    int http2Responses = 0;  /**< @brief Responses received over HTTP/2. */
+    qint64 wireBytes = 0;    /**< @brief Body bytes as transferred. */
+    qint64 decodedBytes = 0; /**< @brief Body bytes after decompression. */
+    int tlsHandshakes = 0;   /**< @brief TLS connections established. */
+    int cachedResponses = 0; /**< @brief Pages served by the cache. */
+    qint64 networkBusyNs = 0; /**< @brief Time the network thread spent
+                                 building requests and handing on replies. */
+    qint64 parseBusyNs = 0;   /**< @brief Time the parsers spent, summed over
+                                 the pool. */
+  };
+
   /**
    * @brief Constructs a LastFmManager instance.
    * @details Initializes the worker thread and worker object, sets up
@@ -41,20 +182,113 @@ public:
   explicit LastFmManager(QObject *parent = nullptr);
   /**
    * @brief Destructor.
-   * @details Stops the worker thread gracefully.
+   * @details Stops the worker thread gracefully (see shutdown()).
    */
   ~LastFmManager();
+  /**
+   * @brief Ends the current fetch and stops the worker and parser threads.
+   * @details The page signals are emitted on the parser threads, so their
+   * directly connected receivers must outlive this call; a parser blocked
+   * in a receiver holds it up until the receiver returns. The manager cannot
+   * fetch afterwards.
+   */
+  void shutdown();
   /**
    * @brief Sets the API key and username required for Last.fm API requests.
    * @param apiKey The Last.fm API key.
    * @param username The Last.fm username.
    */
   void setup(const QString &apiKey, const QString &username);
+  /**
+   * @brief Sets how many page requests may be in flight at once.
+   * @details Takes effect for the next request. Values below 1 are raised to
+   * 1, which fetches strictly one page after another.
+   * @param count The window size.
+   */
+  void setMaxPagesInFlight(int count);
+  /** @brief Returns the number of page requests that may be in flight. */
+  int maxPagesInFlight() const { return m_maxPagesInFlight; }
+  /**
+   * @brief Sets the API endpoint requests are sent to.
+   * @details Meant for pointing the client at a local mock server; takes
+   * effect for the next request.
+   * @param url The endpoint; an empty string restores DEFAULT_API_BASE_URL.
+   */
+  void setApiBaseUrl(const QString &url);
+  /**
+   * @brief Replaces the request budget of the rate limiter.
+   * @details Resets any running backoff. Meant for benchmarks against a local
+   * server; the default matches Last.fm's published limit.
+   * @param requestsPerSecond The new budget.
+   */
+  void setRequestsPerSecond(double requestsPerSecond);
+  /**
+   * @brief Sets the tracks requested per page.
+   * @details Last.fm accepts at most PAGE_LIMIT, the default; larger pages
+   * are for benchmarks against a local server. Takes effect for the next
+   * fetch.
+   * @param limit The page size; values below 1 are raised to 1.
+   */
+  void setPageLimit(int limit);
+  /** @brief Returns the tracks requested per page. */
+  int pageLimit() const { return m_pageLimit; }
+  /**
+   * @brief Sets how many parser threads responses are spread over.
+   * @details The pool is started with min(idealThreadCount, 4) threads;
+   * this only limits how many of them receive work.
+   * @param count The number of parsers, clamped to the pool size.
+   */
+  void setParserThreads(int count);
+  /** @brief Returns the number of parsers that receive responses. */
+  int parserThreads() const { return m_activeParsers.loadRelaxed(); }
+  /**
+   * @brief Keeps successfully parsed responses in an on-disk ResponseCache.
+   * @details Windowed imports read pages from the cache before requesting
+   * them, whatever their age: a window lies in the past and its pages do not
+   * change. Page and update fetches only fill the cache, since their pinned
+   * end differs from that of any earlier fetch.
+   * @param directory The cache directory; an empty string disables caching.
+   * @param maxBytes The size cap of the cache.
+   */
+  void setResponseCache(const QString &directory,
+                        qint64 maxBytes = ResponseCache::DEFAULT_MAX_BYTES);
+  /**
+   * @brief Sets how many emitted pages may wait in the persist stage before
+   * no new page is requested.
+   * @param pages The limit; values below 1 are raised to 1.
+   */
+  void setDownstreamCapacity(int pages);
+  /** @brief Returns the persist stage backlog at which fetching pauses. */
+  int downstreamCapacity() const { return m_downstreamCapacity; }
+  /**
+   * @brief Returns the number of requested pages not yet handed on (waiting
+   * for the network, the parser or the pages before them).
+   */
+  int pagesInFlight() const { return int(m_pagesInFlight.size()); }
+  /** @brief Returns the number of responses waiting for the parser. */
+  int pagesAwaitingParse() const;
+  /**
+   * @brief Returns the number of parsed pages held back for ordering.
+   * @note Thread-safe.
+   */
+  int pagesAwaitingOrder() const;
+  /**
+   * @brief Returns the network volume and thread busy times since the
+   * current fetch started.
+   */
+  TransferStats transferStats() const;
+  /**
+   * @brief Returns the end (exclusive) of the current (or last) page fetch.
+   * @details Pinned when the fetch starts and sent as `to` with every page,
+   * so scrobbles arriving meanwhile do not shift the pages.
+   */
+  qint64 fetchEndTimestamp() const { return m_fetchEndTimestamp; }
   /**
    * @brief Initiates fetching scrobbles added since a specific timestamp
    * (update mode).
    * @details Resets fetch state and starts fetching from page 1, using the
-   * 'from' parameter in the API call.
+   * 'from' parameter in the API call. The end is pinned to the current
+   * time.
    * @param lastSyncTimestamp The UTC timestamp (seconds since epoch) of the
    * last known scrobble. Fetches tracks *after* this time.
    */
@@ -69,6 +303,63 @@ public:
    * unknown.
    */
   void startInitialOrResumeFetch(int startPage, int knownTotalPages);
+  /**
+   * @brief Compares the stored history with Last.fm and fetches only the time
+   * windows that are missing scrobbles.
+   * @details Plans with a HistoryVerifier; the pages of the missing windows
+   * are emitted with backfillPageReady, in no particular order and possibly
+   * overlapping stored scrobbles. Ends with fetchFinished, after fetchError
+   * on failure.
+   * @param localWeekCounts Stored scrobbles per week start, see
+   * DatabaseManager::getWeekCounts().
+   * @param endUts End of the verified range (exclusive), normally one second
+   * after the last stored scrobble.
+   */
+  void verifyHistory(const QMap<qint64, int> &localWeekCounts, qint64 endUts);
+  /** @brief Returns the outcome of the current (or last) verification. */
+  HistoryVerifier::Summary verificationSummary() const {
+    return m_verifier.summary();
+  }
+  /**
+   * @brief Imports the history before a fixed end time as independent time
+   * windows.
+   * @details The windows are the cells of a fixed grid (see
+   * importWindowIndex()) clipped to [startUts, endUts). Unlike page numbers
+   * they do not move when new scrobbles arrive, so any number of windows and
+   * pages can be fetched at once and an import resumes exactly where it
+   * stopped. Without a known range, two one-track probes find the newest and
+   * the oldest scrobble first and importRangeDetermined reports the range,
+   * which is fixed for the rest of the import. A window is emitted with
+   * importWindowReady once all its pages arrived; windows come in no
+   * particular order. Ends with fetchFinished, after fetchError on failure.
+   * @param startUts Start of the history (inclusive), or 0 to probe.
+   * @param endUts End of the imported range (exclusive), or 0 to probe.
+   * @param completedWindows Grid indices of windows already saved.
+   */
+  void startWindowedImport(qint64 startUts, qint64 endUts,
+                           const QSet<int> &completedWindows);
+  /**
+   * @brief Returns the grid index of the import window containing a time.
+   * @details Windows of IMPORT_WINDOW_SECS on the WeekGrid, so every window
+   * boundary is a week boundary.
+   */
+  static int importWindowIndex(qint64 uts);
+  /** @brief Returns the start of an import window of the grid. */
+  static qint64 importWindowStart(int index);
+  /** @brief Returns the number of grid windows covering [startUts, endUts). */
+  static int importWindowCount(qint64 startUts, qint64 endUts);
+  /** @brief Length of an import window in seconds (four weeks). */
+  static constexpr qint64 IMPORT_WINDOW_SECS = 4 * WeekGrid::WEEK_SECS;
+
+public slots:
+  /**
+   * @brief Updates the number of pages waiting in the persist stage.
+   * @details Connect to DatabaseManager::saveQueueDepthChanged. Fetching
+   * pauses while @p pages is at least downstreamCapacity() and resumes once
+   * it drops below.
+   * @param pages The current persist stage backlog in pages.
+   */
+  void setDownstreamDepth(int pages);
 
 signals:
   /**
@@ -76,20 +367,49 @@ signals:
    * operation.
    * @param apiKey The API key to use.
    * @param username The username to fetch for.
-   * @param fromTimestamp The 'from' timestamp for the API query (0 for initial
-   * fetch).
-   * @param page The page number to fetch.
+   * @param request The request.
+   * @param generation Identifies the fetch the request belongs to; echoed
+   * back with the result.
    */
   void startFetching(const QString &apiKey, const QString &username,
-                     qint64 fromTimestamp, int page);
+                     const RecentTracksRequest &request, int generation);
   /**
    * @brief Emitted when a page of scrobbles has been successfully fetched and
-   * parsed.
-   * @param pageScrobbles The list of scrobbles from the fetched page.
+   * parsed, in ascending page order, empty pages included.
+   * @details Emitted on a parser thread, one page at a time; the arguments
+   * match DatabaseManager::saveScrobblesAsync().
    * @param pageNumber The page number that was fetched.
+   * @param username The user given to setup() when the fetch started.
+   * @param pageScrobbles The list of scrobbles from the fetched page.
    */
-  void pageReadyForSaving(const QList<ScrobbleData> &pageScrobbles,
-                          int pageNumber);
+  void pageReadyForSaving(int pageNumber, const QString &username,
+                          const QList<ScrobbleData> &pageScrobbles);
+  /**
+   * @brief Emitted during verifyHistory() for every fetched page of a window
+   * that was missing scrobbles.
+   * @details Emitted on a parser thread, like pageReadyForSaving.
+   * @param pageNumber Always 0; backfilled pages have no resume state.
+   * @param username The user given to setup() when the fetch started.
+   * @param scrobbles The scrobbles of the page.
+   */
+  void backfillPageReady(int pageNumber, const QString &username,
+                         const QList<ScrobbleData> &scrobbles);
+  /**
+   * @brief Emitted when startWindowedImport() has determined (or been given)
+   * the imported range.
+   * @param startUts Start of the history (inclusive).
+   * @param endUts End of the imported range (exclusive).
+   */
+  void importRangeDetermined(qint64 startUts, qint64 endUts);
+  /**
+   * @brief Emitted when every page of an import window has been fetched.
+   * @details Emitted on a parser thread, like pageReadyForSaving.
+   * @param windowIndex Grid index of the window.
+   * @param username The user given to setup() when the fetch started.
+   * @param scrobbles The scrobbles of the window, possibly empty.
+   */
+  void importWindowReady(int windowIndex, const QString &username,
+                         const QList<ScrobbleData> &scrobbles);
   /**
    * @brief Emitted when the total number of pages is determined or updated from
    * an API response.
@@ -110,68 +430,235 @@ signals:
 
 private slots:
   /**
-   * @brief Slot to handle the results when the worker thread successfully
-   * fetches a page.
-   * @param pageScrobbles The scrobbles from the page.
+   * @brief Slot to handle the outcome of a successfully parsed request,
+   * queued by routeResult().
+   * @param pageScrobbles The scrobbles of a request routed back to the
+   * manager (Route::Kind::Control); empty for the others, whose scrobbles
+   * went on to the persist stage.
+   * @param scrobbleCount The number of scrobbles of the response.
    * @param totalPages The total pages reported by the API for this request.
    * @param currentPage The page number that was actually fetched (as reported
    * by API).
+   * @param requestedPage The id of the request: the page number of a page
+   * fetch.
+   * @param generation The fetch the request belongs to; results of an earlier
+   * fetch are ignored.
    */
   void handlePageResultReady(const QList<ScrobbleData> &pageScrobbles,
-                             int totalPages, int currentPage);
+                             int scrobbleCount, int totalPages, int currentPage,
+                             int requestedPage, int generation);
   /**
    * @brief Slot to handle errors reported by the worker thread.
    * @param errorString Description of the error.
    * @param httpStatusCode The HTTP status code associated with the error (0 if
    * not applicable).
+   * @param apiErrorCode The Last.fm error code in the response (0 if none).
+   * @param requestedPage The id of the request: the page number of a page
+   * fetch.
+   * @param generation The fetch the request belongs to.
    */
-  void handleFetchErrorWorker(const QString &errorString, int httpStatusCode);
+  void handleFetchErrorWorker(const QString &errorString, int httpStatusCode,
+                              int apiErrorCode, int requestedPage,
+                              int generation);
   /**
    * @brief Slot connected to the worker's finished signal. (Currently minimal
    * use).
    */
   void handleWorkerFinished();
   /**
-   * @brief Slot called by the retry timer to re-attempt the last failed fetch
-   * operation.
+   * @brief Adds one response to the transfer statistics.
+   * @param page The requested page.
+   * @param wireBytes Body size as transferred.
+   * @param decodedBytes Body size after decompression.
+   * @param http2 True if the response came over HTTP/2.
    */
-  void retryLastFetch();
+  void handlePageTransferred(int page, qint64 wireBytes, qint64 decodedBytes,
+                             bool http2);
+  /** @brief Counts a TLS handshake of the worker's network manager. */
+  void handleConnectionEncrypted();
+  /**
+   * @brief Counts a page served by the response cache.
+   * @param page The requested page.
+   * @param bytes Size of the cached body.
+   */
+  void handlePageServedFromCache(int page, qint64 bytes);
+  /**
+   * @brief Requests pages until the window is full, the rate limit defers the
+   * next request, or no page is left to request.
+   */
+  void fillRequestWindow();
 
 private:
   /**
-   * @brief Schedules the fetch for the next page after a short delay.
+   * @brief Starts a new generation with empty request bookkeeping.
    */
-  void scheduleNextPageFetch();
+  void resetFetchState();
   /**
-   * @brief Resets retry-related state variables (count, timer, flags).
+   * @brief Sends planned verification or import requests until the window
+   * is full, the rate limit defers the next request, or none is planned.
+   */
+  void fillPlannedWindow();
+  /** @brief Returns true if the verifier or the import has a request. */
+  bool hasPlannedRequest() const;
+  /**
+   * @brief Takes the next verification or import request and records it.
+   * @param id The id to send it with.
+   */
+  RecentTracksRequest takePlannedRequest(int id);
+  /**
+   * @brief Feeds an import answer to the import planning.
+   * @param requestId The request the answer belongs to.
+   * @param scrobbles The scrobbles of a probe; empty for window pages.
+   * @param totalPages The page count of the answer.
+   */
+  void handleImportResult(int requestId, const QList<ScrobbleData> &scrobbles,
+                          int totalPages);
+  /**
+   * @brief Queues the first page of every window of the import range that is
+   * not completed.
+   * @param completedWindows Grid indices of windows already saved.
+   */
+  void planImportWindows(const QSet<int> &completedWindows);
+  /** @brief Ends the fetch if no planned request is left or in flight. */
+  bool finishPlannedFetchIfDone();
+  /**
+   * @brief Feeds a verification answer to the planner.
+   * @param requestId The request the answer belongs to.
+   * @param totalPages The page count of the answer.
+   */
+  void handleVerificationResult(int requestId, int totalPages);
+  /**
+   * @brief Resets the fetch state and requests the first page(s).
+   * @param fromTimestamp 'from' timestamp for update fetches, 0 otherwise.
+   * @param startPage The first page to fetch.
+   * @param knownTotalPages The known total page count, or 0 if unknown.
+   * @param isUpdate True for an update fetch.
+   */
+  void beginFetch(qint64 fromTimestamp, int startPage, int knownTotalPages,
+                  bool isUpdate);
+  /**
+   * @brief Records where the scrobbles of a request go once it is parsed.
+   * @param id The id the request is sent with.
+   * @param route The destination.
+   */
+  void addRoute(int id, const Route &route);
+  /**
+   * @brief Drops the routes and buffered scrobbles of the previous fetch and
+   * binds the routes to the current generation and user.
+   */
+  void resetRoutes();
+  /**
+   * @brief Routes the scrobbles of a parsed response and queues its outcome
+   * to handlePageResultReady().
+   * @details Pages go into the reorder buffer, from which every page that
+   * directly follows the last emitted one is emitted with
+   * pageReadyForSaving and only then reported to the manager; window pages
+   * are collected until their window is complete. A response without a
+   * route (stale, or a duplicate of one already routed) is dropped.
+   * @note Runs on a parser thread, directly connected to
+   * LastFmParser::resultReady. The emitted signals may block in the persist
+   * stage; m_routeMutex is not held meanwhile, so the manager's thread does
+   * not wait for the disk.
+   */
+  void routeResult(const QList<ScrobbleData> &scrobbles, int totalPages,
+                   int currentPage, int requestedPage, int generation);
+  /**
+   * @brief Ends the current fetch; replies still in flight are ignored.
+   */
+  void endFetch();
+  /**
+   * @brief Resets retry-related state variables (pages, attempt counts).
    */
   void resetRetryState();
+  /**
+   * @brief Hands a response body to the least busy parser of the pool.
+   * @note Runs on the network thread, directly connected to
+   * LastFmWorker::replyReceived; touches only the pool, which is fixed after
+   * construction, and m_activeParsers.
+   */
+  void dispatchReply(const QByteArray &body, int httpStatusCode,
+                     const QString &networkError, int requestedPage,
+                     int generation, const QString &cacheKey);
 
   QThread *m_workerThread =
       nullptr; /**< @brief The thread where the LastFmWorker runs. */
   LastFmWorker *m_worker =
       nullptr; /**< @brief The worker object performing network requests. */
+  QList<QThread *> m_parserThreads; /**< @brief One thread per parser. */
+  QList<LastFmParser *>
+      m_parsers; /**< @brief Parse responses off the network thread. */
+  QAtomicInt m_activeParsers; /**< @brief Parsers receiving responses. */
+  int m_pageLimit = PAGE_LIMIT; /**< @brief Tracks requested per page. */
+  qint64 m_networkBusyAtStart = 0; /**< @brief Network thread busy time when
+                                      the current fetch started. */
+  qint64 m_parseBusyAtStart = 0;   /**< @brief Parser busy time when the
+                                      current fetch started. */
+  int m_downstreamCapacity =
+      DEFAULT_DOWNSTREAM_CAPACITY; /**< @brief Persist backlog limit. */
+  int m_downstreamDepth = 0; /**< @brief Last reported persist backlog. */
 
   QString m_apiKey;   /**< @brief Stored Last.fm API key. */
   QString m_username; /**< @brief Stored Last.fm username. */
   qint64 m_fetchFromTimestamp =
       0; /**< @brief 'from' timestamp for update fetches (0 otherwise). */
-  int m_currentPageFetching =
-      0; /**< @brief The page number currently being fetched or requested. */
+  qint64 m_fetchEndTimestamp = 0; /**< @brief End (exclusive) of the page
+                                     fetch, pinned when it starts. */
+  int m_nextPageToRequest = 0; /**< @brief Next page not yet requested. */
   int m_expectedTotalPages =
       0; /**< @brief The last known total number of pages. */
+  bool m_totalPagesKnown = false; /**< @brief A response of the current fetch
+                                     reported the total page count. */
+  bool m_fetchActive = false; /**< @brief A fetch is in progress. */
+  int m_fetchGeneration = 0;  /**< @brief Incremented whenever a fetch starts
+                                 or ends. */
+  int m_maxPagesInFlight =
+      DEFAULT_PAGES_IN_FLIGHT; /**< @brief Size of the request window. */
+  QSet<int> m_pagesInFlight; /**< @brief Pages requested but not answered. */
+  RateLimiter m_rateLimiter;  /**< @brief Paces request starts. */
+  QElapsedTimer m_clock;      /**< @brief Monotonic time base of the limiter. */
+  QTimer *m_dispatchTimer =
+      nullptr; /**< @brief Defers requests to respect the rate limit. */
   bool m_isPerformingUpdate = false; /**< @brief Flag indicating if the current
                                         fetch is an update (since timestamp). */
+  bool m_isVerifying = false; /**< @brief The current fetch is a
+                                 verifyHistory() run. */
+  HistoryVerifier m_verifier; /**< @brief Plans the verification requests. */
+  QHash<int, HistoryVerifier::Request>
+      m_verifyRequests; /**< @brief Sent verification requests by id. */
+  bool m_isImporting = false; /**< @brief The current fetch is a
+                                 startWindowedImport() run. */
+  qint64 m_importStartUts = 0; /**< @brief Start of the import range. */
+  qint64 m_importEndUts = 0;   /**< @brief End of the import range. */
+  QList<ImportRequest> m_importQueue; /**< @brief Import requests not yet
+                                         sent; follow-up pages first. */
+  QHash<int, ImportRequest>
+      m_importRequests; /**< @brief Sent import requests by id. */
+  QHash<int, RecentTracksRequest>
+      m_sentRequests;      /**< @brief Planned requests in flight, by id. */
+  int m_nextRequestId = 1; /**< @brief Id of the next planned request. */
+  QSharedPointer<ResponseCache>
+      m_responseCache; /**< @brief Shared with the worker and the parser. */
+
+  // Shared with the parser threads (see routeResult()); guarded by
+  // m_routeMutex.
+  mutable QMutex m_routeMutex; /**< @brief Guards the routing state. */
+  QMutex m_emitMutex; /**< @brief Held by the parser thread handing pages on,
+                         so they leave in the order they were taken. */
+  int m_routeGeneration = 0; /**< @brief Fetch the routes belong to. */
+  QString m_routeUsername;   /**< @brief User the routed pages belong to. */
+  QHash<int, Route> m_routes; /**< @brief Routes of unanswered requests. */
+  int m_nextPageToEmit = 0; /**< @brief Next page due for pageReadyForSaving. */
+  QMap<int, ParsedPage>
+      m_completedPages; /**< @brief Reorder buffer of pages completed ahead
+                           of m_nextPageToEmit. */
+  QHash<int, int> m_windowPagesLeft; /**< @brief Pages still to arrive per
+                                        open window. */
+  QHash<int, QList<ScrobbleData>>
+      m_windowScrobbles; /**< @brief Scrobbles of the open windows. */
 
-  QTimer *m_retryTimer = nullptr; /**< @brief Timer to delay retry attempts. */
-  int m_retryCount =
-      0; /**< @brief Current retry attempt count for 500 errors. */
-  qint64 m_lastFailed_fromTimestamp =
-      0; /**< @brief 'from' timestamp of the last failed request. */
-  int m_lastFailed_page =
-      0; /**< @brief Page number of the last failed request. */
-  bool m_isRetryPending =
-      false; /**< @brief Flag indicating if a retry attempt is scheduled. */
+  QList<int> m_retryPages; /**< @brief Pages to request again, ascending. */
+  QHash<int, int> m_retryCounts; /**< @brief Throttling retries per page. */
+  TransferStats m_transferStats; /**< @brief Volume of the current fetch. */
 };
 
 /**
@@ -179,8 +666,17 @@ private:
  * @brief Worker object performing actual Last.fm API requests in a separate
  * thread.
  * @details Encapsulates the QNetworkAccessManager and handles the request
- * construction, sending, and basic reply processing (parsing JSON, extracting
- * data/errors). Runs within the thread managed by LastFmManager.
+ * construction and sending. Response bodies are handed on unparsed with
+ * replyReceived, so the network thread only does I/O. Runs within the thread
+ * managed by LastFmManager.
+ *
+ * All requests go through one QNetworkAccessManager living in the worker
+ * thread, so connections are kept alive and reused across pages. Requests
+ * allow HTTP/2, which multiplexes the in-flight pages over a single TLS
+ * connection, and ask for `gzip` and `deflate` themselves: when the manager
+ * negotiates compression it inflates the body and drops Content-Length,
+ * leaving no way to tell the bytes on the wire. The worker inflates the body
+ * with zlib instead, after counting it.
  * @inherits QObject
  */
 class LastFmWorker : public QObject {
@@ -191,6 +687,11 @@ public:
    * @param parent The parent QObject, defaults to nullptr.
    */
   explicit LastFmWorker(QObject *parent = nullptr);
+  /**
+   * @brief Returns the time spent in doFetch() and reply handling so far.
+   * @note Thread-safe.
+   */
+  qint64 busyNsecs() const { return m_busyNs.loadRelaxed(); }
 public slots:
   /**
    * @brief Performs the network request to fetch a specific page of recent
@@ -198,28 +699,71 @@ public slots:
    * @note This slot is executed in the worker thread.
    * @param apiKey The Last.fm API key.
    * @param username The Last.fm username.
-   * @param fromTimestamp The 'from' timestamp (seconds since epoch + 1) for
-   * update fetches, or 0 for initial/full fetches.
-   * @param page The 1-based page number to fetch.
+   * @param request The page, window and tag of the request.
+   * @param generation Fetch identifier echoed back with the result.
    */
   void doFetch(const QString &apiKey, const QString &username,
-               qint64 fromTimestamp, int page);
+               const RecentTracksRequest &request, int generation);
+  /**
+   * @brief Sets the endpoint used by subsequent doFetch() calls.
+   * @note This slot is executed in the worker thread.
+   * @param url The API endpoint.
+   */
+  void setApiBaseUrl(const QString &url);
+  /**
+   * @brief Sets the cache consulted by doFetch(), or none if null.
+   * @note This slot is executed in the worker thread.
+   * @param cache The response cache.
+   */
+  void setResponseCache(QSharedPointer<ResponseCache> cache);
 signals:
   /**
-   * @brief Emitted when a page is successfully fetched and parsed.
-   * @param scrobbles The list of ScrobbleData extracted from the page.
-   * @param totalPages The total number of pages reported by the API response.
-   * @param currentPage The page number reported by the API response.
+   * @brief Emitted when a request has finished, successfully or not.
+   * @param body The raw response body.
+   * @param httpStatusCode The HTTP status code, or 0 if there was none.
+   * @param networkError Description of a network error, empty if none.
+   * @param requestedPage The id of the request: the page number of a page
+   * fetch.
+   * @param generation The generation passed to doFetch().
+   * @param cacheKey The key to cache the body under once it parsed, or empty
+   * if it must not be cached (no cache set, or served from the cache).
    */
-  void resultReady(const QList<ScrobbleData> &scrobbles, int totalPages,
-                   int currentPage);
+  void replyReceived(const QByteArray &body, int httpStatusCode,
+                     const QString &networkError, int requestedPage,
+                     int generation, const QString &cacheKey);
+  /**
+   * @brief Emitted when a page was answered from the response cache instead
+   * of the network.
+   * @param requestedPage The id of the request: the page number of a page
+   * fetch.
+   * @param bytes Size of the cached body.
+   */
+  void pageServedFromCache(int requestedPage, qint64 bytes);
   /**
-   * @brief Emitted when a network or API error occurs during the fetch attempt.
+   * @brief Emitted for every response with its transfer volume.
+   * @details The wire size is the body as received, before inflating;
+   * header bytes are not counted.
+   * @param requestedPage The id of the request: the page number of a page
+   * fetch.
+   * @param wireBytes Body size as transferred.
+   * @param decodedBytes Body size after decompression.
+   * @param http2 True if the response came over HTTP/2.
+   */
+  void pageTransferred(int requestedPage, qint64 wireBytes,
+                       qint64 decodedBytes, bool http2);
+  /** @brief Emitted when a new TLS connection has been established. */
+  void connectionEncrypted();
+  /**
+   * @brief Emitted when a request could not be sent at all.
    * @param errorString A description of the error.
-   * @param httpStatusCode The HTTP status code (e.g., 404, 500), or 0 if not an
-   * HTTP error.
+   * @param httpStatusCode Always 0.
+   * @param apiErrorCode Always 0.
+   * @param requestedPage The id of the request: the page number of a page
+   * fetch.
+   * @param generation The generation passed to doFetch().
    */
-  void errorOccurred(const QString &errorString, int httpStatusCode);
+  void errorOccurred(const QString &errorString, int httpStatusCode,
+                     int apiErrorCode, int requestedPage, int generation);
   /**
    * @brief Emitted when the processing for a single fetch request (doFetch
    * call) is finished, regardless of success or failure.
@@ -228,24 +772,109 @@ signals:
 private slots:
   /**
    * @brief Slot connected to the QNetworkReply's finished signal.
-   * @details Reads the response, parses JSON, extracts data or errors, and
-   * emits appropriate signals (resultReady or errorOccurred).
+   * @details Reads the status and body and emits replyReceived.
    * @param reply The QNetworkReply that has finished.
+   * @param page The page number that was requested.
+   * @param generation The generation passed to doFetch().
+   * @param cacheKey Passed on with replyReceived.
    */
-  void onReplyFinished(QNetworkReply *reply);
+  void onReplyFinished(QNetworkReply *reply, int page, int generation,
+                       const QString &cacheKey);
 
 private:
   QNetworkAccessManager
       m_networkManager; /**< @brief Manages network requests for this worker. */
-  const QString API_BASE_URL =
-      "http://ws.audioscrobbler.com/2.0/"; /**< @brief Base URL for Last.fm API
-                                              v2. */
-  const int FETCH_LIMIT = 200; /**< @brief Number of tracks to request per page
-                                  (max allowed by API). */
-  int m_requestedPage =
-      0; /**< @brief The page number requested in the current doFetch call. */
-  qint64 m_requestedFromTimestamp =
-      0; /**< @brief The 'from' timestamp used in the current doFetch call. */
+  QString m_apiBaseUrl = QString::fromLatin1(
+      LastFmManager::DEFAULT_API_BASE_URL); /**< @brief Endpoint requests are
+                                               sent to. */
+  QSharedPointer<ResponseCache>
+      m_responseCache; /**< @brief Consulted before the network, or null. */
+  QAtomicInteger<qint64> m_busyNs; /**< @brief Time spent working. */
+};
+
+/**
+ * @class LastFmParser
+ * @brief Parse stage of the fetch pipeline: turns response bodies into
+ * scrobble pages or errors.
+ * @details Each parser of LastFmManager's pool runs within its own thread,
+ * between the network worker and the manager.
+ * @inherits QObject
+ */
+class LastFmParser : public QObject {
+  Q_OBJECT
+public:
+  /**
+   * @brief Constructs a LastFmParser instance.
+   * @param parent The parent QObject, defaults to nullptr.
+   */
+  explicit LastFmParser(QObject *parent = nullptr);
+  /**
+   * @brief Counts a response queued for parseReply().
+   * @note Thread-safe; called on the network thread.
+   */
+  void noteReplyQueued() { m_pendingReplies.ref(); }
+  /**
+   * @brief Returns the number of responses queued but not yet parsed.
+   * @note Thread-safe.
+   */
+  int pendingReplies() const { return m_pendingReplies.loadRelaxed(); }
+  /**
+   * @brief Returns the time spent in parseReply() so far.
+   * @note Thread-safe.
+   */
+  qint64 busyNsecs() const { return m_busyNs.loadRelaxed(); }
+public slots:
+  /**
+   * @brief Sets the cache successfully parsed responses are stored in.
+   * @note This slot is executed in the parser thread.
+   * @param cache The response cache, or null for none.
+   */
+  void setResponseCache(QSharedPointer<ResponseCache> cache);
+  /**
+   * @brief Parses one response and emits resultReady or errorOccurred.
+   * @note This slot is executed in the parser thread.
+   * @param body The raw response body.
+   * @param httpStatusCode The HTTP status code, or 0 if there was none.
+   * @param networkError Description of a network error, empty if none.
+   * @param requestedPage The id of the request: the page number of a page
+   * fetch.
+   * @param generation The generation the request was sent with.
+   * @param cacheKey Key to store the body under if it holds a page, or
+   * empty.
+   */
+  void parseReply(const QByteArray &body, int httpStatusCode,
+                  const QString &networkError, int requestedPage,
+                  int generation, const QString &cacheKey);
+signals:
+  /**
+   * @brief Emitted when a response held a page of scrobbles.
+   * @param scrobbles The list of ScrobbleData extracted from the page.
+   * @param totalPages The total number of pages reported by the API response.
+   * @param currentPage The page number reported by the API response.
+   * @param requestedPage The id of the request: the page number of a page
+   * fetch.
+   * @param generation The generation the request was sent with.
+   */
+  void resultReady(const QList<ScrobbleData> &scrobbles, int totalPages,
+                   int currentPage, int requestedPage, int generation);
+  /**
+   * @brief Emitted when a response is an error or cannot be parsed.
+   * @param errorString A description of the error.
+   * @param httpStatusCode The HTTP status code (e.g., 404, 500), or 0 if not an
+   * HTTP error.
+   * @param apiErrorCode The Last.fm `error` code of the response body, or 0.
+   * @param requestedPage The id of the request: the page number of a page
+   * fetch.
+   * @param generation The generation the request was sent with.
+   */
+  void errorOccurred(const QString &errorString, int httpStatusCode,
+                     int apiErrorCode, int requestedPage, int generation);
+
+private:
+  QAtomicInt m_pendingReplies; /**< @brief Responses waiting to be parsed. */
+  QSharedPointer<ResponseCache>
+      m_responseCache; /**< @brief Receives parsed responses, or null. */
+  QAtomicInteger<qint64> m_busyNs; /**< @brief Time spent parsing. */
 };
 
 #endif // LASTFMMANAGER_H
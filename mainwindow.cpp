@@ -13,12 +13,15 @@
 #include <QDateTime>
 #include <QDebug>
 #include <QDesktopServices>
+#include <QDir>
+#include <QFileDialog>
 #include <QHeaderView>
 #include <QInputDialog>
 #include <QLineEdit>
 #include <QMessageBox>
 #include <QMetaType>
 #include <QPushButton>
+#include <QStandardPaths>
 #include <QThread>
 #include <QTimer>
 #include <QUrl>
@@ -33,6 +36,87 @@
 #include <QtCharts/QLineSeries>
 #include <QtCharts/QValueAxis>
 
+namespace {
+/**
+ * @brief Shows bar values in a chart, updating its series in place.
+ * @details The first call with values creates the series, bar set and axes.
+ * Later calls replace only the values that changed, grow or shrink the bar
+ * set, and touch the axes only when the categories or the maximum changed,
+ * so a refresh animates from the previous bars instead of rebuilding the
+ * chart.
+ * @param chart The chart.
+ * @param categories Category labels, one per value.
+ * @param values Bar heights; empty clears the chart.
+ * @param setLabel Label of the bar set.
+ * @param xTitle Title of the category axis, or empty.
+ * @param yTitle Title of the value axis.
+ */
+void setBarChartValues(QChart *chart, const QStringList &categories,
+                       const QList<int> &values, const QString &setLabel,
+                       const QString &xTitle, const QString &yTitle) {
+  QBarSeries *series =
+      chart->series().isEmpty()
+          ? nullptr
+          : qobject_cast<QBarSeries *>(chart->series().constFirst());
+  QBarSet *set = nullptr;
+  QBarCategoryAxis *axX = nullptr;
+  QValueAxis *axY = nullptr;
+  if (series) {
+    if (!series->barSets().isEmpty())
+      set = series->barSets().constFirst();
+    for (QAbstractAxis *axis : series->attachedAxes()) {
+      if (!axX)
+        axX = qobject_cast<QBarCategoryAxis *>(axis);
+      if (!axY)
+        axY = qobject_cast<QValueAxis *>(axis);
+    }
+  }
+  if (!series || !set || !axX || !axY) {
+    if (values.isEmpty())
+      return;
+    chart->removeAllSeries();
+    const QList<QAbstractAxis *> axes = chart->axes();
+    for (QAbstractAxis *axis : axes)
+      chart->removeAxis(axis);
+    qDeleteAll(axes);
+    series = new QBarSeries(chart);
+    set = new QBarSet(setLabel);
+    series->append(set);
+    chart->addSeries(series);
+    chart->setAnimationOptions(QChart::SeriesAnimations);
+    axX = new QBarCategoryAxis(chart);
+    axX->setTitleText(xTitle);
+    chart->addAxis(axX, Qt::AlignBottom);
+    series->attachAxis(axX);
+    axY = new QValueAxis(chart);
+    axY->setLabelFormat("%d");
+    axY->setTitleText(yTitle);
+    chart->addAxis(axY, Qt::AlignLeft);
+    series->attachAxis(axY);
+    chart->legend()->setVisible(false);
+  }
+
+  if (axX->categories() != categories)
+    axX->setCategories(categories);
+  const int shared = qMin<int>(set->count(), values.size());
+  for (int i = 0; i < shared; ++i) {
+    if (set->at(i) != values[i])
+      set->replace(i, values[i]);
+  }
+  if (set->count() > values.size())
+    set->remove(values.size(), set->count() - values.size());
+  for (int i = shared; i < values.size(); ++i)
+    set->append(values[i]);
+
+  int maxV = 0;
+  for (int value : values)
+    maxV = qMax(maxV, value);
+  const qreal top = maxV > 0 ? maxV * 1.1 : 10;
+  if (axY->min() != 0 || !qFuzzyCompare(axY->max(), top))
+    axY->setRange(0, top);
+}
+} // namespace
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent), ui(new Ui::MainWindow), m_fetchingComplete(false),
       m_expectedTotalPages(0), m_lastSuccessfullySavedPage(0),
@@ -56,6 +140,23 @@ MainWindow::MainWindow(QWidget *parent)
   } else {
     qWarning() << "Could not find fetchButton on About page!";
   }
+  QPushButton *verifyBtn =
+      aboutPage ? aboutPage->findChild<QPushButton *>("verifyHistoryButton")
+                : nullptr;
+  if (verifyBtn) {
+    connect(verifyBtn, &QPushButton::clicked, this, &MainWindow::verifyHistory);
+  } else {
+    qWarning() << "Could not find verifyHistoryButton on About page!";
+  }
+  QPushButton *exportBtn =
+      aboutPage ? aboutPage->findChild<QPushButton *>("exportJsonButton")
+                : nullptr;
+  if (exportBtn) {
+    connect(exportBtn, &QPushButton::clicked, this,
+            &MainWindow::exportScrobblesToJson);
+  } else {
+    qWarning() << "Could not find exportJsonButton on About page!";
+  }
   QPushButton *settingsBtn =
       aboutPage ? aboutPage->findChild<QPushButton *>("settingsButton")
                 : nullptr;
@@ -86,8 +187,19 @@ MainWindow::MainWindow(QWidget *parent)
     qWarning() << "Could not find findLastPlayedButton during setup!";
   }
 
-  connect(&m_lastFmManager, &LastFmManager::pageReadyForSaving, this,
-          &MainWindow::handleSavePageOfScrobbles);
+  // Fetched pages go from the parser threads straight into the save queue;
+  // only progress and completion reach the GUI thread.
+  connect(&m_lastFmManager, &LastFmManager::pageReadyForSaving,
+          &m_databaseManager, &DatabaseManager::saveScrobblesAsync,
+          Qt::DirectConnection);
+  connect(&m_lastFmManager, &LastFmManager::backfillPageReady,
+          &m_databaseManager, &DatabaseManager::saveScrobblesAsync,
+          Qt::DirectConnection);
+  connect(&m_lastFmManager, &LastFmManager::importWindowReady,
+          &m_databaseManager, &DatabaseManager::saveScrobblesAsync,
+          Qt::DirectConnection);
+  connect(&m_lastFmManager, &LastFmManager::importRangeDetermined, this,
+          &MainWindow::handleImportRangeDetermined);
   connect(&m_lastFmManager, &LastFmManager::totalPagesDetermined, this,
           &MainWindow::handleTotalPagesDetermined);
   connect(&m_lastFmManager, &LastFmManager::fetchFinished, this,
@@ -98,12 +210,25 @@ MainWindow::MainWindow(QWidget *parent)
           &MainWindow::handlePageSaveComplete);
   connect(&m_databaseManager, &DatabaseManager::pageSaveFailed, this,
           &MainWindow::handlePageSaveFailed);
-  connect(&m_databaseManager, &DatabaseManager::loadComplete, this,
+  connect(&m_databaseManager, &DatabaseManager::saveQueueIdle, this,
+          &MainWindow::checkOverallCompletion);
+  connect(&m_databaseManager, &DatabaseManager::scrobblesSaved, this,
+          &MainWindow::handleScrobblesSaved);
+  connect(&m_databaseManager, &DatabaseManager::saveQueueDepthChanged,
+          &m_lastFmManager, &LastFmManager::setDownstreamDepth);
+  m_lastFmManager.setResponseCache(
+      QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+      "/responses");
+  connect(&m_databaseManager, &DatabaseManager::storeOpened, this,
           &MainWindow::handleDbLoadComplete);
+  connect(&m_databaseManager, &DatabaseManager::snapshotLoaded, this,
+          &MainWindow::handleSnapshotLoaded);
   connect(&m_databaseManager, &DatabaseManager::loadError, this,
           &MainWindow::handleDbLoadError);
   connect(&m_databaseManager, &DatabaseManager::statusMessage, this,
           &MainWindow::handleDbStatusUpdate);
+  connect(&m_databaseManager, &DatabaseManager::exportFinished, this,
+          &MainWindow::handleExportFinished);
 
   connect(&m_analysisWatcher, &QFutureWatcher<AnalysisResults>::finished, this,
           &MainWindow::handleAnalysisComplete);
@@ -115,7 +240,15 @@ MainWindow::MainWindow(QWidget *parent)
   promptForSettings();
 }
 
-MainWindow::~MainWindow() { delete ui; }
+MainWindow::~MainWindow() {
+  // The parser threads call straight into the save queue: cut them off,
+  // release any of them blocked on a full queue, and stop them before the
+  // members go away.
+  disconnect(&m_lastFmManager, nullptr, &m_databaseManager, nullptr);
+  m_databaseManager.shutdown();
+  m_lastFmManager.shutdown();
+  delete ui;
+}
 
 void MainWindow::updateStatusBarState() {
   QString message = "Ready.";
@@ -152,7 +285,7 @@ void MainWindow::updateStatusBarState() {
 
   if (m_findLastPlayedButton)
     m_findLastPlayedButton->setEnabled(m_currentState == AppState::Idle &&
-                                       !m_loadedScrobbles.isEmpty());
+                                       hasLoadedScrobbles());
 }
 
 void MainWindow::setupPages() {
@@ -199,27 +332,64 @@ void MainWindow::setupPages() {
   Ui::DatabaseTablePage ui_dt;
   databaseTablePage = new QWidget();
   ui_dt.setupUi(databaseTablePage);
-  m_dbTableWidget = ui_dt.dbTableWidget;
+  m_dbTableView = ui_dt.dbTableView;
+  m_dbFilterEdit = ui_dt.dbFilterLineEdit;
+  m_dbTableModel = new ScrobbleTableModel(this);
+  m_dbProxyModel = new ScrobbleSortFilterProxyModel(this);
+  m_dbProxyModel->setSourceModel(m_dbTableModel);
+  if (m_dbTableView) {
+    m_dbTableView->setModel(m_dbProxyModel);
+    // Fixed row heights let the view place any of a million rows without
+    // measuring the rows above it.
+    QHeaderView *rows = m_dbTableView->verticalHeader();
+    rows->setSectionResizeMode(QHeaderView::Fixed);
+    rows->setDefaultSectionSize(m_dbTableView->fontMetrics().height() + 6);
+    m_dbTableView->horizontalHeader()->setSectionResizeMode(
+        QHeaderView::Interactive);
+    m_dbTableView->setColumnWidth(ScrobbleTableModel::DateColumn, 130);
+    m_dbTableView->setColumnWidth(ScrobbleTableModel::ArtistColumn, 180);
+    m_dbTableView->setColumnWidth(ScrobbleTableModel::TrackColumn, 220);
+    m_dbTableView->setSortingEnabled(true);
+    m_dbTableView->sortByColumn(ScrobbleTableModel::DateColumn,
+                                Qt::DescendingOrder);
+  }
+  if (m_dbFilterEdit) {
+    connect(m_dbFilterEdit, &QLineEdit::textChanged, m_dbProxyModel,
+            &ScrobbleSortFilterProxyModel::setFilterText);
+  }
+  connect(m_dbProxyModel, &ScrobbleSortFilterProxyModel::busyChanged, this,
+          [this](bool busy) {
+            if (busy)
+              ui->statusbar->showMessage("Sorting history...", 2000);
+          });
   Ui::ArtistsPage ui_a;
   artistsPage = new QWidget();
   ui_a.setupUi(artistsPage);
-  m_artistListWidget = ui_a.artistListWidget;
-  if (m_artistListWidget) {
-    connect(m_artistListWidget, &QListWidget::itemDoubleClicked, this,
+  m_artistListView = ui_a.artistListView;
+  m_artistsModel = new RankedCountsModel(this);
+  m_artistsModel->setPlaceholderText("(No data loaded)");
+  if (m_artistListView) {
+    m_artistListView->setModel(m_artistsModel);
+    m_artistListView->setUniformItemSizes(true);
+    connect(m_artistListView, &QListView::doubleClicked, this,
             &MainWindow::onArtistItemDoubleClicked);
   } else {
-    qWarning() << "m_artistListWidget is null during connection setup!";
+    qWarning() << "m_artistListView is null during connection setup!";
   }
 
   Ui::TracksPage ui_t;
   tracksPage = new QWidget();
   ui_t.setupUi(tracksPage);
-  m_trackListWidget = ui_t.trackListWidget;
-  if (m_trackListWidget) {
-    connect(m_trackListWidget, &QListWidget::itemDoubleClicked, this,
+  m_trackListView = ui_t.trackListView;
+  m_tracksModel = new RankedCountsModel(this);
+  m_tracksModel->setPlaceholderText("(No data loaded)");
+  if (m_trackListView) {
+    m_trackListView->setModel(m_tracksModel);
+    m_trackListView->setUniformItemSizes(true);
+    connect(m_trackListView, &QListView::doubleClicked, this,
             &MainWindow::onTrackItemDoubleClicked);
   } else {
-    qWarning() << "m_trackListWidget is null during connection setup!";
+    qWarning() << "m_trackListView is null during connection setup!";
   }
 
   Ui::ChartsPage ui_c;
@@ -283,20 +453,14 @@ void MainWindow::setupMenu() {
   ui->menuListWidget->setCurrentRow(0);
 }
 
-void MainWindow::onArtistItemDoubleClicked(QListWidgetItem *item) {
-  if (!item)
-    return;
-
-  QString itemText = item->text();
-  int lastParen = itemText.lastIndexOf('(');
-  if (lastParen == -1) {
-    qWarning() << "Could not parse artist item text:" << itemText;
+void MainWindow::onArtistItemDoubleClicked(const QModelIndex &index) {
+  if (!index.isValid())
     return;
-  }
 
-  QString artistName = itemText.left(lastParen).trimmed();
+  QString artistName =
+      index.data(RankedCountsModel::NameRole).toString().trimmed();
   if (artistName.isEmpty()) {
-    qWarning() << "Parsed empty artist name from:" << itemText;
+    qWarning() << "No artist name for item:" << index.data().toString();
     return;
   }
 
@@ -313,20 +477,17 @@ void MainWindow::onArtistItemDoubleClicked(QListWidgetItem *item) {
   }
 }
 
-void MainWindow::onTrackItemDoubleClicked(QListWidgetItem *item) {
-  if (!item)
+void MainWindow::onTrackItemDoubleClicked(const QModelIndex &index) {
+  if (!index.isValid())
     return;
 
-  QString itemText = item->text();
-
-  int lastParen = itemText.lastIndexOf('(');
-  if (lastParen == -1) {
-    qWarning() << "Could not parse track item text (parenthesis):" << itemText;
+  QString fullTrackInfo =
+      index.data(RankedCountsModel::NameRole).toString().trimmed();
+  if (fullTrackInfo.isEmpty()) {
+    qWarning() << "No track name for item:" << index.data().toString();
     return;
   }
 
-  QString fullTrackInfo = itemText.left(lastParen).trimmed();
-
   int separatorPos = fullTrackInfo.indexOf(" - ");
   if (separatorPos <= 0 || separatorPos >= fullTrackInfo.length() - 3) {
     qWarning() << "Could not parse track item text (separator ' - '):"
@@ -405,14 +566,17 @@ void MainWindow::promptForSettings() {
     qInfo() << "[Main Window] Calling LastFmManager::setup with API Key:"
             << (apiKey.isEmpty() ? "EMPTY" : "SET") << "Username:" << username;
     m_lastFmManager.setup(apiKey, username);
+    m_lastFmManager.setMaxPagesInFlight(m_settingsManager.maxPagesInFlight());
+    m_lastFmManager.setApiBaseUrl(m_settingsManager.apiBaseUrl());
 
     onMenuItemChanged(ui->menuListWidget->currentItem(), nullptr);
   } else {
     ui->profileNameLabel->setText("<Required>");
     if (m_currentUserLabel)
       m_currentUserLabel->setText("<Not Set>");
-    m_loadedScrobbles.clear();
+    releaseScrobbleStore();
     m_cachedAnalysisResults.clear();
+    invalidateIncrementalAnalytics();
     updateUiWithAnalysisResults(AnalysisResults());
   }
 }
@@ -459,11 +623,14 @@ void MainWindow::setupUser() {
         << (currentApiKey.isEmpty() ? "EMPTY" : "SET")
         << "Username:" << currentUsername;
     m_lastFmManager.setup(currentApiKey, currentUsername);
+    m_lastFmManager.setMaxPagesInFlight(m_settingsManager.maxPagesInFlight());
+    m_lastFmManager.setApiBaseUrl(m_settingsManager.apiBaseUrl());
     QMessageBox::information(
         this, "Settings Updated",
         "Settings updated. Fetch if needed.\nData cleared.");
-    m_loadedScrobbles.clear();
+    releaseScrobbleStore();
     m_cachedAnalysisResults.clear();
+    invalidateIncrementalAnalytics();
     if (userChanged) {
       m_settingsManager.setInitialFetchComplete(false);
       m_settingsManager.clearResumeState();
@@ -492,7 +659,14 @@ void MainWindow::fetchNewScrobbles() {
   }
 
   m_fetchingComplete = false;
+  // Unmap the week files so the save task can replace them (Windows refuses
+  // to rename over a mapped file). The store is reopened after the sync.
+  releaseScrobbleStore();
   bool isUpdate = m_settingsManager.isInitialFetchComplete();
+  if (!isUpdate) {
+    // Resumed full fetches may overlap the stored pages; recompute after.
+    invalidateIncrementalAnalytics();
+  }
   qInfo() << "================ FETCH TRIGGERED ================";
   if (isUpdate) {
     qint64 startTimestamp = m_databaseManager.getLastSyncTimestamp(username);
@@ -503,19 +677,80 @@ void MainWindow::fetchNewScrobbles() {
     m_lastSuccessfullySavedPage = 0;
     m_lastFmManager.fetchScrobblesSince(startTimestamp);
   } else {
-    m_lastSuccessfullySavedPage =
-        m_settingsManager.loadLastSuccessfullySavedPage();
-    m_expectedTotalPages = m_settingsManager.loadExpectedTotalPages();
-    int startPage = m_lastSuccessfullySavedPage + 1;
+    m_windowedImport = true;
+    m_completedImportWindows = m_settingsManager.completedImportWindows();
+    m_importWindowCount = 0;
     m_currentState = AppState::FetchingApi;
     updateStatusBarState();
-    qInfo() << "Mode: Full Fetch/Resume from page" << startPage
-            << "(Known Total:" << m_expectedTotalPages << ")";
-    m_lastFmManager.startInitialOrResumeFetch(startPage, m_expectedTotalPages);
+    qInfo() << "Mode: Windowed Import/Resume with"
+            << m_completedImportWindows.size() << "windows saved";
+    m_lastFmManager.startWindowedImport(m_settingsManager.importRangeStart(),
+                                        m_settingsManager.importRangeEnd(),
+                                        m_completedImportWindows);
   }
   qInfo() << "==================================================";
 }
 
+void MainWindow::verifyHistory() {
+  if (m_currentState != AppState::Idle) {
+    QMessageBox::warning(this, "Busy", "Operation already in progress.");
+    return;
+  }
+  QString username = m_settingsManager.username();
+  QString apiKey = m_settingsManager.apiKey();
+  if (username.isEmpty() || apiKey.isEmpty()) {
+    QMessageBox::warning(this, "Setup", "Set Username/API Key first.");
+    promptForSettings();
+    return;
+  }
+  const QMap<qint64, int> weekCounts =
+      m_databaseManager.getWeekCounts(username);
+  if (weekCounts.isEmpty()) {
+    QMessageBox::information(this, "Verify History",
+                             "No stored scrobbles yet. Fetch first.");
+    return;
+  }
+
+  m_fetchingComplete = false;
+  m_verifyingHistory = true;
+  releaseScrobbleStore();
+  // Backfilled scrobbles land anywhere in the history; recompute after.
+  invalidateIncrementalAnalytics();
+  qint64 endUts = m_databaseManager.getLastSyncTimestamp(username) + 1;
+  m_currentState = AppState::FetchingApi;
+  updateStatusBarState();
+  qInfo() << "================ VERIFY TRIGGERED ================";
+  m_lastFmManager.verifyHistory(weekCounts, endUts);
+}
+
+void MainWindow::exportScrobblesToJson() {
+  if (m_currentState != AppState::Idle) {
+    QMessageBox::warning(this, "Busy", "Operation already in progress.");
+    return;
+  }
+  QString username = m_settingsManager.username();
+  if (username.isEmpty()) {
+    QMessageBox::warning(this, "Setup", "Set Username/API Key first.");
+    return;
+  }
+  QString targetDir = QFileDialog::getExistingDirectory(
+      this, "Export Scrobbles as JSON", QDir::homePath());
+  if (targetDir.isEmpty())
+    return;
+  qInfo() << "Exporting scrobbles for" << username << "to" << targetDir;
+  m_databaseManager.exportToJsonAsync(username, targetDir);
+}
+
+void MainWindow::handleExportFinished(bool success, const QString &message) {
+  if (success) {
+    ui->statusbar->showMessage("Export complete.", 5000);
+    QMessageBox::information(this, "Export Complete", message);
+  } else {
+    qWarning() << "JSON export failed:" << message;
+    QMessageBox::critical(this, "Export Error", message);
+  }
+}
+
 void MainWindow::onMenuItemChanged(QListWidgetItem *current,
                                    QListWidgetItem *previous) {
   Q_UNUSED(previous);
@@ -527,7 +762,7 @@ void MainWindow::onMenuItemChanged(QListWidgetItem *current,
     ui->selectedTabLabel->setText("Selected: " + current->text());
     ui->stackedWidget->setCurrentIndex(index);
 
-    if (!m_loadedScrobbles.isEmpty()) {
+    if (hasLoadedScrobbles()) {
 
       if (m_cachedAnalysisResults.isEmpty() ||
           m_currentState == AppState::Analyzing) {
@@ -551,7 +786,7 @@ void MainWindow::onMenuItemChanged(QListWidgetItem *current,
           m_currentState = AppState::LoadingDb;
           updateStatusBarState();
 
-          m_databaseManager.loadAllScrobblesAsync(username);
+          m_databaseManager.loadSnapshotAsync(username);
 
         } else {
           qDebug() << "Cannot load data: No username set.";
@@ -566,25 +801,25 @@ void MainWindow::onMenuItemChanged(QListWidgetItem *current,
   }
 }
 
-void MainWindow::handleSavePageOfScrobbles(
-    const QList<ScrobbleData> &pageScrobbles, int pageNumber) {
-  qDebug() << QDateTime::currentDateTime().toString("hh:mm:ss.zzz")
-           << "- [Main] Rcvd pageReady: Page" << pageNumber
-           << ", Size:" << pageScrobbles.count();
-  if (!pageScrobbles.isEmpty()) {
-    qDebug() << "[Main] Calling DB saveAsync page" << pageNumber;
-    m_databaseManager.saveScrobblesAsync(
-        pageNumber, m_settingsManager.username(), pageScrobbles);
-  } else if (!m_settingsManager.isInitialFetchComplete()) {
-    qWarning() << "[Main] Empty Page" << pageNumber
-               << " during initial fetch. Simulating completion.";
-    handlePageSaveComplete(pageNumber);
-  } else {
-    qDebug() << "[Main] Empty Page" << pageNumber
-             << " during update, skipping save call.";
+void MainWindow::handleScrobblesSaved(const QString &username,
+                                      const QList<ScrobbleData> &scrobbles) {
+  qDebug() << "[Main] Saved" << scrobbles.count() << "scrobbles of"
+           << username;
+  if (m_incrementalAnalytics && username == m_settingsManager.username()) {
+    int counted = m_incrementalAnalytics->apply(scrobbles);
+    qDebug() << "[Main] Applied" << counted
+             << "new scrobbles to the retained analysis.";
   }
 }
 
+void MainWindow::handleImportRangeDetermined(qint64 startUts,
+                                             qint64 endUts) {
+  m_importWindowCount = LastFmManager::importWindowCount(startUts, endUts);
+  qInfo() << "[Main] Import range" << startUts << "-" << endUts << "in"
+          << m_importWindowCount << "windows.";
+  m_settingsManager.saveImportRange(startUts, endUts);
+}
+
 void MainWindow::handleTotalPagesDetermined(int totalPages) {
   qInfo() << "[Main] Total pages determined:" << totalPages;
   if (m_expectedTotalPages <= 0 || totalPages != m_expectedTotalPages) {
@@ -607,9 +842,19 @@ void MainWindow::handleApiError(const QString &errorString) {
   qWarning() << QDateTime::currentDateTime().toString("hh:mm:ss.zzz")
              << "- [Main] API Error:" << errorString;
   m_fetchingComplete = true;
+  m_windowedImport = false;
   m_currentState = AppState::Idle;
   updateStatusBarState();
-
+  invalidateIncrementalAnalytics();
+
+  if (m_verifyingHistory) {
+    // Whatever was backfilled is kept; the stored history is no less
+    // complete than before.
+    m_verifyingHistory = false;
+    ui->statusbar->showMessage("API Error.", 5000);
+    QMessageBox::critical(this, "API Error", errorString);
+    return;
+  }
   m_settingsManager.setInitialFetchComplete(false);
   qWarning() << "API Error: Marked initial fetch as incomplete.";
   ui->statusbar->showMessage("API Error.", 5000);
@@ -619,6 +864,17 @@ void MainWindow::handleApiError(const QString &errorString) {
 void MainWindow::handlePageSaveComplete(int pageNumber) {
   qDebug() << QDateTime::currentDateTime().toString("hh:mm:ss.zzz")
            << "- [Main] DB Save Complete: Page" << pageNumber;
+  qDebug() << "[Main] Pipeline depths: fetching"
+           << m_lastFmManager.pagesInFlight() << "| parsing"
+           << m_lastFmManager.pagesAwaitingParse() << "| ordering"
+           << m_lastFmManager.pagesAwaitingOrder() << "| saving"
+           << m_databaseManager.saveQueueDepth();
+  if (m_windowedImport) {
+    m_completedImportWindows.insert(pageNumber);
+    m_settingsManager.markImportWindowComplete(pageNumber);
+    checkOverallCompletion();
+    return;
+  }
   m_lastSuccessfullySavedPage = qMax(m_lastSuccessfullySavedPage, pageNumber);
   if (!m_settingsManager.isInitialFetchComplete()) {
     m_settingsManager.saveLastSuccessfullySavedPage(
@@ -633,8 +889,11 @@ void MainWindow::handlePageSaveFailed(int pageNumber, const QString &error) {
              << "- [Main] DB Save FAILED: Page" << pageNumber
              << "Err:" << error;
   m_fetchingComplete = true;
+  m_verifyingHistory = false;
+  m_windowedImport = false;
   m_currentState = AppState::Idle;
   updateStatusBarState();
+  invalidateIncrementalAnalytics();
 
   m_settingsManager.setInitialFetchComplete(false);
   qWarning() << "DB Save Error: Marked initial fetch as incomplete.";
@@ -663,7 +922,34 @@ void MainWindow::checkOverallCompletion() {
         ui->statusbar->currentMessage().contains("Error", Qt::CaseInsensitive);
     bool wasInitial = !m_settingsManager.isInitialFetchComplete();
     if (!hadError) {
-      if (wasInitial) {
+      if (m_verifyingHistory) {
+        // Every window up to the last sync now matches Last.fm, so an
+        // interrupted import needs no resume.
+        const HistoryVerifier::Summary summary =
+            m_lastFmManager.verificationSummary();
+        qInfo() << "History verified, backfilled" << summary.gapWindows
+                << "windows.";
+        m_settingsManager.setInitialFetchComplete(true);
+        m_settingsManager.clearResumeState();
+        ui->statusbar->showMessage(
+            QString("History verified: %1 missing scrobbles in %2 windows "
+                    "fetched.")
+                .arg(summary.missingScrobbles)
+                .arg(summary.gapWindows),
+            10000);
+      } else if (wasInitial && m_windowedImport) {
+        if (m_completedImportWindows.size() >= m_importWindowCount) {
+          qInfo() << "Windowed import fully completed:" << m_importWindowCount
+                  << "windows.";
+          m_settingsManager.setInitialFetchComplete(true);
+          m_settingsManager.clearResumeState();
+        } else {
+          qWarning() << "Import finished but incomplete! Saved:"
+                     << m_completedImportWindows.size()
+                     << "windows of" << m_importWindowCount;
+          m_settingsManager.setInitialFetchComplete(false);
+        }
+      } else if (wasInitial) {
         if (m_expectedTotalPages > 0 &&
             m_lastSuccessfullySavedPage >= m_expectedTotalPages) {
           qInfo() << "Initial fetch fully completed.";
@@ -680,11 +966,23 @@ void MainWindow::checkOverallCompletion() {
       }
     } else {
     }
-
-    qInfo() << "Reloading data after fetch/save completion.";
-    m_loadedScrobbles.clear();
-    m_cachedAnalysisResults.clear();
-    m_databaseManager.loadAllScrobblesAsync(m_settingsManager.username());
+    m_verifyingHistory = false;
+    m_windowedImport = false;
+
+    releaseScrobbleStore();
+    if (m_incrementalAnalytics && !wasInitial && !hadError) {
+      // The fetched pages were already applied as they were saved; only the
+      // store is reopened (for the table and lookups), not reanalyzed.
+      qInfo() << "Updating analysis incrementally after fetch/save completion.";
+      m_cachedAnalysisResults =
+          m_analyticsEngine.analyzeAll(*m_incrementalAnalytics, 100);
+      m_resultsCurrent = true;
+    } else {
+      qInfo() << "Reloading data after fetch/save completion.";
+      invalidateIncrementalAnalytics();
+      m_cachedAnalysisResults.clear();
+    }
+    m_databaseManager.openStoreAsync(m_settingsManager.username());
 
   } else if (m_fetchingComplete && !savingDone) {
     qDebug() << QDateTime::currentDateTime().toString("hh:mm:ss.zzz")
@@ -699,21 +997,33 @@ void MainWindow::checkOverallCompletion() {
   }
 }
 
-void MainWindow::handleDbLoadComplete(const QList<ScrobbleData> &scrobbles) {
-  qInfo() << "Database load complete, Scrobble count:" << scrobbles.count();
-  m_loadedScrobbles = scrobbles;
-  m_cachedAnalysisResults.clear();
+void MainWindow::handleDbLoadComplete(
+    QSharedPointer<const ScrobbleStore> store) {
+  qInfo() << "Database load complete, Scrobble count:" << store->size();
+  m_scrobbleStore = store;
 
-  if (m_currentState == AppState::LoadingDb ||
-      m_currentState == AppState::SavingDb ||
-      m_currentState == AppState::FetchingApi) {
-    startAnalysisTask();
-  } else if (m_currentState == AppState::Idle) {
+  if (m_resultsCurrent) {
+    m_resultsCurrent = false;
+    m_currentState = AppState::Idle;
+    updateStatusBarState();
+    updateUiWithAnalysisResults(m_cachedAnalysisResults);
+    // Scrobbles were added since the state was rebuilt or restored.
+    if (m_incrementalAnalytics && m_incrementalAnalytics->lastUts() !=
+                                      m_incrementalAnalytics->watermark())
+      saveAnalyticsSnapshot();
+  } else {
+    m_cachedAnalysisResults.clear();
+    if (m_currentState == AppState::LoadingDb ||
+        m_currentState == AppState::SavingDb ||
+        m_currentState == AppState::FetchingApi) {
+      startAnalysisTask();
+    } else if (m_currentState == AppState::Idle) {
 
-    startAnalysisTask();
+      startAnalysisTask();
+    }
   }
 
-  if (!m_settingsManager.isInitialFetchComplete() && !scrobbles.isEmpty()) {
+  if (!m_settingsManager.isInitialFetchComplete() && !store->isEmpty()) {
     qWarning() << "Loaded data, but initial full fetch may be incomplete.";
     QTimer::singleShot(5100, this, [this]() {
       if (this->isVisible() && !m_settingsManager.isInitialFetchComplete()) {
@@ -721,15 +1031,17 @@ void MainWindow::handleDbLoadComplete(const QList<ScrobbleData> &scrobbles) {
       }
     });
   } else if (!m_settingsManager.isInitialFetchComplete() &&
-             scrobbles.isEmpty()) {
+             store->isEmpty()) {
     qInfo() << "No data loaded. Initial fetch needed.";
   }
 }
 
 void MainWindow::handleDbLoadError(const QString &error) {
   qWarning() << "Database load error:" << error;
-  m_loadedScrobbles.clear();
+  releaseScrobbleStore();
   m_cachedAnalysisResults.clear();
+  m_resultsCurrent = false;
+  invalidateIncrementalAnalytics();
   m_currentState = AppState::Idle;
   updateStatusBarState();
   updateUiWithAnalysisResults(AnalysisResults());
@@ -741,7 +1053,7 @@ void MainWindow::startAnalysisTask() {
     qDebug() << "Analysis task requested but already running.";
     return;
   }
-  if (m_loadedScrobbles.isEmpty()) {
+  if (!hasLoadedScrobbles()) {
     qWarning() << "Analysis task requested but no data loaded.";
     m_currentState = AppState::Idle;
     updateStatusBarState();
@@ -752,15 +1064,21 @@ void MainWindow::startAnalysisTask() {
   m_currentState = AppState::Analyzing;
   updateStatusBarState();
 
-  QList<ScrobbleData> dataToAnalyze = m_loadedScrobbles;
+  QSharedPointer<const ScrobbleStore> storeToAnalyze = m_scrobbleStore;
   AnalyticsEngine *engine = &m_analyticsEngine;
+  // Rebuilt off the GUI thread and adopted in handleAnalysisComplete(), so
+  // later update fetches can be applied without another full pass.
+  QSharedPointer<IncrementalAnalytics> state =
+      QSharedPointer<IncrementalAnalytics>::create();
+  m_pendingAnalytics = state;
 
   QFuture<AnalysisResults> future =
-      QtConcurrent::run([engine, dataToAnalyze]() {
+      QtConcurrent::run([engine, storeToAnalyze, state]() {
         qDebug() << "[Analysis Task] Starting analysis in thread"
                  << QThread::currentThreadId();
 
-        AnalysisResults results = engine->analyzeAll(dataToAnalyze, 100);
+        state->rebuild(*storeToAnalyze);
+        AnalysisResults results = engine->analyzeAll(*state, 100);
         qDebug() << "[Analysis Task] Analysis finished in thread"
                  << QThread::currentThreadId();
         return results;
@@ -776,10 +1094,50 @@ void MainWindow::handleAnalysisComplete() {
   AnalysisResults results = m_analysisWatcher.result();
   qDebug() << "Analysis complete. Updating UI.";
   m_cachedAnalysisResults = results;
+  m_incrementalAnalytics = m_pendingAnalytics;
+  m_pendingAnalytics.reset();
   m_currentState = AppState::Idle;
   updateStatusBarState();
 
   updateUiWithAnalysisResults(results);
+  saveAnalyticsSnapshot();
+}
+
+void MainWindow::handleSnapshotLoaded(
+    QSharedPointer<IncrementalAnalytics> state) {
+  if (m_currentState != AppState::LoadingDb) {
+    qDebug() << "Analytics snapshot arrived outside a load, ignoring it.";
+    return;
+  }
+  if (state && !state->isEmpty()) {
+    // Show the restored results right away; the store is still opened for
+    // the table, lookups and means, but not reanalyzed.
+    qInfo() << "Showing analysis from the stored snapshot.";
+    m_incrementalAnalytics = state;
+    m_cachedAnalysisResults = m_analyticsEngine.analyzeAll(*state, 100);
+    m_resultsCurrent = true;
+    updateUiWithAnalysisResults(m_cachedAnalysisResults);
+  }
+  m_databaseManager.openStoreAsync(m_settingsManager.username());
+}
+
+void MainWindow::saveAnalyticsSnapshot() {
+  if (!m_incrementalAnalytics || !m_scrobbleStore ||
+      m_incrementalAnalytics->isEmpty())
+    return;
+  // A copy, as later fetched pages are applied to the live state.
+  m_databaseManager.saveSnapshotAsync(
+      m_settingsManager.username(),
+      QSharedPointer<const IncrementalAnalytics>::create(
+          *m_incrementalAnalytics),
+      m_scrobbleStore);
+}
+
+void MainWindow::invalidateIncrementalAnalytics() {
+  if (m_incrementalAnalytics) {
+    qDebug() << "[Main] Dropping retained analysis state.";
+  }
+  m_incrementalAnalytics.reset();
 }
 
 void MainWindow::handleInitialDbLoadComplete() {
@@ -800,7 +1158,7 @@ void MainWindow::updateUiWithAnalysisResults(const AnalysisResults &results) {
     updateGeneralStatsView(results);
     break;
   case 1:
-    updateDatabaseTableView(results);
+    updateDatabaseTableView();
     break;
   case 2:
     updateArtistsView(results);
@@ -822,6 +1180,12 @@ void MainWindow::updateUiWithAnalysisResults(const AnalysisResults &results) {
   updateStatusBarState();
 }
 
+void MainWindow::releaseScrobbleStore() {
+  m_scrobbleStore.reset();
+  if (m_dbTableModel)
+    m_dbTableModel->setStore(nullptr);
+}
+
 void MainWindow::handleDbStatusUpdate(const QString &message) {
   if (message.contains("Error", Qt::CaseInsensitive)) {
     ui->statusbar->showMessage(message);
@@ -835,7 +1199,7 @@ void MainWindow::handleDbStatusUpdate(const QString &message) {
 }
 
 void MainWindow::updateMeanScrobbleCalculation() {
-  if (m_loadedScrobbles.isEmpty() || !m_meanRangeComboBox ||
+  if (!hasLoadedScrobbles() || !m_meanRangeComboBox ||
       !m_meanScrobblesResultLabel) {
     if (m_meanScrobblesResultLabel)
       m_meanScrobblesResultLabel->setText("N/A");
@@ -847,7 +1211,7 @@ void MainWindow::updateMeanScrobbleCalculation() {
   QDateTime toDateUTC;
 
   QDateTime lastScrobbleUTC =
-      m_analyticsEngine.getLastScrobbleDate(m_loadedScrobbles);
+      m_analyticsEngine.getLastScrobbleDate(*m_scrobbleStore);
   if (lastScrobbleUTC.isNull()) {
 
     lastScrobbleUTC = QDateTime::currentDateTimeUtc();
@@ -862,7 +1226,7 @@ void MainWindow::updateMeanScrobbleCalculation() {
   } else if (selectedRange == "Last 90 Days") {
     fromDateUTC = toDateUTC.addDays(-90);
   } else if (selectedRange == "All Time") {
-    fromDateUTC = m_analyticsEngine.getFirstScrobbleDate(m_loadedScrobbles);
+    fromDateUTC = m_analyticsEngine.getFirstScrobbleDate(*m_scrobbleStore);
     if (fromDateUTC.isNull()) {
       m_meanScrobblesResultLabel->setText("Error: No Date Range");
       return;
@@ -877,7 +1241,7 @@ void MainWindow::updateMeanScrobbleCalculation() {
            << toDateUTC.toString(Qt::ISODate);
 
   double mean = m_analyticsEngine.getMeanScrobblesPerDay(
-      m_loadedScrobbles, fromDateUTC, toDateUTC);
+      *m_scrobbleStore, fromDateUTC, toDateUTC);
   m_meanScrobblesResultLabel->setText(QString::number(mean, 'f', 2));
 }
 
@@ -892,7 +1256,7 @@ void MainWindow::findLastPlayedTrack() {
         "<i style='color: red;'>Enter Artist & Track</i>");
     return;
   }
-  if (m_loadedScrobbles.isEmpty()) {
+  if (!hasLoadedScrobbles()) {
     m_lastPlayedResultLabel->setText(
         "<i style='color: orange;'>No data loaded</i>");
     return;
@@ -902,7 +1266,7 @@ void MainWindow::findLastPlayedTrack() {
   QCoreApplication::processEvents();
 
   QDateTime lastPlayedUTC =
-      m_analyticsEngine.findLastPlayed(m_loadedScrobbles, artist, track);
+      m_analyticsEngine.findLastPlayed(*m_scrobbleStore, artist, track);
 
   if (lastPlayedUTC.isValid()) {
     m_lastPlayedResultLabel->setText(
@@ -973,73 +1337,33 @@ void MainWindow::updateGeneralStatsView(const AnalysisResults &results) {
         results.isEmpty() ? "" : m_lastPlayedResultLabel->text());
 }
 
-void MainWindow::updateDatabaseTableView(const AnalysisResults &results) {
-  if (!m_dbTableWidget)
-    return;
-  m_dbTableWidget->setSortingEnabled(false);
-  m_dbTableWidget->clearContents();
-  m_dbTableWidget->setRowCount(0);
-  if (results.isEmpty()) {
-    m_dbTableWidget->setSortingEnabled(true);
+void MainWindow::updateDatabaseTableView() {
+  if (!m_dbTableModel)
     return;
-  }
-
-  SortedCounts sortedArtists =
-      results.value("topArtists").value<SortedCounts>();
-  m_dbTableWidget->setRowCount(sortedArtists.count());
-  for (int row = 0; row < sortedArtists.count(); ++row) {
-    const auto &pair = sortedArtists[row];
-    QTableWidgetItem *iRank = new QTableWidgetItem();
-    iRank->setData(Qt::DisplayRole, row + 1);
-    QTableWidgetItem *iArtist = new QTableWidgetItem(pair.first);
-    QTableWidgetItem *iCount = new QTableWidgetItem();
-    iCount->setData(Qt::DisplayRole, pair.second);
-    m_dbTableWidget->setItem(row, 0, iRank);
-    m_dbTableWidget->setItem(row, 1, iArtist);
-    m_dbTableWidget->setItem(row, 2, iCount);
-  }
-  m_dbTableWidget->resizeColumnsToContents();
-  m_dbTableWidget->horizontalHeader()->setStretchLastSection(true);
-  m_dbTableWidget->setSortingEnabled(true);
+  // Rows are decoded as the view scrolls to them, so showing the whole
+  // history costs nothing up front.
+  m_dbTableModel->setStore(m_scrobbleStore);
 }
 
 void MainWindow::updateArtistsView(const AnalysisResults &results) {
-  if (!m_artistListWidget)
-    return;
-  m_artistListWidget->clear();
-  if (results.isEmpty()) {
-    m_artistListWidget->addItem("(No data loaded)");
+  if (!m_artistsModel)
     return;
-  }
-
-  SortedCounts top = results.value("topArtists").value<SortedCounts>();
-
-  if (top.isEmpty()) {
-    m_artistListWidget->addItem("(No artist data available)");
-  } else {
-    for (const auto &p : top)
-      m_artistListWidget->addItem(
-          QString("%1 (%2)").arg(p.first).arg(p.second));
-  }
+  // The model applies the ranking as a diff, so a refresh after a sync only
+  // touches the artists whose count or rank changed.
+  m_artistsModel->setPlaceholderText(results.isEmpty()
+                                         ? "(No data loaded)"
+                                         : "(No artist data available)");
+  m_artistsModel->setCounts(
+      results.value("topArtists").value<SortedCounts>());
 }
 
 void MainWindow::updateTracksView(const AnalysisResults &results) {
-  if (!m_trackListWidget)
+  if (!m_tracksModel)
     return;
-  m_trackListWidget->clear();
-  if (results.isEmpty()) {
-    m_trackListWidget->addItem("(No data loaded)");
-    return;
-  }
-
-  SortedCounts top = results.value("topTracks").value<SortedCounts>();
-
-  if (top.isEmpty()) {
-    m_trackListWidget->addItem("(No track data available)");
-  } else {
-    for (const auto &p : top)
-      m_trackListWidget->addItem(QString("%1 (%2)").arg(p.first).arg(p.second));
-  }
+  m_tracksModel->setPlaceholderText(results.isEmpty()
+                                        ? "(No data loaded)"
+                                        : "(No track data available)");
+  m_tracksModel->setCounts(results.value("topTracks").value<SortedCounts>());
 }
 
 void MainWindow::updateChartsView(const AnalysisResults &results) {
@@ -1055,55 +1379,18 @@ void MainWindow::updateArtistChart(const AnalysisResults &results) {
     return;
   }
   QChart *chart = m_artistsChartView->chart();
-  chart->removeAllSeries();
-  QList<QAbstractAxis *> axes;
-  foreach (QAbstractAxis *a, chart->axes())
-    axes.append(a);
-  foreach (QAbstractAxis *a, axes)
-    chart->removeAxis(a);
-  qDeleteAll(axes);
-  axes.clear();
-  chart->setTitle("Top 10 Artists");
+  SortedCounts topData =
+      results.value("topArtists").value<SortedCounts>().mid(0, 10);
+  chart->setTitle(topData.isEmpty() ? "Top 10 Artists (No Data)"
+                                    : "Top 10 Artists");
 
-  if (results.isEmpty()) {
-    chart->setTitle("Top 10 Artists (No Data)");
-
-    return;
-  }
-
-  SortedCounts topDataFull = results.value("topArtists").value<SortedCounts>();
-  SortedCounts topData = topDataFull.mid(0, 10);
-
-  if (topData.isEmpty()) {
-    chart->setTitle("Top 10 Artists (No Data)");
-    return;
-  }
-
-  QBarSeries *series = new QBarSeries(chart);
-  QBarSet *set = new QBarSet("Plays");
   QStringList cats;
-  int maxV = 0;
+  QList<int> values;
   for (int i = topData.size() - 1; i >= 0; --i) {
-    const auto &p = topData[i];
-    *set << p.second;
-    cats << p.first;
-    if (p.second > maxV)
-      maxV = p.second;
-  }
-  series->append(set);
-  chart->addSeries(series);
-  chart->setAnimationOptions(QChart::SeriesAnimations);
-  QBarCategoryAxis *axX = new QBarCategoryAxis(chart);
-  axX->append(cats);
-  chart->addAxis(axX, Qt::AlignBottom);
-  series->attachAxis(axX);
-  QValueAxis *axY = new QValueAxis(chart);
-  axY->setRange(0, maxV > 0 ? maxV * 1.1 : 10);
-  axY->setLabelFormat("%d");
-  axY->setTitleText("Play Count");
-  chart->addAxis(axY, Qt::AlignLeft);
-  series->attachAxis(axY);
-  chart->legend()->setVisible(false);
+    cats << topData[i].first;
+    values << topData[i].second;
+  }
+  setBarChartValues(chart, cats, values, "Plays", QString(), "Play Count");
   m_artistsChartView->setRenderHint(QPainter::Antialiasing);
 }
 
@@ -1112,57 +1399,21 @@ void MainWindow::updateTrackChart(const AnalysisResults &results) {
     return;
   }
   QChart *chart = m_tracksChartView->chart();
-  chart->removeAllSeries();
-  QList<QAbstractAxis *> axes;
-  foreach (QAbstractAxis *a, chart->axes())
-    axes.append(a);
-  foreach (QAbstractAxis *a, axes)
-    chart->removeAxis(a);
-  qDeleteAll(axes);
-  axes.clear();
-  chart->setTitle("Top 10 Tracks");
-
-  if (results.isEmpty()) {
-    chart->setTitle("Top 10 Tracks (No Data)");
-    return;
-  }
+  SortedCounts topData =
+      results.value("topTracks").value<SortedCounts>().mid(0, 10);
+  chart->setTitle(topData.isEmpty() ? "Top 10 Tracks (No Data)"
+                                    : "Top 10 Tracks");
 
-  SortedCounts topDataFull = results.value("topTracks").value<SortedCounts>();
-  SortedCounts topData = topDataFull.mid(0, 10);
-
-  if (topData.isEmpty()) {
-    chart->setTitle("Top 10 Tracks (No Data)");
-    return;
-  }
-
-  QBarSeries *series = new QBarSeries(chart);
-  QBarSet *set = new QBarSet("Plays");
   QStringList cats;
-  int maxV = 0;
+  QList<int> values;
   for (int i = topData.size() - 1; i >= 0; --i) {
-    const auto &p = topData[i];
-    *set << p.second;
-    QString label = p.first;
+    QString label = topData[i].first;
     if (label.length() > 35)
       label = label.left(32) + "...";
     cats << label;
-    if (p.second > maxV)
-      maxV = p.second;
-  }
-  series->append(set);
-  chart->addSeries(series);
-  chart->setAnimationOptions(QChart::SeriesAnimations);
-  QBarCategoryAxis *axX = new QBarCategoryAxis(chart);
-  axX->append(cats);
-  chart->addAxis(axX, Qt::AlignBottom);
-  series->attachAxis(axX);
-  QValueAxis *axY = new QValueAxis(chart);
-  axY->setRange(0, maxV > 0 ? maxV * 1.1 : 10);
-  axY->setLabelFormat("%d");
-  axY->setTitleText("Play Count");
-  chart->addAxis(axY, Qt::AlignLeft);
-  series->attachAxis(axY);
-  chart->legend()->setVisible(false);
+    values << topData[i].second;
+  }
+  setBarChartValues(chart, cats, values, "Plays", QString(), "Play Count");
   m_tracksChartView->setRenderHint(QPainter::Antialiasing);
 }
 
@@ -1171,53 +1422,22 @@ void MainWindow::updateHourlyChart(const AnalysisResults &results) {
     return;
   }
   QChart *chart = m_hourlyChartView->chart();
-  chart->removeAllSeries();
-  QList<QAbstractAxis *> axes;
-  foreach (QAbstractAxis *a, chart->axes())
-    axes.append(a);
-  foreach (QAbstractAxis *a, axes)
-    chart->removeAxis(a);
-  qDeleteAll(axes);
-  axes.clear();
-  chart->setTitle("Scrobbles per Hour of Day (Local Time)");
+  QVector<int> hourlyData = results.value("hourlyData").value<QVector<int>>();
 
+  QStringList cats;
   if (results.isEmpty()) {
     chart->setTitle("Scrobbles per Hour (No Data)");
-    return;
-  }
-
-  QVector<int> hourlyData = results.value("hourlyData").value<QVector<int>>();
-
-  if (hourlyData.size() != 24) {
+    hourlyData.clear();
+  } else if (hourlyData.size() != 24) {
     chart->setTitle("Scrobbles per Hour (Error)");
-    return;
+    hourlyData.clear();
+  } else {
+    chart->setTitle("Scrobbles per Hour of Day (Local Time)");
+    for (int hour = 0; hour < 24; ++hour)
+      cats << QStringLiteral("%1").arg(hour, 2, 10, QLatin1Char('0'));
   }
-
-  QBarSeries *series = new QBarSeries(chart);
-  QBarSet *set = new QBarSet("Scrobbles");
-  QStringList cats;
-  int maxV = 0;
-  for (int hour = 0; hour < 24; ++hour) {
-    *set << hourlyData[hour];
-    cats << QStringLiteral("%1").arg(hour, 2, 10, QLatin1Char('0'));
-    if (hourlyData[hour] > maxV)
-      maxV = hourlyData[hour];
-  }
-  series->append(set);
-  chart->addSeries(series);
-  chart->setAnimationOptions(QChart::SeriesAnimations);
-  QBarCategoryAxis *axX = new QBarCategoryAxis(chart);
-  axX->append(cats);
-  axX->setTitleText("Hour of Day (Local)");
-  chart->addAxis(axX, Qt::AlignBottom);
-  series->attachAxis(axX);
-  QValueAxis *axY = new QValueAxis(chart);
-  axY->setRange(0, maxV > 0 ? maxV * 1.1 : 10);
-  axY->setLabelFormat("%d");
-  axY->setTitleText("Total Scrobbles");
-  chart->addAxis(axY, Qt::AlignLeft);
-  series->attachAxis(axY);
-  chart->legend()->setVisible(false);
+  setBarChartValues(chart, cats, hourlyData, "Scrobbles", "Hour of Day (Local)",
+                    "Total Scrobbles");
   m_hourlyChartView->setRenderHint(QPainter::Antialiasing);
 }
 
@@ -1226,53 +1446,21 @@ void MainWindow::updateWeeklyChart(const AnalysisResults &results) {
     return;
   }
   QChart *chart = m_weeklyChartView->chart();
-  chart->removeAllSeries();
-  QList<QAbstractAxis *> axes;
-  foreach (QAbstractAxis *a, chart->axes())
-    axes.append(a);
-  foreach (QAbstractAxis *a, axes)
-    chart->removeAxis(a);
-  qDeleteAll(axes);
-  axes.clear();
-
-  chart->setTitle("Scrobbles per Day of Week (Local Time)");
+  QVector<int> weeklyData = results.value("weeklyData").value<QVector<int>>();
 
+  QStringList cats;
   if (results.isEmpty()) {
     chart->setTitle("Scrobbles per Day (No Data)");
-    return;
-  }
-
-  QVector<int> weeklyData = results.value("weeklyData").value<QVector<int>>();
-
-  if (weeklyData.size() != 7) {
+    weeklyData.clear();
+  } else if (weeklyData.size() != 7) {
     chart->setTitle("Scrobbles per Day (Error)");
-    return;
+    weeklyData.clear();
+  } else {
+    chart->setTitle("Scrobbles per Day of Week (Local Time)");
+    cats = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
   }
-
-  QBarSeries *series = new QBarSeries(chart);
-  QBarSet *set = new QBarSet("Scrobbles");
-  QStringList cats = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
-  int maxV = 0;
-  for (int day = 0; day < 7; ++day) {
-    *set << weeklyData[day];
-    if (weeklyData[day] > maxV)
-      maxV = weeklyData[day];
-  }
-  series->append(set);
-  chart->addSeries(series);
-  chart->setAnimationOptions(QChart::SeriesAnimations);
-  QBarCategoryAxis *axX = new QBarCategoryAxis(chart);
-  axX->append(cats);
-  axX->setTitleText("Day of Week");
-  chart->addAxis(axX, Qt::AlignBottom);
-  series->attachAxis(axX);
-  QValueAxis *axY = new QValueAxis(chart);
-  axY->setRange(0, maxV > 0 ? maxV * 1.1 : 10);
-  axY->setLabelFormat("%d");
-  axY->setTitleText("Total Scrobbles");
-  chart->addAxis(axY, Qt::AlignLeft);
-  series->attachAxis(axY);
-  chart->legend()->setVisible(false);
+  setBarChartValues(chart, cats, weeklyData, "Scrobbles", "Day of Week",
+                    "Total Scrobbles");
   m_weeklyChartView->setRenderHint(QPainter::Antialiasing);
 }
 
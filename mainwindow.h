@@ -5,12 +5,13 @@
 #include <QFutureWatcher>
 #include <QLabel>
 #include <QLineEdit>
+#include <QListView>
 #include <QListWidget>
 #include <QListWidgetItem>
 #include <QMainWindow>
 #include <QPushButton>
 #include <QStackedWidget>
-#include <QTableWidget>
+#include <QTableView>
 #include <QVariantMap>
 
 QT_BEGIN_NAMESPACE
@@ -20,9 +21,12 @@ class MainWindow;
 QT_END_NAMESPACE
 
 #include "analyticsengine.h"
+#include "incrementalanalytics.h"
 #include "databasemanager.h"
 #include "lastfmmanager.h"
+#include "rankedcountsmodel.h"
 #include "scrobbledata.h"
+#include "scrobbletablemodel.h"
 #include "settingsmanager.h"
 
 #include <QtCharts/QChartGlobal>
@@ -58,6 +62,8 @@ public:
   explicit MainWindow(QWidget *parent = nullptr);
   /**
    * @brief Destructor.
+   * @details Shuts the save queue and the fetch threads down before the
+   * members are destroyed.
    */
   ~MainWindow();
 
@@ -82,6 +88,12 @@ private slots:
    * fetch based on settings. Updates application state.
    */
   void fetchNewScrobbles();
+  /**
+   * @brief Slot called when the user asks to verify the stored history.
+   * @details Compares the stored per-week counts with Last.fm and backfills
+   * the windows missing scrobbles (LastFmManager::verifyHistory()).
+   */
+  void verifyHistory();
   /**
    * @brief Slot called when the date range for the mean scrobble calculation
    * changes.
@@ -96,15 +108,37 @@ private slots:
    * AnalyticsEngine, and updates the result label.
    */
   void findLastPlayedTrack();
+  /**
+   * @brief Slot called when the user requests a JSON export of the local
+   * database.
+   * @details Asks for a target directory and starts
+   * DatabaseManager::exportToJsonAsync().
+   */
+  void exportScrobblesToJson();
+  /**
+   * @brief Slot called when the DatabaseManager finishes a JSON export.
+   * @param success True if the export succeeded.
+   * @param message The target directory or an error description.
+   */
+  void handleExportFinished(bool success, const QString &message);
 
   /**
-   * @brief Slot to handle a page of scrobbles received from LastFmManager.
-   * @details Passes the data to DatabaseManager for asynchronous saving.
-   * @param pageScrobbles The list of scrobbles fetched.
-   * @param pageNumber The corresponding page number.
+   * @brief Slot to handle a batch of fetched scrobbles the DatabaseManager
+   * has journaled.
+   * @details Applies them to the retained analysis, if any. The pages
+   * themselves go from LastFmManager straight to the save queue.
+   * @param username The user the scrobbles belong to.
+   * @param scrobbles The saved scrobbles.
+   */
+  void handleScrobblesSaved(const QString &username,
+                            const QList<ScrobbleData> &scrobbles);
+  /**
+   * @brief Slot to handle the range of a windowed import.
+   * @details Saves it so a resumed import uses the same windows.
+   * @param startUts Start of the history (inclusive).
+   * @param endUts End of the imported range (exclusive).
    */
-  void handleSavePageOfScrobbles(const QList<ScrobbleData> &pageScrobbles,
-                                 int pageNumber);
+  void handleImportRangeDetermined(qint64 startUts, qint64 endUts);
   /**
    * @brief Slot to handle the total number of pages determined by
    * LastFmManager.
@@ -145,13 +179,13 @@ private slots:
    */
   void handlePageSaveFailed(int pageNumber, const QString &error);
   /**
-   * @brief Slot called when the DatabaseManager signals successful loading of
-   * scrobbles.
-   * @details Stores the loaded data, clears the analysis cache, and triggers
-   * the background analysis task via startAnalysisTask().
-   * @param scrobbles The list of loaded scrobbles.
+   * @brief Slot called when the DatabaseManager has opened the scrobble store.
+   * @details Keeps the memory-mapped store. Unless the cached results were
+   * already brought up to date incrementally, clears the analysis cache and
+   * triggers the background analysis task via startAnalysisTask().
+   * @param store The opened, read-only scrobble store.
    */
-  void handleDbLoadComplete(const QList<ScrobbleData> &scrobbles);
+  void handleDbLoadComplete(QSharedPointer<const ScrobbleStore> store);
   /**
    * @brief Slot called when the DatabaseManager signals an error during data
    * loading.
@@ -172,6 +206,15 @@ private slots:
    * the UI via updateUiWithAnalysisResults(), and sets the state to Idle.
    */
   void handleAnalysisComplete();
+  /**
+   * @brief Slot called when the DatabaseManager has tried to restore the
+   * analytics snapshot.
+   * @details With a usable snapshot the results are shown immediately and
+   * marked current, so the store that is opened next is not reanalyzed.
+   * Either way the store is opened via openStoreAsync().
+   * @param state The restored state, or null.
+   */
+  void handleSnapshotLoaded(QSharedPointer<IncrementalAnalytics> state);
   /**
    * @brief Slot called when the initial database load (triggered by view
    * change) completes.
@@ -181,18 +224,19 @@ private slots:
   void handleInitialDbLoadComplete();
 
   /**
-     * @brief Slot called when an item in the artist list is double-clicked.
-     * @details Parses the artist name, constructs the Last.fm URL, and opens it.
-     * @param item The double-clicked list widget item.
-     */
-  void onArtistItemDoubleClicked(QListWidgetItem *item);
+   * @brief Slot called when an item in the artist list is double-clicked.
+   * @details Constructs the Last.fm URL of the artist and opens it.
+   * @param index The double-clicked RankedCountsModel index.
+   */
+  void onArtistItemDoubleClicked(const QModelIndex &index);
 
   /**
-     * @brief Slot called when an item in the track list is double-clicked.
-     * @details Parses the artist and track names, constructs the Last.fm URL, and opens it.
-     * @param item The double-clicked list widget item.
-     */
-  void onTrackItemDoubleClicked(QListWidgetItem *item);
+   * @brief Slot called when an item in the track list is double-clicked.
+   * @details Splits the artist and track names, constructs the Last.fm URL,
+   * and opens it.
+   * @param index The double-clicked RankedCountsModel index.
+   */
+  void onTrackItemDoubleClicked(const QModelIndex &index);
 
 private:
   /**
@@ -226,9 +270,9 @@ private:
   /** @brief Updates the content of the "Top Tracks" list view using analysis
    * results. */
   void updateTracksView(const AnalysisResults &results);
-  /** @brief Updates the content of the "Database View" table using analysis
-   * results. */
-  void updateDatabaseTableView(const AnalysisResults &results);
+  /** @brief Points the "Database View" table at the loaded scrobble store.
+   */
+  void updateDatabaseTableView();
   /** @brief Updates all charts on the "Charts" page using analysis results. */
   void updateChartsView(const AnalysisResults &results);
   /** @brief Updates content on the "About / Settings" page (e.g., current
@@ -257,6 +301,15 @@ private:
    * separate thread using QtConcurrent, and monitors with m_analysisWatcher.
    */
   void startAnalysisTask();
+  /** @brief Returns true if a non-empty scrobble store is loaded. */
+  bool hasLoadedScrobbles() const {
+    return m_scrobbleStore && !m_scrobbleStore->isEmpty();
+  }
+  /**
+   * @brief Drops the loaded scrobble store, also from the database table, so
+   * its week files are unmapped.
+   */
+  void releaseScrobbleStore();
   /** @brief Populates the main menu list widget. */
   void setupMenu();
   /** @brief Checks if settings (username/API key) are missing and prompts the
@@ -274,11 +327,24 @@ private:
    * elements based on the current application state (m_currentState).
    */
   void updateStatusBarState();
+  /**
+   * @brief Drops the retained analysis state so the next load recomputes
+   * everything (after errors, user changes and full fetches).
+   */
+  void invalidateIncrementalAnalytics();
+  /**
+   * @brief Persists a copy of the retained analysis state together with the
+   * identity of the current store's week files (see
+   * DatabaseManager::saveSnapshotAsync()).
+   */
+  void saveAnalyticsSnapshot();
 
   Ui::MainWindow *ui;
   SettingsManager m_settingsManager;
+  DatabaseManager m_databaseManager; /**< @brief Declared before
+                                        m_lastFmManager, whose threads save
+                                        into it, so it is destroyed last. */
   LastFmManager m_lastFmManager;
-  DatabaseManager m_databaseManager;
   AnalyticsEngine m_analyticsEngine;
 
   AppState m_currentState = AppState::Idle; /**< @brief The current operational
@@ -304,11 +370,20 @@ private:
   QPushButton *m_findLastPlayedButton = nullptr;
   QLabel *m_lastPlayedResultLabel = nullptr;
 
-  QTableWidget *m_dbTableWidget = nullptr;
+  QTableView *m_dbTableView = nullptr;
+  QLineEdit *m_dbFilterEdit = nullptr;
+  ScrobbleTableModel *m_dbTableModel =
+      nullptr; /**< @brief Lazily decoded rows of the loaded store. */
+  ScrobbleSortFilterProxyModel *m_dbProxyModel =
+      nullptr; /**< @brief Sorts and filters the table off the GUI thread. */
 
-  QListWidget *m_artistListWidget = nullptr;
+  QListView *m_artistListView = nullptr;
+  RankedCountsModel *m_artistsModel =
+      nullptr; /**< @brief Top artists, refreshed as a diff. */
 
-  QListWidget *m_trackListWidget = nullptr;
+  QListView *m_trackListView = nullptr;
+  RankedCountsModel *m_tracksModel =
+      nullptr; /**< @brief Top tracks, refreshed as a diff. */
 
   QChartView *m_artistsChartView = nullptr;
   QChartView *m_tracksChartView = nullptr;
@@ -324,8 +399,26 @@ private:
   QWidget *chartsPage = nullptr;
   QWidget *aboutPage = nullptr;
 
-  QList<ScrobbleData> m_loadedScrobbles;
+  QSharedPointer<const ScrobbleStore>
+      m_scrobbleStore; /**< @brief Memory-mapped view of the user's scrobbles;
+                          null while nothing is loaded. */
+  QSharedPointer<IncrementalAnalytics>
+      m_incrementalAnalytics; /**< @brief Analysis state of the loaded history,
+                                 fed with the pages of update fetches; null
+                                 when a full recompute is needed. */
+  QSharedPointer<IncrementalAnalytics>
+      m_pendingAnalytics; /**< @brief State being rebuilt by the running
+                             analysis task. */
+  bool m_resultsCurrent =
+      false; /**< @brief True if m_cachedAnalysisResults already include the
+                last update fetch, so the next store load skips the analysis. */
   bool m_fetchingComplete = false;
+  bool m_verifyingHistory =
+      false; /**< @brief The running fetch is a history verification. */
+  bool m_windowedImport =
+      false; /**< @brief The running fetch is a windowed initial import. */
+  int m_importWindowCount = 0; /**< @brief Windows of the import range. */
+  QSet<int> m_completedImportWindows; /**< @brief Saved import windows. */
   int m_expectedTotalPages = 0;
   int m_lastSuccessfullySavedPage = 0;
 };
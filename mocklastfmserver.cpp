@@ -0,0 +1,195 @@
+/**
+ * @file mocklastfmserver.cpp
+ * @brief Implementation of the MockLastFmServer class.
+ */
+
+#include "mocklastfmserver.h"
+#include <QHostAddress>
+#include <QPointer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrlQuery>
+#include <zlib.h>
+
+namespace {
+/**
+ * @brief Compresses a body with zlib.
+ * @param windowBits 15 for a zlib stream, 31 for gzip, -15 for raw deflate.
+ */
+QByteArray compressBody(const QByteArray &body, int windowBits) {
+  z_stream stream = {};
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, windowBits, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    return body;
+  }
+  QByteArray out(qsizetype(deflateBound(&stream, uLong(body.size()))),
+                 Qt::Uninitialized);
+  stream.next_in =
+      reinterpret_cast<Bytef *>(const_cast<char *>(body.constData()));
+  stream.avail_in = uInt(body.size());
+  stream.next_out = reinterpret_cast<Bytef *>(out.data());
+  stream.avail_out = uInt(out.size());
+  deflate(&stream, Z_FINISH);
+  out.truncate(qsizetype(stream.total_out));
+  deflateEnd(&stream);
+  return out;
+}
+
+/**
+ * @brief Appends one track object shaped like a real API track.
+ * @param index Derived from the timestamp, so a track keeps its name when
+ * newer tracks are added.
+ */
+void appendTrack(QByteArray &out, qint64 index, qint64 uts) {
+  const QByteArray artist = "Artist " + QByteArray::number(index % 400);
+  const QByteArray album = "Album " + QByteArray::number(index % 150);
+  const QByteArray name = "Track " + QByteArray::number(index % 2500);
+  out += "{\"artist\":{\"mbid\":\"\",\"#text\":\"" + artist +
+         "\"},\"streamable\":\"0\",\"image\":[{\"size\":\"small\",\"#text\":"
+         "\"https://lastfm.freetls.fastly.net/i/u/34s/mock.png\"}],"
+         "\"mbid\":\"\",\"album\":{\"mbid\":\"\",\"#text\":\"" +
+         album + "\"},\"name\":\"" + name +
+         "\",\"url\":\"https://www.last.fm/music/mock\",\"date\":{\"uts\":\"" +
+         QByteArray::number(uts) + "\",\"#text\":\"\"}}";
+}
+} // namespace
+
+MockLastFmServer::MockLastFmServer(QObject *parent)
+    : QObject(parent), m_random(1) {
+  connect(&m_server, &QTcpServer::newConnection, this,
+          &MockLastFmServer::handleNewConnection);
+}
+
+bool MockLastFmServer::listen() {
+  return m_server.listen(QHostAddress::LocalHost, 0);
+}
+
+QString MockLastFmServer::baseUrl() const {
+  return QString("http://127.0.0.1:%1/2.0/").arg(m_server.serverPort());
+}
+
+void MockLastFmServer::handleNewConnection() {
+  while (QTcpSocket *socket = m_server.nextPendingConnection()) {
+    ++m_connectionCount;
+    connect(socket, &QTcpSocket::readyRead, this,
+            [this, socket]() { processRequests(socket); });
+    connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+      m_buffers.remove(socket);
+      socket->deleteLater();
+    });
+  }
+}
+
+void MockLastFmServer::processRequests(QTcpSocket *socket) {
+  QByteArray &buffer = m_buffers[socket];
+  buffer += socket->readAll();
+
+  qsizetype headerEnd;
+  while ((headerEnd = buffer.indexOf("\r\n\r\n")) >= 0) {
+    const QByteArray header = buffer.left(headerEnd);
+    buffer.remove(0, headerEnd + 4);
+
+    const QList<QByteArray> lines = header.split('\n');
+    const QList<QByteArray> parts = lines.first().trimmed().split(' ');
+    QByteArray acceptEncoding;
+    for (const QByteArray &line : lines) {
+      const QByteArray lower = line.toLower();
+      if (lower.startsWith("accept-encoding:"))
+        acceptEncoding = lower.mid(16);
+    }
+
+    QByteArray status;
+    int page = 0;
+    QByteArray body = buildResponse(parts.size() > 1 ? parts[1] : QByteArray(),
+                                    status, page);
+    QByteArray encodingHeader;
+    const bool gzip = m_compression == Compression::Gzip;
+    if (m_compression != Compression::None &&
+        acceptEncoding.contains(gzip ? "gzip" : "deflate")) {
+      const int windowBits =
+          gzip ? 31 : (m_compression == Compression::Deflate ? 15 : -15);
+      body = compressBody(body, windowBits);
+      encodingHeader = gzip ? "\r\nContent-Encoding: gzip"
+                            : "\r\nContent-Encoding: deflate";
+    }
+    m_bodyBytesSent += body.size();
+    const QByteArray response = "HTTP/1.1 " + status +
+                                "\r\nContent-Type: application/json" +
+                                encodingHeader + "\r\nContent-Length: " +
+                                QByteArray::number(body.size()) +
+                                "\r\nConnection: keep-alive\r\n\r\n" + body;
+
+    const int delayMs =
+        m_latencyMs + (m_latencyJitterMs > 0
+                           ? int(m_random.bounded(m_latencyJitterMs + 1))
+                           : 0);
+    if (delayMs == 0) {
+      socket->write(response);
+      emit responseSent(page);
+    } else {
+      QPointer<QTcpSocket> target(socket);
+      QTimer::singleShot(delayMs, this, [this, target, response, page]() {
+        if (target) {
+          target->write(response);
+          emit responseSent(page);
+        }
+      });
+    }
+  }
+}
+
+QByteArray MockLastFmServer::buildResponse(const QByteArray &target,
+                                           QByteArray &status, int &page) {
+  const qsizetype queryStart = target.indexOf('?');
+  const QUrlQuery query(queryStart >= 0
+                            ? QString::fromLatin1(target.mid(queryStart + 1))
+                            : QString());
+  page = qMax(1, query.queryItemValue("page").toInt());
+  const int limit = qMax(1, query.queryItemValue("limit").toInt());
+  const qint64 from = query.queryItemValue("from").toLongLong();
+  const qint64 to = query.queryItemValue("to").toLongLong();
+  ++m_requestCount;
+  emit requestReceived(page);
+
+  if (m_errorRate > 0 && m_random.generateDouble() < m_errorRate) {
+    status = "500 Internal Server Error";
+    return R"({"error":8,"message":"Operation failed - Most likely the )"
+           R"(backend service failed. Please try again."})";
+  }
+
+  // Indices of the tracks in [from, to], newest first.
+  qint64 newestIndex = 0;
+  qint64 endIndex = m_trackCount;
+  if (from > 0) {
+    endIndex = from > m_newestUts
+                   ? 0
+                   : qMin<qint64>(m_trackCount,
+                                  (m_newestUts - from) / m_trackSpacingSecs +
+                                      1);
+  }
+  if (to > 0 && to < m_newestUts) {
+    newestIndex =
+        (m_newestUts - to + m_trackSpacingSecs - 1) / m_trackSpacingSecs;
+  }
+  const qint64 available = qMax<qint64>(0, endIndex - newestIndex);
+  const qint64 totalPages = (available + limit - 1) / limit;
+  const qint64 first = newestIndex + qint64(page - 1) * limit;
+  const qint64 last = qMin(endIndex, first + limit);
+
+  QByteArray body;
+  body.reserve(int(qMax<qint64>(0, last - first)) * 360 + 256);
+  body += "{\"recenttracks\":{\"track\":[";
+  for (qint64 i = first; i < last; ++i) {
+    if (i != first)
+      body += ',';
+    const qint64 uts = m_newestUts - i * m_trackSpacingSecs;
+    appendTrack(body, uts / m_trackSpacingSecs, uts);
+  }
+  body += "],\"@attr\":{\"user\":\"mock\",\"totalPages\":\"" +
+          QByteArray::number(totalPages) + "\",\"page\":\"" +
+          QByteArray::number(page) + "\",\"perPage\":\"" +
+          QByteArray::number(limit) + "\",\"total\":\"" +
+          QByteArray::number(available) + "\"}}}";
+  status = "200 OK";
+  return body;
+}
@@ -0,0 +1,150 @@
+#ifndef MOCKLASTFMSERVER_H
+#define MOCKLASTFMSERVER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QRandomGenerator>
+#include <QString>
+#include <QTcpServer>
+
+class QTcpSocket;
+
+/**
+ * @class MockLastFmServer
+ * @brief Local HTTP stub serving synthetic `user.getrecenttracks` pages, for
+ * tests and benchmarks that run the fetch path offline.
+ * @details Listens on 127.0.0.1 and answers every GET request with a page of
+ * a fixed synthetic history: trackCount() tracks, trackSpacingSecs() apart
+ * going back from newestTimestamp(), served newest first like the real API,
+ * honouring the `page`, `limit`, `from` and `to` query items. Connections
+ * are kept alive, as QNetworkAccessManager expects, and counted. Bodies are
+ * compressed as compression() says when the request accepts that encoding.
+ * Only HTTP/1.1 is spoken.
+ *
+ * Each response is delayed by latencyMs() plus a random share of
+ * latencyJitterMs(), so answers to concurrent requests can overtake each
+ * other. Track names follow from the timestamp, so adding newer tracks
+ * leaves the older ones unchanged. With probability errorRate() a
+ * request is instead answered with HTTP 500 and Last.fm error 8 ("Operation
+ * failed"). Not intended for production code.
+ * @inherits QObject
+ */
+class MockLastFmServer : public QObject {
+  Q_OBJECT
+
+public:
+  /**
+   * @brief Constructs a stopped server.
+   * @param parent The parent QObject, defaults to nullptr.
+   */
+  explicit MockLastFmServer(QObject *parent = nullptr);
+
+  /**
+   * @brief Starts listening on a free port of 127.0.0.1.
+   * @return False if no port could be bound.
+   */
+  bool listen();
+  /** @brief Returns the endpoint to pass to LastFmManager::setApiBaseUrl(). */
+  QString baseUrl() const;
+
+  /** @brief Sets the size of the synthetic history in tracks. */
+  void setTrackCount(int tracks) { m_trackCount = qMax(0, tracks); }
+  /** @brief Returns the size of the synthetic history in tracks. */
+  int trackCount() const { return m_trackCount; }
+  /** @brief Sets the timestamp of the newest synthetic track. */
+  void setNewestTimestamp(qint64 uts) { m_newestUts = uts; }
+  /** @brief Returns the timestamp of the newest synthetic track. */
+  qint64 newestTimestamp() const { return m_newestUts; }
+  /** @brief Sets the seconds between two synthetic tracks (60 by default). */
+  void setTrackSpacingSecs(qint64 secs) {
+    m_trackSpacingSecs = qMax<qint64>(1, secs);
+  }
+  /** @brief Returns the seconds between two synthetic tracks. */
+  qint64 trackSpacingSecs() const { return m_trackSpacingSecs; }
+  /** @brief Sets the delay before each response in milliseconds. */
+  void setLatencyMs(int ms) { m_latencyMs = qMax(0, ms); }
+  /** @brief Returns the delay before each response in milliseconds. */
+  int latencyMs() const { return m_latencyMs; }
+  /** @brief Sets the maximum random delay added to each response. */
+  void setLatencyJitterMs(int ms) { m_latencyJitterMs = qMax(0, ms); }
+  /** @brief Returns the maximum random delay added to each response. */
+  int latencyJitterMs() const { return m_latencyJitterMs; }
+  /** @brief Sets the fraction (0..1) of requests answered with HTTP 500. */
+  void setErrorRate(double rate) { m_errorRate = qBound(0.0, rate, 1.0); }
+  /** @brief Returns the fraction of requests answered with HTTP 500. */
+  double errorRate() const { return m_errorRate; }
+  /** @brief Seeds the generator deciding which requests fail. */
+  void setSeed(quint32 seed) { m_random.seed(seed); }
+  /** @brief How response bodies are compressed. */
+  enum class Compression {
+    None,      /**< @brief Sent as they are. */
+    Gzip,      /**< @brief `gzip`, what most servers send (the default). */
+    Deflate,   /**< @brief `deflate` as a zlib stream, as HTTP specifies. */
+    RawDeflate /**< @brief `deflate` without the zlib wrapper, as some
+                  servers send it. */
+  };
+  /** @brief Sets how bodies are compressed when the request accepts it. */
+  void setCompression(Compression compression) {
+    m_compression = compression;
+  }
+  /** @brief Returns how bodies are compressed. */
+  Compression compression() const { return m_compression; }
+
+  /** @brief Returns the number of requests received so far. */
+  int requestCount() const { return m_requestCount; }
+  /** @brief Returns the number of connections accepted so far. */
+  int connectionCount() const { return m_connectionCount; }
+  /** @brief Returns the response body bytes written so far. */
+  qint64 bodyBytesSent() const { return m_bodyBytesSent; }
+
+signals:
+  /**
+   * @brief Emitted when a request has been read, before the latency delay.
+   * @param page The requested page.
+   */
+  void requestReceived(int page);
+  /**
+   * @brief Emitted when a response has been written, after the delay.
+   * @param page The requested page.
+   */
+  void responseSent(int page);
+
+private slots:
+  /** @brief Accepts pending connections. */
+  void handleNewConnection();
+
+private:
+  /**
+   * @brief Answers every complete request buffered for a socket.
+   * @param socket The client connection.
+   */
+  void processRequests(QTcpSocket *socket);
+  /**
+   * @brief Builds the response to one request target.
+   * @param target The request target, e.g. `/2.0/?method=...&page=2`.
+   * @param[out] status Receives the HTTP status line text, e.g. "200 OK".
+   * @param[out] page Receives the requested page.
+   * @return The JSON body.
+   */
+  QByteArray buildResponse(const QByteArray &target, QByteArray &status,
+                           int &page);
+
+  QTcpServer m_server; /**< @brief The listening socket. */
+  QHash<QTcpSocket *, QByteArray>
+      m_buffers;              /**< @brief Unprocessed input per connection. */
+  int m_trackCount = 2000;    /**< @brief Size of the synthetic history. */
+  qint64 m_newestUts = 1709510400; /**< @brief Newest synthetic timestamp. */
+  qint64 m_trackSpacingSecs = 60;  /**< @brief Seconds between two tracks. */
+  int m_latencyMs = 0;             /**< @brief Delay before each response. */
+  int m_latencyJitterMs = 0;       /**< @brief Random extra delay, at most. */
+  double m_errorRate = 0.0;        /**< @brief Fraction of failed requests. */
+  int m_requestCount = 0;          /**< @brief Requests received so far. */
+  int m_connectionCount = 0;       /**< @brief Connections accepted so far. */
+  qint64 m_bodyBytesSent = 0;      /**< @brief Body bytes written so far. */
+  Compression m_compression =
+      Compression::Gzip;     /**< @brief Used when accepted. */
+  QRandomGenerator m_random;       /**< @brief Decides failed requests. */
+};
+
+#endif // MOCKLASTFMSERVER_H
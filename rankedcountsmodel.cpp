@@ -0,0 +1,112 @@
+/**
+ * @file rankedcountsmodel.cpp
+ * @brief Implementation of the RankedCountsModel class.
+ */
+
+#include "rankedcountsmodel.h"
+#include <QSet>
+
+RankedCountsModel::RankedCountsModel(QObject *parent)
+    : QAbstractListModel(parent) {}
+
+void RankedCountsModel::setCounts(const SortedCounts &counts) {
+  if (m_rows.isEmpty() || counts.isEmpty()) {
+    // Nothing to diff against; only the placeholder row comes or goes.
+    if (m_rows.isEmpty() && counts.isEmpty())
+      return;
+    beginResetModel();
+    m_rows = counts;
+    endResetModel();
+    return;
+  }
+
+  QSet<QString> names;
+  names.reserve(counts.size());
+  for (const CountPair &entry : counts)
+    names.insert(entry.first);
+
+  // Names that left the ranking go first, as contiguous runs from the bottom
+  // so the rows above keep their numbers.
+  for (int last = m_rows.size() - 1; last >= 0; --last) {
+    if (names.contains(m_rows[last].first))
+      continue;
+    int first = last;
+    while (first > 0 && !names.contains(m_rows[first - 1].first))
+      --first;
+    beginRemoveRows(QModelIndex(), first, last);
+    m_rows.remove(first, last - first + 1);
+    endRemoveRows();
+    last = first;
+  }
+
+  // Every row above `row` is final, so each entry is either already in place,
+  // further down (a rank move) or new (an insert).
+  for (int row = 0; row < counts.size(); ++row) {
+    const CountPair &entry = counts[row];
+    if (row >= m_rows.size() || m_rows[row].first != entry.first) {
+      int from = -1;
+      for (int i = row + 1; i < m_rows.size(); ++i) {
+        if (m_rows[i].first == entry.first) {
+          from = i;
+          break;
+        }
+      }
+      if (from < 0) {
+        beginInsertRows(QModelIndex(), row, row);
+        m_rows.insert(row, entry);
+        endInsertRows();
+        continue;
+      }
+      beginMoveRows(QModelIndex(), from, from, QModelIndex(), row);
+      m_rows.move(from, row);
+      endMoveRows();
+    }
+    if (m_rows[row].second != entry.second) {
+      m_rows[row].second = entry.second;
+      const QModelIndex changed = index(row);
+      emit dataChanged(changed, changed, {Qt::DisplayRole, CountRole});
+    }
+  }
+}
+
+void RankedCountsModel::setPlaceholderText(const QString &text) {
+  if (text == m_placeholder)
+    return;
+  if (!m_rows.isEmpty()) {
+    m_placeholder = text;
+    return;
+  }
+  beginResetModel();
+  m_placeholder = text;
+  endResetModel();
+}
+
+int RankedCountsModel::rowCount(const QModelIndex &parent) const {
+  if (parent.isValid())
+    return 0;
+  return showsPlaceholder() ? 1 : int(m_rows.size());
+}
+
+QVariant RankedCountsModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid() || index.row() >= rowCount())
+    return QVariant();
+  if (showsPlaceholder())
+    return role == Qt::DisplayRole ? QVariant(m_placeholder) : QVariant();
+  const CountPair &entry = m_rows[index.row()];
+  switch (role) {
+  case Qt::DisplayRole:
+    return QString("%1 (%2)").arg(entry.first).arg(entry.second);
+  case NameRole:
+    return entry.first;
+  case CountRole:
+    return entry.second;
+  default:
+    return QVariant();
+  }
+}
+
+Qt::ItemFlags RankedCountsModel::flags(const QModelIndex &index) const {
+  if (showsPlaceholder())
+    return index.isValid() ? Qt::ItemIsEnabled : Qt::NoItemFlags;
+  return QAbstractListModel::flags(index);
+}
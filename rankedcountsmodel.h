@@ -0,0 +1,67 @@
+#ifndef RANKEDCOUNTSMODEL_H
+#define RANKEDCOUNTSMODEL_H
+
+#include "analyticsengine.h"
+#include <QAbstractListModel>
+#include <QString>
+
+/**
+ * @class RankedCountsModel
+ * @brief List model of a ranking (SortedCounts) that applies a new ranking as
+ * a diff instead of a reset.
+ * @details setCounts() compares the new ranking with the shown one by name and
+ * emits the matching fine-grained signals: rows removed for names that left
+ * the ranking, rows moved for names whose rank changed, rows inserted for new
+ * names and dataChanged for counts that changed in place. A refresh after a
+ * sync therefore only touches what the sync changed, and the view keeps its
+ * selection and scroll position.
+ *
+ * While the ranking is empty the model shows a single, non-selectable
+ * placeholder row.
+ * @inherits QAbstractListModel
+ */
+class RankedCountsModel : public QAbstractListModel {
+  Q_OBJECT
+public:
+  /** @brief Custom data roles. */
+  enum Role {
+    NameRole = Qt::UserRole, /**< @brief The entry name (QString). */
+    CountRole                /**< @brief The play count (int). */
+  };
+
+  /**
+   * @brief Constructs an empty model.
+   * @param parent The parent QObject, defaults to nullptr.
+   */
+  explicit RankedCountsModel(QObject *parent = nullptr);
+
+  /**
+   * @brief Shows a new ranking, emitting only the differences to the current
+   * one.
+   * @param counts The ranking, highest first; names must be unique.
+   */
+  void setCounts(const SortedCounts &counts);
+  /** @brief Returns the ranking shown. */
+  SortedCounts counts() const { return m_rows; }
+  /**
+   * @brief Sets the text of the row shown while the ranking is empty.
+   * @param text The placeholder, or empty for no row.
+   */
+  void setPlaceholderText(const QString &text);
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index,
+                int role = Qt::DisplayRole) const override;
+  Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+private:
+  /** @brief Returns true if the placeholder row is shown. */
+  bool showsPlaceholder() const {
+    return m_rows.isEmpty() && !m_placeholder.isEmpty();
+  }
+
+  SortedCounts m_rows;   /**< @brief Ranking shown, highest first. */
+  QString m_placeholder; /**< @brief Text shown for an empty ranking. */
+};
+
+#endif // RANKEDCOUNTSMODEL_H
@@ -0,0 +1,72 @@
+/**
+ * @file ratelimiter.cpp
+ * @brief Implementation of the RateLimiter class.
+ */
+
+#include "ratelimiter.h"
+#include <cmath>
+
+namespace {
+/** @brief Backoff level at which the delay reaches MAX_BACKOFF_MS. */
+const int MAX_BACKOFF_LEVEL = 7;
+/** @brief Last.fm error code "Rate limit exceeded". */
+const int API_ERROR_RATE_LIMIT = 29;
+} // namespace
+
+RateLimiter::RateLimiter(double requestsPerSecond, quint32 seed)
+    : m_requestsPerSecond(qMax(0.1, requestsPerSecond)),
+      m_capacity(qMax(1.0, m_requestsPerSecond)), m_tokens(m_capacity),
+      m_random(seed != 0 ? seed : QRandomGenerator::global()->generate()) {}
+
+void RateLimiter::refill(qint64 nowMs) {
+  if (m_lastRefillMs >= 0 && nowMs > m_lastRefillMs) {
+    m_tokens = qMin(m_capacity, m_tokens + (nowMs - m_lastRefillMs) *
+                                               currentRate() / 1000.0);
+  }
+  if (nowMs > m_lastRefillMs)
+    m_lastRefillMs = nowMs;
+}
+
+qint64 RateLimiter::tryAcquire(qint64 nowMs) {
+  refill(nowMs);
+  if (nowMs < m_blockedUntilMs)
+    return m_blockedUntilMs - nowMs;
+  if (m_tokens >= 1.0) {
+    m_tokens -= 1.0;
+    return 0;
+  }
+  return qMax<qint64>(
+      1, qint64(std::ceil((1.0 - m_tokens) * 1000.0 / currentRate())));
+}
+
+void RateLimiter::recordSuccess() {
+  if (m_backoffLevel == 0 && m_rateFactor >= 1.0)
+    return;
+  if (++m_successes < RECOVERY_SUCCESSES)
+    return;
+  m_successes = 0;
+  m_backoffLevel = qMax(0, m_backoffLevel - 1);
+  m_rateFactor = qMin(1.0, m_rateFactor + MIN_RATE_FACTOR);
+}
+
+qint64 RateLimiter::recordThrottle(qint64 nowMs) {
+  refill(nowMs);
+  m_successes = 0;
+  if (nowMs < m_blockedUntilMs)
+    return m_blockedUntilMs - nowMs;
+
+  m_backoffLevel = qMin(MAX_BACKOFF_LEVEL, m_backoffLevel + 1);
+  m_rateFactor = qMax(MIN_RATE_FACTOR, m_rateFactor / 2);
+  m_tokens = 0;
+
+  const qint64 backoff =
+      qMin(MAX_BACKOFF_MS, BASE_BACKOFF_MS << (m_backoffLevel - 1));
+  const qint64 delay = backoff / 2 + m_random.bounded(backoff / 2 + 1);
+  m_blockedUntilMs = nowMs + delay;
+  return delay;
+}
+
+bool RateLimiter::isThrottleResponse(int httpStatusCode, int apiErrorCode) {
+  return httpStatusCode == 429 || httpStatusCode == 500 ||
+         httpStatusCode == 503 || apiErrorCode == API_ERROR_RATE_LIMIT;
+}
@@ -0,0 +1,101 @@
+#ifndef RATELIMITER_H
+#define RATELIMITER_H
+
+#include <QRandomGenerator>
+#include <QtGlobal>
+
+/**
+ * @class RateLimiter
+ * @brief Token bucket pacing Last.fm API requests, with exponential backoff
+ * when the service signals overload.
+ * @details The bucket refills at the documented budget of five requests per
+ * second and holds at most one second's worth of tokens, so a burst never
+ * exceeds the budget either. Each request start takes one token.
+ *
+ * A throttling response (HTTP 429, 500 or 503, or API error 29) halves the
+ * refill rate, down to an eighth of the budget, and blocks all requests for
+ * an exponentially growing delay with equal jitter (a random value between
+ * half and all of 1 s, 2 s, 4 s ... capped at 60 s). Throttling responses
+ * arriving while that block is still running belong to requests sent before
+ * it and do not escalate further. Every RECOVERY_SUCCESSES successful
+ * responses restore one eighth of the budget and one backoff step.
+ *
+ * Times are passed in by the caller as milliseconds of a monotonic clock,
+ * which keeps the class free of timers and deterministic in tests. Not
+ * thread-safe.
+ */
+class RateLimiter {
+public:
+  /** @brief Last.fm's documented budget in requests per second. */
+  static constexpr double DEFAULT_REQUESTS_PER_SECOND = 5.0;
+  /** @brief First backoff delay in milliseconds. */
+  static constexpr qint64 BASE_BACKOFF_MS = 1000;
+  /** @brief Upper bound of a backoff delay in milliseconds. */
+  static constexpr qint64 MAX_BACKOFF_MS = 60 * 1000;
+  /** @brief Successful responses needed for one recovery step. */
+  static constexpr int RECOVERY_SUCCESSES = 10;
+  /** @brief Lowest fraction of the budget the rate is reduced to. */
+  static constexpr double MIN_RATE_FACTOR = 0.125;
+
+  /**
+   * @brief Creates a limiter with a full bucket.
+   * @param requestsPerSecond The request budget.
+   * @param seed Seed of the jitter generator; 0 seeds it randomly.
+   */
+  explicit RateLimiter(
+      double requestsPerSecond = DEFAULT_REQUESTS_PER_SECOND,
+      quint32 seed = 0);
+
+  /**
+   * @brief Takes a token if a request may start now.
+   * @param nowMs Current monotonic time in milliseconds.
+   * @return 0 if a token was taken, otherwise the milliseconds to wait before
+   * asking again.
+   */
+  qint64 tryAcquire(qint64 nowMs);
+
+  /**
+   * @brief Records a successful response, ramping the rate back up over
+   * time.
+   */
+  void recordSuccess();
+
+  /**
+   * @brief Records a throttling response and starts or extends the backoff.
+   * @param nowMs Current monotonic time in milliseconds.
+   * @return Milliseconds until requests may start again.
+   */
+  qint64 recordThrottle(qint64 nowMs);
+
+  /**
+   * @brief Returns whether a response asks the client to slow down.
+   * @param httpStatusCode HTTP status of the response (0 if none).
+   * @param apiErrorCode Last.fm `error` code in the body (0 if none).
+   */
+  static bool isThrottleResponse(int httpStatusCode, int apiErrorCode);
+
+  /** @brief Returns the current refill rate in requests per second. */
+  double currentRate() const { return m_requestsPerSecond * m_rateFactor; }
+  /** @brief Returns the number of unrecovered backoff steps. */
+  int backoffLevel() const { return m_backoffLevel; }
+
+private:
+  /**
+   * @brief Adds the tokens accumulated since the last refill.
+   * @param nowMs Current monotonic time in milliseconds.
+   */
+  void refill(qint64 nowMs);
+
+  double m_requestsPerSecond; /**< @brief The full request budget. */
+  double m_capacity;          /**< @brief Maximum number of stored tokens. */
+  double m_tokens;            /**< @brief Tokens currently available. */
+  double m_rateFactor = 1.0;  /**< @brief Fraction of the budget in use. */
+  qint64 m_lastRefillMs = -1; /**< @brief Time of the last refill, -1 before
+                                 the first request. */
+  qint64 m_blockedUntilMs = 0; /**< @brief End of the running backoff. */
+  int m_backoffLevel = 0;      /**< @brief Backoff steps not yet recovered. */
+  int m_successes = 0; /**< @brief Successes since the last rate change. */
+  QRandomGenerator m_random; /**< @brief Jitter source. */
+};
+
+#endif // RATELIMITER_H
@@ -0,0 +1,173 @@
+/**
+ * @file responsecache.cpp
+ * @brief Implementation of the ResponseCache class.
+ */
+
+#include "responsecache.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+/** @brief Entry file header magic. */
+const char ENTRY_MAGIC[4] = {'L', 'F', 'R', 'C'};
+/** @brief Entry file suffix. */
+const QString ENTRY_SUFFIX = QStringLiteral(".page");
+} // namespace
+
+ResponseCache::ResponseCache(const QString &directory, qint64 maxBytes)
+    : m_directory(directory), m_maxBytes(qMax<qint64>(0, maxBytes)) {}
+
+QString ResponseCache::keyFor(const QString &username, qint64 fromTimestamp,
+                              qint64 toTimestamp, int page, int limit) {
+  const QByteArray identity = "user.getrecenttracks\n" +
+                              username.toLower().toUtf8() + '\n' +
+                              QByteArray::number(fromTimestamp) + '\n' +
+                              QByteArray::number(toTimestamp) + '\n' +
+                              QByteArray::number(page) + '\n' +
+                              QByteArray::number(limit);
+  return QString::fromLatin1(
+      QCryptographicHash::hash(identity, QCryptographicHash::Sha1).toHex());
+}
+
+QString ResponseCache::pathFor(const QString &key) const {
+  return m_directory + "/" + key + ENTRY_SUFFIX;
+}
+
+void ResponseCache::ensureIndexLocked() {
+  if (m_indexLoaded)
+    return;
+  m_indexLoaded = true;
+  if (!QDir().mkpath(m_directory)) {
+    qWarning() << "[ResponseCache] Could not create" << m_directory;
+    return;
+  }
+  const QFileInfoList files =
+      QDir(m_directory).entryInfoList({"*" + ENTRY_SUFFIX}, QDir::Files);
+  for (const QFileInfo &file : files) {
+    Entry entry;
+    entry.size = file.size();
+    entry.lastUsedMs = file.lastModified().toMSecsSinceEpoch();
+    m_index.insert(file.completeBaseName(), entry);
+    m_totalBytes += entry.size;
+  }
+  evictLocked();
+}
+
+bool ResponseCache::lookup(const QString &key, QByteArray &body,
+                           qint64 maxAgeSecs) {
+  QMutexLocker locker(&m_mutex);
+  ensureIndexLocked();
+  auto it = m_index.find(key);
+  if (it == m_index.end())
+    return false;
+
+  QFile file(pathFor(key));
+  if (!file.open(QIODevice::ReadOnly)) {
+    m_totalBytes -= it->size;
+    m_index.erase(it);
+    return false;
+  }
+  const QByteArray data = file.readAll();
+  if (data.size() < HEADER_SIZE ||
+      memcmp(data.constData(), ENTRY_MAGIC, 4) != 0) {
+    qWarning() << "[ResponseCache] Dropping malformed entry" << key;
+    file.close();
+    file.remove();
+    m_totalBytes -= it->size;
+    m_index.erase(it);
+    return false;
+  }
+  const QDateTime now = QDateTime::currentDateTimeUtc();
+  const qint64 storedAt = qFromLittleEndian<qint64>(data.constData() + 8);
+  if (maxAgeSecs >= 0 && now.toSecsSinceEpoch() - storedAt > maxAgeSecs)
+    return false;
+
+  // The modification time doubles as the last use, so LRU order survives a
+  // restart without a separate index file.
+  file.setFileTime(now, QFileDevice::FileModificationTime);
+  it->lastUsedMs = now.toMSecsSinceEpoch();
+  body = data.mid(HEADER_SIZE);
+  return true;
+}
+
+bool ResponseCache::store(const QString &key, const QByteArray &body,
+                          QString &errorMsg) {
+  QMutexLocker locker(&m_mutex);
+  ensureIndexLocked();
+
+  QByteArray data(HEADER_SIZE, '\0');
+  memcpy(data.data(), ENTRY_MAGIC, 4);
+  qToLittleEndian<qint64>(QDateTime::currentSecsSinceEpoch(),
+                          data.data() + 8);
+  data += body;
+
+  QSaveFile file(pathFor(key));
+  if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() ||
+      !file.commit()) {
+    errorMsg = QString("Could not write cache entry %1: %2")
+                   .arg(file.fileName(), file.errorString());
+    return false;
+  }
+
+  Entry &entry = m_index[key];
+  m_totalBytes += data.size() - entry.size;
+  entry.size = data.size();
+  entry.lastUsedMs = QDateTime::currentMSecsSinceEpoch();
+  if (m_totalBytes > m_maxBytes)
+    evictLocked();
+  return true;
+}
+
+void ResponseCache::evictLocked() {
+  if (m_totalBytes <= m_maxBytes)
+    return;
+  // Evicting below the cap leaves headroom, so a full cache does not sort
+  // its index again on every store.
+  const qint64 target = m_maxBytes - m_maxBytes / 10;
+  QList<QPair<qint64, QString>> byAge;
+  byAge.reserve(m_index.size());
+  for (auto it = m_index.cbegin(); it != m_index.cend(); ++it)
+    byAge.append({it->lastUsedMs, it.key()});
+  std::sort(byAge.begin(), byAge.end());
+
+  int evicted = 0;
+  for (const auto &entry : byAge) {
+    if (m_totalBytes <= target)
+      break;
+    QFile::remove(pathFor(entry.second));
+    m_totalBytes -= m_index.take(entry.second).size;
+    ++evicted;
+  }
+  qDebug() << "[ResponseCache] Evicted" << evicted << "entries,"
+           << m_totalBytes << "bytes remain";
+}
+
+QStringList ResponseCache::keys() {
+  QMutexLocker locker(&m_mutex);
+  ensureIndexLocked();
+  QList<QPair<qint64, QString>> byAge;
+  byAge.reserve(m_index.size());
+  for (auto it = m_index.cbegin(); it != m_index.cend(); ++it)
+    byAge.append({-it->lastUsedMs, it.key()});
+  std::sort(byAge.begin(), byAge.end());
+  QStringList result;
+  result.reserve(byAge.size());
+  for (const auto &entry : byAge)
+    result.append(entry.second);
+  return result;
+}
+
+qint64 ResponseCache::totalBytes() {
+  QMutexLocker locker(&m_mutex);
+  ensureIndexLocked();
+  return m_totalBytes;
+}
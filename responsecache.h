@@ -0,0 +1,106 @@
+#ifndef RESPONSECACHE_H
+#define RESPONSECACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @class ResponseCache
+ * @brief On-disk cache of raw `user.getrecenttracks` response bodies with a
+ * size cap and least-recently-used eviction.
+ * @details Entries are addressed by the SHA-1 of the request identity (user,
+ * from, to, page, limit) and stored one file per response, `<sha1>.page`: a 16
+ * byte header (magic "LFRC", quint32 reserved, qint64 store time in seconds
+ * since epoch, little endian) followed by the body. The modification time of
+ * a file is its last use and drives eviction, so recency survives restarts.
+ *
+ * The cache lets a resumed import skip pages that were fetched but not yet
+ * saved when it stopped, and keeps real captured responses around to replay
+ * parser changes against. Thread-safe.
+ */
+class ResponseCache {
+public:
+  /** @brief Default size cap in bytes. */
+  static constexpr qint64 DEFAULT_MAX_BYTES = 64 * 1024 * 1024;
+  /** @brief Default age in seconds after which lookup() ignores an entry. */
+  static constexpr qint64 DEFAULT_MAX_AGE_SECS = 24 * 60 * 60;
+  /** @brief Size of the entry file header in bytes. */
+  static constexpr int HEADER_SIZE = 16;
+
+  /**
+   * @brief Creates a cache over a directory.
+   * @details The directory is created and scanned on first use.
+   * @param directory The directory holding the entry files.
+   * @param maxBytes Size cap for all entry files together.
+   */
+  explicit ResponseCache(const QString &directory,
+                         qint64 maxBytes = DEFAULT_MAX_BYTES);
+
+  /**
+   * @brief Returns the cache key of a request.
+   * @param username The Last.fm user (compared case-insensitively).
+   * @param fromTimestamp The `from` query item, or 0 if not sent.
+   * @param toTimestamp The `to` query item, or 0 if not sent.
+   * @param page The requested page.
+   * @param limit The page size.
+   */
+  static QString keyFor(const QString &username, qint64 fromTimestamp,
+                        qint64 toTimestamp, int page, int limit);
+
+  /**
+   * @brief Reads an entry and marks it as recently used.
+   * @param key The key from keyFor().
+   * @param[out] body Receives the stored response body.
+   * @param maxAgeSecs Entries stored longer ago are treated as missing; a
+   * negative value accepts any age.
+   * @return False if there is no usable entry.
+   */
+  bool lookup(const QString &key, QByteArray &body,
+              qint64 maxAgeSecs = DEFAULT_MAX_AGE_SECS);
+
+  /**
+   * @brief Stores or replaces an entry, then evicts least recently used
+   * entries while the cache exceeds its cap.
+   * @param key The key from keyFor().
+   * @param body The response body.
+   * @param[out] errorMsg Receives a description of a write failure.
+   * @return False if the entry could not be written.
+   */
+  bool store(const QString &key, const QByteArray &body, QString &errorMsg);
+
+  /** @brief Returns the keys of all entries, most recently used first. */
+  QStringList keys();
+  /** @brief Returns the total size of all entry files in bytes. */
+  qint64 totalBytes();
+  /** @brief Returns the directory holding the entry files. */
+  QString directory() const { return m_directory; }
+
+private:
+  /**
+   * @struct Entry
+   * @brief In-memory index record of one entry file.
+   */
+  struct Entry {
+    qint64 size = 0;       /**< @brief File size in bytes. */
+    qint64 lastUsedMs = 0; /**< @brief Last use, ms since epoch. */
+  };
+
+  /** @brief Scans the directory once; the caller holds m_mutex. */
+  void ensureIndexLocked();
+  /** @brief Evicts down to 90% of the cap; the caller holds m_mutex. */
+  void evictLocked();
+  /** @brief Returns the file path of a key. */
+  QString pathFor(const QString &key) const;
+
+  QString m_directory; /**< @brief Directory holding the entry files. */
+  qint64 m_maxBytes;   /**< @brief Size cap. */
+  QMutex m_mutex;                /**< @brief Guards the index and files. */
+  QHash<QString, Entry> m_index; /**< @brief Entries by key. */
+  qint64 m_totalBytes = 0;       /**< @brief Sum of the entry sizes. */
+  bool m_indexLoaded = false;    /**< @brief The directory was scanned. */
+};
+
+#endif // RESPONSECACHE_H
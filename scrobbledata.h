@@ -1,6 +1,7 @@
 #ifndef SCROBBLEDATA_H
 #define SCROBBLEDATA_H
 
+#include "stringinterner.h"
 #include <QDateTime>
 #include <QString>
 
@@ -8,13 +9,77 @@
  * @struct ScrobbleData
  * @brief Represents the essential information for a single Last.fm scrobble (a
  * played track).
+ * @details Compact 24 byte record: the timestamp is kept as UTC seconds since
+ * epoch and the strings as StringInterner IDs, so sorting, comparing and
+ * copying never touch QDateTime or QString. The string and QDateTime
+ * accessors are meant for the UI and serialization boundaries.
  */
 struct ScrobbleData {
-  QString artist;      /**< @brief The name of the artist. */
-  QString track;       /**< @brief The name of the track. */
-  QString album;       /**< @brief The name of the album. */
-  QDateTime timestamp; /**< @brief The UTC timestamp when the track finished
-                          playing (or started, according to Last.fm). */
+  qint64 uts = 0; /**< @brief UTC timestamp (seconds since epoch) when the
+                     track finished playing (or started, according to
+                     Last.fm); 0 if unknown. */
+  quint32 artistId =
+      StringInterner::INVALID_ID; /**< @brief Interned ID of the artist. */
+  quint32 trackId =
+      StringInterner::INVALID_ID; /**< @brief Interned ID of the track name. */
+  quint32 albumId =
+      StringInterner::INVALID_ID; /**< @brief Interned ID of the album. */
+  quint32 trackKeyId =
+      StringInterner::INVALID_ID; /**< @brief Interned ID of the (artist,
+                                     track) pair. */
+
+  /** @brief Constructs an empty scrobble with an invalid timestamp. */
+  ScrobbleData() = default;
+
+  /**
+   * @brief Constructs a scrobble from strings, interning them.
+   * @param artist The name of the artist.
+   * @param track The name of the track.
+   * @param album The name of the album.
+   * @param uts UTC timestamp in seconds since epoch.
+   */
+  ScrobbleData(const QString &artist, const QString &track,
+               const QString &album, qint64 uts)
+      : uts(uts) {
+    StringInterner &interner = StringInterner::instance();
+    artistId = interner.intern(artist);
+    trackId = interner.intern(track);
+    albumId = interner.intern(album);
+    trackKeyId = interner.internPair(artistId, trackId);
+  }
+
+  /**
+   * @brief Constructs a scrobble from strings and a QDateTime.
+   * @details An invalid @p timestamp results in an invalid scrobble (uts 0).
+   */
+  ScrobbleData(const QString &artist, const QString &track,
+               const QString &album, const QDateTime &timestamp)
+      : ScrobbleData(artist, track, album,
+                     timestamp.isValid() ? timestamp.toSecsSinceEpoch() : 0) {}
+
+  /** @brief Returns the artist name. */
+  QString artist() const {
+    return StringInterner::instance().string(artistId);
+  }
+  /** @brief Returns the track name. */
+  QString track() const { return StringInterner::instance().string(trackId); }
+  /** @brief Returns the album name. */
+  QString album() const { return StringInterner::instance().string(albumId); }
+
+  /** @brief Returns true if the scrobble has a usable timestamp. */
+  bool isValid() const { return uts > 0; }
+
+  /**
+   * @brief Returns the timestamp as a UTC QDateTime.
+   * @return The timestamp, or an invalid QDateTime if isValid() is false.
+   */
+  QDateTime timestamp() const {
+    return isValid() ? QDateTime::fromSecsSinceEpoch(uts, Qt::UTC)
+                     : QDateTime();
+  }
+
+  /** @brief Orders scrobbles by timestamp (raw integer comparison). */
+  bool operator<(const ScrobbleData &other) const { return uts < other.uts; }
 };
 
 #endif // SCROBBLEDATA_H
@@ -0,0 +1,202 @@
+/**
+ * @file scrobblejournal.cpp
+ * @brief Implementation of the ScrobbleJournal write-ahead log.
+ */
+
+#include "scrobblejournal.h"
+#include "weekmanifest.h"
+#include <QFile>
+#include <QtEndian>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+/** @brief Appends a little endian integer to a byte array. */
+template <typename T> void appendInt(QByteArray &out, T value) {
+  char bytes[sizeof(T)];
+  qToLittleEndian<T>(value, bytes);
+  out.append(bytes, sizeof(T));
+}
+
+/** @brief Appends a string as quint32 byte length + UTF-8 bytes. */
+void appendString(QByteArray &out, const QString &value) {
+  const QByteArray utf8 = value.toUtf8();
+  appendInt<quint32>(out, quint32(utf8.size()));
+  out.append(utf8);
+}
+
+/**
+ * @brief Reads a string written by appendString().
+ * @param pos Read position; advanced past the string.
+ * @return False if the string runs past @p end.
+ */
+bool readString(const char *&pos, const char *end, QString &value) {
+  if (end - pos < 4)
+    return false;
+  const quint32 length = qFromLittleEndian<quint32>(pos);
+  pos += 4;
+  if (quint64(end - pos) < length)
+    return false;
+  value = QString::fromUtf8(pos, length);
+  pos += length;
+  return true;
+}
+
+/** @brief Flushes Qt's and the operating system's buffers of a file. */
+bool syncToDisk(QFile &file) {
+  if (!file.flush())
+    return false;
+#ifdef Q_OS_WIN
+  return _commit(file.handle()) == 0;
+#else
+  return ::fsync(file.handle()) == 0;
+#endif
+}
+
+/**
+ * @brief Returns the end offset of the last complete record.
+ * @details Walks the record headers only; a bad magic number or a payload
+ * running past the end of the file marks a torn tail.
+ */
+qint64 completeRecordsEnd(QFile &file) {
+  const qint64 size = file.size();
+  qint64 pos = 0;
+  while (pos + ScrobbleJournal::RECORD_HEADER_SIZE <= size) {
+    if (!file.seek(pos))
+      break;
+    const QByteArray header = file.read(ScrobbleJournal::RECORD_HEADER_SIZE);
+    if (header.size() != ScrobbleJournal::RECORD_HEADER_SIZE ||
+        qFromLittleEndian<quint32>(header.constData()) !=
+            ScrobbleJournal::RECORD_MAGIC)
+      break;
+    const qint64 next = pos + ScrobbleJournal::RECORD_HEADER_SIZE +
+                        qFromLittleEndian<quint32>(header.constData() + 4);
+    if (next > size)
+      break;
+    pos = next;
+  }
+  return pos;
+}
+} // namespace
+
+ScrobbleJournal::ScrobbleJournal(const QString &filePath)
+    : m_filePath(filePath) {}
+
+bool ScrobbleJournal::exists() const { return QFile::exists(m_filePath); }
+
+QByteArray ScrobbleJournal::encodeRecord(const QList<ScrobbleData> &rows) {
+  QByteArray payload;
+  appendInt<quint32>(payload, 0);
+  quint32 rowCount = 0;
+  for (const ScrobbleData &s : rows) {
+    if (!s.isValid())
+      continue;
+    appendInt<qint64>(payload, s.uts);
+    appendString(payload, s.artist());
+    appendString(payload, s.track());
+    appendString(payload, s.album());
+    ++rowCount;
+  }
+  qToLittleEndian<quint32>(rowCount, payload.data());
+
+  QByteArray record;
+  record.reserve(RECORD_HEADER_SIZE + payload.size());
+  appendInt<quint32>(record, RECORD_MAGIC);
+  appendInt<quint32>(record, quint32(payload.size()));
+  appendInt<quint32>(record,
+                     WeekManifest::crc32(payload.constData(), payload.size()));
+  record.append(payload);
+  return record;
+}
+
+bool ScrobbleJournal::append(const QList<ScrobbleData> &rows,
+                             QString &errorMsg) {
+  const QByteArray record = encodeRecord(rows);
+  QFile file(m_filePath);
+  if (!file.open(QIODevice::ReadWrite)) {
+    errorMsg = "Cannot open journal: " + file.errorString();
+    return false;
+  }
+  const qint64 end = completeRecordsEnd(file);
+  if (end < file.size() && !file.resize(end)) {
+    errorMsg = "Cannot cut torn journal record: " + file.errorString();
+    return false;
+  }
+  if (!file.seek(end) || file.write(record) != record.size() ||
+      !syncToDisk(file)) {
+    errorMsg = "Cannot append to journal: " + file.errorString();
+    return false;
+  }
+  return true;
+}
+
+bool ScrobbleJournal::replay(QList<ScrobbleData> &rows, QString &warnings,
+                             QString &errorMsg) const {
+  QFile file(m_filePath);
+  if (!file.exists())
+    return true;
+  if (!file.open(QIODevice::ReadOnly)) {
+    errorMsg = "Cannot read journal: " + file.errorString();
+    return false;
+  }
+  const QByteArray data = file.readAll();
+  file.close();
+
+  const char *pos = data.constData();
+  const char *end = pos + data.size();
+  while (end - pos >= RECORD_HEADER_SIZE &&
+         qFromLittleEndian<quint32>(pos) == RECORD_MAGIC) {
+    const quint32 payloadSize = qFromLittleEndian<quint32>(pos + 4);
+    const quint32 checksum = qFromLittleEndian<quint32>(pos + 8);
+    const char *payload = pos + RECORD_HEADER_SIZE;
+    if (quint64(end - payload) < payloadSize)
+      break; // Torn by a crash during the append; never acknowledged.
+    const char *payloadEnd = payload + payloadSize;
+    const qint64 offset = pos - data.constData();
+    pos = payloadEnd;
+    if (WeekManifest::crc32(payload, payloadSize) != checksum ||
+        payloadSize < 4) {
+      warnings += QString("Skipped corrupt journal record at offset %1; ")
+                      .arg(offset);
+      continue;
+    }
+
+    QList<ScrobbleData> recordRows;
+    const quint32 rowCount = qFromLittleEndian<quint32>(payload);
+    const char *cursor = payload + 4;
+    bool ok = true;
+    for (quint32 i = 0; i < rowCount && ok; ++i) {
+      QString artist, track, album;
+      ok = payloadEnd - cursor >= 8;
+      if (!ok)
+        break;
+      const qint64 uts = qFromLittleEndian<qint64>(cursor);
+      cursor += 8;
+      ok = readString(cursor, payloadEnd, artist) &&
+           readString(cursor, payloadEnd, track) &&
+           readString(cursor, payloadEnd, album);
+      if (ok)
+        recordRows.append(ScrobbleData(artist, track, album, uts));
+    }
+    if (!ok) {
+      warnings += QString("Skipped malformed journal record at offset %1; ")
+                      .arg(offset);
+      continue;
+    }
+    rows.append(recordRows);
+  }
+  return true;
+}
+
+bool ScrobbleJournal::remove(QString &errorMsg) {
+  QFile file(m_filePath);
+  if (file.exists() && !file.remove()) {
+    errorMsg = "Cannot remove journal: " + file.errorString();
+    return false;
+  }
+  return true;
+}
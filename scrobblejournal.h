@@ -0,0 +1,82 @@
+#ifndef SCROBBLEJOURNAL_H
+#define SCROBBLEJOURNAL_H
+
+#include "scrobbledata.h"
+#include <QList>
+#include <QString>
+
+/**
+ * @class ScrobbleJournal
+ * @brief Append-only, checksummed write-ahead log of fetched scrobble pages.
+ * @details Each page is stored as one record with a single sequential write
+ * followed by an fsync, so saving a page never reads or rewrites a week file.
+ * DatabaseManager later folds the journal into the week files in one batch
+ * (see DatabaseManager::foldJournalSync()) and deletes it; a journal left
+ * behind by a crash is folded the next time the user's data is read.
+ *
+ * Record layout (all integers little endian): quint32 magic "LFJR", quint32
+ * payload size, quint32 CRC-32 of the payload, then the payload: quint32 row
+ * count followed by, per row, qint64 uts and the artist, track and album
+ * names as quint32 byte length + UTF-8 bytes. Names rather than dictionary
+ * IDs are stored so that appending never touches the string dictionary.
+ */
+class ScrobbleJournal {
+public:
+  /** @brief Leading magic number of every record ("LFJR"). */
+  static constexpr quint32 RECORD_MAGIC = 0x524A464C;
+  /** @brief Size of the record header in bytes. */
+  static constexpr int RECORD_HEADER_SIZE = 12;
+
+  /**
+   * @brief Constructs a journal bound to the given file.
+   * @param filePath Path of the journal file (need not exist yet).
+   */
+  explicit ScrobbleJournal(const QString &filePath);
+
+  /** @brief Returns true if the journal file exists. */
+  bool exists() const;
+
+  /**
+   * @brief Appends one record and flushes it to stable storage.
+   * @details A torn record left at the end by a crash is cut off first, so
+   * new records always follow the last complete one.
+   * @param rows The scrobbles to append. Invalid rows are skipped.
+   * @param[out] errorMsg Receives a description of the problem on failure.
+   * @return True once the record is durable.
+   */
+  bool append(const QList<ScrobbleData> &rows, QString &errorMsg);
+
+  /**
+   * @brief Reads the rows of every intact record, in append order.
+   * @details Records whose checksum does not match are skipped and reported
+   * in @p warnings; a torn trailing record is ignored.
+   * @param[out] rows Decoded rows are appended here.
+   * @param[out] warnings Receives descriptions of skipped records.
+   * @param[out] errorMsg Receives a description of the problem on failure.
+   * @return False if the journal exists but cannot be read.
+   */
+  bool replay(QList<ScrobbleData> &rows, QString &warnings,
+              QString &errorMsg) const;
+
+  /**
+   * @brief Deletes the journal file.
+   * @param[out] errorMsg Receives a description of the problem on failure.
+   * @return True if the file is gone.
+   */
+  bool remove(QString &errorMsg);
+
+  /**
+   * @brief Serializes rows into one record.
+   * @param rows The scrobbles to encode. Invalid rows are skipped.
+   * @return The record bytes, header included.
+   */
+  static QByteArray encodeRecord(const QList<ScrobbleData> &rows);
+
+  /** @brief Returns the path of the journal file. */
+  QString filePath() const { return m_filePath; }
+
+private:
+  QString m_filePath; /**< @brief Path of the journal file. */
+};
+
+#endif // SCROBBLEJOURNAL_H
@@ -0,0 +1,537 @@
+/**
+ * @file scrobblejsonparser.cpp
+ * @brief Implementation of the ScrobbleJsonParser streaming decoder.
+ */
+
+#include "scrobblejsonparser.h"
+#include <QByteArrayView>
+
+namespace {
+/** @brief Appends a Unicode code point as UTF-8. */
+void appendUtf8(QByteArray &out, char32_t cp) {
+  if (cp < 0x80) {
+    out.append(char(cp));
+  } else if (cp < 0x800) {
+    out.append(char(0xC0 | (cp >> 6)));
+    out.append(char(0x80 | (cp & 0x3F)));
+  } else if (cp < 0x10000) {
+    out.append(char(0xE0 | (cp >> 12)));
+    out.append(char(0x80 | ((cp >> 6) & 0x3F)));
+    out.append(char(0x80 | (cp & 0x3F)));
+  } else {
+    out.append(char(0xF0 | (cp >> 18)));
+    out.append(char(0x80 | ((cp >> 12) & 0x3F)));
+    out.append(char(0x80 | ((cp >> 6) & 0x3F)));
+    out.append(char(0x80 | (cp & 0x3F)));
+  }
+}
+
+/**
+ * @brief Reads four hex digits.
+ * @param pos Read position; advanced past the digits on success.
+ * @return False if fewer than four hex digits follow.
+ */
+bool readHex4(const char *&pos, const char *end, char32_t &value) {
+  if (end - pos < 4)
+    return false;
+  value = 0;
+  for (int i = 0; i < 4; ++i) {
+    const char c = pos[i];
+    int digit = -1;
+    if (c >= '0' && c <= '9')
+      digit = c - '0';
+    else if (c >= 'a' && c <= 'f')
+      digit = c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F')
+      digit = c - 'A' + 10;
+    if (digit < 0)
+      return false;
+    value = (value << 4) | char32_t(digit);
+  }
+  pos += 4;
+  return true;
+}
+
+/**
+ * @brief Decodes the escape sequences of a string body into UTF-8.
+ * @details Unpaired surrogates become U+FFFD.
+ * @return False on an invalid escape sequence.
+ */
+bool unescape(const char *pos, const char *end, QByteArray &out) {
+  out.reserve(end - pos);
+  while (pos < end) {
+    const char c = *pos++;
+    if (c != '\\') {
+      out.append(c);
+      continue;
+    }
+    if (pos == end)
+      return false;
+    const char escape = *pos++;
+    switch (escape) {
+    case '"':
+    case '\\':
+    case '/':
+      out.append(escape);
+      break;
+    case 'b':
+      out.append('\b');
+      break;
+    case 'f':
+      out.append('\f');
+      break;
+    case 'n':
+      out.append('\n');
+      break;
+    case 'r':
+      out.append('\r');
+      break;
+    case 't':
+      out.append('\t');
+      break;
+    case 'u': {
+      char32_t cp = 0;
+      if (!readHex4(pos, end, cp))
+        return false;
+      if (cp >= 0xD800 && cp <= 0xDBFF) {
+        const char *next = pos + 2;
+        char32_t low = 0;
+        if (end - pos >= 6 && pos[0] == '\\' && pos[1] == 'u' &&
+            readHex4(next, end, low) && low >= 0xDC00 && low <= 0xDFFF) {
+          pos = next;
+          cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+        } else {
+          cp = 0xFFFD;
+        }
+      } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+        cp = 0xFFFD;
+      }
+      appendUtf8(out, cp);
+      break;
+    }
+    default:
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @class JsonReader
+ * @brief Forward-only JSON tokenizer over a byte buffer.
+ * @details Methods return false on a syntax error and leave the reader
+ * failed; the offset of the first error is kept for the message. The object
+ * and array iterators also return false at the closing bracket, so callers
+ * check failed() after their loops.
+ */
+class JsonReader {
+public:
+  explicit JsonReader(const QByteArray &data)
+      : m_begin(data.constData()), m_pos(m_begin),
+        m_end(m_begin + data.size()) {}
+
+  bool failed() const { return m_failed; }
+
+  QString errorString() const {
+    return QString("JSON syntax error at offset %1.").arg(m_errorOffset);
+  }
+
+  /** @brief Returns the next non-whitespace byte, or 0 at the end. */
+  char peek() {
+    while (m_pos < m_end && (*m_pos == ' ' || *m_pos == '\n' ||
+                             *m_pos == '\r' || *m_pos == '\t'))
+      ++m_pos;
+    return m_pos < m_end ? *m_pos : '\0';
+  }
+
+  /** @brief Consumes @p c, which must be the next token. */
+  bool expect(char c) {
+    if (m_failed || peek() != c)
+      return fail();
+    ++m_pos;
+    return true;
+  }
+
+  /** @brief Fails unless only whitespace is left. */
+  bool expectEnd() { return peek() == '\0' && m_pos == m_end ? true : fail(); }
+
+  /**
+   * @brief Advances to the next member of an object opened with expect('{').
+   * @param first True before the first member; cleared by the call.
+   * @param[out] key The member name; valid until the next key is read.
+   * @return False at the closing brace or on error.
+   */
+  bool nextMember(bool &first, QByteArrayView &key) {
+    return advance(first, '}') && readRawString(key) && expect(':');
+  }
+
+  /**
+   * @brief Advances to the next element of an array opened with expect('[').
+   * @param first True before the first element; cleared by the call.
+   * @return False at the closing bracket or on error.
+   */
+  bool nextElement(bool &first) { return advance(first, ']'); }
+
+  /**
+   * @brief Reads a string value. Any other value is skipped and yields an
+   * empty string.
+   */
+  bool readString(QString &out) {
+    if (peek() != '"') {
+      out.clear();
+      return skipValue();
+    }
+    const char *start = ++m_pos;
+    bool escaped = false;
+    if (!scanString(escaped))
+      return false;
+    const char *stop = m_pos - 1;
+    if (!escaped) {
+      out = QString::fromUtf8(start, stop - start);
+      return true;
+    }
+    m_scratch.clear();
+    if (!unescape(start, stop, m_scratch))
+      return fail();
+    out = QString::fromUtf8(m_scratch);
+    return true;
+  }
+
+  /**
+   * @brief Reads an integer given as a JSON number or as a numeric string.
+   * @details Non-numeric strings and other values yield 0.
+   */
+  bool readInteger(qint64 &out) {
+    out = 0;
+    const char c = peek();
+    QByteArrayView token;
+    if (c == '"') {
+      if (!readRawString(token))
+        return false;
+    } else if (c == '-' || (c >= '0' && c <= '9')) {
+      const char *start = m_pos;
+      while (m_pos < m_end && isNumberChar(*m_pos))
+        ++m_pos;
+      token = QByteArrayView(start, m_pos - start);
+    } else {
+      return skipValue();
+    }
+
+    qsizetype i = 0;
+    const bool negative = !token.isEmpty() && token[0] == '-';
+    if (negative)
+      ++i;
+    quint64 value = 0;
+    for (; i < token.size() && token[i] >= '0' && token[i] <= '9'; ++i)
+      value = value * 10 + quint64(token[i] - '0');
+    if (i == token.size()) {
+      out = negative ? -qint64(value) : qint64(value);
+    } else {
+      bool ok = false;
+      const double d =
+          QByteArray::fromRawData(token.data(), token.size()).toDouble(&ok);
+      if (ok)
+        out = qint64(d);
+    }
+    return true;
+  }
+
+  /** @brief Skips one value of any type. */
+  bool skipValue() {
+    const char c = peek();
+    bool escaped = false;
+    if (c == '"') {
+      ++m_pos;
+      return scanString(escaped);
+    }
+    if (c == '{' || c == '[') {
+      int depth = 0;
+      while (m_pos < m_end) {
+        const char d = *m_pos++;
+        if (d == '"') {
+          if (!scanString(escaped))
+            return false;
+        } else if (d == '{' || d == '[') {
+          ++depth;
+        } else if (d == '}' || d == ']') {
+          if (--depth == 0)
+            return true;
+        }
+      }
+      return fail();
+    }
+    const char *start = m_pos;
+    while (m_pos < m_end &&
+           ((*m_pos >= 'a' && *m_pos <= 'z') || isNumberChar(*m_pos)))
+      ++m_pos;
+    return m_pos != start ? true : fail();
+  }
+
+private:
+  static bool isNumberChar(char c) {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' ||
+           c == 'e' || c == 'E';
+  }
+
+  bool fail() {
+    if (!m_failed) {
+      m_failed = true;
+      m_errorOffset = m_pos - m_begin;
+    }
+    return false;
+  }
+
+  bool advance(bool &first, char close) {
+    if (m_failed)
+      return false;
+    const char c = peek();
+    if (c == close) {
+      ++m_pos;
+      return false;
+    }
+    if (!first) {
+      if (c != ',')
+        return fail();
+      ++m_pos;
+    }
+    first = false;
+    return true;
+  }
+
+  /** @brief Moves past the closing quote of a string whose body starts at
+   * the current position. */
+  bool scanString(bool &escaped) {
+    while (m_pos < m_end) {
+      const char c = *m_pos++;
+      if (c == '"')
+        return true;
+      if (c == '\\') {
+        escaped = true;
+        if (m_pos == m_end)
+          break;
+        ++m_pos;
+      } else if (quint8(c) < 0x20) {
+        return fail();
+      }
+    }
+    return fail();
+  }
+
+  /** @brief Reads a string as raw UTF-8; unescaped into m_scratch if
+   * needed. */
+  bool readRawString(QByteArrayView &out) {
+    if (peek() != '"')
+      return fail();
+    const char *start = ++m_pos;
+    bool escaped = false;
+    if (!scanString(escaped))
+      return false;
+    const char *stop = m_pos - 1;
+    if (!escaped) {
+      out = QByteArrayView(start, stop - start);
+      return true;
+    }
+    m_scratch.clear();
+    if (!unescape(start, stop, m_scratch))
+      return fail();
+    out = m_scratch;
+    return true;
+  }
+
+  const char *m_begin;
+  const char *m_pos;
+  const char *m_end;
+  bool m_failed = false;
+  qint64 m_errorOffset = 0;
+  QByteArray m_scratch; /**< @brief Buffer for unescaped strings. */
+};
+
+/** @brief Reads a `{"#text": ...}` object, or a plain string. */
+bool readText(JsonReader &reader, QString &out) {
+  out.clear();
+  if (reader.peek() != '{')
+    return reader.readString(out);
+  reader.expect('{');
+  bool first = true;
+  QByteArrayView key;
+  while (reader.nextMember(first, key)) {
+    if (!(key == "#text" ? reader.readString(out) : reader.skipValue()))
+      return false;
+  }
+  return !reader.failed();
+}
+
+/** @brief Reads one element of `recenttracks.track`. */
+bool readTrack(JsonReader &reader,
+               ScrobbleJsonParser::RecentTracksPage &page) {
+  if (reader.peek() != '{')
+    return reader.skipValue();
+  reader.expect('{');
+  QString artist, name, album, nowPlaying;
+  qint64 uts = 0;
+  bool first = true;
+  QByteArrayView key;
+  while (reader.nextMember(first, key)) {
+    bool ok = true;
+    if (key == "artist") {
+      ok = readText(reader, artist);
+    } else if (key == "name") {
+      ok = reader.readString(name);
+    } else if (key == "album") {
+      ok = readText(reader, album);
+    } else if (key == "date" && reader.peek() == '{') {
+      reader.expect('{');
+      bool firstDate = true;
+      while (ok && reader.nextMember(firstDate, key)) {
+        ok = key == "uts" ? reader.readInteger(uts) : reader.skipValue();
+      }
+    } else if (key == "@attr" && reader.peek() == '{') {
+      reader.expect('{');
+      bool firstAttr = true;
+      while (ok && reader.nextMember(firstAttr, key)) {
+        ok = key == "nowplaying" ? reader.readString(nowPlaying)
+                                 : reader.skipValue();
+      }
+    } else {
+      ok = reader.skipValue();
+    }
+    if (!ok || reader.failed())
+      return false;
+  }
+  if (reader.failed())
+    return false;
+
+  if (nowPlaying == QLatin1String("true"))
+    return true;
+  if (uts > 0)
+    page.scrobbles.append(ScrobbleData(artist, name, album, uts));
+  else
+    ++page.skippedTracks;
+  return true;
+}
+
+/** @brief Reads the `recenttracks` object. */
+bool readRecentTracks(JsonReader &reader,
+                      ScrobbleJsonParser::RecentTracksPage &page) {
+  if (!reader.expect('{'))
+    return false;
+  bool first = true;
+  QByteArrayView key;
+  while (reader.nextMember(first, key)) {
+    bool ok = true;
+    if (key == "track" && reader.peek() == '[') {
+      reader.expect('[');
+      bool firstTrack = true;
+      while (ok && reader.nextElement(firstTrack))
+        ok = readTrack(reader, page);
+    } else if (key == "track") {
+      ok = readTrack(reader, page);
+    } else if (key == "@attr" && reader.peek() == '{') {
+      reader.expect('{');
+      bool firstAttr = true;
+      while (ok && reader.nextMember(firstAttr, key)) {
+        qint64 value = 0;
+        if (key == "page") {
+          ok = reader.readInteger(value);
+          page.page = int(value);
+        } else if (key == "totalPages") {
+          ok = reader.readInteger(value);
+          page.totalPages = int(value);
+        } else {
+          ok = reader.skipValue();
+        }
+      }
+    } else {
+      ok = reader.skipValue();
+    }
+    if (!ok || reader.failed())
+      return false;
+  }
+  return !reader.failed();
+}
+} // namespace
+
+bool ScrobbleJsonParser::parseRecentTracks(const QByteArray &data,
+                                           RecentTracksPage &page,
+                                           QString &errorMsg) {
+  page = RecentTracksPage();
+  JsonReader reader(data);
+  if (reader.expect('{')) {
+    bool first = true;
+    QByteArrayView key;
+    while (reader.nextMember(first, key)) {
+      bool ok = true;
+      if (key == "error") {
+        page.isApiError = true;
+        qint64 code = 0;
+        ok = reader.readInteger(code);
+        page.apiErrorCode = int(code);
+      } else if (key == "message") {
+        ok = reader.readString(page.apiErrorMessage);
+      } else if (key == "recenttracks") {
+        page.hasRecentTracks = true;
+        ok = readRecentTracks(reader, page);
+      } else {
+        ok = reader.skipValue();
+      }
+      if (!ok)
+        break;
+    }
+  }
+  if (reader.failed() || !reader.expectEnd()) {
+    errorMsg = reader.errorString();
+    page = RecentTracksPage();
+    return false;
+  }
+  return true;
+}
+
+bool ScrobbleJsonParser::parseWeekArray(const QByteArray &data,
+                                        QList<ScrobbleData> &rows,
+                                        QString &errorMsg) {
+  JsonReader reader(data);
+  QList<ScrobbleData> parsed;
+  if (reader.expect('[')) {
+    bool first = true;
+    while (reader.nextElement(first)) {
+      if (reader.peek() != '{') {
+        if (!reader.skipValue())
+          break;
+        continue;
+      }
+      reader.expect('{');
+      QString artist, track, album;
+      qint64 uts = 0;
+      bool hasArtist = false;
+      bool hasTrack = false;
+      bool memberFirst = true;
+      QByteArrayView key;
+      bool ok = true;
+      while (ok && reader.nextMember(memberFirst, key)) {
+        if (key == "artist") {
+          hasArtist = true;
+          ok = reader.readString(artist);
+        } else if (key == "track") {
+          hasTrack = true;
+          ok = reader.readString(track);
+        } else if (key == "album") {
+          ok = reader.readString(album);
+        } else if (key == "uts") {
+          ok = reader.readInteger(uts);
+        } else {
+          ok = reader.skipValue();
+        }
+      }
+      if (reader.failed())
+        break;
+      if (hasArtist && hasTrack && uts > 0)
+        parsed.append(ScrobbleData(artist, track, album, uts));
+    }
+  }
+  if (reader.failed() || !reader.expectEnd()) {
+    errorMsg = reader.errorString();
+    return false;
+  }
+  rows.append(parsed);
+  return true;
+}
@@ -0,0 +1,64 @@
+#ifndef SCROBBLEJSONPARSER_H
+#define SCROBBLEJSONPARSER_H
+
+#include "scrobbledata.h"
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+/**
+ * @class ScrobbleJsonParser
+ * @brief Streaming decoder for the two JSON documents the application reads:
+ * `user.getrecenttracks` API pages and legacy weekly JSON files.
+ * @details The input is tokenized in one forward pass and fields are decoded
+ * straight into ScrobbleData, without building a QJsonDocument. Members the
+ * schema does not use (images, URLs, MBIDs) are skipped without being
+ * decoded, and strings are only unescaped when they contain a backslash.
+ * Skipped values are checked for balanced brackets and quotes but not fully
+ * validated.
+ */
+class ScrobbleJsonParser {
+public:
+  /**
+   * @struct RecentTracksPage
+   * @brief Content of one `user.getrecenttracks` response.
+   */
+  struct RecentTracksPage {
+    QList<ScrobbleData> scrobbles; /**< @brief Played tracks, in API order. */
+    int page = 0;                  /**< @brief `@attr.page`. */
+    int totalPages = 0;            /**< @brief `@attr.totalPages`. */
+    bool hasRecentTracks = false;  /**< @brief A `recenttracks` member was
+                                      present. */
+    bool isApiError = false;  /**< @brief The response is an API error. */
+    int apiErrorCode = 0;     /**< @brief `error` code of an API error. */
+    QString apiErrorMessage;  /**< @brief `message` of an API error. */
+    int skippedTracks = 0;    /**< @brief Tracks without a usable date
+                                 (the now playing track is not counted). */
+  };
+
+  /**
+   * @brief Parses a `user.getrecenttracks` JSON response.
+   * @details A `track` member holding a single object instead of an array is
+   * accepted as a one-track page.
+   * @param data The raw response body.
+   * @param[out] page Receives the parsed content.
+   * @param[out] errorMsg Receives a description of a syntax error.
+   * @return False if @p data is not a well-formed JSON object.
+   */
+  static bool parseRecentTracks(const QByteArray &data, RecentTracksPage &page,
+                                QString &errorMsg);
+
+  /**
+   * @brief Parses a legacy JSON week file (array of {artist, track, album,
+   * uts} objects).
+   * @details Elements without artist, track or a positive uts are skipped.
+   * @param data The raw file content.
+   * @param[out] rows Valid scrobbles are appended here.
+   * @param[out] errorMsg Receives a description of a syntax error.
+   * @return False if @p data is not a well-formed JSON array.
+   */
+  static bool parseWeekArray(const QByteArray &data, QList<ScrobbleData> &rows,
+                             QString &errorMsg);
+};
+
+#endif // SCROBBLEJSONPARSER_H
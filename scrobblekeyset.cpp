@@ -0,0 +1,89 @@
+/**
+ * @file scrobblekeyset.cpp
+ * @brief Implementation of the ScrobbleKeySet class.
+ */
+
+#include "scrobblekeyset.h"
+
+namespace {
+/** @brief Smallest table size allocated on first use. */
+constexpr size_t MIN_CAPACITY = 16;
+} // namespace
+
+ScrobbleKeySet::ScrobbleKeySet(qsizetype expectedSize) {
+  if (expectedSize > 0)
+    reserve(expectedSize);
+}
+
+size_t ScrobbleKeySet::slotIndex(qint64 uts, quint32 artistId,
+                                 quint32 trackId, size_t mask) {
+  // splitmix64 finalizer over the packed key.
+  quint64 h = quint64(uts) * 0x9E3779B97F4A7C15ull ^
+              ((quint64(artistId) << 32) | trackId);
+  h ^= h >> 30;
+  h *= 0xBF58476D1CE4E5B9ull;
+  h ^= h >> 27;
+  h *= 0x94D049BB133111EBull;
+  h ^= h >> 31;
+  return size_t(h) & mask;
+}
+
+void ScrobbleKeySet::reserve(qsizetype count) {
+  size_t capacity = MIN_CAPACITY;
+  while (capacity < size_t(count) * 2)
+    capacity *= 2;
+  if (capacity > m_slots.size())
+    rehash(capacity);
+}
+
+void ScrobbleKeySet::rehash(size_t capacity) {
+  std::vector<Slot> old;
+  old.swap(m_slots);
+  m_slots.assign(capacity, Slot());
+  const size_t mask = capacity - 1;
+  for (const Slot &slot : old) {
+    if (slot.uts == 0)
+      continue;
+    size_t i = slotIndex(slot.uts, slot.artistId, slot.trackId, mask);
+    while (m_slots[i].uts != 0)
+      i = (i + 1) & mask;
+    m_slots[i] = slot;
+  }
+}
+
+bool ScrobbleKeySet::insert(const ScrobbleData &scrobble) {
+  if (!scrobble.isValid())
+    return false;
+  if (size_t(m_size + 1) * 2 > m_slots.size())
+    rehash(qMax(MIN_CAPACITY, m_slots.size() * 2));
+
+  const size_t mask = m_slots.size() - 1;
+  size_t i =
+      slotIndex(scrobble.uts, scrobble.artistId, scrobble.trackId, mask);
+  while (m_slots[i].uts != 0) {
+    const Slot &slot = m_slots[i];
+    if (slot.uts == scrobble.uts && slot.artistId == scrobble.artistId &&
+        slot.trackId == scrobble.trackId)
+      return false;
+    i = (i + 1) & mask;
+  }
+  m_slots[i] = {scrobble.uts, scrobble.artistId, scrobble.trackId};
+  ++m_size;
+  return true;
+}
+
+bool ScrobbleKeySet::contains(const ScrobbleData &scrobble) const {
+  if (!scrobble.isValid() || m_slots.empty())
+    return false;
+  const size_t mask = m_slots.size() - 1;
+  size_t i =
+      slotIndex(scrobble.uts, scrobble.artistId, scrobble.trackId, mask);
+  while (m_slots[i].uts != 0) {
+    const Slot &slot = m_slots[i];
+    if (slot.uts == scrobble.uts && slot.artistId == scrobble.artistId &&
+        slot.trackId == scrobble.trackId)
+      return true;
+    i = (i + 1) & mask;
+  }
+  return false;
+}
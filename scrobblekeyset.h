@@ -0,0 +1,65 @@
+#ifndef SCROBBLEKEYSET_H
+#define SCROBBLEKEYSET_H
+
+#include "scrobbledata.h"
+#include <vector>
+
+/**
+ * @class ScrobbleKeySet
+ * @brief Open-addressing hash set of scrobble identities, used to drop
+ * duplicates when new scrobbles are merged into a week file.
+ * @details A scrobble is identified by (uts, artist ID, track ID), so two
+ * different tracks played within the same second are both kept. Keys are
+ * stored inline in one flat array probed linearly; the table never holds
+ * more than half its capacity, and no per-entry allocation takes place.
+ * Only valid scrobbles (uts > 0) can be stored; uts 0 marks an empty slot.
+ */
+class ScrobbleKeySet {
+public:
+  /**
+   * @brief Constructs an empty set.
+   * @param expectedSize Number of keys to reserve room for.
+   */
+  explicit ScrobbleKeySet(qsizetype expectedSize = 0);
+
+  /**
+   * @brief Adds the identity of a scrobble.
+   * @param scrobble The scrobble. Invalid scrobbles are never added.
+   * @return True if it was not in the set yet.
+   */
+  bool insert(const ScrobbleData &scrobble);
+
+  /** @brief Returns true if the identity of @p scrobble is in the set. */
+  bool contains(const ScrobbleData &scrobble) const;
+
+  /** @brief Returns the number of keys in the set. */
+  qsizetype size() const { return m_size; }
+
+  /**
+   * @brief Grows the table so @p count keys fit without rehashing.
+   * @param count The number of keys to make room for.
+   */
+  void reserve(qsizetype count);
+
+private:
+  /**
+   * @struct Slot
+   * @brief One table entry; empty while uts is 0.
+   */
+  struct Slot {
+    qint64 uts = 0;       /**< @brief Timestamp of the scrobble. */
+    quint32 artistId = 0; /**< @brief Interned artist ID. */
+    quint32 trackId = 0;  /**< @brief Interned track ID. */
+  };
+
+  /** @brief Returns the probe start of a key in a table of the given mask. */
+  static size_t slotIndex(qint64 uts, quint32 artistId, quint32 trackId,
+                          size_t mask);
+  /** @brief Reinserts all keys into a table of @p capacity slots. */
+  void rehash(size_t capacity);
+
+  std::vector<Slot> m_slots; /**< @brief The table; size is a power of two. */
+  qsizetype m_size = 0;      /**< @brief Number of occupied slots. */
+};
+
+#endif // SCROBBLEKEYSET_H
@@ -0,0 +1,156 @@
+/**
+ * @file scrobblestore.cpp
+ * @brief Implementation of the memory-mapped ScrobbleStore.
+ */
+
+#include "scrobblestore.h"
+#include "stringdictionary.h"
+#include "weekfile.h"
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QtEndian>
+#include <algorithm>
+
+QUtf8StringView ScrobbleRecordView::artist() const {
+  return store->string(artistId);
+}
+
+QUtf8StringView ScrobbleRecordView::track() const {
+  return store->string(trackId);
+}
+
+QUtf8StringView ScrobbleRecordView::album() const {
+  return store->string(albumId);
+}
+
+ScrobbleStore::ScrobbleStore() = default;
+
+ScrobbleStore::~ScrobbleStore() = default;
+
+bool ScrobbleStore::open(const QString &dictionaryPath,
+                         const QStringList &weekFilePaths, QString &errorMsg) {
+  m_segments.clear();
+  m_weekFiles.clear();
+  m_files.clear();
+  m_stringOffsets.clear();
+  m_dictionary = nullptr;
+  m_rowCount = 0;
+
+  m_segments.reserve(weekFilePaths.size());
+  for (const QString &path : weekFilePaths) {
+    const QDateTime lastModified = QFileInfo(path).lastModified();
+    auto file = std::make_unique<QFile>(path);
+    if (!file->open(QIODevice::ReadOnly)) {
+      errorMsg += "Cannot open file: " + QFileInfo(path).fileName() + "; ";
+      continue;
+    }
+    const qint64 fileSize = file->size();
+    uchar *data = fileSize > 0 ? file->map(0, fileSize) : nullptr;
+    // The mapping outlives the descriptor, which keeps large histories well
+    // below the per-process open file limit.
+    file->close();
+
+    quint32 rowCount = 0;
+    qint64 weekStartUts = 0;
+    if (!data || !WeekFile::readHeader(reinterpret_cast<const char *>(data),
+                                       fileSize, rowCount, weekStartUts)) {
+      errorMsg += "Corrupt file: " + QFileInfo(path).fileName() + "; ";
+      continue;
+    }
+
+    Segment segment;
+    segment.rowCount = rowCount;
+    segment.firstRow = m_rowCount;
+    segment.uts = data + WeekFile::HEADER_SIZE;
+    segment.artist = segment.uts + qint64(rowCount) * 8;
+    segment.track = segment.artist + qint64(rowCount) * 4;
+    segment.album = segment.track + qint64(rowCount) * 4;
+    m_weekFiles.push_back({path, weekStartUts, fileSize,
+                           lastModified.toMSecsSinceEpoch(), rowCount,
+                           m_rowCount});
+    m_rowCount += rowCount;
+    if (rowCount > 0)
+      m_segments.push_back(segment);
+    m_files.push_back(std::move(file));
+  }
+
+  auto dictionary = std::make_unique<QFile>(dictionaryPath);
+  if (!dictionary->exists()) {
+    // No dictionary means no rows were ever written; any mapped segment
+    // resolves to empty strings.
+    return true;
+  }
+  if (!dictionary->open(QIODevice::ReadOnly)) {
+    errorMsg += "Cannot read string dictionary " +
+                QFileInfo(dictionaryPath).fileName() + ": " +
+                dictionary->errorString();
+    return false;
+  }
+  const qint64 dictionarySize = dictionary->size();
+  if (dictionarySize < StringDictionary::HEADER_SIZE) {
+    return true;
+  }
+  m_dictionary = dictionary->map(0, dictionarySize);
+  dictionary->close();
+  if (!m_dictionary) {
+    errorMsg += "Cannot map string dictionary " +
+                QFileInfo(dictionaryPath).fileName();
+    return false;
+  }
+
+  qint64 pos = StringDictionary::HEADER_SIZE;
+  while (pos + 4 <= dictionarySize) {
+    quint32 length = qFromLittleEndian<quint32>(m_dictionary + pos);
+    if (pos + 4 + length > dictionarySize)
+      break;
+    m_stringOffsets.push_back(static_cast<quint32>(pos));
+    pos += 4 + length;
+  }
+  m_files.push_back(std::move(dictionary));
+
+  qDebug() << "[Scrobble Store] Mapped" << m_segments.size() << "segments,"
+           << m_rowCount << "rows," << m_stringOffsets.size() << "strings";
+  return true;
+}
+
+void ScrobbleStore::fillView(const Segment &segment, quint32 row,
+                             ScrobbleRecordView &view) {
+  view.uts = qFromLittleEndian<qint64>(segment.uts + qint64(row) * 8);
+  view.artistId = qFromLittleEndian<quint32>(segment.artist + qint64(row) * 4);
+  view.trackId = qFromLittleEndian<quint32>(segment.track + qint64(row) * 4);
+  view.albumId = qFromLittleEndian<quint32>(segment.album + qint64(row) * 4);
+}
+
+const ScrobbleStore::Segment &
+ScrobbleStore::segmentFor(qsizetype index) const {
+  auto it = std::upper_bound(m_segments.cbegin(), m_segments.cend(), index,
+                             [](qsizetype value, const Segment &segment) {
+                               return value < segment.firstRow;
+                             });
+  return *(it - 1);
+}
+
+ScrobbleRecordView ScrobbleStore::at(qsizetype index) const {
+  Q_ASSERT(index >= 0 && index < m_rowCount);
+  const Segment &segment = segmentFor(index);
+  ScrobbleRecordView view;
+  view.store = this;
+  fillView(segment, static_cast<quint32>(index - segment.firstRow), view);
+  return view;
+}
+
+qint64 ScrobbleStore::utsAt(qsizetype index) const {
+  Q_ASSERT(index >= 0 && index < m_rowCount);
+  const Segment &segment = segmentFor(index);
+  return qFromLittleEndian<qint64>(segment.uts +
+                                   (index - segment.firstRow) * 8);
+}
+
+QUtf8StringView ScrobbleStore::string(quint32 id) const {
+  if (id >= m_stringOffsets.size())
+    return QUtf8StringView();
+  const uchar *entry = m_dictionary + m_stringOffsets[id];
+  quint32 length = qFromLittleEndian<quint32>(entry);
+  return QUtf8StringView(reinterpret_cast<const char *>(entry + 4), length);
+}
@@ -0,0 +1,229 @@
+#ifndef SCROBBLESTORE_H
+#define SCROBBLESTORE_H
+
+#include <QDateTime>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QUtf8StringView>
+#include <QVector>
+#include <memory>
+#include <vector>
+
+class QFile;
+class ScrobbleStore;
+
+/**
+ * @struct ScrobbleRecordView
+ * @brief Lightweight, non-owning view of one scrobble inside a ScrobbleStore.
+ * @details Holds the decoded timestamp and string IDs of a row; the string
+ * accessors return views that point straight into the mapped dictionary
+ * pages. A view is only valid while the store it came from is alive.
+ */
+struct ScrobbleRecordView {
+  const ScrobbleStore *store = nullptr; /**< @brief The owning store. */
+  qint64 uts = 0;       /**< @brief UTC timestamp in seconds since epoch. */
+  quint32 artistId = 0; /**< @brief Dictionary ID of the artist name. */
+  quint32 trackId = 0;  /**< @brief Dictionary ID of the track name. */
+  quint32 albumId = 0;  /**< @brief Dictionary ID of the album name. */
+
+  /** @brief Returns the artist name as a view into the mapped dictionary. */
+  QUtf8StringView artist() const;
+  /** @brief Returns the track name as a view into the mapped dictionary. */
+  QUtf8StringView track() const;
+  /** @brief Returns the album name as a view into the mapped dictionary. */
+  QUtf8StringView album() const;
+  /** @brief Converts the timestamp to a UTC QDateTime (for UI use). */
+  QDateTime timestamp() const {
+    return QDateTime::fromSecsSinceEpoch(uts, Qt::UTC);
+  }
+};
+
+/**
+ * @class ScrobbleStore
+ * @brief Read-only, memory-mapped view over a user's binary week files.
+ * @details Every week file and the string dictionary are mapped with
+ * QFile::map; rows are decoded on access straight from the mapped pages, so
+ * the history is never materialized into a QList<ScrobbleData>. Segments are
+ * ordered by week start, which makes the whole store sorted by timestamp.
+ * The store is immutable after open() and may be shared between threads.
+ */
+class ScrobbleStore {
+public:
+  /** @brief Constructs an empty, closed store. */
+  ScrobbleStore();
+  /** @brief Unmaps all files. */
+  ~ScrobbleStore();
+
+  ScrobbleStore(const ScrobbleStore &) = delete;
+  ScrobbleStore &operator=(const ScrobbleStore &) = delete;
+
+  /**
+   * @struct WeekFileInfo
+   * @brief Identity of a mapped week file, captured when it was opened.
+   * @details Used to tell whether data derived from the store (such as a
+   * persisted analytics snapshot) still matches the files on disk.
+   */
+  struct WeekFileInfo {
+    QString path;              /**< @brief Path of the week file. */
+    qint64 weekStartUts = 0;   /**< @brief Week start from the file header. */
+    qint64 byteSize = 0;       /**< @brief File size in bytes. */
+    qint64 lastModifiedMs = 0; /**< @brief Modified time, ms since epoch. */
+    quint32 rowCount = 0;      /**< @brief Number of rows. */
+    qsizetype firstRow = 0;    /**< @brief Global index of the first row. */
+  };
+
+  /**
+   * @brief Maps the given week files and the string dictionary.
+   * @details Week files are mapped before the dictionary: the dictionary only
+   * grows, so every ID referenced by an already mapped week file is covered.
+   * Corrupt week files are skipped and reported in @p errorMsg.
+   * @param dictionaryPath Path of the user's string dictionary.
+   * @param weekFilePaths Week file paths, sorted by week start.
+   * @param[out] errorMsg Accumulates descriptions of files that could not be
+   * mapped.
+   * @return False if the dictionary could not be mapped, true otherwise.
+   */
+  bool open(const QString &dictionaryPath, const QStringList &weekFilePaths,
+            QString &errorMsg);
+
+  /** @brief Returns the total number of rows across all segments. */
+  qsizetype size() const { return m_rowCount; }
+  /** @brief Returns true if the store holds no rows. */
+  bool isEmpty() const { return m_rowCount == 0; }
+
+  /**
+   * @brief Returns a view of the row at a global index.
+   * @param index Row index in [0, size()).
+   */
+  ScrobbleRecordView at(qsizetype index) const;
+
+  /**
+   * @brief Returns the timestamp of the row at a global index.
+   * @param index Row index in [0, size()).
+   */
+  qint64 utsAt(qsizetype index) const;
+
+  /**
+   * @brief Returns the mapped bytes of a dictionary string.
+   * @param id The dictionary ID.
+   * @return The string view, or an empty view for unknown IDs.
+   */
+  QUtf8StringView string(quint32 id) const;
+
+  /** @brief Returns the number of strings in the mapped dictionary. */
+  int stringCount() const { return static_cast<int>(m_stringOffsets.size()); }
+
+  /**
+   * @brief Returns the mapped week files in time order, including empty ones.
+   * @details The modification time is read before a file is mapped, so a
+   * file rewritten while the store was opening never looks unchanged.
+   */
+  const std::vector<WeekFileInfo> &weekFiles() const { return m_weekFiles; }
+
+  /**
+   * @brief Calls @p visit for every row in timestamp order.
+   * @details Iterates the mapped columns segment by segment, which is the
+   * fastest way to sweep the whole store.
+   * @param visit Callable taking a `const ScrobbleRecordView &`.
+   */
+  template <typename Visitor> void forEach(Visitor visit) const {
+    ScrobbleRecordView view;
+    view.store = this;
+    for (const Segment &segment : m_segments) {
+      for (quint32 i = 0; i < segment.rowCount; ++i) {
+        fillView(segment, i, view);
+        visit(view);
+      }
+    }
+  }
+
+  /**
+   * @brief Calls @p visit for every row in [begin, end) in timestamp order.
+   * @details Like forEach(), but limited to a range of global row indices so
+   * that disjoint ranges can be swept by different threads.
+   * @param begin First global row index.
+   * @param end One past the last global row index.
+   * @param visit Callable taking a `const ScrobbleRecordView &`.
+   */
+  template <typename Visitor>
+  void forEachInRange(qsizetype begin, qsizetype end, Visitor visit) const {
+    begin = qMax<qsizetype>(begin, 0);
+    end = qMin(end, m_rowCount);
+    if (begin >= end)
+      return;
+    ScrobbleRecordView view;
+    view.store = this;
+    for (const Segment *segment = &segmentFor(begin);
+         segment != m_segments.data() + m_segments.size(); ++segment) {
+      if (segment->firstRow >= end)
+        break;
+      const quint32 first =
+          static_cast<quint32>(qMax(begin - segment->firstRow, qsizetype(0)));
+      const quint32 last = static_cast<quint32>(
+          qMin(end - segment->firstRow, qsizetype(segment->rowCount)));
+      for (quint32 i = first; i < last; ++i) {
+        fillView(*segment, i, view);
+        visit(view);
+      }
+    }
+  }
+
+  /**
+   * @brief Calls @p visit for every row in reverse timestamp order.
+   * @param visit Callable taking a `const ScrobbleRecordView &` and returning
+   * false to stop the iteration early.
+   */
+  template <typename Visitor> void forEachReverse(Visitor visit) const {
+    ScrobbleRecordView view;
+    view.store = this;
+    for (auto it = m_segments.crbegin(); it != m_segments.crend(); ++it) {
+      for (quint32 i = it->rowCount; i > 0; --i) {
+        fillView(*it, i - 1, view);
+        if (!visit(view))
+          return;
+      }
+    }
+  }
+
+private:
+  /**
+   * @struct Segment
+   * @brief Column pointers into one mapped week file.
+   */
+  struct Segment {
+    const uchar *uts = nullptr;    /**< @brief qint64 uts column. */
+    const uchar *artist = nullptr; /**< @brief quint32 artist ID column. */
+    const uchar *track = nullptr;  /**< @brief quint32 track ID column. */
+    const uchar *album = nullptr;  /**< @brief quint32 album ID column. */
+    quint32 rowCount = 0;          /**< @brief Number of rows. */
+    qsizetype firstRow = 0; /**< @brief Global index of the first row. */
+  };
+
+  /**
+   * @brief Decodes one row of a segment into a view.
+   * @param segment The segment holding the row.
+   * @param row Row index inside the segment.
+   * @param[out] view Receives the decoded values.
+   */
+  static void fillView(const Segment &segment, quint32 row,
+                       ScrobbleRecordView &view);
+
+  /**
+   * @brief Finds the segment holding a global row index.
+   * @param index Row index in [0, size()).
+   */
+  const Segment &segmentFor(qsizetype index) const;
+
+  std::vector<std::unique_ptr<QFile>>
+      m_files; /**< @brief Mapped files; kept alive to keep the maps valid. */
+  std::vector<Segment> m_segments; /**< @brief Week segments in time order. */
+  std::vector<WeekFileInfo>
+      m_weekFiles; /**< @brief Identity of every mapped week file. */
+  const uchar *m_dictionary = nullptr; /**< @brief Mapped dictionary bytes. */
+  std::vector<quint32>
+      m_stringOffsets; /**< @brief Offset of each entry's length prefix. */
+  qsizetype m_rowCount = 0; /**< @brief Total rows across all segments. */
+};
+
+#endif // SCROBBLESTORE_H
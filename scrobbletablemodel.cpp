@@ -0,0 +1,338 @@
+/**
+ * @file scrobbletablemodel.cpp
+ * @brief Implementation of the ScrobbleTableModel and
+ * ScrobbleSortFilterProxyModel classes.
+ */
+
+#include "scrobbletablemodel.h"
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QtConcurrent>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+ScrobbleTableModel::ScrobbleTableModel(QObject *parent)
+    : QAbstractTableModel(parent) {}
+
+void ScrobbleTableModel::setStore(QSharedPointer<const ScrobbleStore> store) {
+  if (store == m_store)
+    return;
+  beginResetModel();
+  m_store = std::move(store);
+  endResetModel();
+}
+
+int ScrobbleTableModel::rowCount(const QModelIndex &parent) const {
+  if (parent.isValid() || !m_store)
+    return 0;
+  return int(qMin<qsizetype>(m_store->size(), std::numeric_limits<int>::max()));
+}
+
+int ScrobbleTableModel::columnCount(const QModelIndex &parent) const {
+  return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant ScrobbleTableModel::data(const QModelIndex &index, int role) const {
+  if (role != Qt::DisplayRole || !m_store || !index.isValid() ||
+      index.row() >= m_store->size()) {
+    return QVariant();
+  }
+  const ScrobbleRecordView row = m_store->at(index.row());
+  switch (index.column()) {
+  case DateColumn:
+    return row.timestamp().toLocalTime().toString("yyyy-MM-dd hh:mm");
+  case ArtistColumn:
+    return row.artist().toString();
+  case TrackColumn:
+    return row.track().toString();
+  case AlbumColumn:
+    return row.album().toString();
+  default:
+    return QVariant();
+  }
+}
+
+QVariant ScrobbleTableModel::headerData(int section,
+                                        Qt::Orientation orientation,
+                                        int role) const {
+  if (role != Qt::DisplayRole)
+    return QVariant();
+  if (orientation == Qt::Vertical)
+    return section + 1;
+  switch (section) {
+  case DateColumn:
+    return QStringLiteral("Date");
+  case ArtistColumn:
+    return QStringLiteral("Artist");
+  case TrackColumn:
+    return QStringLiteral("Track");
+  case AlbumColumn:
+    return QStringLiteral("Album");
+  default:
+    return QVariant();
+  }
+}
+
+ScrobbleSortFilterProxyModel::ScrobbleSortFilterProxyModel(QObject *parent)
+    : QAbstractProxyModel(parent) {
+  connect(&m_watcher, &QFutureWatcherBase::finished, this,
+          &ScrobbleSortFilterProxyModel::handlePermutationReady);
+}
+
+void ScrobbleSortFilterProxyModel::setSourceModel(
+    QAbstractItemModel *sourceModel) {
+  if (m_scrobbleModel) {
+    disconnect(m_scrobbleModel, nullptr, this, nullptr);
+  }
+  m_scrobbleModel = qobject_cast<ScrobbleTableModel *>(sourceModel);
+  if (sourceModel && !m_scrobbleModel) {
+    qWarning() << "[Table Proxy] Source is not a ScrobbleTableModel.";
+  }
+  beginResetModel();
+  QAbstractProxyModel::setSourceModel(m_scrobbleModel);
+  m_mapped = false;
+  m_permutation = Permutation();
+  endResetModel();
+  if (m_scrobbleModel) {
+    connect(m_scrobbleModel, &QAbstractItemModel::modelAboutToBeReset, this,
+            [this]() { beginResetModel(); });
+    connect(m_scrobbleModel, &QAbstractItemModel::modelReset, this,
+            &ScrobbleSortFilterProxyModel::handleSourceReset);
+  }
+  rebuild();
+}
+
+void ScrobbleSortFilterProxyModel::setFilterText(const QString &text) {
+  if (text == m_filterText)
+    return;
+  m_filterText = text;
+  rebuild();
+}
+
+void ScrobbleSortFilterProxyModel::sort(int column, Qt::SortOrder order) {
+  if (column < 0 || column >= ScrobbleTableModel::ColumnCount)
+    return;
+  if (column == m_sortColumn && order == m_sortOrder)
+    return;
+  m_sortColumn = column;
+  m_sortOrder = order;
+  rebuild();
+}
+
+bool ScrobbleSortFilterProxyModel::needsPermutation() const {
+  return !m_filterText.isEmpty() ||
+         m_sortColumn != ScrobbleTableModel::DateColumn;
+}
+
+void ScrobbleSortFilterProxyModel::handleSourceReset() {
+  // The old permutations index the previous store; until the new ones are
+  // built the table shows nothing rather than wrong rows.
+  m_permutation = Permutation();
+  m_mapped = needsPermutation();
+  endResetModel();
+  rebuild();
+}
+
+void ScrobbleSortFilterProxyModel::rebuild() {
+  ++m_generation;
+  if (!needsPermutation()) {
+    beginResetModel();
+    m_mapped = false;
+    m_permutation = Permutation();
+    endResetModel();
+    return;
+  }
+  // A running build is restarted with the latest order once it finishes.
+  if (!m_watcher.isRunning())
+    startBuild();
+}
+
+void ScrobbleSortFilterProxyModel::startBuild() {
+  QSharedPointer<const ScrobbleStore> store =
+      m_scrobbleModel ? m_scrobbleModel->store() : nullptr;
+  if (!store) {
+    beginResetModel();
+    m_mapped = true;
+    m_permutation = Permutation();
+    endResetModel();
+    return;
+  }
+  m_buildGeneration = m_generation;
+  const int column = m_sortColumn;
+  const Qt::SortOrder order = m_sortOrder;
+  const QString filterText = m_filterText;
+  m_watcher.setFuture(QtConcurrent::run([store, column, order, filterText]() {
+    return buildPermutation(*store, column, order, filterText);
+  }));
+  emit busyChanged(true);
+}
+
+void ScrobbleSortFilterProxyModel::handlePermutationReady() {
+  if (m_buildGeneration != m_generation) {
+    if (needsPermutation()) {
+      startBuild();
+      return;
+    }
+    emit busyChanged(false);
+    return;
+  }
+  beginResetModel();
+  m_mapped = true;
+  m_permutation = m_watcher.result();
+  endResetModel();
+  emit busyChanged(false);
+}
+
+ScrobbleSortFilterProxyModel::Permutation
+ScrobbleSortFilterProxyModel::buildPermutation(const ScrobbleStore &store,
+                                               int column, Qt::SortOrder order,
+                                               const QString &filterText) {
+  QElapsedTimer timer;
+  timer.start();
+  const int stringCount = store.stringCount();
+  const bool byString = column != ScrobbleTableModel::DateColumn;
+
+  // Everything per string is decided once over the dictionary, which is far
+  // smaller than the history; the rows then only compare integers.
+  std::vector<QString> strings;
+  if (byString || !filterText.isEmpty()) {
+    strings.resize(stringCount);
+    for (int id = 0; id < stringCount; ++id)
+      strings[id] = store.string(quint32(id)).toString();
+  }
+  std::vector<char> matches;
+  if (!filterText.isEmpty()) {
+    matches.resize(stringCount);
+    for (int id = 0; id < stringCount; ++id)
+      matches[id] = strings[id].contains(filterText, Qt::CaseInsensitive);
+  }
+  std::vector<quint32> rank;
+  if (byString) {
+    std::vector<quint32> ids(stringCount);
+    std::iota(ids.begin(), ids.end(), 0u);
+    std::sort(ids.begin(), ids.end(), [&](quint32 a, quint32 b) {
+      return QString::compare(strings[a], strings[b], Qt::CaseInsensitive) < 0;
+    });
+    rank.resize(stringCount);
+    for (int i = 0; i < stringCount; ++i)
+      rank[ids[i]] = quint32(i);
+  }
+  auto matchesId = [&](quint32 id) {
+    return id < matches.size() && matches[id];
+  };
+  auto rankOf = [&](quint32 id) {
+    return id < rank.size() ? rank[id] : quint32(stringCount);
+  };
+
+  // (rank, source row) pairs; rows are in time order, so sorting the pairs
+  // breaks ties by time.
+  std::vector<std::pair<quint32, quint32>> keyed;
+  keyed.reserve(size_t(store.size()));
+  quint32 sourceRow = 0;
+  store.forEach([&](const ScrobbleRecordView &row) {
+    if (filterText.isEmpty() || matchesId(row.artistId) ||
+        matchesId(row.trackId) || matchesId(row.albumId)) {
+      quint32 key = 0;
+      switch (column) {
+      case ScrobbleTableModel::ArtistColumn:
+        key = rankOf(row.artistId);
+        break;
+      case ScrobbleTableModel::TrackColumn:
+        key = rankOf(row.trackId);
+        break;
+      case ScrobbleTableModel::AlbumColumn:
+        key = rankOf(row.albumId);
+        break;
+      default:
+        break;
+      }
+      keyed.emplace_back(key, sourceRow);
+    }
+    ++sourceRow;
+  });
+  if (byString)
+    std::sort(keyed.begin(), keyed.end());
+  if (order == Qt::DescendingOrder)
+    std::reverse(keyed.begin(), keyed.end());
+
+  Permutation permutation;
+  permutation.sourceRows.reserve(keyed.size());
+  permutation.proxyRows.assign(size_t(store.size()), -1);
+  for (const auto &entry : keyed) {
+    permutation.proxyRows[entry.second] =
+        qint32(permutation.sourceRows.size());
+    permutation.sourceRows.push_back(entry.second);
+  }
+  qDebug() << "[Table Proxy] Ordered" << permutation.sourceRows.size() << "of"
+           << store.size() << "rows in" << timer.elapsed() << "ms";
+  return permutation;
+}
+
+QModelIndex
+ScrobbleSortFilterProxyModel::index(int row, int column,
+                                    const QModelIndex &parent) const {
+  if (parent.isValid() || row < 0 || row >= rowCount() || column < 0 ||
+      column >= columnCount()) {
+    return QModelIndex();
+  }
+  return createIndex(row, column);
+}
+
+QModelIndex ScrobbleSortFilterProxyModel::parent(const QModelIndex &) const {
+  return QModelIndex();
+}
+
+int ScrobbleSortFilterProxyModel::rowCount(const QModelIndex &parent) const {
+  if (parent.isValid() || !m_scrobbleModel)
+    return 0;
+  return m_mapped ? int(m_permutation.sourceRows.size())
+                  : m_scrobbleModel->rowCount();
+}
+
+int ScrobbleSortFilterProxyModel::columnCount(
+    const QModelIndex &parent) const {
+  return parent.isValid() ? 0 : ScrobbleTableModel::ColumnCount;
+}
+
+QModelIndex
+ScrobbleSortFilterProxyModel::mapToSource(const QModelIndex &proxyIndex) const {
+  if (!m_scrobbleModel || !proxyIndex.isValid())
+    return QModelIndex();
+  int row = proxyIndex.row();
+  if (m_mapped) {
+    if (size_t(row) >= m_permutation.sourceRows.size())
+      return QModelIndex();
+    row = int(m_permutation.sourceRows[row]);
+  } else if (m_sortOrder == Qt::DescendingOrder) {
+    row = m_scrobbleModel->rowCount() - 1 - row;
+  }
+  return m_scrobbleModel->index(row, proxyIndex.column());
+}
+
+QModelIndex ScrobbleSortFilterProxyModel::mapFromSource(
+    const QModelIndex &sourceIndex) const {
+  if (!m_scrobbleModel || !sourceIndex.isValid())
+    return QModelIndex();
+  int row = sourceIndex.row();
+  if (m_mapped) {
+    if (size_t(row) >= m_permutation.proxyRows.size() ||
+        m_permutation.proxyRows[row] < 0) {
+      return QModelIndex();
+    }
+    row = m_permutation.proxyRows[row];
+  } else if (m_sortOrder == Qt::DescendingOrder) {
+    row = m_scrobbleModel->rowCount() - 1 - row;
+  }
+  return index(row, sourceIndex.column());
+}
+
+QVariant ScrobbleSortFilterProxyModel::headerData(int section,
+                                                  Qt::Orientation orientation,
+                                                  int role) const {
+  // Columns are never permuted, and vertical headers number the proxy rows.
+  if (!m_scrobbleModel)
+    return QVariant();
+  return m_scrobbleModel->headerData(section, orientation, role);
+}
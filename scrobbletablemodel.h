@@ -0,0 +1,169 @@
+#ifndef SCROBBLETABLEMODEL_H
+#define SCROBBLETABLEMODEL_H
+
+#include "scrobblestore.h"
+#include <QAbstractProxyModel>
+#include <QAbstractTableModel>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include <QString>
+#include <vector>
+
+/**
+ * @class ScrobbleTableModel
+ * @brief Table model over every row of a ScrobbleStore.
+ * @details Holds no copy of the history: data() decodes the requested row
+ * from the mapped week files when a view asks for it, so only the visible
+ * rows are ever touched. Rows are in store order (oldest first); sorting and
+ * filtering are left to ScrobbleSortFilterProxyModel.
+ * @inherits QAbstractTableModel
+ */
+class ScrobbleTableModel : public QAbstractTableModel {
+  Q_OBJECT
+public:
+  /** @brief The columns of the table. */
+  enum Column {
+    DateColumn,   /**< @brief Local date and time of the scrobble. */
+    ArtistColumn, /**< @brief Artist name. */
+    TrackColumn,  /**< @brief Track name. */
+    AlbumColumn,  /**< @brief Album name. */
+    ColumnCount   /**< @brief Number of columns. */
+  };
+
+  /**
+   * @brief Constructs an empty model.
+   * @param parent The parent QObject, defaults to nullptr.
+   */
+  explicit ScrobbleTableModel(QObject *parent = nullptr);
+
+  /**
+   * @brief Shows the rows of a store, resetting the model.
+   * @param store The store, or null to show nothing (and release the
+   * mapped files).
+   */
+  void setStore(QSharedPointer<const ScrobbleStore> store);
+  /** @brief Returns the store shown, or null. */
+  QSharedPointer<const ScrobbleStore> store() const { return m_store; }
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index,
+                int role = Qt::DisplayRole) const override;
+  QVariant headerData(int section, Qt::Orientation orientation,
+                      int role = Qt::DisplayRole) const override;
+
+private:
+  QSharedPointer<const ScrobbleStore> m_store; /**< @brief Rows shown. */
+};
+
+/**
+ * @class ScrobbleSortFilterProxyModel
+ * @brief Sorting and filtering proxy for a ScrobbleTableModel that does its
+ * work off the GUI thread.
+ * @details The proxy keeps two index permutations: proxy row to source row,
+ * and source row to proxy row (-1 for rows filtered out). They are built by
+ * buildPermutation() in a QtConcurrent task; until it finishes the previous
+ * order stays on screen (a new store shows no rows) and busyChanged reports
+ * the work. Requests arriving meanwhile are folded into one rebuild once the
+ * running task ends.
+ *
+ * Date order without a filter is the store's own order (or its reverse), so
+ * it is mapped arithmetically and needs neither a task nor permutations.
+ * Sorting by a string column ranks the dictionary once and then sorts the
+ * rows by integer rank, ties by time; the filter is a case-insensitive
+ * substring match on artist, track or album, likewise decided once per
+ * dictionary string.
+ * @inherits QAbstractProxyModel
+ */
+class ScrobbleSortFilterProxyModel : public QAbstractProxyModel {
+  Q_OBJECT
+public:
+  /**
+   * @struct Permutation
+   * @brief Row mapping produced by buildPermutation().
+   */
+  struct Permutation {
+    std::vector<quint32> sourceRows; /**< @brief Source row per proxy row. */
+    std::vector<qint32> proxyRows;   /**< @brief Proxy row per source row, or
+                                        -1 if filtered out. */
+  };
+
+  /**
+   * @brief Constructs a proxy sorted by date, newest first.
+   * @param parent The parent QObject, defaults to nullptr.
+   */
+  explicit ScrobbleSortFilterProxyModel(QObject *parent = nullptr);
+
+  /**
+   * @brief Sets the model to sort and filter.
+   * @param sourceModel A ScrobbleTableModel.
+   */
+  void setSourceModel(QAbstractItemModel *sourceModel) override;
+  /**
+   * @brief Keeps only the rows whose artist, track or album contains a text.
+   * @param text The text, compared case-insensitively; empty keeps all rows.
+   */
+  void setFilterText(const QString &text);
+  /** @brief Returns the filter text. */
+  QString filterText() const { return m_filterText; }
+  /** @brief Returns true while a permutation is being built. */
+  bool isBusy() const { return m_watcher.isRunning(); }
+
+  /**
+   * @brief Builds the permutation for a sort order and filter.
+   * @details Runs on any thread; the store is only read.
+   * @param store The rows to order.
+   * @param column The ScrobbleTableModel::Column to sort by.
+   * @param order The sort order.
+   * @param filterText The filter, or empty for all rows.
+   */
+  static Permutation buildPermutation(const ScrobbleStore &store, int column,
+                                      Qt::SortOrder order,
+                                      const QString &filterText);
+
+  void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+  QModelIndex index(int row, int column,
+                    const QModelIndex &parent = QModelIndex()) const override;
+  QModelIndex parent(const QModelIndex &child) const override;
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+  QModelIndex mapToSource(const QModelIndex &proxyIndex) const override;
+  QModelIndex mapFromSource(const QModelIndex &sourceIndex) const override;
+  QVariant headerData(int section, Qt::Orientation orientation,
+                      int role = Qt::DisplayRole) const override;
+
+signals:
+  /**
+   * @brief Emitted when a permutation build starts or the last one ends.
+   * @param busy True while building.
+   */
+  void busyChanged(bool busy);
+
+private slots:
+  /** @brief Applies a finished build, or starts the next one if stale. */
+  void handlePermutationReady();
+  /** @brief Drops the permutations of the previous store and rebuilds. */
+  void handleSourceReset();
+
+private:
+  /** @brief Returns true if the current order needs permutations. */
+  bool needsPermutation() const;
+  /** @brief Re-derives the mapping after the order or filter changed. */
+  void rebuild();
+  /** @brief Starts a build for the current order and filter. */
+  void startBuild();
+
+  ScrobbleTableModel *m_scrobbleModel = nullptr; /**< @brief The source. */
+  int m_sortColumn =
+      ScrobbleTableModel::DateColumn; /**< @brief Column sorted by. */
+  Qt::SortOrder m_sortOrder = Qt::DescendingOrder; /**< @brief Sort order. */
+  QString m_filterText;  /**< @brief Current filter, or empty. */
+  bool m_mapped = false; /**< @brief m_permutation holds the mapping. */
+  Permutation m_permutation; /**< @brief Mapping of the current order. */
+  int m_generation = 0;      /**< @brief Bumped by every order change. */
+  int m_buildGeneration = 0; /**< @brief Generation of the running build. */
+  QFutureWatcher<Permutation>
+      m_watcher; /**< @brief Watches the running build. */
+};
+
+#endif // SCROBBLETABLEMODEL_H
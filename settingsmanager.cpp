@@ -84,18 +84,60 @@ int SettingsManager::loadExpectedTotalPages() const {
   return m_settings.value(KEY_EXPECTED_TOTAL_PAGES, 0).toInt();
 }
 
+void SettingsManager::saveImportRange(qint64 startUts, qint64 endUts) {
+  qInfo() << "Settings: Saving import range" << startUts << "-" << endUts;
+  m_settings.setValue(KEY_IMPORT_START, startUts);
+  m_settings.setValue(KEY_IMPORT_END, endUts);
+  m_settings.sync();
+}
+
+qint64 SettingsManager::importRangeStart() const {
+  return m_settings.value(KEY_IMPORT_START, 0).toLongLong();
+}
+
+qint64 SettingsManager::importRangeEnd() const {
+  return m_settings.value(KEY_IMPORT_END, 0).toLongLong();
+}
+
+void SettingsManager::markImportWindowComplete(int windowIndex) {
+  QVariantList windows =
+      m_settings.value(KEY_COMPLETED_IMPORT_WINDOWS).toList();
+  if (windows.contains(windowIndex))
+    return;
+  windows.append(windowIndex);
+  m_settings.setValue(KEY_COMPLETED_IMPORT_WINDOWS, windows);
+  m_settings.sync();
+}
+
+QSet<int> SettingsManager::completedImportWindows() const {
+  QSet<int> windows;
+  const QVariantList values =
+      m_settings.value(KEY_COMPLETED_IMPORT_WINDOWS).toList();
+  for (const QVariant &value : values)
+    windows.insert(value.toInt());
+  return windows;
+}
+
+int SettingsManager::maxPagesInFlight() const {
+  return m_settings.value(KEY_MAX_PAGES_IN_FLIGHT, 4).toInt();
+}
+
+QString SettingsManager::apiBaseUrl() const {
+  return m_settings.value(KEY_API_BASE_URL).toString();
+}
+
 void SettingsManager::clearResumeState() {
-  qInfo()
-      << "Settings: Clearing resume state (lastSavedPage, expectedTotalPages).";
+  qInfo() << "Settings: Clearing resume state (lastSavedPage, "
+             "expectedTotalPages, import range and windows).";
   bool changed = false;
 
-  if (m_settings.contains(KEY_LAST_SAVED_PAGE)) {
-    m_settings.remove(KEY_LAST_SAVED_PAGE);
-    changed = true;
-  }
-  if (m_settings.contains(KEY_EXPECTED_TOTAL_PAGES)) {
-    m_settings.remove(KEY_EXPECTED_TOTAL_PAGES);
-    changed = true;
+  for (const QString &key :
+       {KEY_LAST_SAVED_PAGE, KEY_EXPECTED_TOTAL_PAGES, KEY_IMPORT_START,
+        KEY_IMPORT_END, KEY_COMPLETED_IMPORT_WINDOWS}) {
+    if (m_settings.contains(key)) {
+      m_settings.remove(key);
+      changed = true;
+    }
   }
   if (changed) {
     m_settings.sync();
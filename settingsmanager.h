@@ -2,6 +2,7 @@
 #define SETTINGSMANAGER_H
 
 #include <QObject>
+#include <QSet>
 #include <QSettings>
 #include <QString>
 
@@ -83,9 +84,52 @@ public:
    * @return The saved total pages count, or 0 if not set.
    */
   int loadExpectedTotalPages() const;
+  /**
+   * @brief Saves the time range of a windowed initial import.
+   * @details Fixed when the import starts, so the windows stay the same when
+   * it is resumed.
+   * @param startUts Start of the history (inclusive).
+   * @param endUts End of the imported range (exclusive).
+   */
+  void saveImportRange(qint64 startUts, qint64 endUts);
+  /**
+   * @brief Loads the start of the windowed import range.
+   * @return The saved start, or 0 if not set.
+   */
+  qint64 importRangeStart() const;
+  /**
+   * @brief Loads the end of the windowed import range.
+   * @return The saved end, or 0 if not set.
+   */
+  qint64 importRangeEnd() const;
+  /**
+   * @brief Records an import window whose scrobbles have been saved.
+   * @param windowIndex Grid index of the window.
+   */
+  void markImportWindowComplete(int windowIndex);
+  /**
+   * @brief Loads the import windows whose scrobbles have been saved.
+   * @return The grid indices of the saved windows.
+   */
+  QSet<int> completedImportWindows() const;
+  /**
+   * @brief Gets the number of API page requests kept in flight during a fetch.
+   * @details Not exposed in the settings dialog; edit the settings file to
+   * change it.
+   * @return The configured window size, 4 if not set.
+   */
+  int maxPagesInFlight() const;
+  /**
+   * @brief Gets the Last.fm API endpoint.
+   * @details Not exposed in the settings dialog; set it in the settings file
+   * to point the client at a local mock server.
+   * @return The configured endpoint, or an empty string for the default.
+   */
+  QString apiBaseUrl() const;
   /**
    * @brief Clears settings related to resuming an initial fetch (last saved
-   * page, expected total pages).
+   * page, expected total pages, fetch end, import range and completed
+   * windows).
    * @details Typically called when a fetch completes successfully or the user
    * changes.
    */
@@ -107,6 +151,20 @@ private:
   const QString KEY_EXPECTED_TOTAL_PAGES =
       "state/expectedTotalPages"; /**< @brief Settings key for the expected
                                      total pages during initial fetch. */
+  const QString KEY_IMPORT_START =
+      "state/importStartUts"; /**< @brief Settings key for the start of the
+                                 windowed import range. */
+  const QString KEY_IMPORT_END =
+      "state/importEndUts"; /**< @brief Settings key for the end of the
+                               windowed import range. */
+  const QString KEY_COMPLETED_IMPORT_WINDOWS =
+      "state/completedImportWindows"; /**< @brief Settings key for the saved
+                                         import windows. */
+  const QString KEY_MAX_PAGES_IN_FLIGHT =
+      "network/maxPagesInFlight"; /**< @brief Settings key for the number of
+                                     concurrent page requests. */
+  const QString KEY_API_BASE_URL =
+      "network/apiBaseUrl"; /**< @brief Settings key for the API endpoint. */
 };
 
 #endif // SETTINGSMANAGER_H
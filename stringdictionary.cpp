@@ -0,0 +1,210 @@
+/**
+ * @file stringdictionary.cpp
+ * @brief Implementation of the StringDictionary class.
+ */
+
+#include "stringdictionary.h"
+#include "stringinterner.h"
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QtEndian>
+#include <cstring>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+const char DICTIONARY_MAGIC[4] = {'L', 'F', 'M', 'D'};
+
+/** @brief Flushes a file and forces its data to the storage device. */
+bool syncToDisk(QFile &file) {
+  if (!file.flush())
+    return false;
+#ifdef Q_OS_WIN
+  return _commit(file.handle()) == 0;
+#else
+  return ::fsync(file.handle()) == 0;
+#endif
+}
+} // namespace
+
+StringDictionary::StringDictionary(const QString &filePath)
+    : m_filePath(filePath) {}
+
+bool StringDictionary::load(QString &errorMsg) {
+  m_strings.clear();
+  m_ids.clear();
+  m_globalIds.clear();
+  m_localIds.clear();
+  m_persistedCount = 0;
+  m_persistedBytes = 0;
+  return refresh(errorMsg);
+}
+
+bool StringDictionary::refresh(QString &errorMsg) {
+  QFile file(m_filePath);
+  if (!file.exists()) {
+    return true;
+  }
+  if (!file.open(QIODevice::ReadOnly)) {
+    errorMsg = "Cannot read string dictionary " +
+               QFileInfo(m_filePath).fileName() + ": " + file.errorString();
+    return false;
+  }
+  QByteArray data = file.readAll();
+  file.close();
+
+  if (m_persistedBytes == 0) {
+    if (data.size() < HEADER_SIZE) {
+      // An empty or partially written header is treated as a fresh file.
+      return true;
+    }
+    if (memcmp(data.constData(), DICTIONARY_MAGIC, 4) != 0) {
+      errorMsg = "Invalid string dictionary header: " +
+                 QFileInfo(m_filePath).fileName();
+      return false;
+    }
+    quint16 version = qFromLittleEndian<quint16>(data.constData() + 4);
+    if (version > FORMAT_VERSION) {
+      errorMsg =
+          QString("Unsupported string dictionary version %1").arg(version);
+      return false;
+    }
+    m_persistedBytes = HEADER_SIZE;
+  }
+
+  // Strings interned but not yet flushed are re-appended after the entries
+  // read from disk so their IDs stay consistent with the file.
+  QList<QString> pending = m_strings.mid(m_persistedCount);
+  m_strings.resize(m_persistedCount);
+  for (int i = m_persistedCount; i < m_globalIds.size(); ++i)
+    m_localIds.remove(m_globalIds.at(i));
+  m_globalIds.resize(m_persistedCount);
+  for (const QString &s : pending)
+    m_ids.remove(s);
+
+  parseEntries(data);
+
+  for (const QString &s : pending)
+    intern(s);
+  return true;
+}
+
+void StringDictionary::parseEntries(const QByteArray &data) {
+  const char *ptr = data.constData();
+  qint64 pos = m_persistedBytes;
+  const qint64 end = data.size();
+  while (pos + 4 <= end) {
+    quint32 length = qFromLittleEndian<quint32>(ptr + pos);
+    if (pos + 4 + length > end) {
+      qWarning() << "[String Dictionary] Ignoring truncated trailing entry in"
+                 << QFileInfo(m_filePath).fileName();
+      break;
+    }
+    QString value = QString::fromUtf8(ptr + pos + 4, length);
+    quint32 id = m_strings.size();
+    m_strings.append(value);
+    m_ids.insert(value, id);
+    appendGlobalId(value, id);
+    pos += 4 + length;
+  }
+  m_persistedBytes = pos;
+  m_persistedCount = m_strings.size();
+}
+
+quint32 StringDictionary::intern(const QString &value) {
+  auto it = m_ids.constFind(value);
+  if (it != m_ids.constEnd())
+    return it.value();
+  quint32 id = m_strings.size();
+  m_strings.append(value);
+  m_ids.insert(value, id);
+  appendGlobalId(value, id);
+  return id;
+}
+
+quint32 StringDictionary::internGlobal(quint32 globalId) {
+  auto it = m_localIds.constFind(globalId);
+  if (it != m_localIds.constEnd())
+    return it.value();
+  return intern(StringInterner::instance().string(globalId));
+}
+
+void StringDictionary::appendGlobalId(const QString &value, quint32 id) {
+  quint32 globalId = StringInterner::instance().intern(value);
+  m_globalIds.append(globalId);
+  m_localIds.insert(globalId, id);
+}
+
+bool StringDictionary::contains(const QString &value, quint32 *id) const {
+  auto it = m_ids.constFind(value);
+  if (it == m_ids.constEnd())
+    return false;
+  if (id)
+    *id = it.value();
+  return true;
+}
+
+QString StringDictionary::string(quint32 id) const {
+  if (id >= static_cast<quint32>(m_strings.size()))
+    return QString();
+  return m_strings.at(id);
+}
+
+quint32 StringDictionary::globalId(quint32 id) const {
+  if (id >= static_cast<quint32>(m_globalIds.size()))
+    return StringInterner::INVALID_ID;
+  return m_globalIds.at(id);
+}
+
+bool StringDictionary::flush(QString &errorMsg) {
+  QFile file(m_filePath);
+  if (!file.open(QIODevice::ReadWrite)) {
+    errorMsg = "Cannot open string dictionary for writing: " +
+               QFileInfo(m_filePath).fileName() + " Error: " +
+               file.errorString();
+    return false;
+  }
+
+  if (m_persistedBytes == 0) {
+    QByteArray header(HEADER_SIZE, '\0');
+    memcpy(header.data(), DICTIONARY_MAGIC, 4);
+    qToLittleEndian<quint16>(FORMAT_VERSION, header.data() + 4);
+    if (!file.resize(0) || file.write(header) != header.size() ||
+        (!hasPendingEntries() && !syncToDisk(file))) {
+      errorMsg = "Failed to write string dictionary header: " +
+                 file.errorString();
+      return false;
+    }
+    m_persistedBytes = HEADER_SIZE;
+  } else if (file.size() != m_persistedBytes) {
+    // Drop a partially written entry left behind by an interrupted append.
+    file.resize(m_persistedBytes);
+  }
+
+  if (hasPendingEntries()) {
+    QByteArray buffer;
+    for (int i = m_persistedCount; i < m_strings.size(); ++i) {
+      QByteArray utf8 = m_strings.at(i).toUtf8();
+      char lengthBytes[4];
+      qToLittleEndian<quint32>(utf8.size(), lengthBytes);
+      buffer.append(lengthBytes, 4);
+      buffer.append(utf8);
+    }
+    if (!file.seek(m_persistedBytes) ||
+        file.write(buffer) != buffer.size() || !syncToDisk(file)) {
+      errorMsg = "Failed to append to string dictionary: " +
+                 file.errorString();
+      file.resize(m_persistedBytes);
+      return false;
+    }
+    m_persistedBytes += buffer.size();
+    m_persistedCount = m_strings.size();
+  }
+  file.close();
+  return true;
+}
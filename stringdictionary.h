@@ -0,0 +1,143 @@
+#ifndef STRINGDICTIONARY_H
+#define STRINGDICTIONARY_H
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+/**
+ * @class StringDictionary
+ * @brief Append-only, per-user table of the artist/track/album strings
+ * referenced by the binary week files.
+ * @details Each distinct string is stored once and identified by its index in
+ * the table. Because entries are only ever appended, an ID handed out once
+ * stays valid for the lifetime of the user's database. On disk the file starts
+ * with an 8 byte header ("LFMD", version) followed by entries of the form
+ * `quint32 byteLength` (little endian) + UTF-8 bytes. A truncated trailing
+ * entry (e.g. from a crash mid-append) is ignored on load and overwritten by
+ * the next flush.
+ *
+ * Every string is also registered with the process-wide StringInterner as it
+ * is loaded or added; globalId() maps a dictionary ID to that interner ID.
+ */
+class StringDictionary {
+public:
+  /** @brief Current on-disk format version of the dictionary file. */
+  static constexpr quint16 FORMAT_VERSION = 1;
+  /** @brief Size of the dictionary file header in bytes. */
+  static constexpr int HEADER_SIZE = 8;
+
+  /**
+   * @brief Constructs an empty dictionary bound to the given file.
+   * @param filePath Path of the dictionary file (need not exist yet).
+   */
+  explicit StringDictionary(const QString &filePath = QString());
+
+  /**
+   * @brief Loads all entries from the dictionary file, replacing any in-memory
+   * state.
+   * @details A missing file is not an error and results in an empty
+   * dictionary.
+   * @param[out] errorMsg Receives a description of the problem on failure.
+   * @return True if the file was missing or read successfully, false if it
+   * exists but is unreadable or has an unknown header.
+   */
+  bool load(QString &errorMsg);
+
+  /**
+   * @brief Reads entries appended to the file since the last load/refresh.
+   * @details Used by readers that run concurrently with the save task and
+   * encounter IDs they do not know yet.
+   * @param[out] errorMsg Receives a description of the problem on failure.
+   * @return True on success.
+   */
+  bool refresh(QString &errorMsg);
+
+  /**
+   * @brief Returns the ID of a string, adding it to the dictionary if needed.
+   * @details Newly added strings are kept pending until flush() is called.
+   * @param value The string to look up.
+   * @return The stable ID of the string.
+   */
+  quint32 intern(const QString &value);
+
+  /**
+   * @brief Returns the dictionary ID of a StringInterner string, adding it to
+   * the dictionary if needed.
+   * @details Avoids hashing the string when the interner ID was seen before.
+   * @param globalId The StringInterner ID.
+   * @return The stable dictionary ID of the string.
+   */
+  quint32 internGlobal(quint32 globalId);
+
+  /**
+   * @brief Looks up the ID of a string without adding it.
+   * @param value The string to look up.
+   * @param[out] id Receives the ID if found.
+   * @return True if the string is present.
+   */
+  bool contains(const QString &value, quint32 *id = nullptr) const;
+
+  /**
+   * @brief Returns the string stored under an ID.
+   * @details The returned QString is implicitly shared with the dictionary, so
+   * copying it does not allocate.
+   * @param id The string ID.
+   * @return The string, or an empty string if the ID is out of range.
+   */
+  QString string(quint32 id) const;
+
+  /**
+   * @brief Returns the StringInterner ID of a dictionary string.
+   * @param id The dictionary ID.
+   * @return The interner ID, or StringInterner::INVALID_ID if out of range.
+   */
+  quint32 globalId(quint32 id) const;
+
+  /** @brief Returns the number of strings (persisted and pending). */
+  int size() const { return m_strings.size(); }
+
+  /** @brief Returns true if strings were interned since the last flush. */
+  bool hasPendingEntries() const {
+    return m_persistedCount < m_strings.size();
+  }
+
+  /**
+   * @brief Appends all pending strings to the dictionary file.
+   * @details Creates the file (with header) if it does not exist yet, even if
+   * nothing is pending. New data is synced to the storage device before
+   * returning, so week files committed afterwards never reference IDs that a
+   * power loss could take back.
+   * @param[out] errorMsg Receives a description of the problem on failure.
+   * @return True on success.
+   */
+  bool flush(QString &errorMsg);
+
+  /** @brief Returns the path of the backing dictionary file. */
+  QString filePath() const { return m_filePath; }
+
+private:
+  /**
+   * @brief Parses entries from raw file content starting at m_persistedBytes.
+   * @param data The complete file content.
+   */
+  void parseEntries(const QByteArray &data);
+
+  /**
+   * @brief Records the StringInterner ID of a newly added entry.
+   * @param value The entry's string.
+   * @param id The entry's dictionary ID.
+   */
+  void appendGlobalId(const QString &value, quint32 id);
+
+  QString m_filePath;            /**< @brief Backing file path. */
+  QList<QString> m_strings;      /**< @brief Strings indexed by ID. */
+  QHash<QString, quint32> m_ids; /**< @brief Reverse lookup string -> ID. */
+  QList<quint32> m_globalIds; /**< @brief StringInterner ID of each entry. */
+  QHash<quint32, quint32>
+      m_localIds; /**< @brief Reverse lookup StringInterner ID -> ID. */
+  int m_persistedCount = 0; /**< @brief Number of entries already on disk. */
+  qint64 m_persistedBytes = 0; /**< @brief Valid byte length of the file. */
+};
+
+#endif // STRINGDICTIONARY_H
@@ -0,0 +1,72 @@
+/**
+ * @file stringinterner.cpp
+ * @brief Implementation of the StringInterner class.
+ */
+
+#include "stringinterner.h"
+
+StringInterner &StringInterner::instance() {
+  static StringInterner interner;
+  return interner;
+}
+
+quint32 StringInterner::intern(const QString &value) {
+  {
+    QReadLocker locker(&m_lock);
+    auto it = m_ids.constFind(value);
+    if (it != m_ids.constEnd())
+      return it.value();
+  }
+  QWriteLocker locker(&m_lock);
+  // Another thread may have added the string between the two locks.
+  auto it = m_ids.constFind(value);
+  if (it != m_ids.constEnd())
+    return it.value();
+  quint32 id = m_strings.size();
+  m_strings.append(value);
+  m_ids.insert(value, id);
+  return id;
+}
+
+quint32 StringInterner::internPair(quint32 artistId, quint32 trackId) {
+  const quint64 key = (quint64(artistId) << 32) | trackId;
+  {
+    QReadLocker locker(&m_lock);
+    auto it = m_pairIds.constFind(key);
+    if (it != m_pairIds.constEnd())
+      return it.value();
+  }
+  QWriteLocker locker(&m_lock);
+  auto it = m_pairIds.constFind(key);
+  if (it != m_pairIds.constEnd())
+    return it.value();
+  quint32 id = m_pairs.size();
+  m_pairs.append(key);
+  m_pairIds.insert(key, id);
+  return id;
+}
+
+QString StringInterner::string(quint32 id) const {
+  QReadLocker locker(&m_lock);
+  if (id >= static_cast<quint32>(m_strings.size()))
+    return QString();
+  return m_strings.at(id);
+}
+
+QPair<quint32, quint32> StringInterner::pair(quint32 pairId) const {
+  QReadLocker locker(&m_lock);
+  if (pairId >= static_cast<quint32>(m_pairs.size()))
+    return qMakePair(INVALID_ID, INVALID_ID);
+  const quint64 key = m_pairs.at(pairId);
+  return qMakePair(quint32(key >> 32), quint32(key));
+}
+
+int StringInterner::size() const {
+  QReadLocker locker(&m_lock);
+  return m_strings.size();
+}
+
+int StringInterner::pairCount() const {
+  QReadLocker locker(&m_lock);
+  return m_pairs.size();
+}
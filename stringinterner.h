@@ -0,0 +1,79 @@
+#ifndef STRINGINTERNER_H
+#define STRINGINTERNER_H
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QReadWriteLock>
+#include <QString>
+#include <limits>
+
+/**
+ * @class StringInterner
+ * @brief Process-wide, thread-safe table assigning stable integer IDs to
+ * artist/track/album strings and to (artist, track) pairs.
+ * @details IDs are dense and handed out in first-seen order, so they can index
+ * plain counter arrays. Scrobbles receive their IDs when they are decoded from
+ * a week file or parsed from an API page; analytics then count by ID and only
+ * resolve names for the final results.
+ *
+ * The persistent form of the string IDs is the per-user StringDictionary next
+ * to the week files: every string a dictionary loads or adds is interned here
+ * in dictionary order, so for the first user loaded in a process the global
+ * IDs equal the on-disk IDs and survive restarts.
+ */
+class StringInterner {
+public:
+  /** @brief ID value meaning "not interned". */
+  static constexpr quint32 INVALID_ID = std::numeric_limits<quint32>::max();
+
+  /** @brief Returns the process-wide instance. */
+  static StringInterner &instance();
+
+  /**
+   * @brief Returns the ID of a string, adding it if needed.
+   * @param value The string to intern.
+   * @return The stable ID of the string.
+   */
+  quint32 intern(const QString &value);
+
+  /**
+   * @brief Returns the ID of an (artist, track) pair, adding it if needed.
+   * @param artistId String ID of the artist.
+   * @param trackId String ID of the track name.
+   * @return The stable ID of the pair.
+   */
+  quint32 internPair(quint32 artistId, quint32 trackId);
+
+  /**
+   * @brief Returns the string stored under an ID.
+   * @param id The string ID.
+   * @return The (implicitly shared) string, or an empty string if unknown.
+   */
+  QString string(quint32 id) const;
+
+  /**
+   * @brief Returns the (artist ID, track ID) stored under a pair ID.
+   * @param pairId The pair ID.
+   * @return The pair, or (INVALID_ID, INVALID_ID) if unknown.
+   */
+  QPair<quint32, quint32> pair(quint32 pairId) const;
+
+  /** @brief Returns the number of interned strings. */
+  int size() const;
+  /** @brief Returns the number of interned (artist, track) pairs. */
+  int pairCount() const;
+
+private:
+  StringInterner() = default;
+  StringInterner(const StringInterner &) = delete;
+  StringInterner &operator=(const StringInterner &) = delete;
+
+  mutable QReadWriteLock m_lock; /**< @brief Guards all members below. */
+  QList<QString> m_strings;      /**< @brief Strings indexed by ID. */
+  QHash<QString, quint32> m_ids; /**< @brief Reverse lookup string -> ID. */
+  QList<quint64> m_pairs; /**< @brief Packed (artist << 32 | track) by ID. */
+  QHash<quint64, quint32> m_pairIds; /**< @brief Reverse lookup for pairs. */
+};
+
+#endif // STRINGINTERNER_H
@@ -1,10 +1,20 @@
 #include <QCoreApplication>
 #include <QDateTime>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QThreadPool>
 #include <QTimeZone>
 #include <QtTest>
 
 #include "analyticsengine.h"
+#include "incrementalanalytics.h"
+#include "rankedcountsmodel.h"
 #include "scrobbledata.h"
+#include "scrobblestore.h"
+#include "scrobbletablemodel.h"
+#include "stringdictionary.h"
+#include "stringinterner.h"
+#include "weekfile.h"
 
 Q_DECLARE_METATYPE(ListeningStreak)
 Q_DECLARE_METATYPE(SortedCounts)
@@ -30,6 +40,7 @@ private slots:
   void cleanup();
 
   void testSortMapByValue();
+  void testStringInterner();
   void testGetTopArtists_data();
   void testGetTopArtists();
   void testGetTopTracks_data();
@@ -45,6 +56,12 @@ private slots:
   void testCalculateListeningStreaks_data();
   void testCalculateListeningStreaks();
   void testAnalyzeAll();
+  void testAnalyzeAllThreadCount();
+  void testScrobbleStoreOverloads();
+  void testIncrementalAnalytics();
+  void testIncrementalAnalyticsDuplicates();
+  void testScrobbleTableModel();
+  void testRankedCountsModel();
 };
 
 QDateTime TestAnalyticsEngine::createUtcDateTime(int year, int month, int day,
@@ -93,11 +110,11 @@ void TestAnalyticsEngine::initTestCase() {
 
   std::sort(m_scrobbles.begin(), m_scrobbles.end(),
             [](const ScrobbleData &a, const ScrobbleData &b) {
-              if (!a.timestamp.isValid())
+              if (!a.timestamp().isValid())
                 return false;
-              if (!b.timestamp.isValid())
+              if (!b.timestamp().isValid())
                 return true;
-              return a.timestamp < b.timestamp;
+              return a.uts < b.uts;
             });
 }
 
@@ -125,12 +142,8 @@ void TestAnalyticsEngine::testSortMapByValue() {
   QCOMPARE(sortedList[0].first, QString("A"));
   QCOMPARE(sortedList[0].second, 50);
 
-  bool b_found = (sortedList[1].first == "B" && sortedList[1].second == 20) ||
-                 (sortedList[2].first == "B" && sortedList[2].second == 20);
-  bool d_found = (sortedList[1].first == "D" && sortedList[1].second == 20) ||
-                 (sortedList[2].first == "D" && sortedList[2].second == 20);
-  QVERIFY(b_found);
-  QVERIFY(d_found);
+  QCOMPARE(sortedList[1], qMakePair(QString("B"), 20));
+  QCOMPARE(sortedList[2], qMakePair(QString("D"), 20));
 
   QCOMPARE(sortedList[3].first, QString("C"));
   QCOMPARE(sortedList[3].second, 10);
@@ -141,6 +154,35 @@ void TestAnalyticsEngine::testSortMapByValue() {
   QVERIFY(emptySortedList.isEmpty());
 }
 
+void TestAnalyticsEngine::testStringInterner() {
+  StringInterner &interner = StringInterner::instance();
+  quint32 artist = interner.intern("Interner Artist");
+  quint32 track = interner.intern("Interner Track");
+  QVERIFY(artist != track);
+  QCOMPARE(interner.intern("Interner Artist"), artist);
+  QCOMPARE(interner.string(artist), QString("Interner Artist"));
+  QVERIFY(interner.string(StringInterner::INVALID_ID).isEmpty());
+
+  quint32 pairId = interner.internPair(artist, track);
+  QCOMPARE(interner.internPair(artist, track), pairId);
+  QVERIFY(interner.internPair(track, artist) != pairId);
+  QCOMPARE(interner.pair(pairId), qMakePair(artist, track));
+
+  ScrobbleData s{"Interner Artist", "Interner Track", "Interner Album",
+                 QDateTime()};
+  QCOMPARE(s.artistId, artist);
+  QCOMPARE(s.trackId, track);
+  QCOMPARE(s.trackKeyId, pairId);
+  QCOMPARE(s.album(), QString("Interner Album"));
+  QVERIFY(!s.isValid());
+  QVERIFY(!s.timestamp().isValid());
+
+  ScrobbleData earlier("Interner Artist", "Interner Track", "", 100);
+  ScrobbleData later("Interner Artist", "Interner Track", "", 200);
+  QVERIFY(earlier < later);
+  QCOMPARE(later.timestamp(), QDateTime::fromSecsSinceEpoch(200, Qt::UTC));
+}
+
 void TestAnalyticsEngine::testGetTopArtists_data() {
   QTest::addColumn<QList<ScrobbleData>>("scrobbles");
   QTest::addColumn<int>("count");
@@ -152,19 +194,19 @@ void TestAnalyticsEngine::testGetTopArtists_data() {
 
   SortedCounts expected_all;
   expected_all << qMakePair(QString("Artist A"), 4)
-               << qMakePair(QString("artist a"), 1)
                << qMakePair(QString("Artist B"), 2)
                << qMakePair(QString("Artist C"), 1)
                << qMakePair(QString("Artist D"), 1)
-               << qMakePair(QString("Artist Inv"), 1);
+               << qMakePair(QString("Artist Inv"), 1)
+               << qMakePair(QString("artist a"), 1);
   QTest::newRow("all_n=50") << m_scrobbles << 50 << expected_all;
   QTest::newRow("all_n=0") << m_scrobbles << 0 << expected_all;
   QTest::newRow("all_n=-1") << m_scrobbles << -1 << expected_all;
 
   SortedCounts expected_top3;
   expected_top3 << qMakePair(QString("Artist A"), 4)
-                << qMakePair(QString("artist a"), 1)
-                << qMakePair(QString("Artist B"), 2);
+                << qMakePair(QString("Artist B"), 2)
+                << qMakePair(QString("Artist C"), 1);
   QTest::newRow("top3") << m_scrobbles << 3 << expected_top3;
 
   SortedCounts expected_top1;
@@ -196,20 +238,20 @@ void TestAnalyticsEngine::testGetTopTracks_data() {
   SortedCounts expected_all;
 
   expected_all << qMakePair(QString("Artist A - Track 1"), 2);
-  expected_all << qMakePair(QString("artist a - track 1"), 1);
-  expected_all << qMakePair(QString("Artist B - Track 2"), 1);
   expected_all << qMakePair(QString("Artist A - Track 3"), 1);
-  expected_all << qMakePair(QString("Artist C - Track 4"), 1);
+  expected_all << qMakePair(QString("Artist A - Track 7"), 1);
+  expected_all << qMakePair(QString("Artist B - Track 2"), 1);
   expected_all << qMakePair(QString("Artist B - Track 5"), 1);
+  expected_all << qMakePair(QString("Artist C - Track 4"), 1);
   expected_all << qMakePair(QString("Artist D - Track 6"), 1);
-  expected_all << qMakePair(QString("Artist A - Track 7"), 1);
   expected_all << qMakePair(QString("Artist Inv - Track Inv"), 1);
+  expected_all << qMakePair(QString("artist a - track 1"), 1);
 
   QTest::newRow("all_n=50") << m_scrobbles << 50 << expected_all;
 
   SortedCounts expected_top2;
   expected_top2 << qMakePair(QString("Artist A - Track 1"), 2);
-  expected_top2 << qMakePair(QString("artist a - track 1"), 1);
+  expected_top2 << qMakePair(QString("Artist A - Track 3"), 1);
   QTest::newRow("top2") << m_scrobbles << 2 << expected_top2;
 }
 
@@ -288,19 +330,19 @@ void TestAnalyticsEngine::testGetMeanScrobblesPerDay_data() {
   QDateTime gap_end = createUtcDateTime(2023, 10, 27, 0, 0, 0);
   QTest::newRow("gap_day") << m_scrobbles << gap_start << gap_end << 0.0 / 1.0;
 
-  QDateTime first_scrobble_time = m_scrobbles.first().timestamp;
+  QDateTime first_scrobble_time = m_scrobbles.first().timestamp();
   qint64 total_seconds = first_scrobble_time.secsTo(t_last_plus_one);
   double total_days = static_cast<double>(total_seconds) / (24.0 * 60.0 * 60.0);
   int valid_scrobble_count = 0;
   for (const auto &s : m_scrobbles) {
-    if (s.timestamp.isValid())
+    if (s.timestamp().isValid())
       valid_scrobble_count++;
   }
   QTest::newRow("full_range")
       << m_scrobbles << first_scrobble_time << t_last_plus_one
       << static_cast<double>(valid_scrobble_count) / total_days;
 
-  QDateTime t_exact = m_scrobbles[0].timestamp;
+  QDateTime t_exact = m_scrobbles[0].timestamp();
   QTest::newRow("tiny_range_one_scrobble")
       << m_scrobbles << t_exact << t_exact.addSecs(1)
       << 1.0 / (1.0 / (24.0 * 60.0 * 60.0));
@@ -330,11 +372,11 @@ void TestAnalyticsEngine::testGetFirstScrobbleDate() {
 
   std::sort(listWithInvalidFirst.begin(), listWithInvalidFirst.end(),
             [](const ScrobbleData &a, const ScrobbleData &b) {
-              if (!a.timestamp.isValid())
+              if (!a.timestamp().isValid())
                 return false;
-              if (!b.timestamp.isValid())
+              if (!b.timestamp().isValid())
                 return true;
-              return a.timestamp < b.timestamp;
+              return a.uts < b.uts;
             });
   QCOMPARE(engine->getFirstScrobbleDate(listWithInvalidFirst), expectedFirst);
 }
@@ -361,8 +403,8 @@ void TestAnalyticsEngine::testGetScrobblesPerHourOfDay() {
 
   QMap<int, int> expectedCountsMap;
   for (const auto &s : m_scrobbles) {
-    if (s.timestamp.isValid()) {
-      int hour = s.timestamp.toLocalTime().time().hour();
+    if (s.timestamp().isValid()) {
+      int hour = s.timestamp().toLocalTime().time().hour();
       expectedCountsMap[hour]++;
     }
   }
@@ -385,8 +427,8 @@ void TestAnalyticsEngine::testGetScrobblesPerDayOfWeek() {
 
   QMap<int, int> expectedCountsMap;
   for (const auto &s : m_scrobbles) {
-    if (s.timestamp.isValid()) {
-      int dayOfWeek = s.timestamp.toLocalTime().date().dayOfWeek();
+    if (s.timestamp().isValid()) {
+      int dayOfWeek = s.timestamp().toLocalTime().date().dayOfWeek();
       expectedCountsMap[dayOfWeek - 1]++;
     }
   }
@@ -428,7 +470,7 @@ void TestAnalyticsEngine::testCalculateListeningStreaks_data() {
   s_streak_yesterday << ScrobbleData{"A", "T", "", yesterday.toUTC()};
   std::sort(
       s_streak_yesterday.begin(), s_streak_yesterday.end(),
-      [](const auto &a, const auto &b) { return a.timestamp < b.timestamp; });
+      [](const auto &a, const auto &b) { return a.uts < b.uts; });
   QTest::newRow("current_ends_yesterday")
       << s_streak_yesterday << 3 << yesterday.date() << 3
       << twoDaysBefore.date();
@@ -442,7 +484,7 @@ void TestAnalyticsEngine::testCalculateListeningStreaks_data() {
   s_streak_today << ScrobbleData{"A", "T", "", today.toUTC()};
   std::sort(
       s_streak_today.begin(), s_streak_today.end(),
-      [](const auto &a, const auto &b) { return a.timestamp < b.timestamp; });
+      [](const auto &a, const auto &b) { return a.uts < b.uts; });
   QTest::newRow("current_ends_today_longest_different")
       << s_streak_today << 3 << wayBefore1.date() << 2 << yesterday.date();
 
@@ -452,7 +494,7 @@ void TestAnalyticsEngine::testCalculateListeningStreaks_data() {
   s_streak_broken << ScrobbleData{"A", "T", "", dayBefore.toUTC()};
   std::sort(
       s_streak_broken.begin(), s_streak_broken.end(),
-      [](const auto &a, const auto &b) { return a.timestamp < b.timestamp; });
+      [](const auto &a, const auto &b) { return a.uts < b.uts; });
   QTest::newRow("streak_broken")
       << s_streak_broken << 2 << wayBefore2.date() << 0 << QDate();
 
@@ -476,7 +518,7 @@ void TestAnalyticsEngine::testCalculateListeningStreaks_data() {
   s_streak_multi_same_day << ScrobbleData{"A", "T4", "", today.toUTC()};
   std::sort(
       s_streak_multi_same_day.begin(), s_streak_multi_same_day.end(),
-      [](const auto &a, const auto &b) { return a.timestamp < b.timestamp; });
+      [](const auto &a, const auto &b) { return a.uts < b.uts; });
   QTest::newRow("multi_same_day")
       << s_streak_multi_same_day << 2 << today.date() << 2 << yesterday.date();
 
@@ -579,11 +621,361 @@ void TestAnalyticsEngine::testAnalyzeAll() {
   QVERIFY(results["mean90"].toDouble() >= 0.0);
   QVERIFY(results["meanAllTime"].toDouble() > 0.0);
 
+  // The fused single pass must agree with the individual methods.
+  QCOMPARE(results["hourlyData"].value<QVector<int>>(),
+           engine->getScrobblesPerHourOfDay(m_scrobbles));
+  QCOMPARE(results["weeklyData"].value<QVector<int>>(),
+           engine->getScrobblesPerDayOfWeek(m_scrobbles));
+  ListeningStreak fusedStreak = results["streak"].value<ListeningStreak>();
+  ListeningStreak streak = engine->calculateListeningStreaks(m_scrobbles);
+  QCOMPARE(fusedStreak.longestStreakDays, streak.longestStreakDays);
+  QCOMPARE(fusedStreak.longestStreakEndDate, streak.longestStreakEndDate);
+  QCOMPARE(fusedStreak.currentStreakDays, streak.currentStreakDays);
+  QDateTime toDate = engine->getLastScrobbleDate(m_scrobbles).addSecs(1);
+  QCOMPARE(results["mean7"].toDouble(),
+           engine->getMeanScrobblesPerDay(m_scrobbles, toDate.addDays(-7),
+                                          toDate));
+  QCOMPARE(results["mean90"].toDouble(),
+           engine->getMeanScrobblesPerDay(m_scrobbles, toDate.addDays(-90),
+                                          toDate));
+  QCOMPARE(results["meanAllTime"].toDouble(),
+           engine->getMeanScrobblesPerDay(
+               m_scrobbles, engine->getFirstScrobbleDate(m_scrobbles), toDate));
+
   QList<ScrobbleData> emptyList;
   QVariantMap emptyResults = engine->analyzeAll(emptyList, topN);
   QVERIFY(emptyResults.isEmpty());
 }
 
+void TestAnalyticsEngine::testAnalyzeAllThreadCount() {
+  // Enough rows for several chunks, with ties between artists and tracks.
+  QList<ScrobbleData> scrobbles;
+  const qint64 start =
+      createUtcDateTime(2020, 1, 1, 0, 0, 0).toSecsSinceEpoch();
+  for (int i = 0; i < 200000; ++i) {
+    scrobbles << ScrobbleData(QString("Artist %1").arg(i % 37),
+                              QString("Track %1").arg(i % 101), "Album",
+                              start + qint64(i) * 397);
+  }
+
+  QThreadPool single;
+  single.setMaxThreadCount(1);
+  QThreadPool several;
+  several.setMaxThreadCount(4);
+  QVariantMap serial = engine->analyzeAll(scrobbles, 10, &single);
+  QVariantMap parallel = engine->analyzeAll(scrobbles, 10, &several);
+
+  QCOMPARE(parallel["topArtists"].value<SortedCounts>(),
+           serial["topArtists"].value<SortedCounts>());
+  QCOMPARE(parallel["topArtists"].value<SortedCounts>(),
+           engine->getTopArtists(scrobbles, 10));
+  QCOMPARE(parallel["topTracks"].value<SortedCounts>(),
+           engine->getTopTracks(scrobbles, 10));
+  QCOMPARE(parallel["hourlyData"].value<QVector<int>>(),
+           engine->getScrobblesPerHourOfDay(scrobbles));
+  QCOMPARE(parallel["weeklyData"].value<QVector<int>>(),
+           engine->getScrobblesPerDayOfWeek(scrobbles));
+  QCOMPARE(parallel["firstDate"].toDateTime(),
+           engine->getFirstScrobbleDate(scrobbles));
+  QCOMPARE(parallel["lastDate"].toDateTime(),
+           engine->getLastScrobbleDate(scrobbles));
+  QCOMPARE(parallel["mean30"].toDouble(), serial["mean30"].toDouble());
+  QCOMPARE(parallel["meanAllTime"].toDouble(),
+           serial["meanAllTime"].toDouble());
+  ListeningStreak streak = parallel["streak"].value<ListeningStreak>();
+  QCOMPARE(streak.longestStreakDays,
+           engine->calculateListeningStreaks(scrobbles).longestStreakDays);
+}
+
+void TestAnalyticsEngine::testScrobbleStoreOverloads() {
+  QList<ScrobbleData> valid;
+  for (const ScrobbleData &s : m_scrobbles) {
+    if (s.timestamp().isValid())
+      valid << s;
+  }
+
+  // Split the rows over two week files to cover multi-segment access.
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  StringDictionary dictionary(dir.filePath("strings.dict"));
+  QStringList weekFiles;
+  const int half = valid.size() / 2;
+  const QList<QList<ScrobbleData>> parts = {valid.mid(0, half),
+                                            valid.mid(half)};
+  for (const QList<ScrobbleData> &part : parts) {
+    qint64 weekStart = part.first().timestamp().toSecsSinceEpoch();
+    QString path =
+        dir.filePath(QString::number(weekStart) + WeekFile::fileSuffix());
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(WeekFile::encode(weekStart, part, dictionary));
+    file.close();
+    weekFiles << path;
+  }
+  QString errorMsg;
+  QVERIFY(dictionary.flush(errorMsg));
+
+  ScrobbleStore store;
+  QVERIFY(store.open(dictionary.filePath(), weekFiles, errorMsg));
+  QVERIFY2(errorMsg.isEmpty(), qPrintable(errorMsg));
+  QCOMPARE(store.size(), valid.size());
+  for (int i = 0; i < valid.size(); ++i) {
+    ScrobbleRecordView row = store.at(i);
+    QCOMPARE(row.timestamp(), valid[i].timestamp());
+    QCOMPARE(row.artist().toString(), valid[i].artist());
+    QCOMPARE(row.track().toString(), valid[i].track());
+    QCOMPARE(row.album().toString(), valid[i].album());
+  }
+
+  QCOMPARE(engine->getTopArtists(store, 0), engine->getTopArtists(valid, 0));
+  QCOMPARE(engine->getTopTracks(store, 2), engine->getTopTracks(valid, 2));
+  QCOMPARE(engine->getArtistPlayCounts(store),
+           engine->getArtistPlayCounts(valid));
+  QCOMPARE(engine->getFirstScrobbleDate(store),
+           engine->getFirstScrobbleDate(valid));
+  QCOMPARE(engine->getLastScrobbleDate(store),
+           engine->getLastScrobbleDate(valid));
+  QCOMPARE(engine->getScrobblesPerHourOfDay(store),
+           engine->getScrobblesPerHourOfDay(valid));
+  QCOMPARE(engine->getScrobblesPerDayOfWeek(store),
+           engine->getScrobblesPerDayOfWeek(valid));
+  QCOMPARE(engine->findLastPlayed(store, "ARTIST A", "track 1"),
+           engine->findLastPlayed(valid, "ARTIST A", "track 1"));
+  QVERIFY(!engine->findLastPlayed(store, "Artist A", "Track 6").isValid());
+
+  QDateTime from = createUtcDateTime(2023, 10, 24, 0, 0, 0);
+  QDateTime to = createUtcDateTime(2023, 10, 29, 0, 0, 0);
+  QCOMPARE(engine->getMeanScrobblesPerDay(store, from, to),
+           engine->getMeanScrobblesPerDay(valid, from, to));
+
+  ListeningStreak storeStreak = engine->calculateListeningStreaks(store);
+  ListeningStreak listStreak = engine->calculateListeningStreaks(valid);
+  QCOMPARE(storeStreak.longestStreakDays, listStreak.longestStreakDays);
+  QCOMPARE(storeStreak.longestStreakEndDate, listStreak.longestStreakEndDate);
+
+  QVariantMap storeResults = engine->analyzeAll(store, 2);
+  QVariantMap listResults = engine->analyzeAll(valid, 2);
+  QCOMPARE(storeResults["topArtists"].value<SortedCounts>(),
+           listResults["topArtists"].value<SortedCounts>());
+  QCOMPARE(storeResults["topTracks"].value<SortedCounts>(),
+           listResults["topTracks"].value<SortedCounts>());
+  QCOMPARE(storeResults["hourlyData"].value<QVector<int>>(),
+           listResults["hourlyData"].value<QVector<int>>());
+  QCOMPARE(storeResults["mean30"].toDouble(), listResults["mean30"].toDouble());
+
+  ScrobbleStore emptyStore;
+  QVERIFY(engine->analyzeAll(emptyStore).isEmpty());
+}
+
+void TestAnalyticsEngine::testIncrementalAnalytics() {
+  QList<ScrobbleData> valid;
+  for (const ScrobbleData &s : m_scrobbles) {
+    if (s.timestamp().isValid())
+      valid << s;
+  }
+  const int half = valid.size() / 2;
+  const QList<ScrobbleData> stored = valid.mid(0, half);
+  const QList<ScrobbleData> fetched = valid.mid(half);
+
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  StringDictionary dictionary(dir.filePath("strings.dict"));
+  qint64 weekStart = stored.first().uts;
+  QString path =
+      dir.filePath(QString::number(weekStart) + WeekFile::fileSuffix());
+  QFile file(path);
+  QVERIFY(file.open(QIODevice::WriteOnly));
+  file.write(WeekFile::encode(weekStart, stored, dictionary));
+  file.close();
+  QString errorMsg;
+  QVERIFY(dictionary.flush(errorMsg));
+  ScrobbleStore store;
+  QVERIFY(store.open(dictionary.filePath(), {path}, errorMsg));
+
+  IncrementalAnalytics state;
+  state.rebuild(store);
+  QCOMPARE(state.scrobbleCount(), qint64(stored.size()));
+  QCOMPARE(state.watermark(), stored.last().uts);
+  QCOMPARE(engine->analyzeAll(state, 0)["topArtists"].value<SortedCounts>(),
+           engine->getTopArtists(stored, 0));
+
+  // Pages arrive newest first; rows already stored are skipped.
+  QList<ScrobbleData> page(fetched.crbegin(), fetched.crend());
+  QCOMPARE(state.apply(page), int(fetched.size()));
+  QCOMPARE(state.apply(stored), 0);
+
+  QVariantMap incremental = engine->analyzeAll(state, 3);
+  QVariantMap full = engine->analyzeAll(valid, 3);
+  for (const QString &key : {QString("firstDate"), QString("lastDate"),
+                             QString("mean7"), QString("mean30"),
+                             QString("mean90"), QString("meanAllTime")}) {
+    QCOMPARE(incremental[key], full[key]);
+  }
+  QCOMPARE(incremental["topArtists"].value<SortedCounts>(),
+           full["topArtists"].value<SortedCounts>());
+  QCOMPARE(incremental["topTracks"].value<SortedCounts>(),
+           full["topTracks"].value<SortedCounts>());
+  QCOMPARE(incremental["hourlyData"].value<QVector<int>>(),
+           full["hourlyData"].value<QVector<int>>());
+  QCOMPARE(incremental["weeklyData"].value<QVector<int>>(),
+           full["weeklyData"].value<QVector<int>>());
+  QCOMPARE(incremental["streak"].value<ListeningStreak>().longestStreakDays,
+           full["streak"].value<ListeningStreak>().longestStreakDays);
+}
+
+void TestAnalyticsEngine::testIncrementalAnalyticsDuplicates() {
+  QList<ScrobbleData> valid;
+  for (const ScrobbleData &s : m_scrobbles) {
+    if (s.timestamp().isValid())
+      valid << s;
+  }
+  const QList<ScrobbleData> page = valid.mid(0, 5);
+
+  IncrementalAnalytics state;
+  QCOMPARE(state.apply(page), int(page.size()));
+  const QVariantMap once = engine->analyzeAll(state);
+  const AnalyticsAccumulator::WindowCounts windows = state.windowCounts();
+
+  // The same page again (e.g. after a resume) counts nothing.
+  QCOMPARE(state.apply(page), 0);
+  QCOMPARE(state.scrobbleCount(), qint64(page.size()));
+  QVERIFY(state.windowCounts() == windows);
+  const QVariantMap twice = engine->analyzeAll(state);
+  QCOMPARE(twice["topArtists"].value<SortedCounts>(),
+           once["topArtists"].value<SortedCounts>());
+  QCOMPARE(twice["topTracks"].value<SortedCounts>(),
+           once["topTracks"].value<SortedCounts>());
+  QCOMPARE(twice["hourlyData"].value<QVector<int>>(),
+           once["hourlyData"].value<QVector<int>>());
+
+  // A shifted page repeats its boundary row; only the new rows count.
+  QCOMPARE(state.apply(valid.mid(4, 3)), 2);
+  QCOMPARE(state.scrobbleCount(), qint64(7));
+
+  // A same-second scrobble of another track is a different row.
+  ScrobbleData sameSecond{"Artist Z", "Track Z", "", page.first().uts};
+  QCOMPARE(state.apply({sameSecond}), 1);
+  QCOMPARE(state.scrobbleCount(), qint64(8));
+}
+
+void TestAnalyticsEngine::testScrobbleTableModel() {
+  QList<ScrobbleData> valid;
+  for (const ScrobbleData &s : m_scrobbles) {
+    if (s.timestamp().isValid())
+      valid << s;
+  }
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  StringDictionary dictionary(dir.filePath("strings.dict"));
+  QStringList weekFiles;
+  const int half = valid.size() / 2;
+  const QList<QList<ScrobbleData>> parts = {valid.mid(0, half),
+                                            valid.mid(half)};
+  for (const QList<ScrobbleData> &part : parts) {
+    qint64 weekStart = part.first().uts;
+    QString path =
+        dir.filePath(QString::number(weekStart) + WeekFile::fileSuffix());
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(WeekFile::encode(weekStart, part, dictionary));
+    file.close();
+    weekFiles << path;
+  }
+  QString errorMsg;
+  QVERIFY(dictionary.flush(errorMsg));
+  auto store = QSharedPointer<ScrobbleStore>::create();
+  QVERIFY(store->open(dictionary.filePath(), weekFiles, errorMsg));
+
+  ScrobbleTableModel model;
+  model.setStore(store);
+  QCOMPARE(model.rowCount(), int(valid.size()));
+  QCOMPARE(model.columnCount(), int(ScrobbleTableModel::ColumnCount));
+  QCOMPARE(model.index(0, ScrobbleTableModel::ArtistColumn).data().toString(),
+           valid.first().artist());
+  QCOMPARE(model.headerData(ScrobbleTableModel::TrackColumn, Qt::Horizontal)
+               .toString(),
+           QString("Track"));
+
+  // Default order is newest first, mapped without a permutation.
+  ScrobbleSortFilterProxyModel proxy;
+  proxy.setSourceModel(&model);
+  QVERIFY(!proxy.isBusy());
+  QCOMPARE(proxy.rowCount(), int(valid.size()));
+  QCOMPARE(proxy.index(0, ScrobbleTableModel::TrackColumn).data().toString(),
+           valid.last().track());
+  QCOMPARE(proxy.mapFromSource(model.index(1, 0)).row(), int(valid.size()) - 2);
+
+  ScrobbleSortFilterProxyModel::Permutation byArtist =
+      ScrobbleSortFilterProxyModel::buildPermutation(
+          *store, ScrobbleTableModel::ArtistColumn, Qt::DescendingOrder, "");
+  QCOMPARE(byArtist.sourceRows.size(), size_t(valid.size()));
+  QCOMPARE(valid[int(byArtist.sourceRows.front())].artist(),
+           QString("Artist D"));
+  for (size_t row = 0; row < byArtist.sourceRows.size(); ++row)
+    QCOMPARE(byArtist.proxyRows[byArtist.sourceRows[row]], qint32(row));
+
+  ScrobbleSortFilterProxyModel::Permutation filtered =
+      ScrobbleSortFilterProxyModel::buildPermutation(
+          *store, ScrobbleTableModel::ArtistColumn, Qt::AscendingOrder,
+          "track 1");
+  QCOMPARE(filtered.sourceRows.size(), size_t(4));
+  QCOMPARE(std::count(filtered.proxyRows.cbegin(), filtered.proxyRows.cend(),
+                      -1),
+           std::ptrdiff_t(valid.size() - 4));
+
+  // Filtering runs in the background; the result replaces the mapping.
+  proxy.setFilterText("album y");
+  QTRY_VERIFY(!proxy.isBusy());
+  QCOMPARE(proxy.rowCount(), 2);
+  QCOMPARE(proxy.index(0, ScrobbleTableModel::TrackColumn).data().toString(),
+           QString("Track 5"));
+  QVERIFY(!proxy.mapFromSource(model.index(0, 0)).isValid());
+
+  model.setStore(nullptr);
+  QTRY_VERIFY(!proxy.isBusy());
+  QCOMPARE(proxy.rowCount(), 0);
+}
+
+void TestAnalyticsEngine::testRankedCountsModel() {
+  RankedCountsModel model;
+  model.setPlaceholderText("(No data loaded)");
+  QCOMPARE(model.rowCount(), 1);
+  QCOMPARE(model.index(0).data().toString(), QString("(No data loaded)"));
+  QVERIFY(!(model.flags(model.index(0)) & Qt::ItemIsSelectable));
+
+  const SortedCounts before = {{"A", 9}, {"B", 7}, {"C", 5}, {"D", 3}};
+  model.setCounts(before);
+  QCOMPARE(model.counts(), before);
+  QCOMPARE(model.index(1).data().toString(), QString("B (7)"));
+  QCOMPARE(model.index(1).data(RankedCountsModel::NameRole).toString(),
+           QString("B"));
+
+  // C overtakes B, D leaves, E enters and A gains a play.
+  const SortedCounts after = {{"A", 10}, {"C", 8}, {"B", 7}, {"E", 4}};
+  QSignalSpy resets(&model, &QAbstractItemModel::modelReset);
+  QSignalSpy removed(&model, &QAbstractItemModel::rowsRemoved);
+  QSignalSpy moved(&model, &QAbstractItemModel::rowsMoved);
+  QSignalSpy inserted(&model, &QAbstractItemModel::rowsInserted);
+  QSignalSpy changed(&model, &QAbstractItemModel::dataChanged);
+  model.setCounts(after);
+  QCOMPARE(model.counts(), after);
+  QCOMPARE(resets.count(), 0);
+  QCOMPARE(removed.count(), 1);
+  QCOMPARE(moved.count(), 1);
+  QCOMPARE(inserted.count(), 1);
+  QCOMPARE(changed.count(), 2);
+
+  // An unchanged ranking emits nothing.
+  changed.clear();
+  model.setCounts(after);
+  QCOMPARE(changed.count(), 0);
+  QCOMPARE(moved.count(), 1);
+
+  model.setCounts(SortedCounts());
+  QCOMPARE(resets.count(), 1);
+  QCOMPARE(model.rowCount(), 1);
+}
+
 QTEST_MAIN(TestAnalyticsEngine)
 
 #include "testanalyticsengine.moc"
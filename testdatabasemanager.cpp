@@ -8,9 +8,17 @@
 #include <QTemporaryDir>
 #include <QThread>
 #include <QtTest>
+#include <algorithm>
+#include <limits>
 
+#include "analyticsengine.h"
 #include "databasemanager.h"
 #include "scrobbledata.h"
+#include "scrobblejournal.h"
+#include "scrobblejsonparser.h"
+#include "stringdictionary.h"
+#include "weekfile.h"
+#include "weekmanifest.h"
 
 QDateTime createUtcDateTime(int year, int month, int day, int hour, int min,
                             int sec) {
@@ -36,7 +44,7 @@ private:
 
   bool compareScrobbles(const QList<ScrobbleData> &s1,
                         const QList<ScrobbleData> &s2);
-  QList<ScrobbleData> readJsonFileDirectly(const QString &filePath);
+  QList<ScrobbleData> readWeekFileDirectly(const QString &filePath);
 
 private slots:
   void initTestCase();
@@ -45,11 +53,13 @@ private slots:
   void cleanup();
 
   void testGetWeekStart();
+  void testGetWeekStart_uts();
   void testGetWeekFilePath();
 
   void testSaveChunkSync_new();
   void testSaveChunkSync_merge();
   void testSaveChunkSync_duplicates();
+  void testSaveChunkSync_sameSecond();
   void testSaveChunkSync_emptyInput();
   void testSaveChunkSync_invalidUser();
   void testSaveChunkSync_multipleFiles();
@@ -58,12 +68,25 @@ private slots:
   void testLoadScrobblesSync_empty();
   void testLoadScrobblesSync_range();
   void testLoadScrobblesSync_all();
+  void testLoadScrobblesSync_manyWeeks();
   void testLoadScrobblesSync_corruptFile();
 
+  void testMigrateLegacyJson();
+  void testMigrateLegacyJson_corruptWeekFile();
+  void testScrobbleJsonParser();
+  void testExportJsonSync();
+  void testOpenStoreSync();
+  void testAnalyticsSnapshot();
+
   void testFindLastTimestampSync_empty();
   void testFindLastTimestampSync_found();
+  void testWeekManifest();
+  void testScrobbleJournal();
 
   void testIsSaveInProgress();
+  void testSaveQueueBatching();
+  void testSaveQueueBounded();
+  void testShutdownReleasesBlockedSaves();
 };
 
 bool TestDatabaseManager::compareScrobbles(const QList<ScrobbleData> &s1,
@@ -72,8 +95,8 @@ bool TestDatabaseManager::compareScrobbles(const QList<ScrobbleData> &s1,
     return false;
   for (int i = 0; i < s1.size(); ++i) {
 
-    if (s1[i].timestamp != s2[i].timestamp || s1[i].artist != s2[i].artist ||
-        s1[i].track != s2[i].track || s1[i].album != s2[i].album) {
+    if (s1[i].uts != s2[i].uts || s1[i].artist() != s2[i].artist() ||
+        s1[i].track() != s2[i].track() || s1[i].album() != s2[i].album()) {
       return false;
     }
   }
@@ -81,36 +104,27 @@ bool TestDatabaseManager::compareScrobbles(const QList<ScrobbleData> &s1,
 }
 
 QList<ScrobbleData>
-TestDatabaseManager::readJsonFileDirectly(const QString &filePath) {
+TestDatabaseManager::readWeekFileDirectly(const QString &filePath) {
   QList<ScrobbleData> dataList;
   QFile file(filePath);
-  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+  if (!file.open(QIODevice::ReadOnly)) {
     qWarning() << "Failed to open file for direct read:" << filePath;
     return dataList;
   }
-  QByteArray jsonData = file.readAll();
+  QByteArray data = file.readAll();
   file.close();
-  QJsonDocument doc = QJsonDocument::fromJson(jsonData);
-  if (!doc.isArray()) {
-    qWarning() << "File is not a JSON array:" << filePath;
+  QString errorMsg;
+  StringDictionary dictionary(
+      DatabaseManager::getDictionaryPath(QFileInfo(filePath).absolutePath()));
+  if (!dictionary.load(errorMsg)) {
+    qWarning() << "Failed to load string dictionary:" << errorMsg;
     return dataList;
   }
-  QJsonArray array = doc.array();
-  for (const QJsonValue &val : array) {
-    QJsonObject obj = val.toObject();
-    ScrobbleData s;
-    s.timestamp =
-        QDateTime::fromSecsSinceEpoch(obj["uts"].toInteger(), Qt::UTC);
-    s.artist = obj["artist"].toString();
-    s.track = obj["track"].toString();
-    s.album = obj["album"].toString();
-    if (s.timestamp.isValid() && !s.artist.isEmpty() && !s.track.isEmpty()) {
-      dataList.append(s);
-    }
+  if (WeekFile::decode(data, dictionary, std::numeric_limits<qint64>::min(),
+                       std::numeric_limits<qint64>::max(),
+                       dataList) != WeekFile::DecodeResult::Ok) {
+    qWarning() << "File is not a valid week file:" << filePath;
   }
-  std::sort(dataList.begin(), dataList.end(), [](const auto &a, const auto &b) {
-    return a.timestamp < b.timestamp;
-  });
   return dataList;
 }
 
@@ -183,17 +197,29 @@ void TestDatabaseManager::testGetWeekStart() {
   QCOMPARE(DatabaseManager::getWeekStart(dt5), expected5);
 }
 
+void TestDatabaseManager::testGetWeekStart_uts() {
+  // Thursday 1970-01-01 belongs to the week starting Monday 1969-12-29.
+  QCOMPARE(DatabaseManager::getWeekStart(qint64(0)), qint64(-3 * 86400));
+  QCOMPARE(DatabaseManager::getWeekStart(qint64(-1)), qint64(-3 * 86400));
+  for (const ScrobbleData &s : scrobblesPage1 + scrobblesPage3_different_week) {
+    QCOMPARE(DatabaseManager::getWeekStart(s.uts),
+             DatabaseManager::getWeekStart(s.timestamp()).toSecsSinceEpoch());
+  }
+}
+
 void TestDatabaseManager::testGetWeekFilePath() {
   QString userPath = dbPath + "/" + testUser;
   QDateTime dt1 = createUtcDateTime(2023, 10, 23, 10, 0, 0);
-  QString expectedPath1 = QString("%1/%2.json").arg(userPath).arg(1698019200);
+  QString expectedPath1 =
+      QString("%1/%2.week").arg(userPath).arg(1698019200);
   QCOMPARE(DatabaseManager::getWeekFilePath(userPath, dt1), expectedPath1);
 
   QDateTime dt2 = createUtcDateTime(2023, 10, 29, 23, 0, 0);
   QCOMPARE(DatabaseManager::getWeekFilePath(userPath, dt2), expectedPath1);
 
   QDateTime dt3 = createUtcDateTime(2023, 10, 30, 0, 0, 1);
-  QString expectedPath3 = QString("%1/%2.json").arg(userPath).arg(1698624000);
+  QString expectedPath3 =
+      QString("%1/%2.week").arg(userPath).arg(1698624000);
   QCOMPARE(DatabaseManager::getWeekFilePath(userPath, dt3), expectedPath3);
 }
 
@@ -205,14 +231,15 @@ void TestDatabaseManager::testSaveChunkSync_new() {
   QVERIFY(errorMsg.isEmpty());
 
   QDateTime weekStart =
-      DatabaseManager::getWeekStart(scrobblesPage1[0].timestamp);
-  QString filePath = QString("%1/%2/%3.json")
+      DatabaseManager::getWeekStart(scrobblesPage1[0].timestamp());
+  QString filePath = QString("%1/%2/%3%4")
                          .arg(dbPath)
                          .arg(testUser)
-                         .arg(weekStart.toSecsSinceEpoch());
+                         .arg(weekStart.toSecsSinceEpoch())
+                         .arg(WeekFile::fileSuffix());
   QVERIFY(QFile::exists(filePath));
 
-  QList<ScrobbleData> loadedData = readJsonFileDirectly(filePath);
+  QList<ScrobbleData> loadedData = readWeekFileDirectly(filePath);
   QCOMPARE(loadedData.size(), scrobblesPage1.size());
   QVERIFY(compareScrobbles(loadedData, scrobblesPage1));
 }
@@ -228,19 +255,20 @@ void TestDatabaseManager::testSaveChunkSync_merge() {
   QVERIFY(errorMsg.isEmpty());
 
   QDateTime weekStart =
-      DatabaseManager::getWeekStart(scrobblesPage1[0].timestamp);
-  QString filePath = QString("%1/%2/%3.json")
+      DatabaseManager::getWeekStart(scrobblesPage1[0].timestamp());
+  QString filePath = QString("%1/%2/%3%4")
                          .arg(dbPath)
                          .arg(testUser)
-                         .arg(weekStart.toSecsSinceEpoch());
+                         .arg(weekStart.toSecsSinceEpoch())
+                         .arg(WeekFile::fileSuffix());
   QVERIFY(QFile::exists(filePath));
 
-  QList<ScrobbleData> loadedData = readJsonFileDirectly(filePath);
+  QList<ScrobbleData> loadedData = readWeekFileDirectly(filePath);
   QList<ScrobbleData> expectedData = scrobblesPage1;
   expectedData.append(scrobblesPage2_overlap.last());
   std::sort(
       expectedData.begin(), expectedData.end(),
-      [](const auto &a, const auto &b) { return a.timestamp < b.timestamp; });
+      [](const auto &a, const auto &b) { return a.uts < b.uts; });
 
   QCOMPARE(loadedData.size(), 3);
   QVERIFY(compareScrobbles(loadedData, expectedData));
@@ -257,16 +285,40 @@ void TestDatabaseManager::testSaveChunkSync_duplicates() {
   QVERIFY(errorMsg.isEmpty());
 
   QDateTime weekStart =
-      DatabaseManager::getWeekStart(scrobblesPage1[0].timestamp);
-  QString filePath = QString("%1/%2/%3.json")
+      DatabaseManager::getWeekStart(scrobblesPage1[0].timestamp());
+  QString filePath = QString("%1/%2/%3%4")
                          .arg(dbPath)
                          .arg(testUser)
-                         .arg(weekStart.toSecsSinceEpoch());
-  QList<ScrobbleData> loadedData = readJsonFileDirectly(filePath);
+                         .arg(weekStart.toSecsSinceEpoch())
+                         .arg(WeekFile::fileSuffix());
+  QList<ScrobbleData> loadedData = readWeekFileDirectly(filePath);
   QCOMPARE(loadedData.size(), scrobblesPage1.size());
   QVERIFY(compareScrobbles(loadedData, scrobblesPage1));
 }
 
+void TestDatabaseManager::testSaveChunkSync_sameSecond() {
+  QString errorMsg;
+  const qint64 uts = scrobblesPage1.first().uts;
+  // Newest first, as delivered by the API; two tracks share one second.
+  QList<ScrobbleData> page;
+  page << ScrobbleData("Artist B", "Track 2", "Album Y", uts + 60)
+       << ScrobbleData("Artist A", "Track 9", "Album X", uts)
+       << ScrobbleData("Artist A", "Track 1", "Album X", uts);
+  QVERIFY(DatabaseManager::saveChunkSync(dbPath, testUser, page, errorMsg));
+  QVERIFY(DatabaseManager::saveChunkSync(dbPath, testUser, scrobblesPage1,
+                                         errorMsg));
+
+  const QString filePath =
+      DatabaseManager::getWeekFilePath(dbPath + "/" + testUser, uts);
+  QList<ScrobbleData> loadedData = readWeekFileDirectly(filePath);
+  QCOMPARE(loadedData.size(), 4);
+  QCOMPARE(loadedData[0].uts, uts);
+  QCOMPARE(loadedData[1].uts, uts);
+  QVERIFY(loadedData[0].track() != loadedData[1].track());
+  QCOMPARE(loadedData[2].uts, uts + 60);
+  QVERIFY(std::is_sorted(loadedData.cbegin(), loadedData.cend()));
+}
+
 void TestDatabaseManager::testSaveChunkSync_emptyInput() {
   QString errorMsg;
   QList<ScrobbleData> emptyList;
@@ -300,21 +352,24 @@ void TestDatabaseManager::testSaveChunkSync_multipleFiles() {
   QVERIFY(errorMsg.isEmpty());
 
   QDateTime weekStart1 =
-      DatabaseManager::getWeekStart(scrobblesPage1[0].timestamp);
-  QString filePath1 = QString("%1/%2/%3.json")
+      DatabaseManager::getWeekStart(scrobblesPage1[0].timestamp());
+  QString filePath1 = QString("%1/%2/%3%4")
                           .arg(dbPath)
                           .arg(testUser)
-                          .arg(weekStart1.toSecsSinceEpoch());
+                          .arg(weekStart1.toSecsSinceEpoch())
+                          .arg(WeekFile::fileSuffix());
   QVERIFY(QFile::exists(filePath1));
   QDateTime weekStart2 =
-      DatabaseManager::getWeekStart(scrobblesPage3_different_week[0].timestamp);
-  QString filePath2 = QString("%1/%2/%3.json")
+      DatabaseManager::getWeekStart(
+          scrobblesPage3_different_week[0].timestamp());
+  QString filePath2 = QString("%1/%2/%3%4")
                           .arg(dbPath)
                           .arg(testUser)
-                          .arg(weekStart2.toSecsSinceEpoch());
+                          .arg(weekStart2.toSecsSinceEpoch())
+                          .arg(WeekFile::fileSuffix());
   QVERIFY(QFile::exists(filePath2));
 
-  QList<ScrobbleData> loadedData2 = readJsonFileDirectly(filePath2);
+  QList<ScrobbleData> loadedData2 = readWeekFileDirectly(filePath2);
   QVERIFY(compareScrobbles(loadedData2, scrobblesPage3_different_week));
 }
 
@@ -325,11 +380,12 @@ void TestDatabaseManager::testSaveChunkSync_corruptExistingFile() {
                                          errorMsg));
 
   QDateTime weekStart =
-      DatabaseManager::getWeekStart(scrobblesPage1[0].timestamp);
-  QString filePath = QString("%1/%2/%3.json")
+      DatabaseManager::getWeekStart(scrobblesPage1[0].timestamp());
+  QString filePath = QString("%1/%2/%3%4")
                          .arg(dbPath)
                          .arg(testUser)
-                         .arg(weekStart.toSecsSinceEpoch());
+                         .arg(weekStart.toSecsSinceEpoch())
+                         .arg(WeekFile::fileSuffix());
   QFile file(filePath);
   QVERIFY(
       file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text));
@@ -340,22 +396,22 @@ void TestDatabaseManager::testSaveChunkSync_corruptExistingFile() {
                                          scrobblesPage2_overlap, errorMsg));
   QVERIFY(errorMsg.isEmpty());
 
-  QList<ScrobbleData> loadedData = readJsonFileDirectly(filePath);
+  QList<ScrobbleData> loadedData = readWeekFileDirectly(filePath);
   QList<ScrobbleData> expectedData;
   QMap<qint64, bool> existingTimestamps;
   for (const ScrobbleData &newScrobble : scrobblesPage2_overlap) {
-    if (newScrobble.timestamp.isValid() &&
-        newScrobble.timestamp.toSecsSinceEpoch() > 0) {
+    if (newScrobble.timestamp().isValid() &&
+        newScrobble.timestamp().toSecsSinceEpoch() > 0) {
       if (!existingTimestamps.contains(
-              newScrobble.timestamp.toSecsSinceEpoch())) {
+              newScrobble.timestamp().toSecsSinceEpoch())) {
         expectedData.append(newScrobble);
-        existingTimestamps[newScrobble.timestamp.toSecsSinceEpoch()] = true;
+        existingTimestamps[newScrobble.timestamp().toSecsSinceEpoch()] = true;
       }
     }
   }
   std::sort(
       expectedData.begin(), expectedData.end(),
-      [](const auto &a, const auto &b) { return a.timestamp < b.timestamp; });
+      [](const auto &a, const auto &b) { return a.uts < b.uts; });
 
   QCOMPARE(loadedData.size(), expectedData.size());
   QVERIFY(compareScrobbles(loadedData, expectedData));
@@ -387,7 +443,7 @@ void TestDatabaseManager::testLoadScrobblesSync_range() {
       dbPath, testUser, scrobblesPage3_different_week, errorMsg));
 
   QDateTime week1Start =
-      DatabaseManager::getWeekStart(scrobblesPage1[0].timestamp);
+      DatabaseManager::getWeekStart(scrobblesPage1[0].timestamp());
   QDateTime week1End = week1Start.addDays(7);
   QList<ScrobbleData> loaded = DatabaseManager::loadScrobblesSync(
       dbPath, testUser, week1Start, week1End, errorMsg);
@@ -396,7 +452,8 @@ void TestDatabaseManager::testLoadScrobblesSync_range() {
   QVERIFY(compareScrobbles(loaded, scrobblesPage1));
 
   QDateTime week2Start =
-      DatabaseManager::getWeekStart(scrobblesPage3_different_week[0].timestamp);
+      DatabaseManager::getWeekStart(
+          scrobblesPage3_different_week[0].timestamp());
   QDateTime week2End = week2Start.addDays(7);
   loaded = DatabaseManager::loadScrobblesSync(dbPath, testUser, week2Start,
                                               week2End, errorMsg);
@@ -404,7 +461,7 @@ void TestDatabaseManager::testLoadScrobblesSync_range() {
   QCOMPARE(loaded.size(), scrobblesPage3_different_week.size());
   QVERIFY(compareScrobbles(loaded, scrobblesPage3_different_week));
 
-  QDateTime midWeek1 = scrobblesPage1[0].timestamp.addDays(1);
+  QDateTime midWeek1 = scrobblesPage1[0].timestamp().addDays(1);
   loaded = DatabaseManager::loadScrobblesSync(dbPath, testUser, midWeek1,
                                               week1End, errorMsg);
   QVERIFY(errorMsg.isEmpty());
@@ -413,9 +470,9 @@ void TestDatabaseManager::testLoadScrobblesSync_range() {
   QCOMPARE(loaded.size(), 1);
   QVERIFY(compareScrobbles(loaded, expectedPartial));
 
-  QDateTime crossWeekStart = scrobblesPage1.last().timestamp.addSecs(-1);
+  QDateTime crossWeekStart = scrobblesPage1.last().timestamp().addSecs(-1);
   QDateTime crossWeekEnd =
-      scrobblesPage3_different_week[0].timestamp.addSecs(1);
+      scrobblesPage3_different_week[0].timestamp().addSecs(1);
   loaded = DatabaseManager::loadScrobblesSync(dbPath, testUser, crossWeekStart,
                                               crossWeekEnd, errorMsg);
   QVERIFY(errorMsg.isEmpty());
@@ -424,7 +481,7 @@ void TestDatabaseManager::testLoadScrobblesSync_range() {
   expectedCross << scrobblesPage3_different_week.first();
   std::sort(
       expectedCross.begin(), expectedCross.end(),
-      [](const auto &a, const auto &b) { return a.timestamp < b.timestamp; });
+      [](const auto &a, const auto &b) { return a.uts < b.uts; });
   QCOMPARE(loaded.size(), 2);
   QVERIFY(compareScrobbles(loaded, expectedCross));
 }
@@ -448,12 +505,42 @@ void TestDatabaseManager::testLoadScrobblesSync_all() {
   expectedAll << scrobblesPage3_different_week;
   std::sort(
       expectedAll.begin(), expectedAll.end(),
-      [](const auto &a, const auto &b) { return a.timestamp < b.timestamp; });
+      [](const auto &a, const auto &b) { return a.uts < b.uts; });
 
   QCOMPARE(loaded.size(), 5);
   QVERIFY(compareScrobbles(loaded, expectedAll));
 }
 
+void TestDatabaseManager::testLoadScrobblesSync_manyWeeks() {
+  // Enough week files to be spread over several loader threads; saved in
+  // reverse so that file order cannot come from write order.
+  QList<ScrobbleData> expected;
+  const qint64 start =
+      createUtcDateTime(2020, 1, 1, 0, 0, 0).toSecsSinceEpoch();
+  for (int i = 0; i < 300; ++i) {
+    expected << ScrobbleData(QString("Artist %1").arg(i % 7),
+                             QString("Track %1").arg(i % 13), "",
+                             start + qint64(i) * 2 * 24 * 60 * 60 + i);
+  }
+  QList<ScrobbleData> reversed(expected.crbegin(), expected.crend());
+  QString errorMsg;
+  QVERIFY(
+      DatabaseManager::saveChunkSync(dbPath, testUser, reversed, errorMsg));
+
+  QList<ScrobbleData> loaded =
+      DatabaseManager::loadAllScrobblesSync(dbPath, testUser, errorMsg);
+  QVERIFY2(errorMsg.isEmpty(), qPrintable(errorMsg));
+  QVERIFY(compareScrobbles(loaded, expected));
+
+  // A range inside the history only returns its rows, still in order.
+  const QList<ScrobbleData> middle = expected.mid(100, 50);
+  loaded = DatabaseManager::loadScrobblesSync(
+      dbPath, testUser, middle.first().timestamp(),
+      middle.last().timestamp().addSecs(1), errorMsg);
+  QVERIFY2(errorMsg.isEmpty(), qPrintable(errorMsg));
+  QVERIFY(compareScrobbles(loaded, middle));
+}
+
 void TestDatabaseManager::testLoadScrobblesSync_corruptFile() {
   QString errorMsg;
 
@@ -463,11 +550,12 @@ void TestDatabaseManager::testLoadScrobblesSync_corruptFile() {
       dbPath, testUser, scrobblesPage3_different_week, errorMsg));
 
   QDateTime weekStart1 =
-      DatabaseManager::getWeekStart(scrobblesPage1[0].timestamp);
-  QString filePath1 = QString("%1/%2/%3.json")
+      DatabaseManager::getWeekStart(scrobblesPage1[0].timestamp());
+  QString filePath1 = QString("%1/%2/%3%4")
                           .arg(dbPath)
                           .arg(testUser)
-                          .arg(weekStart1.toSecsSinceEpoch());
+                          .arg(weekStart1.toSecsSinceEpoch())
+                          .arg(WeekFile::fileSuffix());
   QFile file(filePath1);
   QVERIFY(
       file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text));
@@ -485,6 +573,249 @@ void TestDatabaseManager::testLoadScrobblesSync_corruptFile() {
   QVERIFY(compareScrobbles(loaded, scrobblesPage3_different_week));
 }
 
+void TestDatabaseManager::testMigrateLegacyJson() {
+  QString userPath = dbPath + "/" + testUser;
+  QVERIFY(QDir().mkpath(userPath));
+
+  QDateTime weekStart =
+      DatabaseManager::getWeekStart(scrobblesPage1[0].timestamp());
+  QString legacyPath =
+      QString("%1/%2.json").arg(userPath).arg(weekStart.toSecsSinceEpoch());
+  QFile legacyFile(legacyPath);
+  QVERIFY(legacyFile.open(QIODevice::WriteOnly | QIODevice::Text));
+  legacyFile.write(DatabaseManager::toLegacyJson(scrobblesPage1));
+  legacyFile.close();
+
+  QString errorMsg;
+  QList<ScrobbleData> loaded =
+      DatabaseManager::loadAllScrobblesSync(dbPath, testUser, errorMsg);
+  QVERIFY(errorMsg.isEmpty());
+  QVERIFY(compareScrobbles(loaded, scrobblesPage1));
+
+  QString weekPath =
+      DatabaseManager::getWeekFilePath(userPath, scrobblesPage1[0].timestamp());
+  QVERIFY(QFile::exists(weekPath));
+  QVERIFY(!QFile::exists(legacyPath));
+  QVERIFY(QFile::exists(userPath + "/json-backup/" +
+                        QFileInfo(legacyPath).fileName()));
+  QVERIFY(compareScrobbles(readWeekFileDirectly(weekPath), scrobblesPage1));
+
+  QVERIFY(DatabaseManager::saveChunkSync(dbPath, testUser,
+                                         scrobblesPage2_overlap, errorMsg));
+  loaded = DatabaseManager::loadAllScrobblesSync(dbPath, testUser, errorMsg);
+  QCOMPARE(loaded.size(), 3);
+}
+
+void TestDatabaseManager::testMigrateLegacyJson_corruptWeekFile() {
+  QString userPath = dbPath + "/" + testUser;
+  QVERIFY(QDir().mkpath(userPath));
+
+  // Two distinct scrobbles within the same second must both survive.
+  QDateTime when = scrobblesPage1[0].timestamp();
+  QList<ScrobbleData> legacyRows = {
+      ScrobbleData{"Legacy Artist", "Track A", "", when},
+      ScrobbleData{"Legacy Artist", "Track B", "", when}};
+  QDateTime weekStart = DatabaseManager::getWeekStart(when);
+  QString legacyPath =
+      QString("%1/%2.json").arg(userPath).arg(weekStart.toSecsSinceEpoch());
+  QFile legacyFile(legacyPath);
+  QVERIFY(legacyFile.open(QIODevice::WriteOnly | QIODevice::Text));
+  legacyFile.write(DatabaseManager::toLegacyJson(legacyRows));
+  legacyFile.close();
+
+  QString weekPath = DatabaseManager::getWeekFilePath(userPath, when);
+  const QByteArray garbage = "not a week file";
+  QFile weekFile(weekPath);
+  QVERIFY(weekFile.open(QIODevice::WriteOnly));
+  weekFile.write(garbage);
+  weekFile.close();
+
+  // The undecodable week file is neither overwritten nor is the migration
+  // recorded as done.
+  QString errorMsg;
+  DatabaseManager::loadAllScrobblesSync(dbPath, testUser, errorMsg);
+  QVERIFY(weekFile.open(QIODevice::ReadOnly));
+  QCOMPARE(weekFile.readAll(), garbage);
+  weekFile.close();
+  QVERIFY(QFile::exists(legacyPath));
+  QVERIFY(!QFile::exists(userPath + "/storage.version"));
+
+  // Once the week file is repaired the skipped file is retried.
+  QVERIFY(QFile::remove(weekPath));
+  errorMsg.clear();
+  QList<ScrobbleData> loaded =
+      DatabaseManager::loadAllScrobblesSync(dbPath, testUser, errorMsg);
+  QVERIFY2(errorMsg.isEmpty(), qPrintable(errorMsg));
+  QCOMPARE(loaded.size(), 2);
+  QVERIFY(!QFile::exists(legacyPath));
+  QVERIFY(QFile::exists(userPath + "/storage.version"));
+}
+
+void TestDatabaseManager::testScrobbleJsonParser() {
+  const QByteArray page = R"({"recenttracks":{"track":[
+      {"artist":{"mbid":"","#text":"Sigur Rós"},"name":"Hoppípolla",
+       "image":[{"size":"small","#text":"x"}],"@attr":{"nowplaying":"true"}},
+      {"artist":{"#text":"A \"B\" C"},"album":{"#text":"🎵"},
+       "name":"T\/1","date":{"uts":"1698055200","#text":"x"}},
+      {"artist":{"#text":"No Date"},"name":"X"}],
+    "@attr":{"page":"2","totalPages":"7","total":"1300"}}})";
+  ScrobbleJsonParser::RecentTracksPage parsed;
+  QString errorMsg;
+  QVERIFY2(ScrobbleJsonParser::parseRecentTracks(page, parsed, errorMsg),
+           qPrintable(errorMsg));
+  QVERIFY(parsed.hasRecentTracks);
+  QCOMPARE(parsed.page, 2);
+  QCOMPARE(parsed.totalPages, 7);
+  QCOMPARE(parsed.skippedTracks, 1);
+  QCOMPARE(parsed.scrobbles.size(), 1);
+  QCOMPARE(parsed.scrobbles[0].artist(), QString("A \"B\" C"));
+  QCOMPARE(parsed.scrobbles[0].track(), QString("T/1"));
+  QCOMPARE(parsed.scrobbles[0].album(), QString::fromUtf8("\xF0\x9F\x8E\xB5"));
+  QCOMPARE(parsed.scrobbles[0].uts, qint64(1698055200));
+
+  // A single track may come as an object rather than an array.
+  QVERIFY(ScrobbleJsonParser::parseRecentTracks(
+      R"({"recenttracks":{"track":{"artist":{"#text":"A"},"name":"B",)"
+      R"("date":{"uts":"5"}}}})",
+      parsed, errorMsg));
+  QCOMPARE(parsed.scrobbles.size(), 1);
+
+  QVERIFY(ScrobbleJsonParser::parseRecentTracks(
+      R"({"error":6,"message":"User not found"})", parsed, errorMsg));
+  QVERIFY(parsed.isApiError);
+  QCOMPARE(parsed.apiErrorCode, 6);
+  QCOMPARE(parsed.apiErrorMessage, QString("User not found"));
+
+  QVERIFY(!ScrobbleJsonParser::parseRecentTracks(
+      R"({"recenttracks":{"track":[{"name":"x"},]}})", parsed, errorMsg));
+  QVERIFY(!ScrobbleJsonParser::parseRecentTracks(R"({"a":"b"} x)", parsed,
+                                                 errorMsg));
+
+  QList<ScrobbleData> rows;
+  QVERIFY(ScrobbleJsonParser::parseWeekArray(
+      R"([{"artist":"A","track":"B","album":"C","uts":1698055200},)"
+      R"({"artist":"A","uts":1698055300},7,)"
+      R"({"artist":"D","track":"E","uts":0}])",
+      rows, errorMsg));
+  QCOMPARE(rows.size(), 1);
+  QCOMPARE(rows[0].album(), QString("C"));
+  QVERIFY(!ScrobbleJsonParser::parseWeekArray(R"([{"artist":"A")", rows,
+                                               errorMsg));
+  QCOMPARE(rows.size(), 1);
+}
+
+void TestDatabaseManager::testExportJsonSync() {
+  QString errorMsg;
+  QVERIFY(DatabaseManager::saveChunkSync(dbPath, testUser, scrobblesPage1,
+                                         errorMsg));
+  QVERIFY(DatabaseManager::saveChunkSync(
+      dbPath, testUser, scrobblesPage3_different_week, errorMsg));
+
+  QTemporaryDir exportDir;
+  QVERIFY(exportDir.isValid());
+  QVERIFY(DatabaseManager::exportJsonSync(dbPath, testUser, exportDir.path(),
+                                          errorMsg));
+  QVERIFY(errorMsg.isEmpty());
+
+  QStringList exported =
+      QDir(exportDir.path()).entryList({"*.json"}, QDir::Files, QDir::Name);
+  QCOMPARE(exported.size(), 2);
+
+  QDateTime weekStart =
+      DatabaseManager::getWeekStart(scrobblesPage1[0].timestamp());
+  QFile file(QString("%1/%2.json")
+                 .arg(exportDir.path())
+                 .arg(weekStart.toSecsSinceEpoch()));
+  QVERIFY(file.open(QIODevice::ReadOnly | QIODevice::Text));
+  QList<ScrobbleData> parsed;
+  QVERIFY(DatabaseManager::parseLegacyJson(file.readAll(), parsed));
+  QVERIFY(compareScrobbles(parsed, scrobblesPage1));
+}
+
+void TestDatabaseManager::testOpenStoreSync() {
+  QString errorMsg;
+  QSharedPointer<ScrobbleStore> store =
+      DatabaseManager::openStoreSync(dbPath, testUser, errorMsg);
+  QVERIFY(errorMsg.isEmpty());
+  QVERIFY(store);
+  QVERIFY(store->isEmpty());
+
+  QVERIFY(DatabaseManager::saveChunkSync(dbPath, testUser, scrobblesPage1,
+                                         errorMsg));
+  QVERIFY(DatabaseManager::saveChunkSync(
+      dbPath, testUser, scrobblesPage3_different_week, errorMsg));
+  QList<ScrobbleData> loaded =
+      DatabaseManager::loadAllScrobblesSync(dbPath, testUser, errorMsg);
+  QVERIFY(errorMsg.isEmpty());
+
+  store = DatabaseManager::openStoreSync(dbPath, testUser, errorMsg);
+  QVERIFY2(errorMsg.isEmpty(), qPrintable(errorMsg));
+  QCOMPARE(store->size(), loaded.size());
+  QList<ScrobbleData> fromStore;
+  store->forEach([&fromStore](const ScrobbleRecordView &row) {
+    fromStore << ScrobbleData{row.artist().toString(), row.track().toString(),
+                              row.album().toString(), row.timestamp()};
+  });
+  QVERIFY(compareScrobbles(fromStore, loaded));
+  QCOMPARE(store->utsAt(store->size() - 1),
+           loaded.last().timestamp().toSecsSinceEpoch());
+}
+
+void TestDatabaseManager::testAnalyticsSnapshot() {
+  QString errorMsg;
+  QVERIFY(!DatabaseManager::loadSnapshotSync(dbPath, testUser, errorMsg));
+  QVERIFY(errorMsg.isEmpty());
+
+  QVERIFY(DatabaseManager::saveChunkSync(dbPath, testUser, scrobblesPage1,
+                                         errorMsg));
+  QVERIFY(DatabaseManager::saveChunkSync(
+      dbPath, testUser, scrobblesPage3_different_week, errorMsg));
+  QSharedPointer<ScrobbleStore> store =
+      DatabaseManager::openStoreSync(dbPath, testUser, errorMsg);
+  QVERIFY2(errorMsg.isEmpty(), qPrintable(errorMsg));
+  IncrementalAnalytics state;
+  state.rebuild(*store);
+  QVERIFY2(DatabaseManager::saveSnapshotSync(dbPath, testUser, state, *store,
+                                             errorMsg),
+           qPrintable(errorMsg));
+
+  AnalyticsEngine engine;
+  QSharedPointer<IncrementalAnalytics> restored =
+      DatabaseManager::loadSnapshotSync(dbPath, testUser, errorMsg);
+  QVERIFY2(restored, qPrintable(errorMsg));
+  QCOMPARE(restored->scrobbleCount(), state.scrobbleCount());
+  QCOMPARE(restored->watermark(), state.lastUts());
+  QVariantMap expected = engine.analyzeAll(*store, 100);
+  QVariantMap actual = engine.analyzeAll(*restored, 100);
+  QCOMPARE(actual.value("topArtists").value<SortedCounts>(),
+           expected.value("topArtists").value<SortedCounts>());
+  QCOMPARE(actual.value("topTracks").value<SortedCounts>(),
+           expected.value("topTracks").value<SortedCounts>());
+  QCOMPARE(actual.value("hourlyData").value<QVector<int>>(),
+           expected.value("hourlyData").value<QVector<int>>());
+
+  // Rows stored after the snapshot (in its last week) are folded in.
+  QList<ScrobbleData> newer;
+  newer << ScrobbleData{"Artist A", "Track 1", "",
+                        createUtcDateTime(2023, 11, 1, 20, 0, 0)};
+  QVERIFY(DatabaseManager::saveChunkSync(dbPath, testUser, newer, errorMsg));
+  restored = DatabaseManager::loadSnapshotSync(dbPath, testUser, errorMsg);
+  QVERIFY2(restored, qPrintable(errorMsg));
+  QCOMPARE(restored->scrobbleCount(), state.scrobbleCount() + 1);
+  store = DatabaseManager::openStoreSync(dbPath, testUser, errorMsg);
+  expected = engine.analyzeAll(*store, 100);
+  actual = engine.analyzeAll(*restored, 100);
+  QCOMPARE(actual.value("topArtists").value<SortedCounts>(),
+           expected.value("topArtists").value<SortedCounts>());
+
+  // A change to an older week invalidates the snapshot.
+  QVERIFY(DatabaseManager::saveChunkSync(dbPath, testUser,
+                                         scrobblesPage2_overlap, errorMsg));
+  restored = DatabaseManager::loadSnapshotSync(dbPath, testUser, errorMsg);
+  QVERIFY(!restored);
+  QVERIFY(!errorMsg.isEmpty());
+}
+
 void TestDatabaseManager::testFindLastTimestampSync_empty() {
 
   QCOMPARE(DatabaseManager::findLastTimestampSync(dbPath, testUser), (qint64)0);
@@ -501,7 +832,7 @@ void TestDatabaseManager::testFindLastTimestampSync_found() {
       dbPath, testUser, scrobblesPage3_different_week, errorMsg));
 
   qint64 expectedTs =
-      scrobblesPage3_different_week.last().timestamp.toSecsSinceEpoch();
+      scrobblesPage3_different_week.last().timestamp().toSecsSinceEpoch();
   QCOMPARE(DatabaseManager::findLastTimestampSync(dbPath, testUser),
            expectedTs);
 
@@ -512,6 +843,103 @@ void TestDatabaseManager::testFindLastTimestampSync_found() {
            expectedTs);
 }
 
+void TestDatabaseManager::testWeekManifest() {
+  QString errorMsg;
+  QVERIFY(DatabaseManager::saveChunkSync(dbPath, testUser, scrobblesPage1,
+                                         errorMsg));
+  QVERIFY(DatabaseManager::saveChunkSync(
+      dbPath, testUser, scrobblesPage3_different_week, errorMsg));
+
+  const QString userPath = dbPath + "/" + testUser;
+  WeekManifest manifest(DatabaseManager::getManifestPath(userPath));
+  QVERIFY2(manifest.load(errorMsg), qPrintable(errorMsg));
+  QList<WeekManifest::Entry> entries = manifest.entries();
+  QCOMPARE(entries.size(), 2);
+  QCOMPARE(entries[0].weekStartUts,
+           DatabaseManager::getWeekStart(scrobblesPage1.first().uts));
+  QCOMPARE(entries[0].minUts, scrobblesPage1.first().uts);
+  QCOMPARE(entries[0].maxUts, scrobblesPage1.last().uts);
+  QCOMPARE(entries[0].rowCount, quint32(scrobblesPage1.size()));
+  QCOMPARE(manifest.lastTimestamp(), scrobblesPage3_different_week.last().uts);
+  QCOMPARE(manifest.entriesInRange(scrobblesPage1.last().uts + 1,
+                                   scrobblesPage3_different_week.first().uts)
+               .size(),
+           0);
+
+  QStringList problems;
+  QVERIFY(DatabaseManager::checkManifestSync(userPath, manifest, true,
+                                             problems));
+
+  // Rewriting a week file behind the manifest's back is detected.
+  const QString filePath =
+      DatabaseManager::getWeekFilePath(userPath, entries[0].weekStartUts);
+  QFile file(filePath);
+  QVERIFY(file.open(QIODevice::ReadWrite));
+  QByteArray data = file.readAll();
+  data[data.size() - 1] = char(data[data.size() - 1] ^ 0x01);
+  QVERIFY(file.seek(0));
+  QCOMPARE(file.write(data), qint64(data.size()));
+  file.close();
+  QVERIFY(DatabaseManager::checkManifestSync(userPath, manifest, false,
+                                             problems));
+  QVERIFY(!DatabaseManager::checkManifestSync(userPath, manifest, true,
+                                              problems));
+  QCOMPARE(problems.size(), 1);
+
+  // A missing manifest is rebuilt from the week files.
+  QVERIFY(QFile::remove(manifest.filePath()));
+  QCOMPARE(DatabaseManager::findLastTimestampSync(dbPath, testUser),
+           scrobblesPage3_different_week.last().uts);
+  QVERIFY(QFile::exists(manifest.filePath()));
+  QVERIFY(manifest.load(errorMsg));
+  problems.clear();
+  QVERIFY(DatabaseManager::checkManifestSync(userPath, manifest, true,
+                                             problems));
+}
+
+void TestDatabaseManager::testScrobbleJournal() {
+  QString errorMsg;
+  QVERIFY(DatabaseManager::journalChunkSync(dbPath, testUser, scrobblesPage1,
+                                            errorMsg));
+  QVERIFY(DatabaseManager::journalChunkSync(
+      dbPath, testUser, scrobblesPage3_different_week, errorMsg));
+
+  const QString userPath = dbPath + "/" + testUser;
+  ScrobbleJournal journal(DatabaseManager::getJournalPath(userPath));
+  QVERIFY(journal.exists());
+  QVERIFY(!QFile::exists(DatabaseManager::getWeekFilePath(
+      userPath, scrobblesPage1.first().uts)));
+
+  // A record torn by a crash is ignored on replay and cut off on append.
+  QFile file(journal.filePath());
+  QVERIFY(file.open(QIODevice::Append));
+  const QByteArray record =
+      ScrobbleJournal::encodeRecord(scrobblesPage2_overlap);
+  file.write(record.left(record.size() / 2));
+  file.close();
+  QList<ScrobbleData> replayed;
+  QString warnings;
+  QVERIFY(journal.replay(replayed, warnings, errorMsg));
+  QVERIFY(warnings.isEmpty());
+  QCOMPARE(replayed.size(),
+           scrobblesPage1.size() + scrobblesPage3_different_week.size());
+  QVERIFY(compareScrobbles(replayed.mid(0, scrobblesPage1.size()),
+                           scrobblesPage1));
+  QVERIFY(DatabaseManager::journalChunkSync(dbPath, testUser,
+                                            scrobblesPage2_overlap, errorMsg));
+
+  // Reading the user folds the journal into the week files and removes it.
+  QList<ScrobbleData> loaded =
+      DatabaseManager::loadAllScrobblesSync(dbPath, testUser, errorMsg);
+  QVERIFY2(errorMsg.isEmpty(), qPrintable(errorMsg));
+  QVERIFY(!journal.exists());
+  QList<ScrobbleData> expected = scrobblesPage1;
+  expected << scrobblesPage2_overlap.last() << scrobblesPage3_different_week;
+  QVERIFY(compareScrobbles(loaded, expected));
+  QCOMPARE(DatabaseManager::findLastTimestampSync(dbPath, testUser),
+           scrobblesPage3_different_week.last().uts);
+}
+
 void TestDatabaseManager::testIsSaveInProgress() {
 
   QVERIFY(!dbManager->isSaveInProgress());
@@ -532,6 +960,105 @@ void TestDatabaseManager::testIsSaveInProgress() {
   QVERIFY(!dbManager->isSaveInProgress());
 }
 
+void TestDatabaseManager::testSaveQueueBatching() {
+  QSignalSpy completedSpy(dbManager, &DatabaseManager::pageSaveCompleted);
+  QSignalSpy idleSpy(dbManager, &DatabaseManager::saveQueueIdle);
+  QSignalSpy depthSpy(dbManager, &DatabaseManager::saveQueueDepthChanged);
+
+  // Pages queued back to back hit the same week file and are saved together.
+  dbManager->saveScrobblesAsync(1, testUser, scrobblesPage1);
+  dbManager->saveScrobblesAsync(2, testUser, scrobblesPage2_overlap);
+  dbManager->saveScrobblesAsync(3, testUser, scrobblesPage3_different_week);
+  QTRY_VERIFY_WITH_TIMEOUT(!dbManager->isSaveInProgress(), 5000);
+  QTRY_VERIFY(idleSpy.count() > 0);
+
+  QCOMPARE(completedSpy.count(), 3);
+  for (int i = 0; i < completedSpy.count(); ++i)
+    QCOMPARE(completedSpy.at(i).at(0).toInt(), i + 1);
+  // The backlog counts pages until their batch is written.
+  QCOMPARE(depthSpy.first().at(0).toInt(), 1);
+  QCOMPARE(depthSpy.last().at(0).toInt(), 0);
+  QCOMPARE(dbManager->saveQueueDepth(), 0);
+
+  const QString userPath = dbPath + "/" + testUser;
+  QVERIFY(!QFile::exists(DatabaseManager::getJournalPath(userPath)));
+  QList<ScrobbleData> expected = scrobblesPage1;
+  expected << scrobblesPage2_overlap.last() << scrobblesPage3_different_week;
+  QList<ScrobbleData> week1 = readWeekFileDirectly(
+      DatabaseManager::getWeekFilePath(userPath, scrobblesPage1.first().uts));
+  QVERIFY(compareScrobbles(week1, expected.mid(0, 3)));
+}
+
+void TestDatabaseManager::testSaveQueueBounded() {
+  QSignalSpy completedSpy(dbManager, &DatabaseManager::pageSaveCompleted);
+  QSignalSpy savedSpy(dbManager, &DatabaseManager::scrobblesSaved);
+  QList<int> depths;
+  const QMetaObject::Connection depthConnection =
+      connect(dbManager, &DatabaseManager::saveQueueDepthChanged, this,
+              [&depths](int depth) { depths.append(depth); },
+              Qt::DirectConnection);
+
+  // Each call returns only once the queue has room, so the backlog (queued
+  // pages plus the batch being written) never exceeds twice the cap.
+  const int cap = 2;
+  const int pages = 20;
+  const int defaultCap = dbManager->maxSaveQueuePages();
+  dbManager->setMaxSaveQueuePages(cap);
+  const qint64 firstUts = scrobblesPage1.first().uts;
+  for (int page = 1; page <= pages; ++page) {
+    QList<ScrobbleData> rows;
+    if (page % 5 != 0) {
+      rows.append(ScrobbleData("Artist", "Track", "Album",
+                               firstUts + page * 60));
+    }
+    dbManager->saveScrobblesAsync(page, testUser, rows);
+  }
+  QTRY_VERIFY_WITH_TIMEOUT(!dbManager->isSaveInProgress(), 10000);
+  dbManager->setMaxSaveQueuePages(defaultCap);
+  disconnect(depthConnection);
+
+  QVERIFY(!depths.isEmpty());
+  QVERIFY(*std::max_element(depths.begin(), depths.end()) <= 2 * cap);
+  // Empty pages are completed in turn, without rows.
+  QCOMPARE(completedSpy.count(), pages);
+  for (int i = 0; i < completedSpy.count(); ++i)
+    QCOMPARE(completedSpy.at(i).at(0).toInt(), i + 1);
+  int savedRows = 0;
+  for (const QList<QVariant> &arguments : std::as_const(savedSpy))
+    savedRows += int(arguments.at(1).value<QList<ScrobbleData>>().size());
+  QCOMPARE(savedRows, pages - pages / 5);
+}
+
+void TestDatabaseManager::testShutdownReleasesBlockedSaves() {
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  DatabaseManager database(dir.path());
+  database.setMaxSaveQueuePages(1);
+
+  // Stands in for a parser thread feeding the queue faster than it drains.
+  const int pages = 200;
+  const qint64 firstUts = scrobblesPage1.first().uts;
+  QAtomicInt returned = 0;
+  QScopedPointer<QThread> producer(QThread::create([&]() {
+    for (int page = 1; page <= pages; ++page) {
+      database.saveScrobblesAsync(
+          page, testUser,
+          {ScrobbleData("Artist", "Track", "Album", firstUts + page * 60)});
+      returned.fetchAndAddRelaxed(1);
+    }
+  }));
+  producer->start();
+  QTRY_VERIFY(returned.loadRelaxed() > 0);
+
+  database.shutdown();
+  QVERIFY(!database.isSaveInProgress());
+  // Whatever was still blocked or still to come is rejected at once.
+  QVERIFY(producer->wait(10000));
+  QCOMPARE(returned.loadRelaxed(), pages);
+  database.saveScrobblesAsync(pages + 1, testUser, scrobblesPage1);
+  QCOMPARE(database.saveQueueDepth(), 0);
+}
+
 QTEST_MAIN(TestDatabaseManager)
 
 #include "testdatabasemanager.moc"
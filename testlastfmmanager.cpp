@@ -0,0 +1,569 @@
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QTemporaryDir>
+#include <QtEndian>
+#include <QtTest>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "historyverifier.h"
+#include "lastfmmanager.h"
+#include "mocklastfmserver.h"
+#include "ratelimiter.h"
+#include "responsecache.h"
+#include "scrobbledata.h"
+#include "weekgrid.h"
+
+class TestLastFmManager : public QObject {
+  Q_OBJECT
+
+private:
+  QString testUser = "testuser";
+
+  void configure(LastFmManager &lastFm, const MockLastFmServer &server);
+
+private slots:
+  void testRateLimiter();
+  void testResponseCache();
+  void testHistoryVerifier();
+  void testPagesInOrderUnderJitter();
+  void testTransferStatsCountWireBytes_data();
+  void testTransferStatsCountWireBytes();
+  void testPagesInOrderWithSeveralParsers();
+  void testImportWindowGrid();
+  void testWindowedImportResumes();
+  void testImportReadsOldCachedWindows();
+};
+
+void TestLastFmManager::configure(LastFmManager &lastFm,
+                                  const MockLastFmServer &server) {
+  lastFm.setup("testkey", testUser);
+  lastFm.setApiBaseUrl(server.baseUrl());
+  lastFm.setRequestsPerSecond(1000.0);
+  lastFm.setMaxPagesInFlight(4);
+}
+
+void TestLastFmManager::testRateLimiter() {
+  RateLimiter limiter(5.0, 42);
+
+  // A full bucket allows one second's budget at once, then one request per
+  // 200 ms.
+  for (int i = 0; i < 5; ++i)
+    QCOMPARE(limiter.tryAcquire(0), qint64(0));
+  QCOMPARE(limiter.tryAcquire(0), qint64(200));
+  QCOMPARE(limiter.tryAcquire(200), qint64(0));
+
+  const qint64 backoff = limiter.recordThrottle(1000);
+  QVERIFY(backoff >= RateLimiter::BASE_BACKOFF_MS / 2);
+  QVERIFY(backoff <= RateLimiter::BASE_BACKOFF_MS);
+  QCOMPARE(limiter.backoffLevel(), 1);
+  QCOMPARE(limiter.currentRate(), 2.5);
+  QCOMPARE(limiter.tryAcquire(1000), backoff);
+
+  // Replies to requests sent before the backoff do not escalate it.
+  QCOMPARE(limiter.recordThrottle(1001), backoff - 1);
+  QCOMPARE(limiter.backoffLevel(), 1);
+  QCOMPARE(limiter.tryAcquire(1000 + backoff), qint64(0));
+
+  for (int i = 0; i < RateLimiter::RECOVERY_SUCCESSES; ++i)
+    limiter.recordSuccess();
+  QCOMPARE(limiter.backoffLevel(), 0);
+  QCOMPARE(limiter.currentRate(), 3.125);
+
+  QVERIFY(RateLimiter::isThrottleResponse(429, 0));
+  QVERIFY(RateLimiter::isThrottleResponse(503, 0));
+  QVERIFY(RateLimiter::isThrottleResponse(0, 29));
+  QVERIFY(!RateLimiter::isThrottleResponse(404, 0));
+  QVERIFY(!RateLimiter::isThrottleResponse(0, 6));
+}
+
+void TestLastFmManager::testResponseCache() {
+  QTemporaryDir cacheDir;
+  QVERIFY(cacheDir.isValid());
+  auto key = [](int page) {
+    return ResponseCache::keyFor("testuser", 0, 0, page, 200);
+  };
+  QCOMPARE(ResponseCache::keyFor("TestUser", 0, 0, 1, 200), key(1));
+  QVERIFY(ResponseCache::keyFor("testuser", 1700000000, 0, 1, 200) != key(1));
+  QVERIFY(ResponseCache::keyFor("testuser", 0, 1700000000, 1, 200) != key(1));
+  QVERIFY(key(2) != key(1));
+
+  const QByteArray body(1000, 'x');
+  const qint64 entryBytes = ResponseCache::HEADER_SIZE + body.size();
+  QByteArray read;
+  QString error;
+  {
+    ResponseCache cache(cacheDir.path(), 3 * entryBytes);
+    QVERIFY(!cache.lookup(key(1), read));
+    for (int page = 1; page <= 3; ++page) {
+      QVERIFY2(cache.store(key(page), body, error), qPrintable(error));
+      QTest::qWait(5);
+    }
+    QVERIFY(cache.lookup(key(1), read));
+    QCOMPARE(read, body);
+    QTest::qWait(5);
+
+    // Over the cap, least recently used entries go until 90% of it is left:
+    // pages 2 and 3, but not page 1, which was just read.
+    QVERIFY2(cache.store(key(4), body, error), qPrintable(error));
+    QCOMPARE(cache.totalBytes(), 2 * entryBytes);
+    QVERIFY(!cache.lookup(key(2), read));
+    QVERIFY(!cache.lookup(key(3), read));
+  }
+
+  // A new instance rebuilds the index and LRU order from the files.
+  ResponseCache reopened(cacheDir.path(), 3 * entryBytes);
+  QCOMPARE(reopened.keys(), QStringList({key(4), key(1)}));
+  QVERIFY(reopened.lookup(key(4), read, -1));
+  QCOMPARE(read, body);
+
+  QFile corrupt(cacheDir.filePath(key(5) + ".page"));
+  QVERIFY(corrupt.open(QIODevice::WriteOnly));
+  corrupt.write("not an entry");
+  corrupt.close();
+  ResponseCache withCorrupt(cacheDir.path());
+  QVERIFY(!withCorrupt.lookup(key(5), read));
+  QVERIFY(!corrupt.exists());
+}
+
+void TestLastFmManager::testHistoryVerifier() {
+  // Last.fm holds 100 scrobbles in each of 52 weeks. Week 20 is missing
+  // locally and week 30 holds only 60.
+  const qint64 firstWeek = 1704067200; // Monday 2024-01-01
+  const qint64 week = HistoryVerifier::WEEK_SECS;
+  QList<qint64> remote;
+  QMap<qint64, int> local;
+  for (int w = 0; w < 52; ++w) {
+    for (int i = 0; i < 100; ++i)
+      remote.append(firstWeek + w * week + i * 600);
+    if (w != 20)
+      local.insert(firstWeek + w * week, w == 30 ? 60 : 100);
+  }
+  auto remoteCount = [&](qint64 fromUts, qint64 toUts) {
+    return int(std::count_if(remote.cbegin(), remote.cend(), [&](qint64 uts) {
+      return uts >= fromUts && uts < toUts;
+    }));
+  };
+
+  HistoryVerifier verifier(local, remote.last() + 1, 200);
+  QCOMPARE(verifier.localCount(0, remote.last() + 1), qint64(5040));
+  QList<HistoryVerifier::Request> fetches;
+  while (verifier.hasRequest()) {
+    const HistoryVerifier::Request request = verifier.takeRequest();
+    QVERIFY(request.fromUts < request.toUts);
+    const int total = remoteCount(request.fromUts, request.toUts);
+    if (request.kind == HistoryVerifier::Kind::Count) {
+      verifier.handleCount(request, total);
+    } else {
+      fetches.append(request);
+      verifier.handlePage(request, (total + 199) / 200);
+    }
+  }
+
+  const HistoryVerifier::Summary summary = verifier.summary();
+  QCOMPARE(summary.missingScrobbles, qint64(140));
+  QCOMPARE(summary.extraScrobbles, qint64(0));
+  QCOMPARE(summary.gapWindows, 2);
+  QCOMPARE(summary.pagesFetched, 2);
+  // Bisection needs fewer requests than counting every week.
+  QVERIFY(summary.countRequests < 52);
+  for (int w : {20, 30}) {
+    const qint64 uts = firstWeek + w * week;
+    QVERIFY(std::any_of(fetches.cbegin(), fetches.cend(), [&](const auto &f) {
+      return f.fromUts <= uts && uts + week <= f.toUts;
+    }));
+  }
+  for (const HistoryVerifier::Request &fetch : fetches) {
+    QCOMPARE((fetch.fromUts - firstWeek) % week, qint64(0));
+    QVERIFY(fetch.toUts - fetch.fromUts <= 2 * week);
+  }
+
+  // Scrobbles deleted on Last.fm are reported, not fetched.
+  HistoryVerifier extra({{firstWeek, 5}}, firstWeek + 3600);
+  extra.handleCount(extra.takeRequest(), 3);
+  QVERIFY(!extra.hasRequest());
+  QCOMPARE(extra.summary().extraScrobbles, qint64(2));
+}
+
+void TestLastFmManager::testPagesInOrderUnderJitter() {
+  // The newest track lies just before the fetch starts; the tracks added
+  // once the first page is in all lie after the pinned end.
+  const qint64 spacing = 3600;
+  const int tracks = 3000;
+  MockLastFmServer server;
+  server.setTrackCount(tracks);
+  server.setTrackSpacingSecs(spacing);
+  server.setNewestTimestamp(QDateTime::currentSecsSinceEpoch() - 60);
+  server.setLatencyMs(5);
+  server.setLatencyJitterMs(40);
+  QVERIFY(server.listen());
+  const qint64 newestAtStart = server.newestTimestamp();
+
+  LastFmManager lastFm;
+  configure(lastFm, server);
+  lastFm.setPageLimit(100);
+
+  QList<int> sentPages;
+  connect(&server, &MockLastFmServer::responseSent, this,
+          [&](int page) { sentPages.append(page); });
+  QList<int> emittedPages;
+  QSet<qint64> timestamps;
+  int scrobbles = 0;
+  connect(&lastFm, &LastFmManager::pageReadyForSaving, this,
+          [&](int pageNumber, const QString &,
+              const QList<ScrobbleData> &page) {
+            if (emittedPages.isEmpty()) {
+              server.setTrackCount(tracks + 50);
+              server.setNewestTimestamp(newestAtStart + 50 * spacing);
+            }
+            emittedPages.append(pageNumber);
+            scrobbles += int(page.size());
+            for (const ScrobbleData &scrobble : page)
+              timestamps.insert(scrobble.uts);
+          });
+  bool fetchDone = false;
+  QString error;
+  connect(&lastFm, &LastFmManager::fetchFinished, this,
+          [&]() { fetchDone = true; });
+  connect(&lastFm, &LastFmManager::fetchError, this,
+          [&](const QString &message) { error = message; });
+
+  lastFm.startInitialOrResumeFetch(1, 0);
+  QTRY_VERIFY_WITH_TIMEOUT(fetchDone, 60000);
+  QVERIFY2(error.isEmpty(), qPrintable(error));
+
+  const int pages = tracks / 100;
+  QList<int> expectedPages;
+  for (int page = 1; page <= pages; ++page)
+    expectedPages.append(page);
+  QCOMPARE(emittedPages, expectedPages);
+  QCOMPARE(scrobbles, tracks);
+  QCOMPARE(int(timestamps.size()), tracks);
+  QCOMPARE(*std::max_element(timestamps.begin(), timestamps.end()),
+           newestAtStart);
+  QVERIFY(lastFm.fetchEndTimestamp() > newestAtStart);
+  QVERIFY(lastFm.fetchEndTimestamp() <= newestAtStart + spacing);
+
+  // The jitter must have let some answers overtake earlier pages, or the
+  // reorder buffer was never exercised.
+  QVERIFY(!std::is_sorted(sentPages.begin(), sentPages.end()));
+}
+
+void TestLastFmManager::testTransferStatsCountWireBytes_data() {
+  using Compression = MockLastFmServer::Compression;
+  QTest::addColumn<int>("compression");
+  QTest::newRow("gzip") << int(Compression::Gzip);
+  QTest::newRow("deflate") << int(Compression::Deflate);
+  QTest::newRow("raw deflate") << int(Compression::RawDeflate);
+  QTest::newRow("identity") << int(Compression::None);
+}
+
+void TestLastFmManager::testTransferStatsCountWireBytes() {
+  QFETCH(int, compression);
+  const bool compressed =
+      compression != int(MockLastFmServer::Compression::None);
+  MockLastFmServer server;
+  server.setTrackCount(1000);
+  server.setCompression(MockLastFmServer::Compression(compression));
+  QVERIFY(server.listen());
+
+  LastFmManager lastFm;
+  configure(lastFm, server);
+  int scrobbles = 0;
+  connect(&lastFm, &LastFmManager::pageReadyForSaving, this,
+          [&](int, const QString &, const QList<ScrobbleData> &page) {
+            scrobbles += int(page.size());
+          });
+  bool fetchDone = false;
+  QString error;
+  connect(&lastFm, &LastFmManager::fetchFinished, this,
+          [&]() { fetchDone = true; });
+  connect(&lastFm, &LastFmManager::fetchError, this,
+          [&](const QString &message) { error = message; });
+
+  lastFm.startInitialOrResumeFetch(1, 0);
+  QTRY_VERIFY_WITH_TIMEOUT(fetchDone, 30000);
+  QVERIFY2(error.isEmpty(), qPrintable(error));
+  QCOMPARE(scrobbles, 1000);
+
+  // The worker inflates the bodies itself, after counting them as sent.
+  const LastFmManager::TransferStats transfer = lastFm.transferStats();
+  QCOMPARE(transfer.responses, server.requestCount());
+  QCOMPARE(transfer.wireBytes, server.bodyBytesSent());
+  if (compressed)
+    QVERIFY(transfer.wireBytes < transfer.decodedBytes);
+  else
+    QCOMPARE(transfer.wireBytes, transfer.decodedBytes);
+}
+
+void TestLastFmManager::testPagesInOrderWithSeveralParsers() {
+  // Large pages (beyond Last.fm's limit of 200, which the mock server does
+  // not enforce) keep the parsers busy long enough for their queues to
+  // overlap.
+  const int tracks = 20000;
+  const int pageLimit = 1000;
+  MockLastFmServer server;
+  server.setTrackCount(tracks);
+  server.setLatencyMs(1);
+  server.setLatencyJitterMs(10);
+  QVERIFY(server.listen());
+
+  LastFmManager lastFm;
+  configure(lastFm, server);
+  lastFm.setPageLimit(pageLimit);
+  lastFm.setMaxPagesInFlight(8);
+  lastFm.setParserThreads(4);
+  if (lastFm.parserThreads() < 2)
+    QSKIP("The parser pool has a single thread on this machine.");
+
+  QList<int> emittedPages;
+  QList<QList<ScrobbleData>> pages;
+  connect(&lastFm, &LastFmManager::pageReadyForSaving, this,
+          [&](int pageNumber, const QString &,
+              const QList<ScrobbleData> &page) {
+            emittedPages.append(pageNumber);
+            pages.append(page);
+          });
+  bool fetchDone = false;
+  QString error;
+  connect(&lastFm, &LastFmManager::fetchFinished, this,
+          [&]() { fetchDone = true; });
+  connect(&lastFm, &LastFmManager::fetchError, this,
+          [&](const QString &message) { error = message; });
+
+  lastFm.startInitialOrResumeFetch(1, 0);
+  QTRY_VERIFY_WITH_TIMEOUT(fetchDone, 60000);
+  QVERIFY2(error.isEmpty(), qPrintable(error));
+  QCOMPARE(lastFm.pagesAwaitingOrder(), 0);
+
+  QList<int> expectedPages;
+  for (int page = 1; page <= tracks / pageLimit; ++page)
+    expectedPages.append(page);
+  QCOMPARE(emittedPages, expectedPages);
+
+  // Each page is full and strictly older than the page before it.
+  QSet<qint64> timestamps;
+  qint64 previousUts = server.newestTimestamp() + 1;
+  for (const QList<ScrobbleData> &page : std::as_const(pages)) {
+    QCOMPARE(int(page.size()), pageLimit);
+    for (const ScrobbleData &scrobble : page) {
+      QVERIFY(scrobble.uts < previousUts);
+      previousUts = scrobble.uts;
+      timestamps.insert(scrobble.uts);
+    }
+  }
+  QCOMPARE(int(timestamps.size()), tracks);
+}
+
+void TestLastFmManager::testImportWindowGrid() {
+  // Monday 1970-01-05 00:00 UTC.
+  const qint64 origin = 4 * 24 * 60 * 60;
+  const qint64 window = LastFmManager::IMPORT_WINDOW_SECS;
+  QCOMPARE(window, qint64(28 * 24 * 60 * 60));
+  QCOMPARE(WeekGrid::ORIGIN_UTS, origin);
+
+  // Week starts, on the same grid as the import windows.
+  const qint64 week = WeekGrid::WEEK_SECS;
+  QCOMPARE(WeekGrid::weekStart(origin), origin);
+  QCOMPARE(WeekGrid::weekStart(origin + week - 1), origin);
+  QCOMPARE(WeekGrid::weekStart(origin - 1), origin - week);
+  QCOMPARE(WeekGrid::weekStart(0), origin - week); // Monday 1969-12-29
+  QCOMPARE(WeekGrid::weekStart(1704067200 + 3600), qint64(1704067200));
+
+  QCOMPARE(LastFmManager::importWindowIndex(origin), 0);
+  QCOMPARE(LastFmManager::importWindowIndex(origin - 1), -1);
+  QCOMPARE(LastFmManager::importWindowIndex(0), -1);
+  QCOMPARE(LastFmManager::importWindowIndex(origin - window), -1);
+  QCOMPARE(LastFmManager::importWindowIndex(origin - window - 1), -2);
+  QCOMPARE(LastFmManager::importWindowIndex(origin + window - 1), 0);
+  QCOMPARE(LastFmManager::importWindowIndex(origin + window), 1);
+
+  for (int index : {-2, -1, 0, 1, 700}) {
+    const qint64 start = LastFmManager::importWindowStart(index);
+    QCOMPARE(LastFmManager::importWindowIndex(start), index);
+    QCOMPARE(LastFmManager::importWindowIndex(start - 1), index - 1);
+    QCOMPARE(LastFmManager::importWindowStart(index + 1) - start, window);
+  }
+  QCOMPARE(LastFmManager::importWindowStart(0), origin);
+
+  QCOMPARE(LastFmManager::importWindowCount(origin, origin), 0);
+  QCOMPARE(LastFmManager::importWindowCount(origin, origin - 1), 0);
+  QCOMPARE(LastFmManager::importWindowCount(origin, origin + 1), 1);
+  QCOMPARE(LastFmManager::importWindowCount(origin, origin + window), 1);
+  QCOMPARE(LastFmManager::importWindowCount(origin, origin + window + 1), 2);
+  QCOMPARE(LastFmManager::importWindowCount(origin - 1, origin + 1), 2);
+  QCOMPARE(LastFmManager::importWindowCount(origin - 1, origin), 1);
+  QCOMPARE(LastFmManager::importWindowCount(0, origin + 3 * window), 4);
+}
+
+void TestLastFmManager::testWindowedImportResumes() {
+  // One scrobble a day and ten per page: a window has three pages.
+  const int tracks = 1200;
+  MockLastFmServer server;
+  server.setTrackCount(tracks);
+  server.setTrackSpacingSecs(24 * 60 * 60);
+  server.setNewestTimestamp(QDateTime::currentSecsSinceEpoch() - 3600);
+  server.setLatencyMs(5);
+  server.setLatencyJitterMs(20);
+  QVERIFY(server.listen());
+
+  // Stands in for the database: windows are stored as they are emitted,
+  // until the first import is interrupted.
+  QMutex storeMutex;
+  QMap<int, QList<ScrobbleData>> stored;
+  int duplicateWindows = 0;
+  std::atomic<bool> accepting{true};
+  const int interruptAfter = 5;
+  auto store = [&](int windowIndex, const QString &username,
+                   const QList<ScrobbleData> &scrobbles) {
+    QMutexLocker locker(&storeMutex);
+    if (!accepting || username != testUser)
+      return;
+    if (stored.contains(windowIndex))
+      ++duplicateWindows;
+    stored.insert(windowIndex, scrobbles);
+    if (stored.size() == interruptAfter)
+      accepting = false;
+  };
+
+  qint64 startUts = 0;
+  qint64 endUts = 0;
+  {
+    auto lastFm = std::make_unique<LastFmManager>();
+    configure(*lastFm, server);
+    lastFm->setPageLimit(10);
+    connect(lastFm.get(), &LastFmManager::importWindowReady, this, store,
+            Qt::DirectConnection);
+    connect(lastFm.get(), &LastFmManager::importRangeDetermined, this,
+            [&](qint64 start, qint64 end) {
+              startUts = start;
+              endUts = end;
+            });
+    lastFm->startWindowedImport(0, 0, {});
+    QTRY_VERIFY_WITH_TIMEOUT(!accepting, 30000);
+  }
+  QVERIFY(startUts > 0);
+  QVERIFY(endUts > server.newestTimestamp());
+  const int windows = LastFmManager::importWindowCount(startUts, endUts);
+  QVERIFY(windows > 2 * interruptAfter);
+
+  QSet<int> completedWindows;
+  {
+    QMutexLocker locker(&storeMutex);
+    QCOMPARE(int(stored.size()), interruptAfter);
+    for (auto it = stored.cbegin(); it != stored.cend(); ++it)
+      completedWindows.insert(it.key());
+    accepting = true;
+  }
+
+  LastFmManager lastFm;
+  configure(lastFm, server);
+  lastFm.setPageLimit(10);
+  connect(&lastFm, &LastFmManager::importWindowReady, this, store,
+          Qt::DirectConnection);
+  const int requestsBefore = server.requestCount();
+  bool probed = false;
+  connect(&lastFm, &LastFmManager::importRangeDetermined, this,
+          [&](qint64 start, qint64 end) {
+            probed = start != startUts || end != endUts;
+          });
+  bool fetchDone = false;
+  QString error;
+  connect(&lastFm, &LastFmManager::fetchFinished, this,
+          [&]() { fetchDone = true; });
+  connect(&lastFm, &LastFmManager::fetchError, this,
+          [&](const QString &message) { error = message; });
+  lastFm.startWindowedImport(startUts, endUts, completedWindows);
+  QTRY_VERIFY_WITH_TIMEOUT(fetchDone, 30000);
+  QVERIFY2(error.isEmpty(), qPrintable(error));
+  QVERIFY(!probed);
+
+  // Every window stored once, and the resumed import only fetched the
+  // windows that were missing: three pages each.
+  QMutexLocker locker(&storeMutex);
+  QCOMPARE(duplicateWindows, 0);
+  QCOMPARE(int(stored.size()), windows);
+  QCOMPARE(stored.firstKey(), LastFmManager::importWindowIndex(startUts));
+  QCOMPARE(stored.lastKey(), LastFmManager::importWindowIndex(endUts - 1));
+  QVERIFY(server.requestCount() - requestsBefore <=
+          3 * (windows - interruptAfter));
+
+  QSet<qint64> timestamps;
+  int scrobbles = 0;
+  for (auto it = stored.cbegin(); it != stored.cend(); ++it) {
+    for (const ScrobbleData &scrobble : it.value()) {
+      QCOMPARE(LastFmManager::importWindowIndex(scrobble.uts), it.key());
+      timestamps.insert(scrobble.uts);
+      ++scrobbles;
+    }
+  }
+  QCOMPARE(scrobbles, tracks);
+  QCOMPARE(int(timestamps.size()), tracks);
+}
+
+void TestLastFmManager::testImportReadsOldCachedWindows() {
+  QTemporaryDir cacheDir;
+  QVERIFY(cacheDir.isValid());
+  MockLastFmServer server;
+  server.setTrackCount(300);
+  server.setTrackSpacingSecs(24 * 60 * 60);
+  QVERIFY(server.listen());
+
+  // Runs an import of a fixed range and returns the scrobbles it emitted.
+  qint64 startUts = 0;
+  qint64 endUts = 0;
+  auto import = [&]() {
+    LastFmManager lastFm;
+    configure(lastFm, server);
+    lastFm.setPageLimit(10);
+    lastFm.setResponseCache(cacheDir.path());
+    int scrobbles = 0;
+    connect(&lastFm, &LastFmManager::importWindowReady, this,
+            [&](int, const QString &, const QList<ScrobbleData> &window) {
+              scrobbles += int(window.size());
+            });
+    connect(&lastFm, &LastFmManager::importRangeDetermined, this,
+            [&](qint64 start, qint64 end) {
+              startUts = start;
+              endUts = end;
+            });
+    bool fetchDone = false;
+    connect(&lastFm, &LastFmManager::fetchFinished, this,
+            [&]() { fetchDone = true; });
+    lastFm.startWindowedImport(startUts, endUts, {});
+    if (!QTest::qWaitFor([&]() { return fetchDone; }, 30000))
+      return -1;
+    return scrobbles;
+  };
+
+  QCOMPARE(import(), 300);
+  const int requests = server.requestCount();
+
+  // Age every entry well past ResponseCache::DEFAULT_MAX_AGE_SECS.
+  const qint64 storedAt = QDateTime::currentSecsSinceEpoch() - 7 * 24 * 3600;
+  const QStringList entries =
+      QDir(cacheDir.path()).entryList({"*.page"}, QDir::Files);
+  QVERIFY(!entries.isEmpty());
+  for (const QString &entry : entries) {
+    QFile file(QDir(cacheDir.path()).filePath(entry));
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    char bytes[8];
+    qToLittleEndian<qint64>(storedAt, bytes);
+    QVERIFY(file.seek(8));
+    QCOMPARE(file.write(bytes, 8), qint64(8));
+  }
+
+  // The windows of a fixed range are read back however old, without a
+  // single request.
+  QCOMPARE(import(), 300);
+  QCOMPARE(server.requestCount(), requests);
+}
+
+QTEST_MAIN(TestLastFmManager)
+
+#include "testlastfmmanager.moc"
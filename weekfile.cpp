@@ -0,0 +1,173 @@
+/**
+ * @file weekfile.cpp
+ * @brief Implementation of the WeekFile binary format helpers.
+ */
+
+#include "weekfile.h"
+#include "scrobblekeyset.h"
+#include "stringdictionary.h"
+#include "stringinterner.h"
+#include <QFile>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace {
+const char WEEK_FILE_MAGIC[4] = {'L', 'F', 'M', 'W'};
+
+/**
+ * @brief Returns the index of the first row whose uts is >= value.
+ * @param utsColumn Pointer to the little endian uts column.
+ * @param rowCount Number of rows in the column.
+ * @param value The timestamp to search for.
+ */
+quint32 lowerBoundUts(const char *utsColumn, quint32 rowCount, qint64 value) {
+  quint32 low = 0;
+  quint32 high = rowCount;
+  while (low < high) {
+    quint32 mid = low + (high - low) / 2;
+    if (qFromLittleEndian<qint64>(utsColumn + mid * 8) < value)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return low;
+}
+} // namespace
+
+QByteArray WeekFile::encode(qint64 weekStartUts,
+                            const QList<ScrobbleData> &sortedScrobbles,
+                            StringDictionary &dictionary) {
+  const quint32 rowCount = sortedScrobbles.size();
+  QByteArray data(HEADER_SIZE + qint64(rowCount) * ROW_SIZE, '\0');
+  char *ptr = data.data();
+
+  memcpy(ptr, WEEK_FILE_MAGIC, 4);
+  qToLittleEndian<quint16>(FORMAT_VERSION, ptr + 4);
+  qToLittleEndian<quint16>(HEADER_SIZE, ptr + 6);
+  qToLittleEndian<quint32>(rowCount, ptr + 8);
+  qToLittleEndian<qint64>(weekStartUts, ptr + 16);
+
+  char *utsColumn = ptr + HEADER_SIZE;
+  char *artistColumn = utsColumn + qint64(rowCount) * 8;
+  char *trackColumn = artistColumn + qint64(rowCount) * 4;
+  char *albumColumn = trackColumn + qint64(rowCount) * 4;
+  for (quint32 i = 0; i < rowCount; ++i) {
+    const ScrobbleData &s = sortedScrobbles.at(i);
+    qToLittleEndian<qint64>(s.uts, utsColumn + i * 8);
+    qToLittleEndian<quint32>(dictionary.internGlobal(s.artistId),
+                             artistColumn + i * 4);
+    qToLittleEndian<quint32>(dictionary.internGlobal(s.trackId),
+                             trackColumn + i * 4);
+    qToLittleEndian<quint32>(dictionary.internGlobal(s.albumId),
+                             albumColumn + i * 4);
+  }
+  return data;
+}
+
+qsizetype WeekFile::mergeRows(const QList<ScrobbleData> &existing,
+                              const QList<ScrobbleData> &incoming,
+                              QList<ScrobbleData> &merged) {
+  ScrobbleKeySet keys(existing.size() + incoming.size());
+  for (const ScrobbleData &s : existing)
+    keys.insert(s);
+  QList<ScrobbleData> added;
+  added.reserve(incoming.size());
+  for (const ScrobbleData &s : incoming) {
+    if (keys.insert(s))
+      added.append(s);
+  }
+
+  auto newerFirst = [](const ScrobbleData &a, const ScrobbleData &b) {
+    return b < a;
+  };
+  if (std::is_sorted(added.cbegin(), added.cend(), newerFirst))
+    std::reverse(added.begin(), added.end());
+  else if (!std::is_sorted(added.cbegin(), added.cend()))
+    std::sort(added.begin(), added.end());
+
+  merged.clear();
+  merged.reserve(existing.size() + added.size());
+  std::merge(existing.cbegin(), existing.cend(), added.cbegin(),
+             added.cend(), std::back_inserter(merged));
+  return added.size();
+}
+
+bool WeekFile::readHeader(const char *data, qint64 size, quint32 &rowCount,
+                          qint64 &weekStartUts) {
+  if (size < HEADER_SIZE || memcmp(data, WEEK_FILE_MAGIC, 4) != 0)
+    return false;
+  quint16 version = qFromLittleEndian<quint16>(data + 4);
+  quint16 headerSize = qFromLittleEndian<quint16>(data + 6);
+  if (version == 0 || version > FORMAT_VERSION || headerSize != HEADER_SIZE)
+    return false;
+  rowCount = qFromLittleEndian<quint32>(data + 8);
+  weekStartUts = qFromLittleEndian<qint64>(data + 16);
+  return size == HEADER_SIZE + qint64(rowCount) * ROW_SIZE;
+}
+
+WeekFile::DecodeResult WeekFile::decode(const QByteArray &data,
+                                        const StringDictionary &dictionary,
+                                        qint64 fromUts, qint64 toUts,
+                                        QList<ScrobbleData> &out) {
+  quint32 rowCount = 0;
+  qint64 weekStartUts = 0;
+  if (!readHeader(data.constData(), data.size(), rowCount, weekStartUts))
+    return DecodeResult::Corrupt;
+
+  const char *utsColumn = data.constData() + HEADER_SIZE;
+  const char *artistColumn = utsColumn + qint64(rowCount) * 8;
+  const char *trackColumn = artistColumn + qint64(rowCount) * 4;
+  const char *albumColumn = trackColumn + qint64(rowCount) * 4;
+
+  const quint32 first = lowerBoundUts(utsColumn, rowCount, fromUts);
+  const quint32 last = lowerBoundUts(utsColumn, rowCount, toUts);
+  if (first >= last)
+    return DecodeResult::Ok;
+
+  const quint32 knownIds = dictionary.size();
+  for (quint32 i = first; i < last; ++i) {
+    if (qFromLittleEndian<quint32>(artistColumn + i * 4) >= knownIds ||
+        qFromLittleEndian<quint32>(trackColumn + i * 4) >= knownIds ||
+        qFromLittleEndian<quint32>(albumColumn + i * 4) >= knownIds)
+      return DecodeResult::UnknownStringId;
+  }
+
+  StringInterner &interner = StringInterner::instance();
+  out.reserve(out.size() + (last - first));
+  for (quint32 i = first; i < last; ++i) {
+    qint64 uts = qFromLittleEndian<qint64>(utsColumn + i * 8);
+    if (uts <= 0)
+      continue;
+    const quint32 artist = qFromLittleEndian<quint32>(artistColumn + i * 4);
+    const quint32 track = qFromLittleEndian<quint32>(trackColumn + i * 4);
+    const quint32 album = qFromLittleEndian<quint32>(albumColumn + i * 4);
+    ScrobbleData s;
+    s.uts = uts;
+    s.artistId = dictionary.globalId(artist);
+    s.trackId = dictionary.globalId(track);
+    s.albumId = dictionary.globalId(album);
+    s.trackKeyId = interner.internPair(s.artistId, s.trackId);
+    out.append(s);
+  }
+  return DecodeResult::Ok;
+}
+
+qint64 WeekFile::readLastTimestamp(const QString &filePath) {
+  QFile file(filePath);
+  if (!file.open(QIODevice::ReadOnly))
+    return 0;
+  QByteArray header = file.read(HEADER_SIZE);
+  quint32 rowCount = 0;
+  qint64 weekStartUts = 0;
+  if (!readHeader(header.constData(), file.size(), rowCount, weekStartUts) ||
+      rowCount == 0)
+    return 0;
+  if (!file.seek(HEADER_SIZE + qint64(rowCount - 1) * 8))
+    return 0;
+  QByteArray lastUts = file.read(8);
+  if (lastUts.size() != 8)
+    return 0;
+  return qFromLittleEndian<qint64>(lastUts.constData());
+}
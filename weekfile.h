@@ -0,0 +1,117 @@
+#ifndef WEEKFILE_H
+#define WEEKFILE_H
+
+#include "scrobbledata.h"
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+class StringDictionary;
+
+/**
+ * @class WeekFile
+ * @brief Encoder/decoder for the versioned binary columnar week-file format.
+ * @details A week file holds all scrobbles of one UTC week, sorted by
+ * timestamp. Layout (all integers little endian):
+ *  - 24 byte header: magic "LFMW", quint16 version, quint16 header size,
+ *    quint32 row count, quint32 reserved, qint64 week start (UTC seconds).
+ *  - qint64 uts column (row count entries, ascending).
+ *  - quint32 artist, track and album columns, each holding IDs into the
+ *    user's StringDictionary.
+ *
+ * The fixed row width means the file size alone determines the row count and
+ * any row's timestamp can be read without touching the rest of the file.
+ */
+class WeekFile {
+public:
+  /** @brief Current on-disk format version written by encode(). */
+  static constexpr quint16 FORMAT_VERSION = 1;
+  /** @brief Size of the fixed file header in bytes. */
+  static constexpr int HEADER_SIZE = 24;
+  /** @brief Bytes used per row across all columns. */
+  static constexpr int ROW_SIZE = 8 + 3 * 4;
+
+  /**
+   * @enum DecodeResult
+   * @brief Outcome of decoding a week file.
+   */
+  enum class DecodeResult {
+    Ok,             /**< @brief The file was decoded successfully. */
+    Corrupt,        /**< @brief Header or size mismatch; file is unusable. */
+    UnknownStringId /**< @brief A column references an ID beyond the
+                       dictionary (dictionary may need a refresh). */
+  };
+
+  /**
+   * @brief Returns the filename suffix used by binary week files.
+   * @return The suffix, including the leading dot (".week").
+   */
+  static QString fileSuffix() { return QStringLiteral(".week"); }
+
+  /**
+   * @brief Serializes a week's scrobbles into the binary format.
+   * @details New strings are interned into @p dictionary; the caller must
+   * flush the dictionary before committing the returned bytes to disk.
+   * @param weekStartUts The UTC start of the week (seconds since epoch).
+   * @param sortedScrobbles Scrobbles of that week, sorted by timestamp.
+   * @param dictionary The user's string dictionary.
+   * @return The encoded file content.
+   */
+  static QByteArray encode(qint64 weekStartUts,
+                           const QList<ScrobbleData> &sortedScrobbles,
+                           StringDictionary &dictionary);
+
+  /**
+   * @brief Decodes the rows of a week file whose timestamp lies in
+   * [fromUts, toUts).
+   * @details The uts column is binary searched, so only rows inside the range
+   * are materialized.
+   * @param data The raw file content.
+   * @param dictionary The user's string dictionary.
+   * @param fromUts Start of the range (inclusive).
+   * @param toUts End of the range (exclusive).
+   * @param[out] out Decoded scrobbles are appended here.
+   * @return The decode result. On failure nothing is appended to @p out.
+   */
+  static DecodeResult decode(const QByteArray &data,
+                             const StringDictionary &dictionary, qint64 fromUts,
+                             qint64 toUts, QList<ScrobbleData> &out);
+
+  /**
+   * @brief Merges new scrobbles into the sorted rows of a week.
+   * @details Duplicates are recognised by (uts, artist, track) with a
+   * ScrobbleKeySet, so distinct scrobbles within the same second are both
+   * kept. New rows already in ascending or descending order (API pages list
+   * the newest scrobble first) are merged linearly; only unordered input is
+   * sorted first.
+   * @param existing The week's current rows, sorted by timestamp.
+   * @param incoming New scrobbles in any order. Invalid rows are skipped.
+   * @param[out] merged Receives the sorted union; existing rows come first
+   * among rows with the same timestamp.
+   * @return The number of rows added.
+   */
+  static qsizetype mergeRows(const QList<ScrobbleData> &existing,
+                             const QList<ScrobbleData> &incoming,
+                             QList<ScrobbleData> &merged);
+
+  /**
+   * @brief Validates a week file header.
+   * @param data Pointer to the start of the file content.
+   * @param size Total size of the file content in bytes.
+   * @param[out] rowCount Receives the number of rows.
+   * @param[out] weekStartUts Receives the week start stored in the header.
+   * @return True if the header is valid and the size matches the row count.
+   */
+  static bool readHeader(const char *data, qint64 size, quint32 &rowCount,
+                         qint64 &weekStartUts);
+
+  /**
+   * @brief Reads the timestamp of the last row of a week file.
+   * @details Only the header and the final uts entry are read from disk.
+   * @param filePath Path of the week file.
+   * @return The last uts, or 0 if the file is empty, missing or corrupt.
+   */
+  static qint64 readLastTimestamp(const QString &filePath);
+};
+
+#endif // WEEKFILE_H
@@ -0,0 +1,42 @@
+#ifndef WEEKGRID_H
+#define WEEKGRID_H
+
+#include <QtGlobal>
+
+/**
+ * @class WeekGrid
+ * @brief The grid of UTC weeks that week files, history verification and
+ * import windows are aligned to.
+ * @details Weeks start on Monday 00:00 UTC. The grid is anchored at
+ * ORIGIN_UTS, the first week start after the epoch; cells spanning several
+ * weeks count from the same origin, so their boundaries are week boundaries
+ * too. Times before the origin fall into negative cells.
+ */
+class WeekGrid {
+public:
+  /** @brief Length of a week in seconds. */
+  static constexpr qint64 WEEK_SECS = 7 * 24 * 60 * 60;
+  /** @brief Monday 1970-01-05 00:00 UTC. */
+  static constexpr qint64 ORIGIN_UTS = 4 * 24 * 60 * 60;
+
+  /**
+   * @brief Returns the index of the grid cell containing a time.
+   * @param uts The time in seconds since epoch.
+   * @param cellSecs The cell length, a multiple of WEEK_SECS.
+   */
+  static constexpr qint64 cellIndex(qint64 uts, qint64 cellSecs) {
+    const qint64 offset = uts - ORIGIN_UTS;
+    // Floor division, so times before the origin round down as well.
+    return offset / cellSecs - (offset % cellSecs < 0 ? 1 : 0);
+  }
+  /** @brief Returns the start of a grid cell of cellSecs seconds. */
+  static constexpr qint64 cellStart(qint64 index, qint64 cellSecs) {
+    return ORIGIN_UTS + index * cellSecs;
+  }
+  /** @brief Returns the start of the week containing a time. */
+  static constexpr qint64 weekStart(qint64 uts) {
+    return cellStart(cellIndex(uts, WEEK_SECS), WEEK_SECS);
+  }
+};
+
+#endif // WEEKGRID_H
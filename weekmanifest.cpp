@@ -0,0 +1,142 @@
+/**
+ * @file weekmanifest.cpp
+ * @brief Implementation of the WeekManifest class.
+ */
+
+#include "weekmanifest.h"
+#include "weekfile.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QtEndian>
+#include <array>
+#include <cstring>
+
+namespace {
+const char MANIFEST_MAGIC[4] = {'L', 'F', 'M', 'M'};
+
+/** @brief Builds the lookup table of the reflected CRC-32 polynomial. */
+std::array<quint32, 256> makeCrcTable() {
+  std::array<quint32, 256> table{};
+  for (quint32 i = 0; i < 256; ++i) {
+    quint32 value = i;
+    for (int bit = 0; bit < 8; ++bit)
+      value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+    table[i] = value;
+  }
+  return table;
+}
+} // namespace
+
+WeekManifest::WeekManifest(const QString &filePath) : m_filePath(filePath) {}
+
+bool WeekManifest::load(QString &errorMsg) {
+  m_entries.clear();
+  QFile file(m_filePath);
+  if (!file.open(QIODevice::ReadOnly)) {
+    errorMsg = "Cannot read week manifest: " + file.errorString();
+    return false;
+  }
+  const QByteArray data = file.readAll();
+  file.close();
+
+  const char *ptr = data.constData();
+  if (data.size() < HEADER_SIZE || memcmp(ptr, MANIFEST_MAGIC, 4) != 0 ||
+      qFromLittleEndian<quint16>(ptr + 4) != FORMAT_VERSION ||
+      qFromLittleEndian<quint16>(ptr + 6) != HEADER_SIZE) {
+    errorMsg = "Unknown week manifest format.";
+    return false;
+  }
+  const quint32 count = qFromLittleEndian<quint32>(ptr + 8);
+  if (data.size() != HEADER_SIZE + qint64(count) * ENTRY_SIZE) {
+    errorMsg = "Truncated week manifest.";
+    return false;
+  }
+  for (quint32 i = 0; i < count; ++i) {
+    const char *record = ptr + HEADER_SIZE + qint64(i) * ENTRY_SIZE;
+    Entry entry;
+    entry.weekStartUts = qFromLittleEndian<qint64>(record);
+    entry.minUts = qFromLittleEndian<qint64>(record + 8);
+    entry.maxUts = qFromLittleEndian<qint64>(record + 16);
+    entry.byteSize = qFromLittleEndian<qint64>(record + 24);
+    entry.rowCount = qFromLittleEndian<quint32>(record + 32);
+    entry.checksum = qFromLittleEndian<quint32>(record + 36);
+    m_entries.insert(entry.weekStartUts, entry);
+  }
+  return true;
+}
+
+bool WeekManifest::save(QString &errorMsg) const {
+  QByteArray data(HEADER_SIZE + qint64(m_entries.size()) * ENTRY_SIZE, '\0');
+  char *ptr = data.data();
+  memcpy(ptr, MANIFEST_MAGIC, 4);
+  qToLittleEndian<quint16>(FORMAT_VERSION, ptr + 4);
+  qToLittleEndian<quint16>(HEADER_SIZE, ptr + 6);
+  qToLittleEndian<quint32>(quint32(m_entries.size()), ptr + 8);
+  char *record = ptr + HEADER_SIZE;
+  for (const Entry &entry : m_entries) {
+    qToLittleEndian<qint64>(entry.weekStartUts, record);
+    qToLittleEndian<qint64>(entry.minUts, record + 8);
+    qToLittleEndian<qint64>(entry.maxUts, record + 16);
+    qToLittleEndian<qint64>(entry.byteSize, record + 24);
+    qToLittleEndian<quint32>(entry.rowCount, record + 32);
+    qToLittleEndian<quint32>(entry.checksum, record + 36);
+    record += ENTRY_SIZE;
+  }
+
+  QSaveFile file(m_filePath);
+  if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() ||
+      !file.commit()) {
+    errorMsg = "Cannot write week manifest: " + file.errorString();
+    return false;
+  }
+  return true;
+}
+
+bool WeekManifest::describe(const QByteArray &data, Entry &entry) {
+  quint32 rowCount = 0;
+  qint64 weekStartUts = 0;
+  if (!WeekFile::readHeader(data.constData(), data.size(), rowCount,
+                            weekStartUts))
+    return false;
+  entry = Entry();
+  entry.weekStartUts = weekStartUts;
+  entry.rowCount = rowCount;
+  entry.byteSize = data.size();
+  entry.checksum = crc32(data.constData(), data.size());
+  if (rowCount > 0) {
+    const char *utsColumn = data.constData() + WeekFile::HEADER_SIZE;
+    entry.minUts = qFromLittleEndian<qint64>(utsColumn);
+    entry.maxUts =
+        qFromLittleEndian<qint64>(utsColumn + qint64(rowCount - 1) * 8);
+  }
+  return true;
+}
+
+quint32 WeekManifest::crc32(const char *data, qint64 size) {
+  static const std::array<quint32, 256> table = makeCrcTable();
+  quint32 crc = 0xFFFFFFFFu;
+  for (qint64 i = 0; i < size; ++i)
+    crc = table[(crc ^ quint8(data[i])) & 0xFF] ^ (crc >> 8);
+  return crc ^ 0xFFFFFFFFu;
+}
+
+QList<WeekManifest::Entry> WeekManifest::entriesInRange(qint64 fromUts,
+                                                        qint64 toUts) const {
+  QList<Entry> result;
+  for (const Entry &entry : m_entries) {
+    if (entry.maxUts < fromUts)
+      continue;
+    if (entry.minUts >= toUts)
+      break;
+    result.append(entry);
+  }
+  return result;
+}
+
+qint64 WeekManifest::lastTimestamp() const {
+  for (auto it = m_entries.crbegin(); it != m_entries.crend(); ++it) {
+    if (it->rowCount > 0)
+      return it->maxUts;
+  }
+  return 0;
+}
@@ -0,0 +1,120 @@
+#ifndef WEEKMANIFEST_H
+#define WEEKMANIFEST_H
+
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QString>
+
+/**
+ * @class WeekManifest
+ * @brief Per-user index of the binary week files.
+ * @details Records, for every week file, its timestamp range, row count, byte
+ * size and a CRC-32 of its content. The latest stored timestamp and the files
+ * overlapping a time range are then known without listing the user directory
+ * or opening any week file. DatabaseManager updates the manifest whenever it
+ * writes a week file and rebuilds it from the files when it is missing or
+ * found out of date. A file that cannot be decoded is recorded with no rows
+ * and the whole week as its range, so loads keep reporting it as corrupt.
+ *
+ * On disk (all integers little endian): a 12 byte header (magic "LFMM",
+ * quint16 version, quint16 header size, quint32 entry count) followed by one
+ * 40 byte record per week file, ordered by week start: qint64 week start,
+ * qint64 min uts, qint64 max uts, qint64 byte size, quint32 row count,
+ * quint32 CRC-32.
+ */
+class WeekManifest {
+public:
+  /** @brief Current on-disk format version of the manifest file. */
+  static constexpr quint16 FORMAT_VERSION = 1;
+  /** @brief Size of the manifest file header in bytes. */
+  static constexpr int HEADER_SIZE = 12;
+  /** @brief Size of one manifest record in bytes. */
+  static constexpr int ENTRY_SIZE = 4 * 8 + 2 * 4;
+
+  /**
+   * @struct Entry
+   * @brief Summary of one week file.
+   */
+  struct Entry {
+    qint64 weekStartUts = 0; /**< @brief UTC week start (file name). */
+    qint64 minUts = 0;       /**< @brief Timestamp of the first row. */
+    qint64 maxUts = 0;       /**< @brief Timestamp of the last row. */
+    qint64 byteSize = 0;     /**< @brief File size in bytes. */
+    quint32 rowCount = 0;    /**< @brief Number of rows. */
+    quint32 checksum = 0;    /**< @brief CRC-32 of the file content. */
+
+    bool operator==(const Entry &other) const {
+      return weekStartUts == other.weekStartUts && minUts == other.minUts &&
+             maxUts == other.maxUts && byteSize == other.byteSize &&
+             rowCount == other.rowCount && checksum == other.checksum;
+    }
+  };
+
+  /**
+   * @brief Constructs an empty manifest bound to the given file.
+   * @param filePath Path of the manifest file (need not exist yet).
+   */
+  explicit WeekManifest(const QString &filePath = QString());
+
+  /**
+   * @brief Loads the manifest file, replacing any in-memory entries.
+   * @param[out] errorMsg Receives a description of the problem on failure.
+   * @return False if the file is missing, unreadable or malformed.
+   */
+  bool load(QString &errorMsg);
+
+  /**
+   * @brief Atomically writes all entries to the manifest file.
+   * @param[out] errorMsg Receives a description of the problem on failure.
+   * @return True on success.
+   */
+  bool save(QString &errorMsg) const;
+
+  /**
+   * @brief Summarizes the content of a week file.
+   * @param data The raw file content.
+   * @param[out] entry Receives the summary.
+   * @return False if @p data is not a valid week file.
+   */
+  static bool describe(const QByteArray &data, Entry &entry);
+
+  /**
+   * @brief Computes the CRC-32 (IEEE 802.3) of a byte range.
+   * @param data Pointer to the bytes.
+   * @param size Number of bytes.
+   */
+  static quint32 crc32(const char *data, qint64 size);
+
+  /** @brief Adds or replaces the entry of a week. */
+  void insert(const Entry &entry) {
+    m_entries.insert(entry.weekStartUts, entry);
+  }
+  /** @brief Removes the entry of a week, if present. */
+  void remove(qint64 weekStartUts) { m_entries.remove(weekStartUts); }
+  /** @brief Removes all entries. */
+  void clear() { m_entries.clear(); }
+
+  /** @brief Returns all entries, ordered by week start. */
+  QList<Entry> entries() const { return m_entries.values(); }
+
+  /**
+   * @brief Returns the entries whose rows overlap [fromUts, toUts).
+   * @param fromUts Start of the range (inclusive).
+   * @param toUts End of the range (exclusive).
+   * @return Matching entries, ordered by week start.
+   */
+  QList<Entry> entriesInRange(qint64 fromUts, qint64 toUts) const;
+
+  /** @brief Returns the timestamp of the latest stored row, or 0 if none. */
+  qint64 lastTimestamp() const;
+
+  /** @brief Returns the path of the manifest file. */
+  QString filePath() const { return m_filePath; }
+
+private:
+  QString m_filePath; /**< @brief Path of the manifest file. */
+  QMap<qint64, Entry> m_entries; /**< @brief Entries keyed by week start. */
+};
+
+#endif // WEEKMANIFEST_H